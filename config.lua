@@ -30,9 +30,18 @@ render =
     antialias_samples = 4;                      -- Maximum depends and is limited by hardware capabilities.
     z_depth = 24;                               -- Maximum and recommended is 24.
     texture_border = 16;
+    parallel_portals = 0;                       -- Portal visibility traversal on worker threads - yes (1) or no (0)
+    room_pvs = 1;                               -- Skip portals to rooms out of precomputed visibility set - yes (1) or no (0)
+    instancing = 1;                             -- Draw repeated static meshes and sprites instanced if supported - yes (1) or no (0)
     fog_color = {r = 255, g = 255, b = 255};
 }
 
+physics =
+{
+    fixed_step = 1;                             -- Simulate with fixed 1/60 s steps and interpolate between them - yes (1) or no (0)
+    max_sub_steps = 2;                          -- Fixed steps per frame, slower frames lose simulation time
+}
+
 controls =
 {
     mouse_sensitivity = 25.0;
@@ -8,7 +8,61 @@
 -- inside entity function array (entity_funcs).
 --------------------------------------------------------------------------------
 
-entity_funcs = {};  -- Initialize entity function array.
+-- Entity function tables report onLoop changes to engine (ENTITY_CALLBACK_LOOP
+-- flag), so only entities with onLoop are passed to loopEntities each frame.
+-- Only onLoop is kept outside of the table (so each assignment goes through
+-- __newindex); all other fields stay raw, __pairs adds onLoop to traversal.
+
+function efuncs_WrapEntity(index, funcs)
+    local loop = rawget(funcs, "onLoop");
+    rawset(funcs, "onLoop", nil);
+
+    setmetatable(funcs, {
+        __index = function(t, k)
+            if(k == "onLoop") then
+                return loop;
+            end;
+        end,
+        __newindex = function(t, k, f)
+            if(k == "onLoop") then
+                setEntityCallbackFlag(index, ENTITY_CALLBACK_LOOP, (f ~= nil) and 1 or 0);
+                loop = f;
+            else
+                rawset(t, k, f);
+            end;
+        end,
+        __pairs = function(t)
+            local k, loop_done = nil, false;
+            return function()
+                if(not loop_done) then
+                    local v;
+                    k, v = next(t, k);
+                    if(k ~= nil) then
+                        return k, v;
+                    end;
+                    loop_done = true;
+                    if(loop ~= nil) then
+                        return "onLoop", loop;
+                    end;
+                end;
+                return nil;
+            end, t, nil;
+        end
+    });
+
+    if(loop ~= nil) then
+        setEntityCallbackFlag(index, ENTITY_CALLBACK_LOOP, 1);
+    end;
+end;
+
+entity_funcs = setmetatable({}, {   -- Initialize entity function array.
+    __newindex = function(t, index, funcs)
+        if(type(funcs) == "table") then
+            efuncs_WrapEntity(index, funcs);
+        end;
+        rawset(t, index, funcs);
+    end
+});
 
 -- Erase single entity function.
 
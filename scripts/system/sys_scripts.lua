@@ -50,40 +50,12 @@ function printTable(tbl)
     end;
 end;
 
--- Task manager functions
-
-engine_tasks = {};  -- task struct: {functions array}
-
-function addTask(f)
-    local i = 0;
-    while(engine_tasks[i] ~= nil) do
-        i = i + 1;  -- find first empty task index.
-    end
-    engine_tasks[i] = f;    -- put the task into free element.
-end
-
-function doTasks()
-    local i = 0;
-    while(engine_tasks[i] ~= nil) do
-        local t = engine_tasks[i]();
-        if(t == false or t == nil) then     -- remove task, if it returns nil or false.
-            local j = i;
-            while(engine_tasks[j] ~= nil) do
-                engine_tasks[j] = engine_tasks[j + 1];
-                j = j + 1;
-            end
-        end
-        i = i + 1;
-    end
-end
-
-function clearTasks()
-    local i = 0;
-    while(engine_tasks[i] ~= nil) do
-        engine_tasks[i] = nil;
-        i = i + 1;
-    end
-end
+-- Task manager functions are provided by engine:
+-- addTask(f, (delay)) - f is a function or coroutine, called each frame until it
+--     returns (yields) false / nil or finishes; returned (yielded) number puts
+--     task to sleep for that many seconds, yield without values waits for the
+--     next frame; returns task handle.
+-- removeTask(handle), clearTasks()
 
 
 -- System entity functions
@@ -124,4 +96,20 @@ function loopEntity(object_id, tick_state)
     end;
 end
 
+-- Called by engine once per frame; list is {id1, tick_state1, id2, tick_state2, ...}
+
+function loopEntities(list, count)
+    local i = 1;
+    while(i < 2 * count) do
+        local object_id = list[i];
+        if((entity_funcs[object_id] ~= nil) and (entity_funcs[object_id].onLoop ~= nil)) then
+            local ok, err = pcall(entity_funcs[object_id].onLoop, object_id, list[i + 1]);
+            if(not ok) then
+                print("onLoop(" .. object_id .. "): " .. tostring(err));
+            end;
+        end;
+        i = i + 2;
+    end;
+end
+
 print("System_scripts.lua loaded");
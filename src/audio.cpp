@@ -27,6 +27,7 @@ extern "C" {
 
 #include "core/system.h"
 #include "core/gl_text.h"
+#include "core/jobs.h"
 #include "core/console.h"
 #include "core/vmath.h"
 #include "render/camera.h"
@@ -153,6 +154,16 @@ public:
 
     bool Load(int track_index);
 
+    bool IsStreamed()                   // OGG track is not preloaded, but decoded on the fly.
+    {
+        return (file_path != NULL);
+    }
+
+    const char *GetPath()
+    {
+        return file_path;
+    }
+
     uint8_t *GetBuffer()
     {
         return buffer;
@@ -187,6 +198,7 @@ private:
     int             track_index;
     uint32_t        buffer_size;
     uint8_t        *buffer;
+    char           *file_path;           // Streamed OGG track path, NULL for preloaded tracks.
     int             stream_type;         // Either BACKGROUND, ONESHOT or CHAT.
     ALenum          format;
     ALsizei         rate;
@@ -220,12 +232,14 @@ public:
     void End();                          // End track with fade-out.
     void Stop();                         // Immediately stop track.
     bool Update();                       // Update track and manage streaming.
+    bool Seek(float time);               // Restart track from given position (in seconds).
 
     bool IsTrack(const int track_index); // Checks desired track's index.
     bool IsType(const int track_type);   // Checks desired track's type.
     bool IsPlaying();                    // Checks if track is playing.
     bool IsActive();                     // Checks if track is still active.
     bool IsDampable();                   // Checks if track is dampable.
+    bool IsWaitingData();                // Checks if streamed track still has data to decode.
 
     void SetFX();                        // Set reverb FX, according to room flag.
     void UnsetFX();                      // Remove any reverb FX from source.
@@ -234,11 +248,22 @@ public:
 
 private:
     bool Stream(ALuint al_buffer);       // General stream routine.
+    int  FillBuffers();                  // Stream and queue free buffers, returns queued count.
+    void ResetBuffers();                 // Stop source and mark all buffers as free.
+
+    void OpenDecoder(const char *path, float time); // Create decoder, file is opened by decode job.
+    void CloseDecoder();                 // Drop decoder, running job frees it by itself.
+    void StartDecode();                  // Schedule decode job, if there are free chunks.
+    bool IsStreamEnded();                // Checks if all OGG data was decoded and queued.
 
     uint32_t        buffer_offset;
     // General OpenAL fields
     ALuint          source;
     ALuint          buffers[TR_AUDIO_STREAM_NUMBUFFERS];
+    ALuint          free_buffers[TR_AUDIO_STREAM_NUMBUFFERS];   // Unqueued buffers, waiting for data.
+    uint32_t        free_buffers_count;
+
+    struct stream_decoder_s *decoder;   // NULL for preloaded tracks.
     ALfloat         current_volume;     // Stream volume, considering fades.
     ALfloat         damped_volume;      // Additional damp volume multiplier.
 
@@ -286,6 +311,16 @@ static ov_callbacks ov_sdl_callbacks =
 };
 
 
+/*
+ * Sample decoded on worker thread, waiting for upload to OpenAL buffer.
+ */
+typedef struct audio_sample_data_s
+{
+    Uint8                          *wav_buffer;             // SDL_LoadWAV_RW data, NULL if sample is broken
+    Uint32                          size;
+    SDL_AudioSpec                   spec;
+} audio_sample_data_t, *audio_sample_data_p;
+
 struct audio_world_data_s
 {
     uint32_t                        audio_emitters_count;   // Amount of audio emitters in level.
@@ -298,6 +333,7 @@ struct audio_world_data_s
 
     uint32_t                        audio_buffers_count;    // Amount of samples.
     ALuint                         *audio_buffers;          // Samples.
+    audio_sample_data_p             samples_data;           // Decoded samples, see Audio_UploadSamples().
     uint32_t                        audio_sources_count;    // Amount of runtime channels.
     AudioSource                    *audio_sources;          // Channels.
 
@@ -318,7 +354,7 @@ void Audio_InitFX();
 int  Audio_LoadReverbToFX(const int effect_index, const EFXEAXREVERBPROPERTIES *reverb);
 #endif
 bool Audio_FillALBuffer(ALuint buf_number, Uint8* buffer_data, Uint32 buffer_size, SDL_AudioSpec wav_spec, bool use_SDL_resampler = false);
-int  Audio_LoadALbufferFromWAV_Mem(ALuint buf_number, uint8_t *sample_pointer, uint32_t sample_size, uint32_t uncomp_sample_size = 0);
+int  Audio_DecodeWAV_Mem(audio_sample_data_p sample, uint32_t index, uint8_t *sample_pointer, uint32_t sample_size, uint32_t uncomp_sample_size = 0);
 int  Audio_LoadALbufferFromWAV_File(ALuint buf_number, const char *fname);
 void Audio_LoadOverridedSamples();
 
@@ -345,6 +381,174 @@ int  Audio_LogALError(int error_marker = 0);    // AL-specific error handler.
 void Audio_LogOGGError(int code);               // Ogg-specific error handler.
 
 
+static bool Audio_OpenOgg(const char *path, OggVorbis_File *vorbis_Stream)
+{
+    SDL_RWops *audio_file = SDL_RWFromFile(path, "rb");
+    int ret;
+
+    if(!audio_file)
+    {
+        Sys_DebugLog(SYS_LOG_FILENAME, "OGG: Couldn't open file: %s.", path);
+        return false;
+    }
+
+    memset(vorbis_Stream, 0x00, sizeof(OggVorbis_File));
+    ret = ov_open_callbacks(audio_file, vorbis_Stream, NULL, 0, ov_sdl_callbacks);
+    if(ret < 0)
+    {
+        SDL_RWclose(audio_file);
+        Sys_DebugLog(SYS_LOG_FILENAME, "OGG: Couldn't open Ogg stream.");
+        Audio_LogOGGError(ret);
+        return false;
+    }
+
+    return true;    // ov_clear closes audio_file (vorbis_Stream->datasource).
+}
+
+
+/*
+ * Streamed OGG decoder. Chunks are the ring between decode job and main
+ * thread: job only writes chunks[chunk_write], main thread only reads
+ * chunks[chunk_read]; chunk data is published by atomic chunks_ready
+ * increment (full barrier) after it is written, and slot is given back by
+ * decrement after it is uploaded. eof is set by job only; it is final only
+ * when state is not RUNNING (last chunk may be still in flight).
+ * Main thread never waits for the job: closed decoder with running job is
+ * ORPHANED and is freed by the job itself.
+ */
+#define STREAM_DECODER_IDLE         (0)
+#define STREAM_DECODER_RUNNING      (1)
+#define STREAM_DECODER_ORPHANED     (2)
+
+typedef struct stream_decoder_s
+{
+    OggVorbis_File      ogg;
+    int                 opened;                     // job only
+    char               *path;                       // own copy, track buffers may be freed first
+    ogg_int64_t         start_pcm;                  // seek position for the first job
+    int                 loop;                       // gapless loop (BGM)
+    uint8_t            *chunks[TR_AUDIO_STREAM_DECODE_CHUNKS];
+    uint32_t            chunks_size[TR_AUDIO_STREAM_DECODE_CHUNKS];
+    uint32_t            chunks_capacity;
+    uint32_t            chunk_read;                 // main thread only
+    uint32_t            chunk_write;                // job only
+    SDL_atomic_t        chunks_ready;
+    SDL_atomic_t        eof;
+    SDL_atomic_t        state;
+}stream_decoder_t, *stream_decoder_p;
+
+static job_group_t          audio_stream_jobs = {{0}};  // waited only in Audio_DeInit()
+
+
+static stream_decoder_p Audio_CreateStreamDecoder(const char *path, ogg_int64_t start_pcm, int loop)
+{
+    stream_decoder_p dec = (stream_decoder_p)calloc(1, sizeof(stream_decoder_t));
+    size_t len = strlen(path) + 1;
+
+    dec->path = (char*)malloc(len);
+    memcpy(dec->path, path, len);
+    dec->start_pcm = start_pcm;
+    dec->loop = loop;
+    dec->chunks_capacity = audio_settings.stream_buffer_size;
+    for(int i = 0; i < TR_AUDIO_STREAM_DECODE_CHUNKS; i++)
+    {
+        dec->chunks[i] = (uint8_t*)malloc(dec->chunks_capacity);
+    }
+    SDL_AtomicSet(&dec->chunks_ready, 0);
+    SDL_AtomicSet(&dec->eof, 0);
+    SDL_AtomicSet(&dec->state, STREAM_DECODER_IDLE);
+
+    return dec;
+}
+
+
+static void Audio_FreeStreamDecoder(stream_decoder_p dec)
+{
+    if(dec->opened)
+    {
+        ov_clear(&dec->ogg);
+    }
+    for(int i = 0; i < TR_AUDIO_STREAM_DECODE_CHUNKS; i++)
+    {
+        free(dec->chunks[i]);
+    }
+    free(dec->path);
+    free(dec);
+}
+
+
+// Decodes one chunk, returns false on the end of track (or broken data).
+static bool Audio_StreamDecodeChunk(stream_decoder_p dec)
+{
+    uint8_t *dst = dec->chunks[dec->chunk_write];
+    uint32_t size = 0;
+    int64_t looped_at = -1;
+    int holes = 0;
+    bool eof = false;
+
+    while(size < dec->chunks_capacity)
+    {
+        int section;
+        long readed = ov_read(&dec->ogg, (char*)dst + size, dec->chunks_capacity - size, 0, 2, 1, &section);
+        if(readed > 0)
+        {
+            size += readed;
+            holes = 0;
+        }
+        else if((readed == OV_HOLE) && (++holes <= TR_AUDIO_STREAM_MAX_HOLES))
+        {
+            continue;                                   // Interrupted data, decoder resyncs by itself.
+        }
+        else if((readed == 0) && dec->loop && (looped_at != size) && (ov_pcm_seek(&dec->ogg, 0) == 0))
+        {
+            looped_at = size;                           // Gapless BGM loop, empty track stops it.
+        }
+        else
+        {
+            eof = true;                                 // End of track, error or too many holes.
+            break;
+        }
+    }
+
+    if(size > 0)
+    {
+        dec->chunks_size[dec->chunk_write] = size;
+        dec->chunk_write = (dec->chunk_write + 1) % TR_AUDIO_STREAM_DECODE_CHUNKS;
+        SDL_AtomicAdd(&dec->chunks_ready, 1);
+    }
+
+    return !eof;
+}
+
+
+static void Audio_StreamDecodeJob(void *data)
+{
+    stream_decoder_p dec = (stream_decoder_p)data;
+    bool ok = true;
+
+    if(!dec->opened)
+    {
+        dec->opened = Audio_OpenOgg(dec->path, &dec->ogg);
+        ok = dec->opened && ((dec->start_pcm <= 0) || (ov_pcm_seek(&dec->ogg, dec->start_pcm) == 0));
+    }
+
+    while(ok && (SDL_AtomicGet(&dec->state) == STREAM_DECODER_RUNNING) &&
+          (SDL_AtomicGet(&dec->chunks_ready) < TR_AUDIO_STREAM_DECODE_CHUNKS))
+    {
+        ok = Audio_StreamDecodeChunk(dec);
+    }
+    if(!ok)
+    {
+        SDL_AtomicSet(&dec->eof, 1);
+    }
+
+    if(!SDL_AtomicCAS(&dec->state, STREAM_DECODER_RUNNING, STREAM_DECODER_IDLE))
+    {
+        Audio_FreeStreamDecoder(dec);                   // Orphaned by main thread.
+    }
+}
+
+
 // ======== AUDIOSOURCE CLASS IMPLEMENTATION ========
 AudioSource::AudioSource()
 {
@@ -663,6 +867,7 @@ StreamTrackBuffer::StreamTrackBuffer() :
     track_index(-1),
     buffer_size(0),
     buffer(NULL),
+    file_path(NULL),
     stream_type(TR_AUDIO_STREAM_TYPE_ONESHOT),
     format(0),
     rate(0)
@@ -678,6 +883,12 @@ StreamTrackBuffer::~StreamTrackBuffer()
         free(buffer);
         buffer = NULL;
     }
+
+    if(file_path)
+    {
+        free(file_path);
+        file_path = NULL;
+    }
 }
 
 
@@ -710,68 +921,37 @@ bool StreamTrackBuffer::Load(int track_index)
         }
     }
 
-    return (this->buffer != NULL);
+    return (this->buffer != NULL) || (this->file_path != NULL);
 }
 
-///@TODO: fix vorbis streaming! ov_bitrate may differ in differ section
+// OGG tracks are not decoded here: only header is checked and format is
+// taken, the track itself is decoded by StreamTrack while it is playing.
 bool StreamTrackBuffer::Load_Ogg(const char *path)
 {
     vorbis_info    *vorbis_Info = NULL;
-    SDL_RWops      *audio_file = SDL_RWFromFile(path, "rb");
     OggVorbis_File  vorbis_Stream;
-    bool            ret = false;
 
-    if(!audio_file)
+    if(!Audio_OpenOgg(path, &vorbis_Stream))
     {
-        Sys_DebugLog(SYS_LOG_FILENAME, "OGG: Couldn't open file: %s.", path);
         return false;
     }
 
-    memset(&vorbis_Stream, 0x00, sizeof(OggVorbis_File));
-    if(ov_open_callbacks(audio_file, &vorbis_Stream, NULL, 0, ov_sdl_callbacks) < 0)
+    vorbis_Info = ov_info(&vorbis_Stream, -1);
+    if(vorbis_Info->channels > 2)
     {
-        SDL_RWclose(audio_file);
-        Sys_DebugLog(SYS_LOG_FILENAME, "OGG: Couldn't open Ogg stream.");
+        Sys_DebugLog(SYS_LOG_FILENAME, "OGG: track has more than 2 channels: %s.", path);
+        ov_clear(&vorbis_Stream);
         return false;
     }
-
-    vorbis_Info = ov_info(&vorbis_Stream, -1);
     format = (vorbis_Info->channels == 1) ? (AL_FORMAT_MONO16) : (AL_FORMAT_STEREO16);
     rate = vorbis_Info->rate;
+    Con_Notify("file \"%s\" opened with rate=%d, bitrate=%.1f", path, rate, ((float)vorbis_Info->bitrate_nominal / 1000));
+    ov_clear(&vorbis_Stream);
 
-    {
-        const size_t temp_buf_size = 64 * 1024 * 1024;
-        long int bitrate_nominal = vorbis_Info->bitrate_nominal;
-        char *temp_buff = (char*)malloc(temp_buf_size);
-        size_t readed = 0;
-        buffer_size = 0;
-        do
-        {
-            int section;
-            readed = ov_read(&vorbis_Stream, temp_buff + buffer_size, 32768, 0, 2, 1, &section);
-            buffer_size += readed;
-            if(buffer_size + 32768 >= temp_buf_size)
-            {
-                buffer_size = 0;
-                break;
-            }
-        }
-        while(readed > 0);
-
-        ov_clear(&vorbis_Stream);
-        //SDL_RWclose(audio_file);   //ov_clear closes (vorbis_Stream->datasource == audio_file);
-
-        if(buffer_size > 0)
-        {
-            buffer = (uint8_t*)malloc(buffer_size);
-            memcpy(buffer, temp_buff, buffer_size);
-            Con_Notify("file \"%s\" loaded with rate=%d, bitrate=%.1f", path, rate, ((float)bitrate_nominal / 1000));
-            ret = true;
-        }
-        free(temp_buff);
-    }
+    file_path = (char*)malloc(strlen(path) + 1);
+    strcpy(file_path, path);
 
-    return ret;
+    return true;
 }
 
 
@@ -944,6 +1124,8 @@ bool StreamTrackBuffer::Load_WavRW(SDL_RWops *file)
 StreamTrack::StreamTrack() :
     buffer_offset(0),
     source(0),
+    free_buffers_count(0),
+    decoder(NULL),
     current_volume(0.0f),
     damped_volume(0.0f),
     active(false),
@@ -979,29 +1161,26 @@ StreamTrack::~StreamTrack()
 
 bool StreamTrack::Play(bool fade_in)
 {
-    int buffers_to_play = 0;
+    StreamTrackBuffer *stb = (current_track >= 0) ? (audio_world_data.stream_buffers[current_track]) : (NULL);
+
+    // Streamed OGG track is opened and decoded by background job, so there
+    // is no data yet; source is started by Update(), when chunks are ready.
+
+    if(stb && stb->IsStreamed())
+    {
+        OpenDecoder(stb->GetPath(), 0.0f);
+    }
 
     // At start-up, we fill all available buffers.
     // TR soundtracks contain a lot of short tracks, like Lara speech etc., and
     // there is high chance that such short tracks won't fill all defined buffers.
-    // For this reason, we count amount of filled buffers, and immediately stop
-    // allocating them as long as Stream() routine returns false. Later, we use
-    // this number for queuing buffers to source.
+    // Buffers, which weren't filled, stay free and are filled later by Update().
 
-    for(int i = 0; i < TR_AUDIO_STREAM_NUMBUFFERS; i++, buffers_to_play++)
+    ResetBuffers();
+    if((FillBuffers() == 0) && !decoder)
     {
-        if(!Stream(buffers[i]))
-        {
-            if(i == 0)
-            {
-                Sys_DebugLog(SYS_LOG_FILENAME, "StreamTrack: error preparing buffers.");
-                return false;
-            }
-            else
-            {
-                break;
-            }
-        }
+        Sys_DebugLog(SYS_LOG_FILENAME, "StreamTrack: error preparing buffers.");
+        return false;
     }
 
     if(fade_in)     // If fade-in flag is set, do it.
@@ -1026,7 +1205,6 @@ bool StreamTrack::Play(bool fade_in)
     }
 
     alSourcef(source, AL_GAIN, current_volume * audio_settings.music_volume);
-    alSourceQueueBuffers(source, buffers_to_play, buffers);
     alSourcePlay(source);
 
     active = true;
@@ -1034,6 +1212,61 @@ bool StreamTrack::Play(bool fade_in)
 }
 
 
+bool StreamTrack::Seek(float time)
+{
+    StreamTrackBuffer *stb = (current_track >= 0) ? (audio_world_data.stream_buffers[current_track]) : (NULL);
+
+    if(!stb || !active)
+    {
+        return false;
+    }
+
+    time = (time < 0.0f) ? (0.0f) : (time);
+    if(decoder)
+    {
+        OpenDecoder(stb->GetPath(), time);          // New decoder starts at the position, old one is dropped.
+    }
+    else if(stb->GetBuffer())
+    {
+        uint32_t frame_size = 2;
+        switch(stb->GetFormat())
+        {
+            case AL_FORMAT_MONO8:
+                frame_size = 1;
+                break;
+            case AL_FORMAT_STEREO16:
+                frame_size = 4;
+                break;
+#ifdef HAVE_ALEXT_H
+            case AL_FORMAT_MONO_FLOAT32:
+                frame_size = 4;
+                break;
+            case AL_FORMAT_STEREO_FLOAT32:
+                frame_size = 8;
+                break;
+#endif
+        }
+        buffer_offset = frame_size * (uint32_t)(time * (float)stb->GetRate());
+        buffer_offset = (buffer_offset + 1 < stb->GetBufferSize()) ? (buffer_offset) : (stb->GetBufferSize() - 1);
+    }
+
+    // Drop already queued data and restart source from new position,
+    // gain and crossfade state are preserved.
+
+    ResetBuffers();
+    if(FillBuffers() > 0)
+    {
+        alSourcePlay(source);
+    }
+    else if(!decoder)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
 void StreamTrack::Pause()
 {
     if(alIsSource(source))
@@ -1054,7 +1287,14 @@ void StreamTrack::Stop()    // Immediately stop track.
     active = false;         // Clear activity flag.
     buffer_offset = 0;
     current_track = -1;
-    if(alIsSource(source))  // Stop and unlink all associated buffers.
+    ResetBuffers();         // Stop and unlink all associated buffers.
+    CloseDecoder();
+}
+
+
+void StreamTrack::ResetBuffers()
+{
+    if(alIsSource(source))
     {
         if(IsPlaying())
         {
@@ -1069,13 +1309,33 @@ void StreamTrack::Stop()    // Immediately stop track.
             alSourceUnqueueBuffers(source, 1, &buffer);                         // Unlink queued buffers.
         }
     }
+
+    for(int i = 0; i < TR_AUDIO_STREAM_NUMBUFFERS; i++)
+    {
+        free_buffers[i] = buffers[TR_AUDIO_STREAM_NUMBUFFERS - 1 - i];          // Fill in buffers order.
+    }
+    free_buffers_count = TR_AUDIO_STREAM_NUMBUFFERS;
+}
+
+
+int StreamTrack::FillBuffers()
+{
+    int queued = 0;
+
+    while((free_buffers_count > 0) && Stream(free_buffers[free_buffers_count - 1]))
+    {
+        free_buffers_count--;
+        alSourceQueueBuffers(source, 1, free_buffers + free_buffers_count);
+        queued++;
+    }
+
+    return queued;
 }
 
 
 bool StreamTrack::Update()
 {
     int  processed     = 0;
-    bool buffered      = true;
     bool change_gain   = false;
 
     // Update damping, if track supports it.
@@ -1161,21 +1421,26 @@ bool StreamTrack::Update()
                                    audio_settings.music_volume);  // Global music volume setting.
     }
 
-    // Check if any track buffers were already processed.
-    // by doc: "Buffer queuing loop must operate in a new thread"
+    // Check if any track buffers were already processed, unlink them and
+    // refill all free buffers, for which data is ready. Streamed track may
+    // have no decoded chunks yet, so buffers wait for the next update.
     alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
     while(processed--)  // Manage processed buffers.
     {
-        ALuint buffer;
-        alSourceUnqueueBuffers(source, 1, &buffer);     // Unlink processed buffer.
-        buffered = Stream(buffer);                      // Refill processed buffer.
-        if(buffered)
+        alSourceUnqueueBuffers(source, 1, free_buffers + free_buffers_count++);
+    }
+
+    if(FillBuffers() > 0)
+    {
+        ALint state = AL_STOPPED;
+        alGetSourcei(source, AL_SOURCE_STATE, &state);
+        if((state == AL_STOPPED) || (state == AL_INITIAL))
         {
-            alSourceQueueBuffers(source, 1, &buffer);   // Relink processed buffer.
+            alSourcePlay(source);                       // First data or source ran dry while decoder was late.
         }
     }
 
-    return buffered;
+    return (free_buffers_count < TR_AUDIO_STREAM_NUMBUFFERS) || IsWaitingData();
 }
 
 
@@ -1203,6 +1468,12 @@ bool StreamTrack::IsDampable()                      // Check if track is dampabl
 }
 
 
+bool StreamTrack::IsWaitingData()                   // Check if streamed track still has data.
+{
+    return (decoder != NULL) && !IsStreamEnded();
+}
+
+
 bool StreamTrack::IsPlaying()                       // Check if track is playing.
 {
     ALenum state = AL_STOPPED;
@@ -1231,7 +1502,18 @@ bool StreamTrack::Stream(ALuint al_buffer)             // Update stream process.
         buffer_size = stb->GetBufferSize();
     }
 
-    if(buffer && (buffer_offset + 1 < buffer_size))
+    if(decoder)
+    {
+        if(SDL_AtomicGet(&decoder->chunks_ready) > 0)
+        {
+            alBufferData(al_buffer, stb->GetFormat(), decoder->chunks[decoder->chunk_read], decoder->chunks_size[decoder->chunk_read], stb->GetRate());
+            decoder->chunk_read = (decoder->chunk_read + 1) % TR_AUDIO_STREAM_DECODE_CHUNKS;
+            SDL_AtomicAdd(&decoder->chunks_ready, -1);
+            ret = true;
+        }
+        StartDecode();
+    }
+    else if(buffer && (buffer_offset + 1 < buffer_size))
     {
         if(buffer_offset + audio_settings.stream_buffer_size < buffer_size)
         {
@@ -1251,6 +1533,48 @@ bool StreamTrack::Stream(ALuint al_buffer)             // Update stream process.
 }
 
 
+void StreamTrack::OpenDecoder(const char *path, float time)
+{
+    StreamTrackBuffer *stb = audio_world_data.stream_buffers[current_track];
+
+    CloseDecoder();
+    decoder = Audio_CreateStreamDecoder(path, (ogg_int64_t)(time * (float)stb->GetRate()),
+                                        stream_type == TR_AUDIO_STREAM_TYPE_BACKGROUND);
+    StartDecode();
+}
+
+
+void StreamTrack::CloseDecoder()
+{
+    if(decoder)
+    {
+        if(!SDL_AtomicCAS(&decoder->state, STREAM_DECODER_RUNNING, STREAM_DECODER_ORPHANED))
+        {
+            Audio_FreeStreamDecoder(decoder);           // No job is running.
+        }
+        decoder = NULL;
+    }
+}
+
+
+void StreamTrack::StartDecode()
+{
+    if(decoder && (SDL_AtomicGet(&decoder->state) == STREAM_DECODER_IDLE) && !SDL_AtomicGet(&decoder->eof) &&
+       (SDL_AtomicGet(&decoder->chunks_ready) < TR_AUDIO_STREAM_DECODE_CHUNKS))
+    {
+        SDL_AtomicSet(&decoder->state, STREAM_DECODER_RUNNING);
+        Jobs_Add(&audio_stream_jobs, Audio_StreamDecodeJob, decoder);
+    }
+}
+
+
+bool StreamTrack::IsStreamEnded()
+{
+    return (SDL_AtomicGet(&decoder->state) == STREAM_DECODER_IDLE) && SDL_AtomicGet(&decoder->eof) &&
+           (SDL_AtomicGet(&decoder->chunks_ready) == 0);
+}
+
+
 void StreamTrack::SetFX()
 {
 #ifdef HAVE_ALEXT_H
@@ -1390,6 +1714,135 @@ int Audio_StreamPlay(const uint32_t track_index, const uint8_t mask)
 }
 
 
+int Audio_StreamSeek(const uint32_t track_index, float time)
+{
+    for(uint32_t i = 0; i < audio_world_data.stream_tracks_count; i++)
+    {
+        StreamTrack *track = audio_world_data.stream_tracks + i;
+        if(track->IsActive() && track->IsTrack(track_index))
+        {
+            return (track->Seek(time)) ? (TR_AUDIO_STREAMPLAY_PROCESSED) : (TR_AUDIO_STREAMPLAY_PLAYERROR);
+        }
+    }
+
+    return TR_AUDIO_STREAMPLAY_IGNORED;     // Track is not playing.
+}
+
+
+// Compares previous OGG loading (whole track decoded into memory) against
+// streamed start (file open and first chunk decoded). Track isn't played.
+// Resident PCM is measured: decode buffers are counted by allocated size,
+// OpenAL buffers by AL_SIZE after data is uploaded into them.
+
+static uint32_t Audio_BenchALSize(ALuint *al_buffers, int count, ALenum format, ALsizei rate, uint8_t *data, uint32_t size)
+{
+    uint32_t ret = 0;
+
+    alGenBuffers(count, al_buffers);
+    for(int i = 0; i < count; i++)
+    {
+        ALint al_size = 0;
+        alBufferData(al_buffers[i], format, data, size, rate);
+        alGetBufferi(al_buffers[i], AL_SIZE, &al_size);
+        ret += al_size;
+    }
+    alDeleteBuffers(count, al_buffers);
+
+    return ret;
+}
+
+
+void Audio_BenchStream(int track_index)
+{
+    StreamTrackBuffer *stb = NULL;
+    OggVorbis_File vorbis_Stream;
+    ALuint al_buffers[TR_AUDIO_STREAM_NUMBUFFERS];
+    const uint32_t chunk_size = audio_settings.stream_buffer_size;
+    uint8_t *data = NULL;
+    uint32_t data_capacity = 0;
+    uint32_t full_size = 0, full_al = 0;
+    uint32_t stream_size = 0, stream_al = 0;
+    float time_full, time_stream;
+    float t;
+
+    if(track_index < 0)
+    {
+        for(uint32_t i = 0; i < audio_world_data.stream_buffers_count; i++)
+        {
+            if(audio_world_data.stream_buffers[i] && audio_world_data.stream_buffers[i]->IsStreamed())
+            {
+                track_index = i;
+                break;
+            }
+        }
+    }
+
+    if((track_index >= 0) && ((uint32_t)track_index < audio_world_data.stream_buffers_count))
+    {
+        stb = audio_world_data.stream_buffers[track_index];
+    }
+
+    if(!stb || !stb->IsStreamed())
+    {
+        Con_Warning("bench_stream: no streamed (ogg) track %d", track_index);
+        return;
+    }
+
+    // Full decode: whole track in growing buffer, then one AL buffer.
+    t = Sys_FloatTime();
+    if(Audio_OpenOgg(stb->GetPath(), &vorbis_Stream))
+    {
+        long readed;
+        int section;
+        do
+        {
+            if(data_capacity - full_size < chunk_size)
+            {
+                data_capacity = (data_capacity) ? (2 * data_capacity) : (chunk_size);
+                data = (uint8_t*)realloc(data, data_capacity);
+            }
+            readed = ov_read(&vorbis_Stream, (char*)data + full_size, data_capacity - full_size, 0, 2, 1, &section);
+            full_size += (readed > 0) ? (readed) : (0);
+        }
+        while(readed > 0);
+        ov_clear(&vorbis_Stream);
+    }
+    if(full_size > 0)
+    {
+        full_al = Audio_BenchALSize(al_buffers, 1, stb->GetFormat(), stb->GetRate(), data, full_size);
+    }
+    time_full = Sys_FloatTime() - t;
+    free(data);
+
+    // Streamed start: decode chunks are allocated, first one is filled.
+    data = (uint8_t*)malloc(TR_AUDIO_STREAM_DECODE_CHUNKS * chunk_size);
+    t = Sys_FloatTime();
+    if(Audio_OpenOgg(stb->GetPath(), &vorbis_Stream))
+    {
+        long readed;
+        int section;
+        while((stream_size < chunk_size) &&
+              ((readed = ov_read(&vorbis_Stream, (char*)data + stream_size, chunk_size - stream_size, 0, 2, 1, &section)) > 0))
+        {
+            stream_size += readed;
+        }
+        ov_clear(&vorbis_Stream);
+    }
+    time_stream = Sys_FloatTime() - t;
+
+    // Playing track keeps all stream buffers queued with one chunk each.
+    if(stream_size > 0)
+    {
+        stream_al = Audio_BenchALSize(al_buffers, TR_AUDIO_STREAM_NUMBUFFERS, stb->GetFormat(), stb->GetRate(), data, stream_size);
+    }
+    free(data);
+
+    Engine_BenchReport("bench_stream", "track %d, full decode %.2f ms / %.1f KB decode buffer + %.1f KB AL, streamed start %.2f ms / %.1f KB chunks + %.1f KB AL",
+                       track_index, 1000.0f * time_full, (float)data_capacity / 1024.0f, (float)full_al / 1024.0f,
+                       1000.0f * time_stream, (float)(TR_AUDIO_STREAM_DECODE_CHUNKS * chunk_size) / 1024.0f, (float)stream_al / 1024.0f);
+}
+
+
 // General damping update procedure. Constantly checks if damp condition exists, and
 // if so, it lowers the volume of tracks which are dampable.
 
@@ -1422,7 +1875,8 @@ void Audio_UpdateStreams()
 
     for(uint32_t i = 0; i < audio_world_data.stream_tracks_count; i++)
     {
-        if(audio_world_data.stream_tracks[i].IsPlaying())
+        // Streamed track may be stopped by OpenAL, if decoder is late - keep it updated.
+        if(audio_world_data.stream_tracks[i].IsPlaying() || audio_world_data.stream_tracks[i].IsWaitingData())
         {
             audio_world_data.stream_tracks[i].Update();
         }
@@ -1441,7 +1895,7 @@ int  Audio_IsTrackPlaying(uint32_t track_index)
 {
     for(uint32_t i = 0; i < audio_world_data.stream_tracks_count; i++)
     {
-        if(audio_world_data.stream_tracks[i].IsPlaying() &&
+        if((audio_world_data.stream_tracks[i].IsPlaying() || audio_world_data.stream_tracks[i].IsWaitingData()) &&
            audio_world_data.stream_tracks[i].IsTrack(track_index))
         {
             return 1;
@@ -1492,8 +1946,9 @@ int Audio_GetFreeStream()
 {
     for(uint32_t i = 0; i < audio_world_data.stream_tracks_count; i++)
     {
-        if( (!audio_world_data.stream_tracks[i].IsPlaying()) &&
-            (!audio_world_data.stream_tracks[i].IsActive())   )
+        if( (!audio_world_data.stream_tracks[i].IsPlaying())     &&
+            (!audio_world_data.stream_tracks[i].IsActive())      &&
+            (!audio_world_data.stream_tracks[i].IsWaitingData())  )
         {
             return i;
         }
@@ -1889,6 +2344,7 @@ void Audio_InitGlobals()
     audio_world_data.audio_sources_count = 0;
     audio_world_data.audio_buffers = NULL;
     audio_world_data.audio_buffers_count = 0;
+    audio_world_data.samples_data = NULL;
     audio_world_data.audio_effects = NULL;
     audio_world_data.audio_effects_count = 0;
 
@@ -2033,44 +2489,11 @@ void Audio_GenSamples(class VT_Level *tr)
     uint32_t      comp_size, uncomp_size;
     uint32_t      i;
 
-    // Generate stream tracks buffers
-    audio_world_data.stream_buffers = NULL;
-    audio_world_data.stream_buffers_count = Script_GetNumTracks(engine_lua);
-    if(audio_world_data.stream_buffers_count > 0)
-    {
-        int secret_track_index = Script_GetSecretTrackNumber(engine_lua);
-        audio_world_data.stream_buffers = (StreamTrackBuffer**)malloc(audio_world_data.stream_buffers_count * sizeof(StreamTrackBuffer));
-        for(uint32_t i = 0; i < audio_world_data.stream_buffers_count; i++)
-        {
-            audio_world_data.stream_buffers[i] = NULL;
-            if((i == secret_track_index) || Audio_IsTrackUsedInTriggers(i))
-            {
-                StreamTrackBuffer *stb = new StreamTrackBuffer();
-                if(stb->Load(i))
-                {
-                    audio_world_data.stream_buffers[i] = stb;
-                }
-                else
-                {
-                    delete stb;
-                }
-            }
-        }
-    }
-
-    // Generate new buffer array.
+    // Samples are only decoded here; OpenAL buffers are generated and filled
+    // on main thread by Audio_UploadSamples().
     audio_world_data.audio_buffers_count = tr->samples_count;
-    audio_world_data.audio_buffers = (ALuint*)malloc(audio_world_data.audio_buffers_count * sizeof(ALuint));
-    memset(audio_world_data.audio_buffers, 0, sizeof(ALuint) * audio_world_data.audio_buffers_count);
-    alGenBuffers(audio_world_data.audio_buffers_count, audio_world_data.audio_buffers);
-
-    // Generate stream track map array.
-    // We use scripted amount of tracks to define map bounds.
-    // If script had no such parameter, we define map bounds by default.
-    audio_world_data.stream_track_map_count = Script_GetNumTracks(engine_lua);
-    if(audio_world_data.stream_track_map_count == 0) audio_world_data.stream_track_map_count = TR_AUDIO_STREAM_MAP_SIZE;
-    audio_world_data.stream_track_map = (uint8_t*)malloc(audio_world_data.stream_track_map_count * sizeof(uint8_t));
-    memset(audio_world_data.stream_track_map, 0, sizeof(uint8_t) * audio_world_data.stream_track_map_count);
+    audio_world_data.audio_buffers = (ALuint*)calloc(audio_world_data.audio_buffers_count, sizeof(ALuint));
+    audio_world_data.samples_data = (audio_sample_data_p)calloc(audio_world_data.audio_buffers_count, sizeof(audio_sample_data_t));
 
     // Generate new audio effects array.
     audio_world_data.audio_effects_count = tr->sound_details_count;
@@ -2108,10 +2531,10 @@ void Audio_GenSamples(class VT_Level *tr)
                 {
                     pointer = tr->samples_data + tr->sample_indices[i];
                     uint32_t size = tr->sample_indices[i + 1] - tr->sample_indices[i];
-                    Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], pointer, size);
+                    Audio_DecodeWAV_Mem(audio_world_data.samples_data + i, i, pointer, size);
                 }
                 i = audio_world_data.audio_buffers_count-1;
-                Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], pointer, (tr->samples_count - tr->sample_indices[i]));
+                Audio_DecodeWAV_Mem(audio_world_data.samples_data + i, i, pointer, (tr->samples_count - tr->sample_indices[i]));
                 break;
 
             case TR_II:
@@ -2135,7 +2558,7 @@ void Audio_GenSamples(class VT_Level *tr)
                         else
                         {
                             uncomp_size = ind2 - ind1;
-                            Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], tr->samples_data + ind1, uncomp_size);
+                            Audio_DecodeWAV_Mem(audio_world_data.samples_data + i, i, tr->samples_data + ind1, uncomp_size);
                             i++;
                             if(i > audio_world_data.audio_buffers_count - 1)
                             {
@@ -2150,7 +2573,7 @@ void Audio_GenSamples(class VT_Level *tr)
                 pointer = tr->samples_data + ind1;
                 if(i < audio_world_data.audio_buffers_count)
                 {
-                    Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], pointer, uncomp_size);
+                    Audio_DecodeWAV_Mem(audio_world_data.samples_data + i, i, pointer, uncomp_size);
                 }
                 break;
 
@@ -2168,8 +2591,8 @@ void Audio_GenSamples(class VT_Level *tr)
                     comp_size   = *((uint32_t*)pointer);
                     pointer += 4;
 
-                    // Load WAV sample into OpenAL buffer.
-                    Audio_LoadALbufferFromWAV_Mem(audio_world_data.audio_buffers[i], pointer, comp_size, uncomp_size);
+                    // Decode WAV sample.
+                    Audio_DecodeWAV_Mem(audio_world_data.samples_data + i, i, pointer, comp_size, uncomp_size);
 
                     // Now we can safely move pointer through current sample data.
                     pointer += comp_size;
@@ -2263,13 +2686,6 @@ void Audio_GenSamples(class VT_Level *tr)
         audio_world_data.audio_effects[i].sample_count = (tr->sound_details[i].num_samples_and_flags_1 >> 2) & TR_AUDIO_SAMPLE_NUMBER_MASK;
     }
 
-    // Try to override samples via script.
-    // If there is no script entry exist, we just leave default samples.
-    // NB! We need to override samples AFTER audio effects array is inited, as override
-    //     routine refers to existence of certain audio effect in level.
-
-    Audio_LoadOverridedSamples();
-
     // Hardcoded version-specific fixes!
 
     switch(tr->game_version)
@@ -2307,10 +2723,95 @@ void Audio_GenSamples(class VT_Level *tr)
 }
 
 
+void Audio_GenScriptData()
+{
+    // Generate stream tracks buffers
+    audio_world_data.stream_buffers = NULL;
+    audio_world_data.stream_buffers_count = Script_GetNumTracks(engine_lua);
+    if(audio_world_data.stream_buffers_count > 0)
+    {
+        int secret_track_index = Script_GetSecretTrackNumber(engine_lua);
+        audio_world_data.stream_buffers = (StreamTrackBuffer**)malloc(audio_world_data.stream_buffers_count * sizeof(StreamTrackBuffer));
+        for(uint32_t i = 0; i < audio_world_data.stream_buffers_count; i++)
+        {
+            audio_world_data.stream_buffers[i] = NULL;
+            if((i == secret_track_index) || Audio_IsTrackUsedInTriggers(i))
+            {
+                StreamTrackBuffer *stb = new StreamTrackBuffer();
+                if(stb->Load(i))
+                {
+                    audio_world_data.stream_buffers[i] = stb;
+                }
+                else
+                {
+                    delete stb;
+                }
+            }
+        }
+    }
+
+    // Generate stream track map array.
+    // We use scripted amount of tracks to define map bounds.
+    // If script had no such parameter, we define map bounds by default.
+    audio_world_data.stream_track_map_count = Script_GetNumTracks(engine_lua);
+    if(audio_world_data.stream_track_map_count == 0) audio_world_data.stream_track_map_count = TR_AUDIO_STREAM_MAP_SIZE;
+    audio_world_data.stream_track_map = (uint8_t*)malloc(audio_world_data.stream_track_map_count * sizeof(uint8_t));
+    memset(audio_world_data.stream_track_map, 0, sizeof(uint8_t) * audio_world_data.stream_track_map_count);
+
+    // Try to override samples via script.
+    // If there is no script entry exist, we just leave default samples.
+    // NB! We need to override samples AFTER audio effects array is inited, as override
+    //     routine refers to existence of certain audio effect in level.
+    Audio_LoadOverridedSamples();
+}
+
+
+void Audio_UploadSamples()
+{
+    if(audio_world_data.samples_data == NULL)
+    {
+        return;
+    }
+
+    alGenBuffers(audio_world_data.audio_buffers_count, audio_world_data.audio_buffers);
+    for(uint32_t i = 0; i < audio_world_data.audio_buffers_count; i++)
+    {
+        audio_sample_data_p sample = audio_world_data.samples_data + i;
+        if(sample->wav_buffer)
+        {
+            Audio_FillALBuffer(audio_world_data.audio_buffers[i], sample->wav_buffer, sample->size, sample->spec);
+            SDL_FreeWAV(sample->wav_buffer);
+            sample->wav_buffer = NULL;
+        }
+    }
+
+    free(audio_world_data.samples_data);
+    audio_world_data.samples_data = NULL;
+}
+
+
 int Audio_DeInit()
 {
     Audio_StopAllSources();
     Audio_StopStreams();
+    Jobs_Wait(&audio_stream_jobs);                      // Orphaned decoders are freed by their jobs.
+
+    if(audio_world_data.samples_data)
+    {
+        // World load was interrupted before upload; buffers were not generated.
+        for(uint32_t i = 0; i < audio_world_data.audio_buffers_count; i++)
+        {
+            if(audio_world_data.samples_data[i].wav_buffer)
+            {
+                SDL_FreeWAV(audio_world_data.samples_data[i].wav_buffer);
+            }
+        }
+        free(audio_world_data.samples_data);
+        audio_world_data.samples_data = NULL;
+        audio_world_data.audio_buffers_count = 0;
+        free(audio_world_data.audio_buffers);
+        audio_world_data.audio_buffers = NULL;
+    }
 
     if(audio_world_data.audio_sources)
     {
@@ -2437,7 +2938,7 @@ void Audio_LogOGGError(int code)
 }
 
 
-int Audio_LoadALbufferFromWAV_Mem(ALuint buf_number, uint8_t *sample_pointer, uint32_t sample_size, uint32_t uncomp_sample_size)
+int Audio_DecodeWAV_Mem(audio_sample_data_p sample, uint32_t index, uint8_t *sample_pointer, uint32_t sample_size, uint32_t uncomp_sample_size)
 {
     SDL_AudioSpec wav_spec;
     Uint8        *wav_buffer;
@@ -2451,7 +2952,7 @@ int Audio_LoadALbufferFromWAV_Mem(ALuint buf_number, uint8_t *sample_pointer, ui
 
     if(SDL_LoadWAV_RW(src, 1, &wav_spec, &wav_buffer, &wav_length) == NULL)
     {
-        Sys_DebugLog(SYS_LOG_FILENAME, "Error: can't load sample #%03d from sample block!", buf_number);
+        Sys_DebugLog(SYS_LOG_FILENAME, "Error: can't load sample #%03d from sample block!", index);
         return -1;
     }
 
@@ -2469,14 +2970,14 @@ int Audio_LoadALbufferFromWAV_Mem(ALuint buf_number, uint8_t *sample_pointer, ui
         uncomp_sample_size = wav_length;
     }
 
-    // Find out sample format and load it correspondingly.
+    // Sample format is found out on upload (see Audio_UploadSamples).
     // Note that with OpenAL, we can have samples of different formats in same level.
 
-    bool result = Audio_FillALBuffer(buf_number, wav_buffer, uncomp_sample_size, wav_spec);
+    sample->wav_buffer = wav_buffer;
+    sample->size = uncomp_sample_size;
+    sample->spec = wav_spec;
 
-    SDL_FreeWAV(wav_buffer);
-
-    return (result) ? (0) : (-3);   // Zero means success.
+    return 0;   // Zero means success.
 }
 
 
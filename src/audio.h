@@ -140,6 +140,18 @@ enum TR_AUDIO_SOUND_GLOBALID
 
 #define TR_AUDIO_STREAM_NUMBUFFERS 4
 
+// DECODE_CHUNKS is a number of decoded, but not yet queued PCM chunks
+// (stream_buffer_size each) for OGG tracks, which are not preloaded, but
+// decoded on the fly by background job. Together with queued buffers,
+// it gives about 2-3 seconds of decoded music per stream.
+
+#define TR_AUDIO_STREAM_DECODE_CHUNKS 2
+
+// MAX_HOLES is a number of successive interruptions in OGG data, after which
+// streamed track is treated as ended (corrupted file must not spin decoder).
+
+#define TR_AUDIO_STREAM_MAX_HOLES 32
+
 // NUMSOURCES tells the engine how many sources we should reserve for
 // in-game music and BGMs, considering crossfades. By default, it's 6,
 // as it's more than enough for typical TR audio setup (one BGM track
@@ -238,7 +250,9 @@ extern struct audio_settings_s audio_settings;
 void Audio_InitGlobals();
 
 void Audio_Init(uint32_t num_Sources = TR_AUDIO_MAX_CHANNELS);
-void Audio_GenSamples(class VT_Level *tr);
+void Audio_GenSamples(class VT_Level *tr);            // no script access, may be called from worker thread
+void Audio_UploadSamples();                            // fill OpenAL buffers with samples decoded by Audio_GenSamples; main thread only
+void Audio_GenScriptData();                            // stream tracks and overrided samples; call after Audio_UploadSamples and triggers generation
 int  Audio_DeInit();
 void Audio_Update(float time);
 
@@ -254,5 +268,8 @@ int  Audio_StopStreams(int stream_type = -1);       // Immediately stop ALL stre
 
 // Generally, you need only this function to trigger any track.
 int Audio_StreamPlay(const uint32_t track_index, const uint8_t mask = 0);
+int Audio_StreamSeek(const uint32_t track_index, float time);      // Seek playing track (time in seconds).
+
+void Audio_BenchStream(int track_index);                            // Measure track full decode against streamed start.
 
 #endif // AUDIO_H
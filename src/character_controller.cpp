@@ -38,7 +38,7 @@ void Character_Create(struct entity_s *ent)
         ent->dir_flag = ENT_STAY;
         ent->no_anim_pos_autocorrection = 0x00;
 
-        ret->target_id = ENTITY_ID_NONE;
+        ret->target = ENTITY_ID_NONE;
         ret->hair_count = 0;
         ret->hairs = NULL;
         ret->ragdoll = NULL;
@@ -248,6 +248,7 @@ void Character_UpdateCurrentHeight(struct entity_s *ent)
 void Character_GetHeightInfo(float pos[3], struct height_info_s *fc, float v_offset)
 {
     float from[3], to[3];
+    physics_query_t queries[2];
     room_p r = (fc->self) ? (fc->self->room) : (NULL);
     room_sector_p rs;
 
@@ -260,15 +261,27 @@ void Character_GetHeightInfo(float pos[3], struct height_info_s *fc, float v_off
     r = World_FindRoomByPosCogerrence(pos, r);
     if(r)
     {
+        // vertical walk uses packed sectors: room index + floor / ceiling only.
+        room_p sr;
+        room_sector_hot_p hs;
+        int index;
+
         rs = Room_GetSectorXYZ(r, pos);                                         // if r != NULL then rs can not been NULL!!!
+        sr = rs->owner_room;
+        hs = sr->sectors_hot + (rs - sr->sectors);
         if(r->flags & TR_ROOM_FLAG_WATER)                                       // in water - go up
         {
-            while(rs->room_above)
+            while(hs->room_above != ROOM_INDEX_NONE)
             {
-                rs = Room_GetSectorRaw(rs->room_above->real_room, rs->pos);
-                if((rs->owner_room->flags & TR_ROOM_FLAG_WATER) == 0x00)        // find air
+                sr = World_GetRoomByID(hs->room_above)->real_room;
+                if((index = Room_GetSectorIndex(sr, rs->pos)) < 0)
                 {
-                    fc->transition_level = (float)rs->floor;
+                    break;
+                }
+                hs = sr->sectors_hot + index;
+                if((sr->flags & TR_ROOM_FLAG_WATER) == 0x00)                    // find air
+                {
+                    fc->transition_level = (float)hs->floor;
                     fc->water = 0x01;
                     break;
                 }
@@ -276,12 +289,17 @@ void Character_GetHeightInfo(float pos[3], struct height_info_s *fc, float v_off
         }
         else if(r->flags & TR_ROOM_FLAG_QUICKSAND)
         {
-            while(rs->room_above)
+            while(hs->room_above != ROOM_INDEX_NONE)
             {
-                rs = Room_GetSectorRaw(rs->room_above->real_room, rs->pos);
-                if((rs->owner_room->flags & TR_ROOM_FLAG_QUICKSAND) == 0x00)    // find air
+                sr = World_GetRoomByID(hs->room_above)->real_room;
+                if((index = Room_GetSectorIndex(sr, rs->pos)) < 0)
+                {
+                    break;
+                }
+                hs = sr->sectors_hot + index;
+                if((sr->flags & TR_ROOM_FLAG_QUICKSAND) == 0x00)                // find air
                 {
-                    fc->transition_level = (float)rs->floor;
+                    fc->transition_level = (float)hs->floor;
                     if(fc->transition_level - fc->floor_hit.point[2] > v_offset)
                     {
                         fc->quicksand = 0x02;
@@ -296,18 +314,23 @@ void Character_GetHeightInfo(float pos[3], struct height_info_s *fc, float v_off
         }
         else                                                                    // in air - go down
         {
-            while(rs->room_below)
+            while(hs->room_below != ROOM_INDEX_NONE)
             {
-                rs = Room_GetSectorRaw(rs->room_below->real_room, rs->pos);
-                if((rs->owner_room->flags & TR_ROOM_FLAG_WATER) != 0x00)        // find water
+                sr = World_GetRoomByID(hs->room_below)->real_room;
+                if((index = Room_GetSectorIndex(sr, rs->pos)) < 0)
+                {
+                    break;
+                }
+                hs = sr->sectors_hot + index;
+                if((sr->flags & TR_ROOM_FLAG_WATER) != 0x00)                    // find water
                 {
-                    fc->transition_level = (float)rs->ceiling;
+                    fc->transition_level = (float)hs->ceiling;
                     fc->water = 0x01;
                     break;
                 }
-                else if((rs->owner_room->flags & TR_ROOM_FLAG_QUICKSAND) != 0x00)// find water
+                else if((sr->flags & TR_ROOM_FLAG_QUICKSAND) != 0x00)           // find water
                 {
-                    fc->transition_level = (float)rs->ceiling;
+                    fc->transition_level = (float)hs->ceiling;
                     if(fc->transition_level - fc->floor_hit.point[2] > v_offset)
                     {
                         fc->quicksand = 0x02;
@@ -323,17 +346,25 @@ void Character_GetHeightInfo(float pos[3], struct height_info_s *fc, float v_off
     }
 
     /*
-     * GET HEIGHTS
+     * GET HEIGHTS: from sectors data, if nothing else can be in the column
      */
+    if(Room_SampleHeights(r, pos, fc->self, COLLISION_FILTER_HEIGHT_TEST, &fc->floor_hit, 8192.0f, &fc->ceiling_hit, 4096.0f))
+    {
+        return;
+    }
+
     vec3_copy(from, pos);
     to[0] = from[0];
     to[1] = from[1];
     to[2] = from[2] - 8192.0f;
-
-    Physics_RayTest(&fc->floor_hit, from ,to, fc->self, COLLISION_FILTER_HEIGHT_TEST);
+    Physics_SetRayQuery(queries + 0, from, to, fc->self, COLLISION_FILTER_HEIGHT_TEST);
 
     to[2] = from[2] + 4096.0f;
-    Physics_RayTest(&fc->ceiling_hit, from ,to, fc->self, COLLISION_FILTER_HEIGHT_TEST);
+    Physics_SetRayQuery(queries + 1, from, to, fc->self, COLLISION_FILTER_HEIGHT_TEST);
+
+    Physics_TestBatch(queries, 2);
+    fc->floor_hit = queries[0].result;
+    fc->ceiling_hit = queries[1].result;
 }
 
 /**
@@ -479,6 +510,7 @@ void Character_CheckClimbability(struct entity_s *ent, struct climb_info_s *clim
     float n0[4], n1[4];                                                         // planes equations
     char up_founded = 0;
     collision_result_t cb;
+    physics_query_t queries[CHARACTER_CLIMB_QUERIES_BATCH];
     //const float color[3] = {1.0, 0.0, 0.0};
 
     if(ent->current_sector && ent->current_sector->room_above &&
@@ -523,16 +555,26 @@ void Character_CheckClimbability(struct entity_s *ent, struct climb_info_s *clim
                 to[0] = test_to[0];
                 to[1] = test_to[1];
                 to[2] = from[2];
-                while(to[2] > test_to[2])
+                for(bool found = false; !found && (to[2] > test_to[2]); )
                 {
-                    if(Physics_SphereTest(&cb, from, to, ent->character->climb_r, ent->self, COLLISION_FILTER_HEIGHT_TEST) && (vec3_dot(cb.normale, n1) < 0.98f))
+                    // casts down by steps are tested by batches, the first accepted hit is used
+                    uint32_t count = 0;
+                    for(; (count < CHARACTER_CLIMB_QUERIES_BATCH) && (to[2] > test_to[2]); count++, from[2] += z_step, to[2] += z_step)
                     {
-                        vec3_copy(n0, cb.normale);
-                        n0[3] = -vec3_dot(n0, cb.point);
-                        break;
+                        Physics_SetSphereQuery(queries + count, from, to, ent->character->climb_r, ent->self, COLLISION_FILTER_HEIGHT_TEST);
+                    }
+                    Physics_TestBatch(queries, count);
+                    for(uint32_t i = 0; i < count; i++)
+                    {
+                        collision_result_p res = &queries[i].result;
+                        if(res->hit && (vec3_dot(res->normale, n1) < 0.98f))
+                        {
+                            vec3_copy(n0, res->normale);
+                            n0[3] = -vec3_dot(n0, res->point);
+                            found = true;
+                            break;
+                        }
                     }
-                    from[2] += z_step;
-                    to[2] += z_step;
                 }
             }
         }
@@ -558,16 +600,23 @@ void Character_CheckClimbability(struct entity_s *ent, struct climb_info_s *clim
             from[0] = test_from[0];
             from[1] = test_from[1];
             from[2] = to[2] = cb.point[2];
-            for(; to[2] >= test_to[2]; from[2] += z_step, to[2] += z_step)      // we can't climb under floor!
+            while((up_founded != 2) && (to[2] >= test_to[2]))                   // we can't climb under floor!
             {
-                //renderer.debugDrawer->DrawLine(from, to, color, color);
-                if(Physics_SphereTest(&cb, from, to, ent->character->climb_r, ent->self, COLLISION_FILTER_HEIGHT_TEST) && (cb.fraction > 0.0f))
+                uint32_t count = 0;
+                for(; (count < CHARACTER_CLIMB_QUERIES_BATCH) && (to[2] >= test_to[2]); count++, from[2] += z_step, to[2] += z_step)
+                {
+                    //renderer.debugDrawer->DrawLine(from, to, color, color);
+                    Physics_SetSphereQuery(queries + count, from, to, ent->character->climb_r, ent->self, COLLISION_FILTER_HEIGHT_TEST);
+                }
+                Physics_TestBatch(queries, count);
+                for(uint32_t i = 0; i < count; i++)
                 {
-                    if(up_founded && (vec3_dist_sq(cb.normale, n0) > 0.05f))
+                    collision_result_p res = &queries[i].result;
+                    if(res->hit && (res->fraction > 0.0f) && (vec3_dist_sq(res->normale, n0) > 0.05f))
                     {
-                        vec3_copy(n1, cb.normale);
-                        n1[3] = -vec3_dot(n1, cb.point);
-                        climb->edge_obj = cb.obj;
+                        vec3_copy(n1, res->normale);
+                        n1[3] = -vec3_dot(n1, res->point);
+                        climb->edge_obj = res->obj;
                         up_founded = 2;
                         break;
                     }
@@ -657,12 +706,28 @@ void Character_CheckClimbability(struct entity_s *ent, struct climb_info_s *clim
         vec3_copy(from, climb->edge_point);
         vec3_copy(to, from);
         to[2] += climb->next_z_space;
-        if(Physics_RayTestFiltered(&cb, from, to, ent->self, COLLISION_FILTER_HEIGHT_TEST))
+        Physics_SetRayQuery(queries + 0, from, to, ent->self, COLLISION_FILTER_HEIGHT_TEST);
+        queries[0].type = PHYSICS_QUERY_RAY_FILTERED;
+
+        // hang test does not depend on the space above edge, so both go in one batch
+        from[0] = to[0] = test_from[0];
+        from[1] = to[1] = test_from[1];
+        from[2] = test_from[2];
+        to[2] = climb->edge_point[2] - ent->character->height;
+        Physics_SetRayQuery(queries + 1, from, to, ent->self, COLLISION_FILTER_HEIGHT_TEST);
+        queries[1].type = PHYSICS_QUERY_RAY_FILTERED;
+
+        Physics_TestBatch(queries, 2);
+        climb->can_hang = (queries[1].result.hit) ? (0x00) : (0x01);
+        if(queries[0].result.hit)
         {
-            climb->next_z_space = cb.point[2] - climb->edge_point[2];
+            climb->next_z_space = queries[0].result.point[2] - climb->edge_point[2];
             if(climb->next_z_space < 0.01f)
             {
                 climb->next_z_space = 2.0 * ent->character->height;
+                vec3_copy(from, climb->edge_point);
+                vec3_copy(to, from);
+                to[2] += climb->next_z_space;
                 from[2] += fabs(climb->next_z_space);
                 if(Physics_RayTestFiltered(&cb, from, to, ent->self, COLLISION_FILTER_HEIGHT_TEST))
                 {
@@ -670,12 +735,6 @@ void Character_CheckClimbability(struct entity_s *ent, struct climb_info_s *clim
                 }
             }
         }
-
-        from[0] = to[0] = test_from[0];
-        from[1] = to[1] = test_from[1];
-        from[2] = test_from[2];
-        to[2] = climb->edge_point[2] - ent->character->height;
-        climb->can_hang = (Physics_RayTestFiltered(NULL, from, to, ent->self, COLLISION_FILTER_HEIGHT_TEST) ? (0x00) : (0x01));
     }
 }
 
@@ -1885,7 +1944,7 @@ void Character_UpdateParams(struct entity_s *ent)
 
     if(ent->character->weapon_current_state != WEAPON_STATE_HIDE)
     {
-        entity_p target = World_GetEntityByID(ent->character->target_id);
+        entity_p target = World_GetEntityByHandle(ent->character->target);
         if(target)
         {
             Character_LookAt(ent, target->obb->centre);
@@ -2041,7 +2100,10 @@ struct entity_s *Character_FindTarget(struct entity_s *ent)
 {
     entity_p ret = NULL;
     float max_dot = 0.0f;
-    collision_result_t cs;
+    physics_query_t queries[CHARACTER_MAX_TARGET_QUERIES];
+    entity_p targets[CHARACTER_MAX_TARGET_QUERIES];
+    float dots[CHARACTER_MAX_TARGET_QUERIES];
+    uint32_t count = 0;
 
     for(int ri = -1; ri < ent->self->room->near_room_list_size; ++ri)
     {
@@ -2058,16 +2120,29 @@ struct entity_s *Character_FindTarget(struct entity_s *ent)
                     vec3_sub(dir, target->transform + 12, ent->transform + 12);
                     vec3_norm(dir, t);
                     t = vec3_dot(ent->transform + 4, dir);
-                    if((t > max_dot) && (!Physics_RayTest(&cs, ent->obb->centre, target->obb->centre, ent->self, COLLISION_FILTER_CHARACTER) || (cs.obj == target->self)))
+                    if((t > 0.0f) && (count < CHARACTER_MAX_TARGET_QUERIES))
                     {
-                        max_dot = t;
-                        ret = target;
+                        Physics_SetRayQuery(queries + count, ent->obb->centre, target->obb->centre, ent->self, COLLISION_FILTER_CHARACTER);
+                        targets[count] = target;
+                        dots[count] = t;
+                        count++;
                     }
                 }
             }
         }
     }
 
+    // visibility of all candidates is tested in one batch
+    Physics_TestBatch(queries, count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if((dots[i] > max_dot) && (!queries[i].result.hit || (queries[i].result.obj == targets[i]->self)))
+        {
+            max_dot = dots[i];
+            ret = targets[i];
+        }
+    }
+
     return ret;
 }
 
@@ -2076,7 +2151,7 @@ void  Character_SetTarget(struct entity_s *ent, uint32_t target_id)
 {
     if(ent && ent->character)
     {
-        ent->character->target_id = target_id;
+        ent->character->target = World_GetEntityHandle(World_GetEntityByID(target_id));
     }
 }
 
@@ -2233,7 +2308,7 @@ int Character_DoOneHandWeponFrame(struct entity_s *ent, struct  ss_animation_s *
         float dt;
         int32_t t;
         uint16_t targeted_bone = (ss_anim->type == ANIM_TYPE_WEAPON_LH) ? (ent->character->bone_l_hand_start) : (ent->character->bone_r_hand_start);
-        entity_p target = (ent->character->target_id != ENTITY_ID_NONE) ? World_GetEntityByID(ent->character->target_id) : (NULL);
+        entity_p target = World_GetEntityByHandle(ent->character->target);
         bool silent = false;
         if(target)
         {
@@ -2525,7 +2600,7 @@ int Character_DoTwoHandWeponFrame(struct entity_s *ent, struct  ss_animation_s *
     {
         float dt;
         int32_t t;
-        entity_p target = (ent->character->target_id != ENTITY_ID_NONE) ? World_GetEntityByID(ent->character->target_id) : (NULL);
+        entity_p target = World_GetEntityByHandle(ent->character->target);
         if(target)
         {
             const float bone_dir[3] = {0.0f, 1.0f, 0.0f};
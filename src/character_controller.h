@@ -62,6 +62,8 @@
 #define CHARACTER_BOX_HALF_SIZE (128.0)
 #define CHARACTER_BASE_RADIUS   (128.0)
 #define CHARACTER_BASE_HEIGHT   (512.0)
+#define CHARACTER_MAX_TARGET_QUERIES    (64)        // targets tested per Character_FindTarget() call
+#define CHARACTER_CLIMB_QUERIES_BATCH   (4)         // climb edge search casts tested at once, small to keep early exit
 
 /*
  * ENTITY MOVEMENT TYPES
@@ -263,7 +265,7 @@ typedef struct character_s
     struct character_param_s    parameters;
     struct character_stats_s    statistics;
 
-    uint32_t                    target_id;
+    uint32_t                    target;                                         // entity handle, see World_GetEntityHandle()
     int8_t                      cam_follow_center;
     int8_t                      hair_count;
     struct hair_s             **hairs;
@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "vmath.h"
+#include "bvh.h"
+
+
+static inline float BVH_ItemKey(bvh_p bvh, uint16_t item, int axis)
+{
+    const float *bb = bvh->item_bb + 6 * item;
+    return bb[axis] + bb[3 + axis];                                             // doubled centre
+}
+
+
+static void BVH_SetLeafBox(bvh_p bvh, bvh_node_p node)
+{
+    const float *bb = bvh->item_bb + 6 * bvh->items[node->first];
+
+    vec3_copy(node->bb_min, bb);
+    vec3_copy(node->bb_max, bb + 3);
+    for(uint16_t i = 1; i < node->count; i++)
+    {
+        bb = bvh->item_bb + 6 * bvh->items[node->first + i];
+        for(int k = 0; k < 3; k++)
+        {
+            node->bb_min[k] = (bb[k] < node->bb_min[k]) ? (bb[k]) : (node->bb_min[k]);
+            node->bb_max[k] = (bb[3 + k] > node->bb_max[k]) ? (bb[3 + k]) : (node->bb_max[k]);
+        }
+    }
+}
+
+
+static void BVH_SetInnerBox(bvh_p bvh, bvh_node_p node)
+{
+    bvh_node_p l = bvh->nodes + node->first;
+    bvh_node_p r = l + 1;
+
+    for(int k = 0; k < 3; k++)
+    {
+        node->bb_min[k] = (l->bb_min[k] < r->bb_min[k]) ? (l->bb_min[k]) : (r->bb_min[k]);
+        node->bb_max[k] = (l->bb_max[k] > r->bb_max[k]) ? (l->bb_max[k]) : (r->bb_max[k]);
+    }
+}
+
+/*
+ * Moves k-th (by centre on axis) item of the range to the k-th place,
+ * smaller ones are placed before it, greater - after.
+ */
+static void BVH_Select(bvh_p bvh, uint16_t *items, int count, int k, int axis)
+{
+    int lo = 0;
+    int hi = count - 1;
+
+    while(lo < hi)
+    {
+        float pivot = BVH_ItemKey(bvh, items[(lo + hi) / 2], axis);
+        int i = lo;
+        int j = hi;
+        while(i <= j)
+        {
+            while(BVH_ItemKey(bvh, items[i], axis) < pivot)
+            {
+                i++;
+            }
+            while(BVH_ItemKey(bvh, items[j], axis) > pivot)
+            {
+                j--;
+            }
+            if(i <= j)
+            {
+                uint16_t t = items[i];
+                items[i] = items[j];
+                items[j] = t;
+                i++;
+                j--;
+            }
+        }
+
+        if(k <= j)
+        {
+            hi = j;
+        }
+        else if(k >= i)
+        {
+            lo = i;
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+
+static void BVH_Split(bvh_p bvh, uint16_t node_index, uint16_t first, uint16_t count)
+{
+    bvh_node_p node = bvh->nodes + node_index;
+
+    node->first = first;
+    node->count = count;
+    if(count <= BVH_LEAF_SIZE)
+    {
+        for(uint16_t i = 0; i < count; i++)
+        {
+            bvh->item_leaf[bvh->items[first + i]] = node_index;
+        }
+        BVH_SetLeafBox(bvh, node);
+    }
+    else
+    {
+        float c_min[3], c_max[3];
+        uint16_t left = bvh->nodes_count;
+        uint16_t half = count / 2;
+        int axis = 0;
+
+        c_min[0] = c_max[0] = BVH_ItemKey(bvh, bvh->items[first], 0);
+        c_min[1] = c_max[1] = BVH_ItemKey(bvh, bvh->items[first], 1);
+        c_min[2] = c_max[2] = BVH_ItemKey(bvh, bvh->items[first], 2);
+        for(uint16_t i = 1; i < count; i++)
+        {
+            for(int k = 0; k < 3; k++)
+            {
+                float c = BVH_ItemKey(bvh, bvh->items[first + i], k);
+                c_min[k] = (c < c_min[k]) ? (c) : (c_min[k]);
+                c_max[k] = (c > c_max[k]) ? (c) : (c_max[k]);
+            }
+        }
+        axis = (c_max[1] - c_min[1] > c_max[axis] - c_min[axis]) ? (1) : (axis);
+        axis = (c_max[2] - c_min[2] > c_max[axis] - c_min[axis]) ? (2) : (axis);
+        BVH_Select(bvh, bvh->items + first, count, half, axis);
+
+        bvh->nodes_count += 2;
+        bvh->nodes[left].parent = node_index;
+        bvh->nodes[left + 1].parent = node_index;
+        node->first = left;
+        node->count = 0;
+        BVH_Split(bvh, left, first, half);
+        BVH_Split(bvh, left + 1, first + half, count - half);
+        BVH_SetInnerBox(bvh, node);
+    }
+}
+
+
+bvh_p BVH_Create(const float *item_bb, uint16_t items_count)
+{
+    bvh_p bvh;
+
+    if((items_count == 0) || (items_count > BVH_MAX_ITEMS))
+    {
+        return NULL;
+    }
+
+    bvh = (bvh_p)malloc(sizeof(bvh_t));
+    bvh->items_count = items_count;
+    bvh->nodes_count = 1;
+    bvh->nodes = (bvh_node_p)malloc(2 * items_count * sizeof(bvh_node_t));
+    bvh->items = (uint16_t*)malloc(items_count * sizeof(uint16_t));
+    bvh->item_leaf = (uint16_t*)malloc(items_count * sizeof(uint16_t));
+    bvh->item_bb = (float*)malloc(6 * items_count * sizeof(float));
+    memcpy(bvh->item_bb, item_bb, 6 * items_count * sizeof(float));
+    for(uint16_t i = 0; i < items_count; i++)
+    {
+        bvh->items[i] = i;
+    }
+
+    bvh->nodes[0].parent = 0;
+    BVH_Split(bvh, 0, 0, items_count);
+
+    return bvh;
+}
+
+
+void BVH_Delete(bvh_p bvh)
+{
+    if(bvh)
+    {
+        free(bvh->nodes);
+        free(bvh->items);
+        free(bvh->item_leaf);
+        free(bvh->item_bb);
+        free(bvh);
+    }
+}
+
+
+void BVH_Refit(bvh_p bvh, uint16_t item, const float bb_min[3], const float bb_max[3])
+{
+    uint16_t node_index = bvh->item_leaf[item];
+    float *bb = bvh->item_bb + 6 * item;
+
+    vec3_copy(bb, bb_min);
+    vec3_copy(bb + 3, bb_max);
+    BVH_SetLeafBox(bvh, bvh->nodes + node_index);
+    while(node_index != 0)
+    {
+        node_index = bvh->nodes[node_index].parent;
+        BVH_SetInnerBox(bvh, bvh->nodes + node_index);
+    }
+}
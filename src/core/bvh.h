@@ -0,0 +1,49 @@
+
+#ifndef BVH_H
+#define BVH_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Small static AABB tree over user items (items are addressed by index in
+ * the array, passed to BVH_Create). Tree is built once by median split;
+ * moved item is handled by BVH_Refit(), which updates boxes of nodes on the
+ * way from item's leaf to the root only, so topology stays the same.
+ * Children of inner node are stored together: right = left + 1.
+ */
+#define BVH_LEAF_SIZE       (4)
+#define BVH_MAX_DEPTH       (32)
+#define BVH_MAX_ITEMS       (0x7FFF)
+
+typedef struct bvh_node_s
+{
+    float           bb_min[3];
+    float           bb_max[3];
+    uint16_t        parent;
+    uint16_t        first;                      // leaf: first item in bvh->items, inner: left child
+    uint16_t        count;                      // leaf: items count, inner: 0
+    uint16_t        unused;
+}bvh_node_t, *bvh_node_p;
+
+typedef struct bvh_s
+{
+    uint16_t        items_count;
+    uint16_t        nodes_count;
+    bvh_node_p      nodes;                      // nodes[0] - root
+    uint16_t       *items;                      // items indexes, grouped by leaves
+    uint16_t       *item_leaf;                  // item index -> leaf node
+    float          *item_bb;                    // bb_min[3], bb_max[3] per item
+}bvh_t, *bvh_p;
+
+bvh_p BVH_Create(const float *item_bb, uint16_t items_count);  // NULL if no items or more than BVH_MAX_ITEMS
+void  BVH_Delete(bvh_p bvh);
+void  BVH_Refit(bvh_p bvh, uint16_t item, const float bb_min[3], const float bb_max[3]);
+
+#ifdef	__cplusplus
+}
+#endif
+#endif /* BVH_H */
@@ -271,6 +271,10 @@ PFNGLISVERTEXARRAYPROC                  qglIsVertexArray = NULL;
 
 PFNGLGENERATEMIPMAPEXTPROC              qglGenerateMipmap = NULL;
 
+PFNGLDRAWARRAYSINSTANCEDARBPROC         qglDrawArraysInstancedARB = NULL;
+PFNGLDRAWELEMENTSINSTANCEDARBPROC       qglDrawElementsInstancedARB = NULL;
+PFNGLVERTEXATTRIBDIVISORARBPROC         qglVertexAttribDivisorARB = NULL;
+
 static char *engine_gl_ext_str = NULL;
 static GLuint whiteTexture = 0;
 
@@ -572,6 +576,14 @@ void InitGLExtFuncs()
     {
         Sys_Error("Shaders not supported");
     }
+
+    /// instancing funcs, renderer falls back to not instanced path without them
+    if(IsGLExtensionSupported("GL_ARB_draw_instanced") && IsGLExtensionSupported("GL_ARB_instanced_arrays"))
+    {
+        qglDrawArraysInstancedARB = (PFNGLDRAWARRAYSINSTANCEDARBPROC)SDL_GL_GetProcAddress("glDrawArraysInstancedARB");
+        qglDrawElementsInstancedARB = (PFNGLDRAWELEMENTSINSTANCEDARBPROC)SDL_GL_GetProcAddress("glDrawElementsInstancedARB");
+        qglVertexAttribDivisorARB = (PFNGLVERTEXATTRIBDIVISORARBPROC)SDL_GL_GetProcAddress("glVertexAttribDivisorARB");
+    }
 }
 
 /**
@@ -428,6 +428,11 @@ extern PFNGLISVERTEXARRAYPROC qglIsVertexArray;
 
 extern PFNGLGENERATEMIPMAPPROC qglGenerateMipmap;
 
+/* instancing EXT, NULL if not supported */
+extern PFNGLDRAWARRAYSINSTANCEDARBPROC qglDrawArraysInstancedARB;
+extern PFNGLDRAWELEMENTSINSTANCEDARBPROC qglDrawElementsInstancedARB;
+extern PFNGLVERTEXATTRIBDIVISORARBPROC qglVertexAttribDivisorARB;
+
 void InitGLExtFuncs();
 int IsGLExtensionSupported(const char *ext);
 
@@ -0,0 +1,247 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+#include <SDL2/SDL_atomic.h>
+#include <SDL2/SDL_cpuinfo.h>
+
+#include "jobs.h"
+
+
+typedef struct job_s
+{
+    job_func_t          func;
+    void               *data;
+    job_group_p         group;
+} job_t, *job_p;
+
+static struct
+{
+    SDL_mutex          *mutex;
+    SDL_cond           *job_cond;                   // new job in queue or shutdown
+    SDL_cond           *done_cond;                  // some job was finished
+    SDL_Thread         *workers[JOBS_MAX_WORKERS];
+    int                 workers_count;
+    int                 shutdown;
+
+    job_t               queue[JOBS_QUEUE_SIZE];     // ring buffer
+    uint32_t            queue_head;
+    uint32_t            queue_size;
+} jobs_state =
+{
+    NULL, NULL, NULL, {NULL}, 0, 0, {{NULL, NULL, NULL}}, 0, 0
+};
+
+
+static void Jobs_Run(job_p job)
+{
+    job->func(job->data);
+    SDL_LockMutex(jobs_state.mutex);
+    SDL_AtomicAdd(&job->group->pending, -1);
+    SDL_CondBroadcast(jobs_state.done_cond);
+    SDL_UnlockMutex(jobs_state.mutex);
+}
+
+/*
+ * Must be called with locked mutex.
+ */
+static int Jobs_Pop(job_p job)
+{
+    if(jobs_state.queue_size > 0)
+    {
+        *job = jobs_state.queue[jobs_state.queue_head];
+        jobs_state.queue_head = (jobs_state.queue_head + 1) % JOBS_QUEUE_SIZE;
+        jobs_state.queue_size--;
+        return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * Must be called with locked mutex. Takes the first queued job of the group,
+ * so waiting owner never gets stuck in other (maybe long) jobs.
+ */
+static int Jobs_PopGroup(job_p job, job_group_p group)
+{
+    for(uint32_t i = 0; i < jobs_state.queue_size; i++)
+    {
+        uint32_t index = (jobs_state.queue_head + i) % JOBS_QUEUE_SIZE;
+        if(jobs_state.queue[index].group == group)
+        {
+            *job = jobs_state.queue[index];
+            for(; i > 0; i--)                                                   // keep order of the rest
+            {
+                uint32_t prev = (jobs_state.queue_head + i - 1) % JOBS_QUEUE_SIZE;
+                jobs_state.queue[(jobs_state.queue_head + i) % JOBS_QUEUE_SIZE] = jobs_state.queue[prev];
+            }
+            jobs_state.queue_head = (jobs_state.queue_head + 1) % JOBS_QUEUE_SIZE;
+            jobs_state.queue_size--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+static int Jobs_WorkerFunc(void *data)
+{
+    job_t job;
+
+    SDL_LockMutex(jobs_state.mutex);
+    while(!jobs_state.shutdown)
+    {
+        if(Jobs_Pop(&job))
+        {
+            SDL_UnlockMutex(jobs_state.mutex);
+            Jobs_Run(&job);
+            SDL_LockMutex(jobs_state.mutex);
+        }
+        else
+        {
+            SDL_CondWait(jobs_state.job_cond, jobs_state.mutex);
+        }
+    }
+    SDL_UnlockMutex(jobs_state.mutex);
+
+    return 0;
+}
+
+
+void Jobs_Init(int workers_count)
+{
+    char name[32];
+
+    if(jobs_state.mutex)
+    {
+        return;
+    }
+
+    if(workers_count <= 0)
+    {
+        workers_count = SDL_GetCPUCount() - 1;
+    }
+    workers_count = (workers_count > JOBS_MAX_WORKERS) ? (JOBS_MAX_WORKERS) : (workers_count);
+
+    jobs_state.mutex = SDL_CreateMutex();
+    jobs_state.job_cond = SDL_CreateCond();
+    jobs_state.done_cond = SDL_CreateCond();
+    jobs_state.shutdown = 0;
+    jobs_state.queue_head = 0;
+    jobs_state.queue_size = 0;
+    jobs_state.workers_count = 0;
+
+    for(int i = 0; i < workers_count; i++)
+    {
+        snprintf(name, sizeof(name), "worker_%d", i);
+        jobs_state.workers[i] = SDL_CreateThread(Jobs_WorkerFunc, name, NULL);
+        if(jobs_state.workers[i] == NULL)
+        {
+            break;
+        }
+        jobs_state.workers_count++;
+    }
+}
+
+
+void Jobs_Destroy()
+{
+    if(jobs_state.mutex == NULL)
+    {
+        return;
+    }
+
+    SDL_LockMutex(jobs_state.mutex);
+    jobs_state.shutdown = 1;
+    SDL_CondBroadcast(jobs_state.job_cond);
+    SDL_UnlockMutex(jobs_state.mutex);
+
+    for(int i = 0; i < jobs_state.workers_count; i++)
+    {
+        SDL_WaitThread(jobs_state.workers[i], NULL);
+        jobs_state.workers[i] = NULL;
+    }
+    jobs_state.workers_count = 0;
+
+    SDL_DestroyCond(jobs_state.job_cond);
+    SDL_DestroyCond(jobs_state.done_cond);
+    SDL_DestroyMutex(jobs_state.mutex);
+    jobs_state.job_cond = NULL;
+    jobs_state.done_cond = NULL;
+    jobs_state.mutex = NULL;
+}
+
+
+int  Jobs_GetWorkersCount()
+{
+    return jobs_state.workers_count;
+}
+
+
+void Jobs_InitGroup(job_group_p group)
+{
+    SDL_AtomicSet(&group->pending, 0);
+}
+
+
+void Jobs_Add(job_group_p group, job_func_t func, void *data)
+{
+    SDL_AtomicAdd(&group->pending, 1);
+
+    if(jobs_state.workers_count > 0)
+    {
+        SDL_LockMutex(jobs_state.mutex);
+        if(jobs_state.queue_size < JOBS_QUEUE_SIZE)
+        {
+            job_p job = jobs_state.queue + (jobs_state.queue_head + jobs_state.queue_size) % JOBS_QUEUE_SIZE;
+            job->func = func;
+            job->data = data;
+            job->group = group;
+            jobs_state.queue_size++;
+            SDL_CondSignal(jobs_state.job_cond);
+            SDL_UnlockMutex(jobs_state.mutex);
+            return;
+        }
+        SDL_UnlockMutex(jobs_state.mutex);
+    }
+
+    // no workers or queue is full - execute in place.
+    func(data);
+    SDL_AtomicAdd(&group->pending, -1);
+}
+
+
+void Jobs_Wait(job_group_p group)
+{
+    job_t job;
+
+    if(jobs_state.workers_count == 0)
+    {
+        return;                                                                 // all jobs were executed in Jobs_Add
+    }
+
+    SDL_LockMutex(jobs_state.mutex);
+    while(SDL_AtomicGet(&group->pending) > 0)
+    {
+        if(Jobs_PopGroup(&job, group))
+        {
+            SDL_UnlockMutex(jobs_state.mutex);
+            Jobs_Run(&job);
+            SDL_LockMutex(jobs_state.mutex);
+        }
+        else
+        {
+            SDL_CondWait(jobs_state.done_cond, jobs_state.mutex);
+        }
+    }
+    SDL_UnlockMutex(jobs_state.mutex);
+}
+
+
+int  Jobs_IsDone(job_group_p group)
+{
+    return SDL_AtomicGet(&group->pending) <= 0;
+}
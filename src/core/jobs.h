@@ -0,0 +1,42 @@
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <SDL2/SDL_atomic.h>
+
+#define JOBS_MAX_WORKERS            (16)
+#define JOBS_QUEUE_SIZE             (1024)
+
+/*
+ * Small worker pool for CPU-only tasks (no GL, no Lua, no console output).
+ * Jobs are grouped; owner of the group waits for it with Jobs_Wait(), which
+ * also executes queued jobs of that group only (so frame critical waits never
+ * run long background jobs, like music decoding); zero workers configuration
+ * degrades to serial execution.
+ */
+typedef void (*job_func_t)(void *data);
+
+typedef struct job_group_s
+{
+    SDL_atomic_t    pending;
+} job_group_t, *job_group_p;
+
+void Jobs_Init(int workers_count);          // workers_count <= 0 - use (CPU count - 1)
+void Jobs_Destroy();
+int  Jobs_GetWorkersCount();
+
+void Jobs_InitGroup(job_group_p group);
+void Jobs_Add(job_group_p group, job_func_t func, void *data);
+void Jobs_Wait(job_group_p group);
+int  Jobs_IsDone(job_group_p group);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif /* JOBS_H */
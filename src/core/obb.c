@@ -374,3 +374,27 @@ int OBB_OBB_Test(obb_p obb1, obb_p obb2, float extend)
     the two boxes overlap */
     return 1;
 }
+
+
+/*
+ * Bounding box of transformed OBB polygons (world coordinates).
+ */
+void OBB_GetAABB(obb_p obb, float bb_min[3], float bb_max[3])
+{
+    vertex_p v = obb->polygons[0].vertices;
+
+    vec3_copy(bb_min, v->position);
+    vec3_copy(bb_max, v->position);
+    for(int i = 0; i < 6; i++)
+    {
+        v = obb->polygons[i].vertices;
+        for(uint16_t j = 0; j < obb->polygons[i].vertex_count; j++, v++)
+        {
+            for(int k = 0; k < 3; k++)
+            {
+                bb_min[k] = (v->position[k] < bb_min[k]) ? (v->position[k]) : (bb_min[k]);
+                bb_max[k] = (v->position[k] > bb_max[k]) ? (v->position[k]) : (bb_max[k]);
+            }
+        }
+    }
+}
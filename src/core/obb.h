@@ -41,6 +41,7 @@ void OBB_Delete(obb_p bv);
 void OBB_Rebuild(obb_p obb, float bb_min[3], float bb_max[3]);
 void OBB_Transform(obb_p obb);
 int OBB_OBB_Test(obb_p obb1, obb_p obb2, float extend);
+void OBB_GetAABB(obb_p obb, float bb_min[3], float bb_max[3]);
 
 #ifdef	__cplusplus
 }
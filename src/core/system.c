@@ -169,7 +169,7 @@ void Sys_Warn(const char *warning, ...)
 void Sys_DebugLog(const char *file, const char *fmt, ...)
 {
     va_list argptr;
-    static char data[4096];
+    char data[4096];
     int32_t written;
 
     va_start(argptr, fmt);
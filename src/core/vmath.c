@@ -2,6 +2,9 @@
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "vmath.h"
 
 
@@ -434,6 +437,96 @@ void vec4_slerp(float ret[4], float q1[4], float q2[4], float t)
 }
 
 
+#if defined(__SSE2__)
+/*
+ * sin(y), y in [0, pi / 2]: Taylor series up to y^11.
+ */
+static inline __m128 vec4_sin_ps(__m128 y)
+{
+    __m128 y2 = _mm_mul_ps(y, y);
+    __m128 s = _mm_set1_ps(-1.0f / 39916800.0f);
+    s = _mm_add_ps(_mm_mul_ps(s, y2), _mm_set1_ps( 1.0f / 362880.0f));
+    s = _mm_add_ps(_mm_mul_ps(s, y2), _mm_set1_ps(-1.0f / 5040.0f));
+    s = _mm_add_ps(_mm_mul_ps(s, y2), _mm_set1_ps( 1.0f / 120.0f));
+    s = _mm_add_ps(_mm_mul_ps(s, y2), _mm_set1_ps(-1.0f / 6.0f));
+    s = _mm_add_ps(_mm_mul_ps(s, y2), _mm_set1_ps(1.0f));
+    return _mm_mul_ps(s, y);
+}
+#endif
+
+/**
+ * vec4_slerp for arrays of quaternions (x, y, z, w), t - array of lerp factors.
+ * SSE2 path evaluates 4 quaternions at once with polynomial acos / sin
+ * (error is about 1e-7), tail and non SSE2 builds use vec4_slerp.
+ */
+void vec4_slerp_array(float *ret, const float *q1, const float *q2, const float *t, uint32_t count)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+    for(; i + 4 <= count; i += 4, q1 += 16, q2 += 16, t += 4, ret += 16)
+    {
+        __m128 ax = _mm_loadu_ps(q1 + 0), ay = _mm_loadu_ps(q1 + 4), az = _mm_loadu_ps(q1 + 8), aw = _mm_loadu_ps(q1 + 12);
+        __m128 bx = _mm_loadu_ps(q2 + 0), by = _mm_loadu_ps(q2 + 4), bz = _mm_loadu_ps(q2 + 8), bw = _mm_loadu_ps(q2 + 12);
+        __m128 tt = _mm_loadu_ps(t);
+        __m128 cos_fi, sign, x, fi, sin_fi, k1, k2, mask, len;
+
+        _MM_TRANSPOSE4_PS(ax, ay, az, aw);
+        _MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+        cos_fi = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(aw, bw), _mm_mul_ps(ax, bx)), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+        sign = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(cos_fi, _mm_setzero_ps()), sign_mask), one);
+        x = _mm_min_ps(_mm_and_ps(cos_fi, abs_mask), one);
+
+        // acos(x), x in [0, 1]: Abramowitz & Stegun 4.4.46
+        fi = _mm_set1_ps(-0.0012624911f);
+        fi = _mm_add_ps(_mm_mul_ps(fi, x), _mm_set1_ps( 0.0066700901f));
+        fi = _mm_add_ps(_mm_mul_ps(fi, x), _mm_set1_ps(-0.0170881256f));
+        fi = _mm_add_ps(_mm_mul_ps(fi, x), _mm_set1_ps( 0.0308918810f));
+        fi = _mm_add_ps(_mm_mul_ps(fi, x), _mm_set1_ps(-0.0501743046f));
+        fi = _mm_add_ps(_mm_mul_ps(fi, x), _mm_set1_ps( 0.0889789874f));
+        fi = _mm_add_ps(_mm_mul_ps(fi, x), _mm_set1_ps(-0.2145988016f));
+        fi = _mm_add_ps(_mm_mul_ps(fi, x), _mm_set1_ps( 1.5707963050f));
+        fi = _mm_mul_ps(fi, _mm_sqrt_ps(_mm_sub_ps(one, x)));
+        sin_fi = _mm_sqrt_ps(_mm_sub_ps(one, _mm_mul_ps(x, x)));               // sin(acos(x))
+
+        k1 = vec4_sin_ps(_mm_mul_ps(fi, _mm_sub_ps(one, tt)));
+        k2 = vec4_sin_ps(_mm_mul_ps(fi, tt));
+        k1 = _mm_div_ps(k1, sin_fi);
+        k2 = _mm_div_ps(_mm_mul_ps(k2, sign), sin_fi);
+
+        mask = _mm_and_ps(_mm_cmpgt_ps(sin_fi, _mm_set1_ps(0.00001f)),
+                          _mm_and_ps(_mm_cmpgt_ps(tt, _mm_set1_ps(0.0001f)), _mm_cmplt_ps(tt, one)));
+        k1 = _mm_or_ps(_mm_and_ps(mask, k1), _mm_andnot_ps(mask, _mm_sub_ps(one, tt)));
+        k2 = _mm_or_ps(_mm_and_ps(mask, k2), _mm_andnot_ps(mask, tt));
+
+        ax = _mm_add_ps(_mm_mul_ps(k1, ax), _mm_mul_ps(k2, bx));
+        ay = _mm_add_ps(_mm_mul_ps(k1, ay), _mm_mul_ps(k2, by));
+        az = _mm_add_ps(_mm_mul_ps(k1, az), _mm_mul_ps(k2, bz));
+        aw = _mm_add_ps(_mm_mul_ps(k1, aw), _mm_mul_ps(k2, bw));
+        len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(ay, ay)), _mm_mul_ps(az, az)), _mm_mul_ps(aw, aw)));
+        len = _mm_div_ps(one, len);
+        ax = _mm_mul_ps(ax, len);
+        ay = _mm_mul_ps(ay, len);
+        az = _mm_mul_ps(az, len);
+        aw = _mm_mul_ps(aw, len);
+
+        _MM_TRANSPOSE4_PS(ax, ay, az, aw);
+        _mm_storeu_ps(ret + 0, ax);
+        _mm_storeu_ps(ret + 4, ay);
+        _mm_storeu_ps(ret + 8, az);
+        _mm_storeu_ps(ret + 12, aw);
+    }
+#endif
+    for(; i < count; i++, q1 += 4, q2 += 4, t++, ret += 4)
+    {
+        vec4_slerp(ret, (float*)q1, (float*)q2, *t);
+    }
+}
+
+
 void vec4_slerp_to(float ret[4], float q1[4], float q2[4], float max_step_rad)
 {
     float cos_fi, sin_fi, fi, k1, k2, sign;
@@ -865,6 +958,30 @@ void Mat4_Mat4_mul(float result[16], const float src1[16], const float src2[16])
 }
 
 
+/**
+ * Mat4_Mat4_mul with SSE2, same summation order, so results are equal.
+ */
+void Mat4_Mat4_mul_SIMD(float result[16], const float src1[16], const float src2[16])
+{
+#if defined(__SSE2__)
+    const __m128 c0 = _mm_loadu_ps(src1 + 0);
+    const __m128 c1 = _mm_loadu_ps(src1 + 4);
+    const __m128 c2 = _mm_loadu_ps(src1 + 8);
+    const __m128 c3 = _mm_loadu_ps(src1 + 12);
+    // column j of result depends only on column j of src2, so aliasing is safe.
+    for(int j = 0; j < 16; j += 4)
+    {
+        __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(src2[j + 0])), _mm_mul_ps(c1, _mm_set1_ps(src2[j + 1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(src2[j + 2])));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(src2[j + 3])));
+        _mm_storeu_ps(result + j, r);
+    }
+#else
+    Mat4_Mat4_mul(result, src1, src2);
+#endif
+}
+
+
 /**
  * OpenGL matrices multiplication. serult = (src1^-1) x src2.
  * Works only with affine transformation matrices!
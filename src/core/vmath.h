@@ -147,6 +147,7 @@ void vec4_slerp(float ret[4], float q1[4], float q2[4], float t);
 void vec4_slerp_to(float ret[4], float q1[4], float q2[4], float max_step_rad);
 void vec4_clampw(float q[4], float w);
 void vec4_SetZXYRotations(float v[4], float rot[3]);
+void vec4_slerp_array(float *ret, const float *q1, const float *q2, const float *t, uint32_t count);
 
 
 /*
@@ -250,6 +251,7 @@ void Mat4_T(float mat[16]);
 void Mat4_affine_inv(float mat[16]);
 int  Mat4_inv(float mat[16], float inv[16]);
 void Mat4_Mat4_mul(float result[16], const float src1[16], const float src2[16]);
+void Mat4_Mat4_mul_SIMD(float result[16], const float src1[16], const float src2[16]);
 void Mat4_inv_Mat4_affine_mul(float result[16], float src1[16], float src2[16]);
 void Mat4_vec3_mul(float v[3], const float mat[16], const float src[3]);
 void Mat4_vec3_mul_inv(float v[3], float mat[16], float src[3]);
@@ -3,6 +3,7 @@
 #include <SDL2/SDL_platform.h>
 #include <SDL2/SDL_opengl.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
@@ -17,14 +18,17 @@ extern "C" {
 }
 
 #include "core/system.h"
+#include "core/jobs.h"
 #include "core/gl_util.h"
 #include "core/gl_font.h"
 #include "core/console.h"
 #include "core/vmath.h"
 #include "core/polygon.h"
+#include "core/obb.h"
 #include "core/gl_text.h"
 #include "render/camera.h"
 #include "render/render.h"
+#include "render/frustum.h"
 #include "script/script.h"
 #include "physics/physics.h"
 #include "gui/gui.h"
@@ -37,6 +41,7 @@ extern "C" {
 #include "gameflow.h"
 #include "room.h"
 #include "world.h"
+#include "world_cache.h"
 #include "resource.h"
 #include "engine.h"
 #include "controls.h"
@@ -58,6 +63,15 @@ static ALCcontext             *al_context     = NULL;
 static char                     base_path[1024] = {0};
 static volatile int             engine_done   = 0;
 static int                      engine_set_zero_time = 0;
+
+static struct
+{
+    int                         frames_left;                // frames to sample, see Engine_BenchFrames()
+    int                         frames;
+    float                       frame_time;
+    float                       frame_time_max;
+    float                       game_time;
+}engine_bench_frames = {0, 0, 0.0f, 0.0f, 0.0f};
 float time_scale = 1.0f;
 
 engine_container_p      last_cont = NULL;
@@ -81,6 +95,7 @@ enum debug_view_state_e
     sector_info,
     room_objects,
     bsp_info,
+    perf_info,
     model_view,
     debug_states_count
 };
@@ -227,6 +242,7 @@ void Engine_Shutdown(int val)
     Gui_Destroy();
     Con_Destroy();
     GLText_Destroy();
+    Jobs_Destroy();
     Sys_Destroy();
 
     /* no more renderings */
@@ -301,6 +317,7 @@ void Engine_Init_Pre()
      * Rendering activation may be done later. */
 
     Sys_Init();
+    Jobs_Init(0);
     GLText_Init();
     Con_Init();
     Gameflow_Init();
@@ -567,6 +584,7 @@ void Engine_LoadConfig(const char *filename)
             Script_ParseAudio(lua, &audio_settings);
             Script_ParseConsole(lua);
             Script_ParseControls(lua, &control_mapper);
+            Script_ParsePhysics(lua, &physics_settings);
             lua_close(lua);
         }
     }
@@ -836,6 +854,46 @@ void Engine_JoyRumble(float power, int time)
 }
 
 
+/*
+ * Real (not scaled and not clamped) frame time of the next frames is
+ * averaged and reported with game logic part and live entities count, so
+ * entity heavy levels may be compared between builds.
+ */
+void Engine_BenchFrames(int count)
+{
+    engine_bench_frames.frames_left = count;
+    engine_bench_frames.frames = -1;                                            // current frame is not complete
+    engine_bench_frames.frame_time = 0.0f;
+    engine_bench_frames.frame_time_max = 0.0f;
+    engine_bench_frames.game_time = 0.0f;
+}
+
+
+static void Engine_BenchFramesUpdate(float time)
+{
+    if(engine_bench_frames.frames_left <= 0)
+    {
+        return;
+    }
+
+    if(engine_bench_frames.frames++ < 0)
+    {
+        engine_bench_frames.game_time = 0.0f;
+        return;
+    }
+
+    engine_bench_frames.frame_time += time;
+    engine_bench_frames.frame_time_max = (time > engine_bench_frames.frame_time_max) ? (time) : (engine_bench_frames.frame_time_max);
+    if(--engine_bench_frames.frames_left == 0)
+    {
+        float n = (float)engine_bench_frames.frames;
+        Engine_BenchReport("bench_frames", "frame %.3f ms (max %.3f ms), game %.3f ms, %d frames, %d entities",
+                           1000.0f * engine_bench_frames.frame_time / n, 1000.0f * engine_bench_frames.frame_time_max,
+                           1000.0f * engine_bench_frames.game_time / n, engine_bench_frames.frames, World_GetEntitiesCount());
+    }
+}
+
+
 void Engine_MainLoop()
 {
     float time = 0.0f;
@@ -852,6 +910,7 @@ void Engine_MainLoop()
         newtime = Sys_FloatTime();
         time = newtime - oldtime;
         oldtime = newtime;
+        Engine_BenchFramesUpdate(time);
         time *= time_scale;
 
         if(engine_set_zero_time)
@@ -859,9 +918,9 @@ void Engine_MainLoop()
             engine_set_zero_time = 0;
             time = 0.0f;
         }
-        else if(time > 1.0f / 30.0f)
+        else if(time > Physics_GetMaxFrameTime())
         {
-            time = 1.0f / 30.0f;
+            time = Physics_GetMaxFrameTime();
         }
 
         engine_frame_time = time;
@@ -886,11 +945,14 @@ void Engine_MainLoop()
         fps->style_id   = FONTSTYLE_MENU_TITLE;
 
         Sys_ResetTempMem();
+        Physics_ResetQueryStats();
         Engine_PollSDLEvents();
         if(screen_info.debug_view_state != debug_view_state_e::model_view)
         {
+            float game_time = Sys_FloatTime();
             Game_Frame(time);
             Gameflow_ProcessCommands();
+            engine_bench_frames.game_time += (engine_bench_frames.frames_left > 0) ? (Sys_FloatTime() - game_time) : (0.0f);
         }
         Audio_Update(time);
         Engine_Display();
@@ -1074,6 +1136,10 @@ void ShowDebugInfo()
 {
     float y = (float)screen_info.h;
     const float dy = -18.0f * screen_info.scale_factor;
+    float lua_loop_time, list_time;
+    uint32_t lua_loop_count, pvs_rooms, pvs_culled, draw_calls, state_changes, queue_items, instances;
+    int32_t saved_draw_calls;
+    physics_query_stats_t query_stats;
 
     if(last_cont && (screen_info.debug_view_state != debug_view_state_e::model_view))
     {
@@ -1250,9 +1316,29 @@ void ShowDebugInfo()
             {
                 GLText_OutTextXY(30.0f, y += dy, "input polygons = %07d", renderer.dynamicBSP->GetInputPolygonsCount());
                 GLText_OutTextXY(30.0f, y += dy, "added polygons = %07d", renderer.dynamicBSP->GetAddedPolygonsCount());
+                GLText_OutTextXY(30.0f, y += dy, "split polygons = %07d", renderer.dynamicBSP->GetSplitPolygonsCount());
+                GLText_OutTextXY(30.0f, y += dy, "uploaded vertices = %07d", renderer.dynamicBSP->GetUploadedVertexCount());
             }
             break;
 
+        case debug_view_state_e::perf_info:
+            GLText_OutTextXY(30.0f, y += dy, "VIEW: Performance stats");
+            Script_GetLoopEntitiesStats(&lua_loop_time, &lua_loop_count);
+            GLText_OutTextXY(30.0f, y += dy, "lua onLoop: %.3f ms, %d entities", 1000.0f * lua_loop_time, lua_loop_count);
+            renderer.GetListStats(&list_time, &pvs_rooms, &pvs_culled);
+            GLText_OutTextXY(30.0f, y += dy, "rooms list: %.3f ms, pvs = %d rooms, %d portals culled", 1000.0f * list_time, pvs_rooms, pvs_culled);
+            renderer.GetDrawStats(&draw_calls, &state_changes, &queue_items);
+            GLText_OutTextXY(30.0f, y += dy, "draw: %d calls, %d state changes, %d queued faces", draw_calls, state_changes, queue_items);
+            if(renderer.GetInstancingStats(&instances, &saved_draw_calls))
+            {
+                GLText_OutTextXY(30.0f, y += dy, "instancing: %d instances, %d draw calls (%d without instancing)", instances, draw_calls, draw_calls + saved_draw_calls);
+            }
+            Physics_GetQueryStats(&query_stats);
+            GLText_OutTextXY(30.0f, y += dy, "queries: %d single, %d batched in %d batches / %d groups (%d candidates), %.3f ms",
+                             query_stats.single_queries, query_stats.batched_queries, query_stats.batches, query_stats.groups, query_stats.candidates, query_stats.batch_time);
+            GLText_OutTextXY(30.0f, y += dy, "physics: %d sub steps (%s)", Physics_GetLastSubSteps(), (physics_settings.fixed_step) ? ("fixed") : ("variable"));
+            break;
+
         case debug_view_state_e::model_view:
             GLText_OutTextXY(30.0f, y += dy, "VIEW: MODELS ANIM (use o, p, [, ], w, s, space, v and arrows)");
             break;
@@ -1367,7 +1453,9 @@ bool Engine_LoadPCLevel(const char *name)
         tr_level->prepare_level();
         //tr_level->dump_textures();
 
+        WorldCache_Open(name);
         World_Open(tr_level);
+        WorldCache_Close();
 
         char buf[LEVEL_NAME_MAX_LEN] = {0x00};
         Engine_GetLevelName(buf, name);
@@ -1456,6 +1544,578 @@ int Engine_LoadMap(const char *name)
 }
 
 
+int Engine_BenchParseCount(char **ch, char *token, int def)
+{
+    int count = def;
+
+    *ch = SC_ParseToken(*ch, token);
+    if(NULL != *ch)
+    {
+        count = atoi(token);
+    }
+
+    return (count > 0) ? (count) : (def);
+}
+
+float Engine_BenchUs(float time, uint32_t runs)
+{
+    return (runs > 0) ? (1000000.0f * time / (float)runs) : (0.0f);
+}
+
+void Engine_BenchReport(const char *name, const char *fmt, ...)
+{
+    va_list argptr;
+    char buf[4096];
+    int len = snprintf(buf, sizeof(buf), "%s: ", name);
+
+    va_start(argptr, fmt);
+    vsnprintf(buf + len, sizeof(buf) - len, fmt, argptr);
+    va_end(argptr);
+
+    Con_Printf("%s", buf);
+    Sys_DebugLog(SYS_LOG_FILENAME, "%s", buf);
+}
+
+void Engine_BenchLevelLoad(const char *name, int count)
+{
+    int trv = VT_Level::get_PC_level_version(name);
+    if(trv == TR_UNKNOWN)
+    {
+        Con_Warning("bench_load: can not detect level version of \"%s\"", name);
+        return;
+    }
+
+    for(int buffered = 0; buffered < 2; buffered++)
+    {
+        float time = Sys_FloatTime();
+        for(int i = 0; i < count; i++)
+        {
+            VT_Level *tr_level = new VT_Level();
+            tr_level->read_level(name, trv, buffered != 0);
+            delete tr_level;
+        }
+        time = Engine_BenchUs(Sys_FloatTime() - time, count) / 1000.0f;
+
+        Engine_BenchReport("bench_load", "\"%s\" %s read %.2f ms (%d runs)", name, (buffered) ? ("buffered") : ("streamed"), time, count);
+    }
+}
+
+typedef struct bench_pose_list_s
+{
+    ss_bone_frame_p    *frames;
+    uint32_t            count;
+    uint32_t            size;
+}bench_pose_list_t, *bench_pose_list_p;
+
+static int Engine_BenchPoseCollect(entity_p ent, void *data)
+{
+    bench_pose_list_p list = (bench_pose_list_p)data;
+    if(ent->bf && ent->bf->animations.model && ent->bf->bone_tag_count && (list->count < list->size))
+    {
+        list->frames[list->count++] = ent->bf;
+    }
+    return 0;
+}
+
+void Engine_BenchPose(int count)
+{
+    bench_pose_list_t list;
+    float time_scalar, time_batch, time_cold, max_q_diff = 0.0f, max_tr_diff = 0.0f;
+    uint32_t mismatches = 0;
+
+    list.count = 0;
+    list.size = 1024;
+    list.frames = (ss_bone_frame_p*)malloc(list.size * sizeof(ss_bone_frame_p));
+    World_IterateAllEntities(Engine_BenchPoseCollect, &list);
+    if(list.count == 0)
+    {
+        Con_Warning("bench_pose: no animated entities");
+        free(list.frames);
+        return;
+    }
+
+    time_scalar = Sys_FloatTime();
+    for(int i = 0; i < count; i++)
+    {
+        SSBoneFrame_UpdatePoseScalar(list.frames[i % list.count]);
+    }
+    time_scalar = Sys_FloatTime() - time_scalar;
+
+    time_batch = Sys_FloatTime();
+    for(int i = 0; i < count; i++)
+    {
+        SSBoneFrame_UpdatePose(list.frames[i % list.count]);
+    }
+    time_batch = Sys_FloatTime() - time_batch;
+
+    // packed frames decoding on each pose
+    time_cold = Sys_FloatTime();
+    for(int i = 0; i < count; i++)
+    {
+        SSBoneFrame_ResetFrameCache(list.frames[i % list.count]);
+        SSBoneFrame_UpdatePose(list.frames[i % list.count]);
+    }
+    time_cold = Sys_FloatTime() - time_cold;
+
+    for(uint32_t i = 0; i < list.count; i++)
+    {
+        ss_bone_frame_p bf = list.frames[i];
+        float *ref = (float*)malloc(bf->bone_tag_count * 20 * sizeof(float));
+        SSBoneFrame_UpdatePoseScalar(bf);
+        for(uint16_t j = 0; j < bf->bone_tag_count; j++)
+        {
+            vec4_copy(ref + 20 * j, bf->bone_tags[j].qrotate);
+            Mat4_Copy(ref + 20 * j + 4, bf->bone_tags[j].full_transform);
+        }
+        SSBoneFrame_UpdatePose(bf);
+        for(uint16_t j = 0; j < bf->bone_tag_count; j++)
+        {
+            float q_diff = 0.0f;
+            for(int k = 0; k < 4; k++)
+            {
+                float d = fabs(ref[20 * j + k] - bf->bone_tags[j].qrotate[k]);
+                q_diff = (d > q_diff) ? (d) : (q_diff);
+            }
+            for(int k = 0; k < 16; k++)
+            {
+                float d = fabs(ref[20 * j + 4 + k] - bf->bone_tags[j].full_transform[k]);
+                max_tr_diff = (d > max_tr_diff) ? (d) : (max_tr_diff);
+            }
+            max_q_diff = (q_diff > max_q_diff) ? (q_diff) : (max_q_diff);
+            mismatches += (q_diff > 0.00001f);
+        }
+        free(ref);
+    }
+    free(list.frames);
+
+    Engine_BenchReport("bench_pose", "scalar %.3f us, batch %.3f us (no frame cache %.3f us), %d poses, max diff q %g / matrix %g, %d mismatches",
+                       Engine_BenchUs(time_scalar, count), Engine_BenchUs(time_batch, count), Engine_BenchUs(time_cold, count),
+                       count, max_q_diff, max_tr_diff, mismatches);
+}
+
+typedef struct bench_camera_point_s
+{
+    float               transform[16];
+    float               fov;
+}bench_camera_point_t, *bench_camera_point_p;
+
+static float Engine_BenchPortalsReplay(camera_p cam, bench_camera_point_p path, int count, uint32_t *hashes, room_p *rooms, uint32_t rooms_count, uint32_t *culled)
+{
+    float time = 0.0f;
+
+    *culled = 0;
+    cam->current_room = NULL;
+    for(int i = 0; i < count; i++)
+    {
+        float t;
+        uint32_t hash = 2166136261u, list_count;
+        Mat4_Copy(cam->gl_transform, path[i].transform);
+        Cam_SetFovAspect(cam, path[i].fov, cam->aspect);
+        Cam_Apply(cam);
+        Cam_RecalcClipPlanes(cam);
+
+        t = Sys_FloatTime();
+        renderer.GenWorldList(cam);
+        time += Sys_FloatTime() - t;
+
+        {
+            float list_time;
+            uint32_t pvs_rooms, pvs_culled;
+            renderer.GetListStats(&list_time, &pvs_rooms, &pvs_culled);
+            *culled += pvs_culled;
+        }
+
+        list_count = renderer.GetRoomsList(rooms, rooms_count);
+        for(uint32_t j = 0; j < list_count; j++)
+        {
+            hash = (hash ^ rooms[j]->id) * 16777619u;
+            for(frustum_p f = rooms[j]->frustum; f; f = f->next)
+            {
+                hash = (hash ^ f->vertex_count) * 16777619u;
+            }
+        }
+        hashes[i] = hash;
+    }
+
+    return time;
+}
+
+/*
+ * Replays camera path (flyby sequences of the level or path through all rooms
+ * centres) with serial traversal without rooms PVS (reference), then serial
+ * and parallel traversal with PVS, no drawing.
+ */
+void Engine_BenchPortals(int count)
+{
+    camera_t cam;
+    room_p rooms, *list;
+    uint32_t rooms_count, seq_count = 0, mismatches_pvs = 0, mismatches_parallel = 0, culled_serial, culled_parallel;
+    uint32_t *hashes_ref, *hashes_serial, *hashes_parallel;
+    bench_camera_point_p path;
+    flyby_camera_sequence_p seq = World_GetFlyBySequences();
+    int8_t parallel_portals = renderer.settings.parallel_portals;
+    int8_t room_pvs = renderer.settings.room_pvs;
+    float time_ref, time_serial, time_parallel;
+
+    World_GetRoomInfo(&rooms, &rooms_count);
+    if(rooms_count == 0)
+    {
+        Con_Warning("bench_portals: no level loaded");
+        return;
+    }
+
+    Cam_Init(&cam);
+    cam.dist_near = engine_camera.dist_near;
+    cam.dist_far = engine_camera.dist_far;
+    cam.aspect = engine_camera.aspect;
+
+    for(flyby_camera_sequence_p s = seq; s; s = s->next)
+    {
+        seq_count++;
+    }
+
+    path = (bench_camera_point_p)malloc(count * sizeof(bench_camera_point_t));
+    for(int i = 0; i < count; i++)
+    {
+        float u = (float)i / (float)count;
+        if(seq_count > 0)
+        {
+            flyby_camera_sequence_p s = seq;
+            uint32_t index = u * seq_count;
+            u = u * seq_count - index;
+            for(uint32_t j = 0; j < index; j++)
+            {
+                s = s->next;
+            }
+            FlyBySequence_SetCamera(s, &cam, u * (s->pos_x->base_points_count - 1));
+        }
+        else
+        {
+            float from[3], to[3];
+            uint32_t index = u * rooms_count;
+            room_p r1 = rooms + index;
+            room_p r2 = rooms + (index + 1) % rooms_count;
+            u = u * rooms_count - index;
+            vec3_add(from, r1->bb_min, r1->bb_max);
+            vec3_add(to, r2->bb_min, r2->bb_max);
+            vec3_mul_scalar(from, from, 0.5f);
+            vec3_mul_scalar(to, to, 0.5f);
+            vec3_interpolate_macro(cam.gl_transform + 12, from, to, u, 1.0f - u);
+            to[2] += 1.0f;                                                      // never look to own position
+            Cam_LookTo(&cam, to);
+        }
+        Mat4_Copy(path[i].transform, cam.gl_transform);
+        path[i].fov = cam.fov;
+    }
+
+    list = (room_p*)malloc(rooms_count * sizeof(room_p));
+    hashes_ref = (uint32_t*)malloc(3 * count * sizeof(uint32_t));
+    hashes_serial = hashes_ref + count;
+    hashes_parallel = hashes_serial + count;
+
+    renderer.settings.parallel_portals = 0;
+    renderer.settings.room_pvs = 0;
+    time_ref = Engine_BenchPortalsReplay(&cam, path, count, hashes_ref, list, rooms_count, &culled_serial);
+    renderer.settings.room_pvs = 1;
+    time_serial = Engine_BenchPortalsReplay(&cam, path, count, hashes_serial, list, rooms_count, &culled_serial);
+    renderer.settings.parallel_portals = 1;
+    time_parallel = Engine_BenchPortalsReplay(&cam, path, count, hashes_parallel, list, rooms_count, &culled_parallel);
+    renderer.settings.parallel_portals = parallel_portals;
+    renderer.settings.room_pvs = room_pvs;
+
+    for(int i = 0; i < count; i++)
+    {
+        mismatches_pvs += (hashes_ref[i] != hashes_serial[i]);
+        mismatches_parallel += (hashes_ref[i] != hashes_parallel[i]);
+    }
+
+    free(hashes_ref);
+    free(list);
+    free(path);
+    free(cam.frustum->vertex);
+    free(cam.frustum);
+    renderer.GenWorldList(&engine_camera);                                     // renderer must not keep local camera
+
+    Engine_BenchReport("bench_portals", "no pvs %.3f us, pvs %.3f us (%.1f portals culled), parallel + pvs %.3f us (%d workers), %d cameras (%s), %d / %d mismatches",
+                       Engine_BenchUs(time_ref, count), Engine_BenchUs(time_serial, count), (float)culled_serial / (float)count,
+                       Engine_BenchUs(time_parallel, count), Jobs_GetWorkersCount(),
+                       count, (seq_count > 0) ? ("flyby") : ("rooms"), mismatches_pvs, mismatches_parallel);
+}
+
+/*
+ * Static meshes of the rendered rooms are tested against room's frustums
+ * list (as DrawRoom does), or against camera frustum if nothing is rendered.
+ */
+void Engine_BenchFrustum(int count)
+{
+    room_p rooms;
+    uint32_t rooms_count, obbs_count = 0, visible = 0, mismatches_single = 0, mismatches_batch = 0;
+    obb_p *obbs;
+    uint32_t *groups;                                                           // first obb of the room, per room + 1
+    uint8_t *ref, *single, *batch;
+    float time_scalar, time_single, time_batch;
+
+    World_GetRoomInfo(&rooms, &rooms_count);
+    if(rooms_count == 0)
+    {
+        Con_Warning("bench_frustum: no level loaded");
+        return;
+    }
+
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        obbs_count += rooms[i].content->static_mesh_count;
+    }
+    if(obbs_count == 0)
+    {
+        Con_Warning("bench_frustum: no static meshes");
+        return;
+    }
+
+    obbs = (obb_p*)malloc(obbs_count * sizeof(obb_p));
+    groups = (uint32_t*)malloc((rooms_count + 1) * sizeof(uint32_t));
+    ref = (uint8_t*)malloc(3 * obbs_count * sizeof(uint8_t));
+    single = ref + obbs_count;
+    batch = single + obbs_count;
+    obbs_count = 0;
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        groups[i] = obbs_count;
+        for(uint32_t j = 0; j < rooms[i].content->static_mesh_count; j++)
+        {
+            obbs[obbs_count++] = rooms[i].content->static_mesh[j].obb;
+        }
+    }
+    groups[rooms_count] = obbs_count;
+
+    time_scalar = Sys_FloatTime();
+    for(int n = 0; n < count; n++)
+    {
+        for(uint32_t i = 0; i < rooms_count; i++)
+        {
+            frustum_p list = (rooms[i].is_in_r_list && rooms[i].frustum) ? (rooms[i].frustum) : (engine_camera.frustum);
+            for(uint32_t j = groups[i]; j < groups[i + 1]; j++)
+            {
+                ref[j] = 0x00;
+                for(frustum_p f = list; f; f = f->next)
+                {
+                    if(Frustum_IsOBBVisibleScalar(obbs[j], f))
+                    {
+                        ref[j] = 0x01;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    time_scalar = Sys_FloatTime() - time_scalar;
+
+    time_single = Sys_FloatTime();
+    for(int n = 0; n < count; n++)
+    {
+        for(uint32_t i = 0; i < rooms_count; i++)
+        {
+            frustum_p list = (rooms[i].is_in_r_list && rooms[i].frustum) ? (rooms[i].frustum) : (engine_camera.frustum);
+            for(uint32_t j = groups[i]; j < groups[i + 1]; j++)
+            {
+                single[j] = Frustum_IsOBBVisibleInFrustumList(obbs[j], list);
+            }
+        }
+    }
+    time_single = Sys_FloatTime() - time_single;
+
+    time_batch = Sys_FloatTime();
+    for(int n = 0; n < count; n++)
+    {
+        for(uint32_t i = 0; i < rooms_count; i++)
+        {
+            frustum_p list = (rooms[i].is_in_r_list && rooms[i].frustum) ? (rooms[i].frustum) : (engine_camera.frustum);
+            Frustum_IsOBBsVisibleInFrustumList(obbs + groups[i], groups[i + 1] - groups[i], list, batch + groups[i]);
+        }
+    }
+    time_batch = Sys_FloatTime() - time_batch;
+
+    for(uint32_t i = 0; i < obbs_count; i++)
+    {
+        visible += ref[i];
+        mismatches_single += (ref[i] != single[i]);
+        mismatches_batch += (ref[i] != batch[i]);
+    }
+
+    free(ref);
+    free(groups);
+    free(obbs);
+
+    Engine_BenchReport("bench_frustum", "scalar %.3f us, simd (x%d) %.3f us, batch %.3f us, %d boxes (%d visible), %d / %d mismatches",
+                       Engine_BenchUs(time_scalar, count), FRUSTUM_SIMD_WIDTH, Engine_BenchUs(time_single, count),
+                       Engine_BenchUs(time_batch, count), obbs_count, visible, mismatches_single, mismatches_batch);
+}
+
+typedef struct bench_queries_list_s
+{
+    physics_query_p     queries;
+    uint32_t           *groups;                                                 // first query of the entity
+    uint32_t            entities_count;
+    uint32_t            count;
+    uint32_t            size;
+}bench_queries_list_t, *bench_queries_list_p;
+
+static void Engine_BenchQueriesAdd(bench_queries_list_p list, physics_query_p query)
+{
+    if(list->count >= list->size)
+    {
+        list->size = (list->size) ? (2 * list->size) : (1024);
+        list->queries = (physics_query_p)realloc(list->queries, list->size * sizeof(physics_query_t));
+    }
+    list->queries[list->count++] = *query;
+}
+
+/*
+ * Per entity probes, as character controller and camera do: floor and
+ * ceiling rays, forward sphere cast and visibility rays to entities.
+ */
+static int Engine_BenchQueriesCollect(entity_p ent, void *data)
+{
+    bench_queries_list_p list = (bench_queries_list_p)data;
+    if(ent->self->room && (ent->state_flags & ENTITY_STATE_ENABLED))
+    {
+        physics_query_t q;
+        float to[3], r = (ent->character) ? (ent->character->climb_r) : (32.0f);
+
+        list->groups = (uint32_t*)realloc(list->groups, (list->entities_count + 2) * sizeof(uint32_t));
+        list->groups[list->entities_count++] = list->count;
+
+        vec3_copy(to, ent->transform + 12);
+        to[2] -= 8192.0f;
+        Physics_SetRayQuery(&q, ent->transform + 12, to, ent->self, COLLISION_FILTER_HEIGHT_TEST);
+        Engine_BenchQueriesAdd(list, &q);
+        to[2] += 8192.0f + 4096.0f;
+        Physics_SetRayQuery(&q, ent->transform + 12, to, ent->self, COLLISION_FILTER_HEIGHT_TEST);
+        Engine_BenchQueriesAdd(list, &q);
+        vec3_add_mul(to, ent->obb->centre, ent->transform + 4, 1024.0f);
+        Physics_SetSphereQuery(&q, ent->obb->centre, to, r, ent->self, COLLISION_FILTER_HEIGHT_TEST);
+        Engine_BenchQueriesAdd(list, &q);
+        for(uint32_t i = 0; (i + 1 < list->entities_count) && (i < 8); i++)
+        {
+            // floor rays of the previous entities start at their positions
+            physics_query_p first = list->queries + list->groups[i];
+            Physics_SetRayQuery(&q, ent->obb->centre, first->from, ent->self, COLLISION_FILTER_CHARACTER);
+            Engine_BenchQueriesAdd(list, &q);
+        }
+    }
+    return 0;
+}
+
+static uint32_t Engine_BenchQueriesCompare(physics_query_p a, physics_query_p b, uint32_t count)
+{
+    uint32_t mismatches = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        collision_result_p ra = &a[i].result, rb = &b[i].result;
+        mismatches += (ra->hit != rb->hit) || (ra->obj != rb->obj) || (fabs(ra->fraction - rb->fraction) > 0.001f);
+    }
+    return mismatches;
+}
+
+void Engine_BenchQueries(int count)
+{
+    bench_queries_list_t list;
+    physics_query_p ref, spread, spread_ref;
+    float time_single, time_entity, time_all, time_spread_single, time_spread_batch;
+    uint32_t hits = 0, mismatches_entity, mismatches_all, spread_count, mismatches_spread;
+
+    memset(&list, 0, sizeof(list));
+    World_IterateAllEntities(Engine_BenchQueriesCollect, &list);
+    if(list.count == 0)
+    {
+        Con_Warning("bench_queries: no entities");
+        free(list.groups);
+        return;
+    }
+    list.groups[list.entities_count] = list.count;
+    ref = (physics_query_p)malloc(list.count * sizeof(physics_query_t));
+    memcpy(ref, list.queries, list.count * sizeof(physics_query_t));
+
+    time_single = Sys_FloatTime();
+    for(int n = 0; n < count; n++)
+    {
+        for(uint32_t i = 0; i < list.count; i++)
+        {
+            physics_query_p q = ref + i;
+            if(q->type == PHYSICS_QUERY_SPHERE)
+            {
+                Physics_SphereTest(&q->result, q->from, q->to, q->radius, q->cont, q->filter);
+            }
+            else
+            {
+                Physics_RayTest(&q->result, q->from, q->to, q->cont, q->filter);
+            }
+        }
+    }
+    time_single = Sys_FloatTime() - time_single;
+
+    time_entity = Sys_FloatTime();
+    for(int n = 0; n < count; n++)
+    {
+        for(uint32_t i = 0; i < list.entities_count; i++)
+        {
+            Physics_TestBatch(list.queries + list.groups[i], list.groups[i + 1] - list.groups[i]);
+        }
+    }
+    time_entity = Sys_FloatTime() - time_entity;
+    mismatches_entity = Engine_BenchQueriesCompare(ref, list.queries, list.count);
+
+    time_all = Sys_FloatTime();
+    for(int n = 0; n < count; n++)
+    {
+        hits = Physics_TestBatch(list.queries, list.count);
+    }
+    time_all = Sys_FloatTime() - time_all;
+    mismatches_all = Engine_BenchQueriesCompare(ref, list.queries, list.count);
+
+    /*
+     * Spread batch: rays from the first entity to all others (as Character_FindTarget()
+     * does), batch box covers most of the level.
+     */
+    spread_count = list.entities_count - 1;
+    spread = (physics_query_p)malloc((spread_count + 1) * sizeof(physics_query_t));
+    for(uint32_t i = 0; i < spread_count; i++)
+    {
+        physics_query_p first = ref + list.groups[0];
+        Physics_SetRayQuery(spread + i, first->from, ref[list.groups[i + 1]].from, first->cont, COLLISION_FILTER_CHARACTER);
+    }
+    time_spread_single = Sys_FloatTime();
+    for(int n = 0; n < count; n++)
+    {
+        for(uint32_t i = 0; i < spread_count; i++)
+        {
+            Physics_RayTest(&spread[i].result, spread[i].from, spread[i].to, spread[i].cont, spread[i].filter);
+        }
+    }
+    time_spread_single = Sys_FloatTime() - time_spread_single;
+    spread_ref = (physics_query_p)malloc((spread_count + 1) * sizeof(physics_query_t));
+    memcpy(spread_ref, spread, spread_count * sizeof(physics_query_t));
+    time_spread_batch = Sys_FloatTime();
+    for(int n = 0; n < count; n++)
+    {
+        Physics_TestBatch(spread, spread_count);
+    }
+    time_spread_batch = Sys_FloatTime() - time_spread_batch;
+    mismatches_spread = Engine_BenchQueriesCompare(spread_ref, spread, spread_count);
+
+    free(spread);
+    free(spread_ref);
+    free(ref);
+    free(list.queries);
+    free(list.groups);
+
+    Engine_BenchReport("bench_queries", "single %.3f us, batch per entity %.3f us, one batch %.3f us (%d workers), %d queries / %d entities (%d hits), %d / %d mismatches",
+                       Engine_BenchUs(time_single, count), Engine_BenchUs(time_entity, count), Engine_BenchUs(time_all, count),
+                       Jobs_GetWorkersCount(), list.count, list.entities_count, hits, mismatches_entity, mismatches_all);
+    Engine_BenchReport("bench_queries", "spread: single %.3f us, batch %.3f us, %d rays, %d mismatches",
+                       Engine_BenchUs(time_spread_single, count), Engine_BenchUs(time_spread_batch, count), spread_count, mismatches_spread);
+}
+
 int Engine_ExecCmd(char *ch)
 {
     char token[1024];
@@ -1482,6 +2142,17 @@ int Engine_ExecCmd(char *ch)
             Con_AddLine("r_wireframe, r_portals, r_frustums, r_room_boxes, r_boxes, r_normals, r_skip_room, r_flyby, r_triggers - render modes\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("playsound(id) - play specified sound\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("stopsound(id) - stop specified sound\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_load file_name [count] - measure level file read time (streamed / buffered)\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_find_room [count] - measure room search by position on random points\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_pose [count] - measure skeletal pose evaluation (scalar / batch) on level entities\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_portals [count] - measure portal visibility (no pvs / pvs / parallel) on camera path, no drawing\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_frustum [count] - measure static meshes frustum tests (scalar / simd / batch) on rendered rooms\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_entities [count] - measure entity lookup by id and iteration (table / map)\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_frames [count] - measure average frame and game logic time of the next frames\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_flip [count] - measure flip collisions update (full / incremental / cached) on level flipmaps\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_queries [count] - measure entity probe rays / sphere casts (single / batch per entity / one batch / spread batch)\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_heights [count] - validate and measure floor / ceiling heights from sectors against physics rays\0", FONTSTYLE_CONSOLE_NOTIFY);
+            Con_AddLine("bench_stream [track] - measure ogg track start and memory (full decode / streamed)\0", FONTSTYLE_CONSOLE_NOTIFY);
             Con_AddLine("Watch out for case sensitive commands!\0", FONTSTYLE_CONSOLE_WARNING);
         }
         else if(!strcmp(token, "goto"))
@@ -1647,6 +2318,73 @@ int Engine_ExecCmd(char *ch)
             }
             return 1;
         }
+        else if(!strcmp(token, "bench_load"))
+        {
+            ch = SC_ParseToken(ch, token);
+            if(NULL != ch)
+            {
+                char level_name[1024];
+                strncpy(level_name, token, sizeof(level_name));
+                Engine_BenchLevelLoad(level_name, Engine_BenchParseCount(&ch, token, 1));
+            }
+            return 1;
+        }
+        else if(!strcmp(token, "bench_find_room"))
+        {
+            World_BenchFindRoomByPos(Engine_BenchParseCount(&ch, token, 100000));
+            return 1;
+        }
+        else if(!strcmp(token, "bench_pose"))
+        {
+            Engine_BenchPose(Engine_BenchParseCount(&ch, token, 100000));
+            return 1;
+        }
+        else if(!strcmp(token, "bench_portals"))
+        {
+            Engine_BenchPortals(Engine_BenchParseCount(&ch, token, 1000));
+            return 1;
+        }
+        else if(!strcmp(token, "bench_frustum"))
+        {
+            Engine_BenchFrustum(Engine_BenchParseCount(&ch, token, 1000));
+            return 1;
+        }
+        else if(!strcmp(token, "bench_entities"))
+        {
+            World_BenchEntities(Engine_BenchParseCount(&ch, token, 1000000));
+            return 1;
+        }
+        else if(!strcmp(token, "bench_frames"))
+        {
+            Engine_BenchFrames(Engine_BenchParseCount(&ch, token, 1000));
+            return 1;
+        }
+        else if(!strcmp(token, "bench_flip"))
+        {
+            World_BenchFlipCollisions(Engine_BenchParseCount(&ch, token, 10));
+            return 1;
+        }
+        else if(!strcmp(token, "bench_queries"))
+        {
+            Engine_BenchQueries(Engine_BenchParseCount(&ch, token, 1000));
+            return 1;
+        }
+        else if(!strcmp(token, "bench_heights"))
+        {
+            World_BenchHeights(Engine_BenchParseCount(&ch, token, 100000));
+            return 1;
+        }
+        else if(!strcmp(token, "bench_stream"))
+        {
+            int track = -1;
+            ch = SC_ParseToken(ch, token);
+            if(NULL != ch)
+            {
+                track = atoi(token);
+            }
+            Audio_BenchStream(track);
+            return 1;
+        }
         else if(!strcmp(token, "xxx"))
         {
             SDL_RWops *f = SDL_RWFromFile("ascII.txt", "r");
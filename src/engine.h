@@ -131,6 +131,18 @@ void Engine_MainLoop();
 // PC-specific level loader routines.
 
 bool Engine_LoadPCLevel(const char *name);
+void Engine_BenchLevelLoad(const char *name, int count);
+void Engine_BenchPose(int count);
+void Engine_BenchPortals(int count);
+void Engine_BenchFrustum(int count);
+void Engine_BenchQueries(int count);
+void Engine_BenchFrames(int count);
+
+// Benchmarks common: optional runs count of console command, time per run
+// and result line, which is printed to console and written to debug log.
+int   Engine_BenchParseCount(char **ch, char *token, int def);
+float Engine_BenchUs(float time, uint32_t runs);
+void  Engine_BenchReport(const char *name, const char *fmt, ...);
 
 // General level loading routines.
 
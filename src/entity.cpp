@@ -1144,6 +1144,19 @@ void Entity_MoveToSink(entity_p entity, struct static_camera_sink_s *sink)
 
 
 void Entity_Frame(entity_p entity, float time)
+{
+    if(Entity_FrameAnimations(entity, time))
+    {
+        SSBoneFrame_Update(entity->bf, time);
+    }
+}
+
+/*
+ * Animation state step without bone frame update (SSBoneFrame_Update()), that
+ * part touches only entity bone frame and may be executed later / in worker.
+ * Returns 1 if bone frame must be updated.
+ */
+int  Entity_FrameAnimations(entity_p entity, float time)
 {
     if(entity && !(entity->type_flags & ENTITY_TYPE_DYNAMIC) && (entity->state_flags & ENTITY_STATE_ACTIVE)  && (entity->state_flags & ENTITY_STATE_ENABLED))
     {
@@ -1206,8 +1219,10 @@ void Entity_Frame(entity_p entity, float time)
             ss_anim = ss_anim->next;
         }
 
-        SSBoneFrame_Update(entity->bf, time);
+        return 1;
     }
+
+    return 0;
 }
 
 /**
@@ -1220,6 +1235,7 @@ void Entity_RebuildBV(entity_p ent)
         //get current BB from animation
         OBB_Rebuild(ent->obb, ent->bf->bb_min, ent->bf->bb_max);
         OBB_Transform(ent->obb);
+        Room_UpdateEntityBV(ent->self);
     }
 }
 
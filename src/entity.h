@@ -104,6 +104,7 @@ struct inventory_node_s;
 #define ENTITY_CALLBACK_COLLISION                   (0x00000004)
 #define ENTITY_CALLBACK_STAND                       (0x00000008)
 #define ENTITY_CALLBACK_HIT                         (0x00000010)
+#define ENTITY_CALLBACK_LOOP                        (0x00000020)    // Has onLoop, set by scripts, see Script_LoopEntities()
 
 #define ENTITY_SUBSTANCE_NONE                     0
 #define ENTITY_SUBSTANCE_WATER_SHALLOW            1
@@ -186,6 +187,7 @@ void Entity_UpdateRoomPos(entity_p ent);
 void Entity_MoveToRoom(entity_p entity, struct room_s *new_room);
 
 void Entity_Frame(entity_p entity, float time);  // process frame + trying to change state
+int  Entity_FrameAnimations(entity_p entity, float time);  // Entity_Frame without bone frame update
 
 void Entity_RebuildBV(entity_p ent);
 void Entity_UpdateTransform(entity_p entity);
@@ -10,6 +10,7 @@ extern "C" {
 
 #include "core/system.h"
 #include "core/console.h"
+#include "core/jobs.h"
 #include "core/vmath.h"
 #include "core/polygon.h"
 #include "core/obb.h"
@@ -26,6 +27,7 @@ extern "C" {
 #include "game.h"
 #include "audio.h"
 #include "skeletal_model.h"
+#include "physics/physics.h"
 #include "entity.h"
 #include "trigger.h"
 #include "character_controller.h"
@@ -242,9 +244,10 @@ int Save_Entity(entity_p ent, void *data)
         {
             fprintf(*f, "\nsetCharacterClimbPoint(%d, %.2f, %.2f, %.2f);", ent->id,
                     ent->character->climb.point[0], ent->character->climb.point[1], ent->character->climb.point[2]);
-            if(ent->character->target_id != ENTITY_ID_NONE)
+            entity_p target = World_GetEntityByHandle(ent->character->target);
+            if(target)
             {
-                fprintf(*f, "\nsetCharacterTarget(%d, %d);", ent->id, ent->character->target_id);
+                fprintf(*f, "\nsetCharacterTarget(%d, %d);", ent->id, target->id);
             }
             else
             {
@@ -544,6 +547,53 @@ void Game_ApplyControls(struct entity_s *ent)
 }
 
 
+/*
+ * Entities are updated one by one in entity tree order: logic, animation,
+ * rigid body and room position, so each entity sees already moved ones.
+ * Pose of entity without physics bodies is used by its room update only as
+ * bounding box; its bones are needed just for rendering, so they are
+ * evaluated after the entities pass on the jobs pool (touches only own bf).
+ */
+#define GAME_BONES_JOB_SIZE     (8)
+
+typedef struct game_bones_job_s
+{
+    entity_p           *entities;
+    uint32_t            count;
+    float               time;
+}game_bones_job_t, *game_bones_job_p;
+
+static struct
+{
+    entity_p           *bones;              // entities with deferred bones
+    uint32_t            bones_count;
+    uint32_t            bones_size;
+    game_bones_job_p    jobs;
+    uint32_t            jobs_size;
+}game_update = {NULL, 0, 0, NULL, 0};
+
+
+static void Game_PushEntity(entity_p **list, uint32_t *count, uint32_t *size, entity_p ent)
+{
+    if(*count >= *size)
+    {
+        *size = (*size) ? (2 * (*size)) : (64);
+        *list = (entity_p*)realloc(*list, *size * sizeof(entity_p));
+    }
+    (*list)[(*count)++] = ent;
+}
+
+
+static void Game_UpdateBonesJob(void *data)
+{
+    game_bones_job_p job = (game_bones_job_p)data;
+    for(uint32_t i = 0; i < job->count; i++)
+    {
+        SSBoneFrame_Update(job->entities[i]->bf, job->time);
+    }
+}
+
+
 int Game_UpdateEntity(entity_p ent, void *data)
 {
     if(ent && (ent != World_GetPlayer()) && (!ent->self->room || (ent->self->room == ent->self->room->real_room)))
@@ -557,7 +607,18 @@ int Game_UpdateEntity(entity_p ent, void *data)
             Entity_ProcessSector(ent);
             Script_LoopEntity(engine_lua, ent);
         }
-        Entity_Frame(ent, engine_frame_time);
+        if(Entity_FrameAnimations(ent, engine_frame_time))
+        {
+            if(ent->character || Physics_IsBodyesInited(ent->physics))
+            {
+                SSBoneFrame_Update(ent->bf, engine_frame_time);
+            }
+            else
+            {
+                SSBoneFrame_UpdateBounds(ent->bf);
+                Game_PushEntity(&game_update.bones, &game_update.bones_count, &game_update.bones_size, ent);
+            }
+        }
         Entity_UpdateRigidBody(ent, ent->character != NULL);
         Entity_UpdateRoomPos(ent);
     }
@@ -566,6 +627,38 @@ int Game_UpdateEntity(entity_p ent, void *data)
 }
 
 
+void Game_UpdateAllEntities()
+{
+    job_group_t group;
+    uint32_t jobs_count;
+
+    game_update.bones_count = 0;
+    World_IterateAllEntities(Game_UpdateEntity, NULL);
+
+    jobs_count = (game_update.bones_count + GAME_BONES_JOB_SIZE - 1) / GAME_BONES_JOB_SIZE;
+    if(jobs_count > game_update.jobs_size)
+    {
+        game_update.jobs_size = jobs_count;
+        game_update.jobs = (game_bones_job_p)realloc(game_update.jobs, jobs_count * sizeof(game_bones_job_t));
+    }
+
+    Jobs_InitGroup(&group);
+    for(uint32_t i = 0; i < jobs_count; i++)
+    {
+        game_bones_job_p job = game_update.jobs + i;
+        uint32_t first = i * GAME_BONES_JOB_SIZE;
+        job->entities = game_update.bones + first;
+        job->count = (game_update.bones_count - first < GAME_BONES_JOB_SIZE) ? (game_update.bones_count - first) : (GAME_BONES_JOB_SIZE);
+        job->time = engine_frame_time;
+        Jobs_Add(&group, Game_UpdateBonesJob, job);
+    }
+    Jobs_Wait(&group);
+
+    // Scripts may read bones, so they are called when all poses are ready.
+    Script_LoopEntities(engine_lua);
+}
+
+
 void Game_UpdateAI()
 {
     entity_p ent = NULL;
@@ -616,21 +709,17 @@ void Game_Frame(float time)
         if(!control_states.noclip)
         {
             Character_Update(player);
-            Script_LoopEntity(engine_lua, player);   ///@TODO: fix that hack (refactoring)
-            if(player->character->target_id == ENTITY_ID_NONE)
+            Script_LoopEntity(engine_lua, player);   ///@TODO: fix that hack (refactoring); called with other entities in Game_UpdateAllEntities()
+            if(player->character->target == ENTITY_ID_NONE)
             {
-                entity_p target = Character_FindTarget(player);
-                if(target)
-                {
-                    player->character->target_id = target->id;
-                }
+                player->character->target = World_GetEntityHandle(Character_FindTarget(player));
             }
             else if(player->character->weapon_current_state != WEAPON_STATE_HIDE)
             {
-                entity_p target = World_GetEntityByID(player->character->target_id);
+                entity_p target = World_GetEntityByHandle(player->character->target);
                 if(!target || !Character_IsTargetAccessible(player, target))
                 {
-                    player->character->target_id = ENTITY_ID_NONE;
+                    player->character->target = ENTITY_ID_NONE;
                 }
             }
         }
@@ -665,7 +754,7 @@ void Game_Frame(float time)
         }
     }
 
-    World_IterateAllEntities(Game_UpdateEntity, NULL);
+    Game_UpdateAllEntities();
 
     Physics_StepSimulation(time);
 
@@ -27,6 +27,7 @@ void Game_LevelTransition(uint16_t level_index);
 void Game_ApplyControls(struct entity_s *ent);
 
 void Game_UpdateAI();
+void Game_UpdateAllEntities();
 
 void Game_PlayFlyBy(uint32_t sequence_id, int once);
 void Game_SetCameraTarget(uint32_t entity_id, float timer);
@@ -99,20 +99,24 @@ void Cam_FollowEntity(struct camera_s *cam, struct camera_state_s *cam_state, st
         {
             if(cam_state->target_dir == TR_CAM_TARG_BACK)
             {
+                physics_query_t side_queries[2];
                 vec3_copy(cameraFrom, cam_pos);
                 cameraTo[0] = cameraFrom[0] + sinf((ent->angles[0] - 90.0f) * (M_PI / 180.0f)) * control_states.cam_distance;
                 cameraTo[1] = cameraFrom[1] - cosf((ent->angles[0] - 90.0f) * (M_PI / 180.0f)) * control_states.cam_distance;
                 cameraTo[2] = cameraFrom[2];
+                Physics_SetSphereQuery(side_queries + 0, cameraFrom, cameraTo, test_r, ent->self, filter);
+
+                cameraTo[0] = cameraFrom[0] + sinf((ent->angles[0] + 90.0f) * (M_PI / 180.0f)) * control_states.cam_distance;
+                cameraTo[1] = cameraFrom[1] - cosf((ent->angles[0] + 90.0f) * (M_PI / 180.0f)) * control_states.cam_distance;
+                cameraTo[2] = cameraFrom[2];
+                Physics_SetSphereQuery(side_queries + 1, cameraFrom, cameraTo, test_r, ent->self, filter);
+                Physics_TestBatch(side_queries, 2);
 
                 //If collided we want to go right otherwise stay left
-                if(Physics_SphereTest(NULL, cameraFrom, cameraTo, test_r, ent->self, filter))
+                if(side_queries[0].result.hit)
                 {
-                    cameraTo[0] = cameraFrom[0] + sinf((ent->angles[0] + 90.0f) * (M_PI / 180.0f)) * control_states.cam_distance;
-                    cameraTo[1] = cameraFrom[1] - cosf((ent->angles[0] + 90.0f) * (M_PI / 180.0f)) * control_states.cam_distance;
-                    cameraTo[2] = cameraFrom[2];
-
                     //If collided we want to go to back else right
-                    if(Physics_SphereTest(NULL, cameraFrom, cameraTo, test_r, ent->self, filter))
+                    if(side_queries[1].result.hit)
                     {
                         cam_state->target_dir = TR_CAM_TARG_BACK;
                     }
@@ -356,6 +356,27 @@ void BaseMesh_GenFaces(base_mesh_p mesh)
     
     mesh->faces_count = 0;
     mesh->faces = NULL;
+
+    for(uint32_t i = 0; i < mesh->polygons_count; i++, p++)
+    {
+        if((p->transparency < 2) && (p->anim_id == 0) && !Polygon_IsBroken(p))
+        {
+            BaseMesh_AddPolygonToFaces(mesh, p);
+        }
+    }
+
+    BaseMesh_GenAnimatedFaces(mesh);
+}
+
+
+/*
+ * Links transparency and animated polygons lists, generates animated faces
+ * and VBO. Static faces (and vertices) must be generated or loaded already.
+ */
+void BaseMesh_GenAnimatedFaces(base_mesh_p mesh)
+{
+    polygon_p p = mesh->polygons;
+
     mesh->animated_faces_count = 0;
     mesh->animated_faces = NULL;
 
@@ -367,11 +388,7 @@ void BaseMesh_GenFaces(base_mesh_p mesh)
     
     for(uint32_t i = 0; i < mesh->polygons_count; i++, p++)
     {
-        if((p->transparency < 2) && (p->anim_id == 0) && !Polygon_IsBroken(p))
-        {
-            BaseMesh_AddPolygonToFaces(mesh, p);
-        }
-        else if(p->transparency >= 2)
+        if(p->transparency >= 2)
         {
             p->next = mesh->transparency_polygons;
             mesh->transparency_polygons = p;            
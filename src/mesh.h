@@ -111,6 +111,7 @@ void BaseMesh_FindBB(base_mesh_p mesh);
 uint32_t BaseMesh_AddVertex(base_mesh_p mesh, struct vertex_s *vertex);
 uint32_t BaseMesh_FindVertexIndex(base_mesh_p mesh, float v[3]);
 void     BaseMesh_GenFaces(base_mesh_p mesh);
+void     BaseMesh_GenAnimatedFaces(base_mesh_p mesh);
 
 
 #ifdef	__cplusplus
@@ -38,6 +38,44 @@ typedef struct collision_result_s
 }collision_result_t, *collision_result_p;
 
 
+/*
+ * Batched queries: close rays and sphere casts of the batch are grouped (while
+ * group box is within PHYSICS_QUERY_GROUP_EXTENT), each group gets candidate
+ * objects from one broadphase (DBVT) pass over its box, then each query tests
+ * only candidates of its group, which AABB its sweep touches. Filtering and
+ * results are the same as of single Physics_RayTest / Physics_RayTestFiltered
+ * / Physics_SphereTest calls. Big batches are split to jobs workers.
+ * Call only from the main thread.
+ */
+#define PHYSICS_QUERY_RAY                  (0)
+#define PHYSICS_QUERY_RAY_FILTERED         (1)     // backfaces are skipped
+#define PHYSICS_QUERY_SPHERE               (2)
+#define PHYSICS_QUERY_GROUP_EXTENT         (2048.0f)
+#define PHYSICS_QUERY_GROUPS_SCAN          (8)     // recent groups, query may join
+#define PHYSICS_QUERY_JOB_SIZE             (32)    // batches of less than 2 * size (64) queries are tested by caller only
+
+typedef struct physics_query_s
+{
+    uint16_t                    type;
+    int16_t                     filter;
+    float                       radius;             // sphere cast only
+    float                       from[3];
+    float                       to[3];
+    struct engine_container_s  *cont;               // self, ignored by test
+    struct collision_result_s   result;
+}physics_query_t, *physics_query_p;
+
+typedef struct physics_query_stats_s
+{
+    uint32_t                    single_queries;     // Physics_*Test calls
+    uint32_t                    batched_queries;
+    uint32_t                    batches;
+    uint32_t                    groups;             // broadphase passes of batches
+    uint32_t                    candidates;         // objects got from broadphase by batches
+    float                       batch_time;         // ms
+}physics_query_stats_t, *physics_query_stats_p;
+
+
 typedef struct ghost_shape_s
 {
     uint32_t    shape_id;
@@ -48,6 +86,25 @@ typedef struct ghost_shape_s
 }ghost_shape_t, *ghost_shape_p;
 
 
+/*
+ * With fixed_step simulation runs with GAME_LOGIC_REFRESH_INTERVAL steps:
+ * frame time is accumulated and up to max_sub_steps steps are done per
+ * frame (the rest of a slow frame is lost). Between steps rendered
+ * transforms of dynamic bodies (ragdolls, hair) are interpolated.
+ * Without fixed_step there is one variable step per frame.
+ * Entity transforms are not interpolated: entity logic and animation are
+ * updated once per rendered frame with frame time, so they do not snap.
+ */
+#define PHYSICS_MAX_SUB_STEPS_DEFAULT      (2)
+
+typedef struct physics_settings_s
+{
+    int8_t      fixed_step;
+    int8_t      max_sub_steps;
+}physics_settings_t, *physics_settings_p;
+
+extern struct physics_settings_s physics_settings;
+
 struct physics_data_s;
 struct physics_object_s;
 
@@ -55,6 +112,8 @@ struct physics_object_s;
 void Physics_Init();
 void Physics_Destroy();
 void Physics_StepSimulation(float time);
+float Physics_GetMaxFrameTime();                            // frame time, which is simulated without loss
+int  Physics_GetLastSubSteps();                             // fixed steps done by last frame, for debug info
 void Physics_DebugDrawWorld();
 void Physics_CleanUpObjects();
 
@@ -67,12 +126,18 @@ void Physics_SetGravity(float g[3]);
 int  Physics_RayTest(struct collision_result_s *result, float from[3], float to[3], struct engine_container_s *cont, int16_t filter);
 int  Physics_RayTestFiltered(struct collision_result_s *result, float from[3], float to[3], struct engine_container_s *cont, int16_t filter);
 int  Physics_SphereTest(struct collision_result_s *result, float from[3], float to[3], float R, struct engine_container_s *cont, int16_t filter);
+int  Physics_TestBatch(struct physics_query_s *queries, uint32_t count);     // returns hits count
+void Physics_SetRayQuery(struct physics_query_s *query, float from[3], float to[3], struct engine_container_s *cont, int16_t filter);
+void Physics_SetSphereQuery(struct physics_query_s *query, float from[3], float to[3], float R, struct engine_container_s *cont, int16_t filter);
+void Physics_GetQueryStats(struct physics_query_stats_s *stats);
+void Physics_ResetQueryStats();
 
 /* Physics object manipulation functions */
 int  Physics_IsBodyesInited(struct physics_data_s *physics);
 int  Physics_IsGhostsInited(struct physics_data_s *physics);
 int  Physics_GetBodiesCount(struct physics_data_s *physics);
 void Physics_GetBodyWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index);
+void Physics_GetBodyRenderTransform(struct physics_data_s *physics, float tr[16], uint16_t index);  // for drawing only: interpolated between fixed steps
 void Physics_SetBodyWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index);
 void Physics_GetGhostWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index);
 void Physics_SetGhostWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index);
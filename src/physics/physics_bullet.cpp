@@ -13,6 +13,8 @@
 #include <BulletCollision/NarrowPhaseCollision/btRaycastCallback.h>
 
 #include "../core/gl_util.h"
+#include "../core/jobs.h"
+#include "../core/system.h"
 #include "../core/gl_font.h"
 #include "../core/gl_text.h"
 #include "../core/console.h"
@@ -28,6 +30,7 @@
 #include "../resource.h"
 #include "../room.h"
 #include "../world.h"
+#include "../game.h"
 #include "physics.h"
 #include "ragdoll.h"
 #include "hair.h"
@@ -153,6 +156,40 @@ private:
 };
 
 
+struct bt_engine_Candidate
+{
+    btCollisionObject   *m_object;
+    btVector3            m_bounds[2];
+};
+
+
+/*
+ * Batch queries close to each other share one broadphase pass over their
+ * united box; candidates of the group are m_candidates[first, first + count).
+ */
+struct bt_engine_QueryGroup
+{
+    btVector3            m_bounds[2];
+    int                  m_first;
+    int                  m_count;
+};
+
+
+struct bt_engine_CandidatesCallback : public btBroadphaseAabbCallback
+{
+    virtual bool process(const btBroadphaseProxy *proxy) override
+    {
+        bt_engine_Candidate &c = m_candidates.expandNonInitializing();
+        c.m_object = (btCollisionObject*)proxy->m_clientObject;
+        c.m_bounds[0] = proxy->m_aabbMin;
+        c.m_bounds[1] = proxy->m_aabbMax;
+        return true;
+    }
+
+    btAlignedObjectArray<bt_engine_Candidate> m_candidates;
+};
+
+
 struct bt_engine_OverlapFilterCallback : public btOverlapFilterCallback
 {
 	// return true when pairs need collision
@@ -287,6 +324,13 @@ btDiscreteDynamicsWorld                 *bt_engine_dynamicsWorld = NULL;
 
 CBulletDebugDrawer                       bt_debug_drawer;
 
+struct physics_settings_s                physics_settings = {1, PHYSICS_MAX_SUB_STEPS_DEFAULT};
+static int                               physics_last_sub_steps = 0;
+static bt_engine_CandidatesCallback      physics_query_candidates;
+static btAlignedObjectArray<bt_engine_QueryGroup> physics_query_groups;
+static btAlignedObjectArray<int>         physics_query_group_index;      // group of each batch query
+static struct physics_query_stats_s      physics_query_stats = {0};
+
 /* bullet collision model calculation */
 btCollisionShape* BT_CSfromBBox(btScalar *bb_min, btScalar *bb_max);
 btCollisionShape* BT_CSfromMesh(struct base_mesh_s *mesh, bool useCompression, bool buildBvh, bool is_static = true);
@@ -354,8 +398,45 @@ void Physics_Destroy()
 
 void Physics_StepSimulation(float time)
 {
-    time = (time < 0.1f) ? (time) : (0.0f);
-    bt_engine_dynamicsWorld->stepSimulation(time, 0);
+    if(physics_settings.fixed_step)
+    {
+        // bullet accumulates the time itself and syncs interpolated transforms to motion states
+        int max_sub_steps = (physics_settings.max_sub_steps > 0) ? (physics_settings.max_sub_steps) : (1);
+        physics_last_sub_steps = bt_engine_dynamicsWorld->stepSimulation(time, max_sub_steps, GAME_LOGIC_REFRESH_INTERVAL);
+    }
+    else
+    {
+        time = (time < 0.1f) ? (time) : (0.0f);
+        bt_engine_dynamicsWorld->stepSimulation(time, 0);
+        physics_last_sub_steps = (time > 0.0f) ? (1) : (0);
+    }
+}
+
+float Physics_GetMaxFrameTime()
+{
+    if(physics_settings.fixed_step && (physics_settings.max_sub_steps > 0))
+    {
+        return (float)physics_settings.max_sub_steps * GAME_LOGIC_REFRESH_INTERVAL;
+    }
+    return 1.0f / 30.0f;
+}
+
+int Physics_GetLastSubSteps()
+{
+    return physics_last_sub_steps;
+}
+
+/*
+ * Transform for drawing: in fixed step mode dynamic body is interpolated
+ * between simulation steps in its motion state.
+ */
+static inline const btTransform &Physics_GetRenderTransform(btRigidBody *body)
+{
+    if(physics_settings.fixed_step && body->getMotionState() && !body->isStaticOrKinematicObject())
+    {
+        return ((btDefaultMotionState*)body->getMotionState())->m_graphicsWorldTrans;
+    }
+    return body->getWorldTransform();
 }
 
 void Physics_DebugDrawWorld()
@@ -516,6 +597,7 @@ int  Physics_RayTest(struct collision_result_s *result, float from[3], float to[
     bt_engine_ClosestRayResultCallback cb(cont, filter);
     btVector3 vFrom(from[0], from[1], from[2]), vTo(to[0], to[1], to[2]);
 
+    physics_query_stats.single_queries++;
     if(result)
     {
         result->hit = 0x00;
@@ -549,6 +631,7 @@ int  Physics_RayTestFiltered(struct collision_result_s *result, float from[3], f
     bt_engine_ClosestRayResultCallback cb(cont, filter);
     btVector3 vFrom(from[0], from[1], from[2]), vTo(to[0], to[1], to[2]);
 
+    physics_query_stats.single_queries++;
     cb.m_flags |= btTriangleRaycastCallback::kF_FilterBackfaces;
     cb.m_flags |= btTriangleRaycastCallback::kF_KeepUnflippedNormal;
 
@@ -592,6 +675,7 @@ int  Physics_SphereTest(struct collision_result_s *result, float from[3], float
     tTo.setIdentity();
     tTo.setOrigin(vTo);
 
+    physics_query_stats.single_queries++;
     if(result)
     {
         result->obj = NULL;
@@ -619,6 +703,294 @@ int  Physics_SphereTest(struct collision_result_s *result, float from[3], float
 }
 
 
+static int Physics_TestQuery(struct physics_query_s *query, const bt_engine_Candidate *candidates, int count)
+{
+    btVector3 vFrom(query->from[0], query->from[1], query->from[2]), vTo(query->to[0], query->to[1], query->to[2]);
+    btTransform tFrom, tTo;
+    collision_result_p result = &query->result;
+
+    tFrom.setIdentity();
+    tFrom.setOrigin(vFrom);
+    tTo.setIdentity();
+    tTo.setOrigin(vTo);
+    result->obj = NULL;
+    result->hit = 0x00;
+    result->fraction = 1.0f;
+
+    if(query->type == PHYSICS_QUERY_SPHERE)
+    {
+        bt_engine_ClosestConvexResultCallback cb(query->cont, query->filter);
+        btSphereShape sphere(query->radius);
+        btVector3 r(query->radius, query->radius, query->radius);
+        btVector3 bb_min = vFrom, bb_max = vFrom;
+        btScalar allowed_penetration = bt_engine_dynamicsWorld->getDispatchInfo().m_allowedCcdPenetration;
+
+        bb_min.setMin(vTo);
+        bb_max.setMax(vTo);
+        bb_min -= r;
+        bb_max += r;
+        for(int i = 0; i < count; i++)
+        {
+            const bt_engine_Candidate *c = candidates + i;
+            if(TestAabbAgainstAabb2(bb_min, bb_max, c->m_bounds[0], c->m_bounds[1]) && cb.needsCollision(c->m_object->getBroadphaseHandle()))
+            {
+                btCollisionWorld::objectQuerySingle(&sphere, tFrom, tTo, c->m_object, c->m_object->getCollisionShape(),
+                                                    c->m_object->getWorldTransform(), cb, allowed_penetration);
+            }
+        }
+
+        if(cb.hasHit())
+        {
+            result->obj      = (struct engine_container_s *)cb.m_hitCollisionObject->getUserPointer();
+            result->hit      = 0x01;
+            result->bone_num = cb.m_hitCollisionObject->getUserIndex();
+            vec3_copy(result->normale, cb.m_hitNormalWorld.m_floats);
+            vec3_copy(result->point, cb.m_hitPointWorld.m_floats);
+            result->fraction = cb.m_closestHitFraction;
+        }
+    }
+    else
+    {
+        bt_engine_ClosestRayResultCallback cb(query->cont, query->filter);
+        btVector3 dir = vTo - vFrom;
+        btVector3 inv_dir;
+        unsigned int sign[3];
+
+        if(query->type == PHYSICS_QUERY_RAY_FILTERED)
+        {
+            cb.m_flags |= btTriangleRaycastCallback::kF_FilterBackfaces;
+            cb.m_flags |= btTriangleRaycastCallback::kF_KeepUnflippedNormal;
+        }
+        for(int k = 0; k < 3; k++)
+        {
+            inv_dir[k] = (dir[k] == 0.0f) ? (BT_LARGE_FLOAT) : (1.0f / dir[k]);
+            sign[k] = inv_dir[k] < 0.0f;
+        }
+
+        for(int i = 0; i < count; i++)
+        {
+            const bt_engine_Candidate *c = candidates + i;
+            btScalar t;
+            // closer hit found already shortens the ray for the next candidates
+            if(btRayAabb2(vFrom, inv_dir, sign, c->m_bounds, t, 0.0f, cb.m_closestHitFraction) && cb.needsCollision(c->m_object->getBroadphaseHandle()))
+            {
+                btCollisionWorld::rayTestSingle(tFrom, tTo, c->m_object, c->m_object->getCollisionShape(), c->m_object->getWorldTransform(), cb);
+            }
+        }
+
+        if(cb.hasHit())
+        {
+            result->obj      = (struct engine_container_s *)cb.m_collisionObject->getUserPointer();
+            result->hit      = 0x01;
+            result->bone_num = cb.m_collisionObject->getUserIndex();
+            vec3_copy(result->normale, cb.m_hitNormalWorld.m_floats);
+            vFrom.setInterpolate3(vFrom, vTo, cb.m_closestHitFraction);
+            vec3_copy(result->point, vFrom.m_floats);
+            result->fraction = cb.m_closestHitFraction;
+        }
+    }
+
+    return result->hit;
+}
+
+
+typedef struct physics_query_job_s
+{
+    struct physics_query_s     *queries;
+    uint32_t                    first;              // index of the first query in batch
+    uint32_t                    count;
+    int                         hits;
+}physics_query_job_t, *physics_query_job_p;
+
+
+static void Physics_TestQueryJob(void *data)
+{
+    physics_query_job_p job = (physics_query_job_p)data;
+    const bt_engine_Candidate *candidates = (physics_query_candidates.m_candidates.size() > 0) ? (&physics_query_candidates.m_candidates[0]) : (NULL);
+
+    job->hits = 0;
+    for(uint32_t i = 0; i < job->count; i++)
+    {
+        const bt_engine_QueryGroup &g = physics_query_groups[physics_query_group_index[job->first + i]];
+        job->hits += Physics_TestQuery(job->queries + i, candidates + g.m_first, g.m_count);
+    }
+}
+
+
+/*
+ * Query joins the first recent group, which united box stays within
+ * PHYSICS_QUERY_GROUP_EXTENT (or already contains query box); spread queries
+ * get own groups, so no query tests candidates far from its sweep.
+ */
+static void Physics_GroupQueries(struct physics_query_s *queries, uint32_t count)
+{
+    physics_query_groups.resize(0);
+    physics_query_group_index.resize(count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        btVector3 r(queries[i].radius, queries[i].radius, queries[i].radius);
+        btVector3 from(queries[i].from[0], queries[i].from[1], queries[i].from[2]);
+        btVector3 to(queries[i].to[0], queries[i].to[1], queries[i].to[2]);
+        btVector3 bb_min, bb_max;
+        int group = -1;
+
+        if(queries[i].type != PHYSICS_QUERY_SPHERE)
+        {
+            r.setZero();
+        }
+        bb_min = from;
+        bb_min.setMin(to);
+        bb_max = from;
+        bb_max.setMax(to);
+        bb_min -= r;
+        bb_max += r;
+
+        for(int g = physics_query_groups.size() - 1; (g >= 0) && (g + PHYSICS_QUERY_GROUPS_SCAN >= physics_query_groups.size()); g--)
+        {
+            bt_engine_QueryGroup &qg = physics_query_groups[g];
+            btVector3 u_min = qg.m_bounds[0], u_max = qg.m_bounds[1];
+            btVector3 extent;
+            u_min.setMin(bb_min);
+            u_max.setMax(bb_max);
+            extent = u_max - u_min;
+            if((extent[extent.maxAxis()] <= PHYSICS_QUERY_GROUP_EXTENT) ||
+               ((u_min == qg.m_bounds[0]) && (u_max == qg.m_bounds[1])))
+            {
+                qg.m_bounds[0] = u_min;
+                qg.m_bounds[1] = u_max;
+                group = g;
+                break;
+            }
+        }
+
+        if(group < 0)
+        {
+            bt_engine_QueryGroup &qg = physics_query_groups.expandNonInitializing();
+            qg.m_bounds[0] = bb_min;
+            qg.m_bounds[1] = bb_max;
+            group = physics_query_groups.size() - 1;
+        }
+        physics_query_group_index[i] = group;
+    }
+
+    physics_query_candidates.m_candidates.resize(0);
+    for(int g = 0; g < physics_query_groups.size(); g++)
+    {
+        bt_engine_QueryGroup &qg = physics_query_groups[g];
+        qg.m_first = physics_query_candidates.m_candidates.size();
+        bt_engine_dynamicsWorld->getBroadphase()->aabbTest(qg.m_bounds[0], qg.m_bounds[1], physics_query_candidates);
+        qg.m_count = physics_query_candidates.m_candidates.size() - qg.m_first;
+    }
+}
+
+
+int  Physics_TestBatch(struct physics_query_s *queries, uint32_t count)
+{
+    float time = Sys_FloatTime();
+    int hits = 0;
+
+    if(count == 0)
+    {
+        return 0;
+    }
+
+    Physics_GroupQueries(queries, count);
+
+    if(physics_query_candidates.m_candidates.size() > 0)
+    {
+        uint32_t jobs_count = count / PHYSICS_QUERY_JOB_SIZE;
+        if((jobs_count > 1) && (Jobs_GetWorkersCount() > 0))
+        {
+            physics_query_job_p jobs = (physics_query_job_p)malloc(jobs_count * sizeof(physics_query_job_t));
+            job_group_t group;
+            uint32_t first = 0;
+
+            Jobs_InitGroup(&group);
+            for(uint32_t i = 0; i < jobs_count; i++)
+            {
+                uint32_t last = (i + 1 == jobs_count) ? (count) : (first + count / jobs_count);
+                jobs[i].queries = queries + first;
+                jobs[i].first = first;
+                jobs[i].count = last - first;
+                Jobs_Add(&group, Physics_TestQueryJob, jobs + i);
+                first = last;
+            }
+            Jobs_Wait(&group);
+            for(uint32_t i = 0; i < jobs_count; i++)
+            {
+                hits += jobs[i].hits;
+            }
+            free(jobs);
+        }
+        else
+        {
+            physics_query_job_t job;
+            job.queries = queries;
+            job.first = 0;
+            job.count = count;
+            Physics_TestQueryJob(&job);
+            hits = job.hits;
+        }
+    }
+    else
+    {
+        for(uint32_t i = 0; i < count; i++)
+        {
+            queries[i].result.obj = NULL;
+            queries[i].result.hit = 0x00;
+            queries[i].result.fraction = 1.0f;
+        }
+    }
+
+    physics_query_stats.batched_queries += count;
+    physics_query_stats.batches++;
+    physics_query_stats.groups += physics_query_groups.size();
+    physics_query_stats.candidates += physics_query_candidates.m_candidates.size();
+    physics_query_stats.batch_time += 1000.0f * (Sys_FloatTime() - time);
+
+    return hits;
+}
+
+
+void Physics_SetRayQuery(struct physics_query_s *query, float from[3], float to[3], struct engine_container_s *cont, int16_t filter)
+{
+    query->type = PHYSICS_QUERY_RAY;
+    query->filter = filter;
+    query->radius = 0.0f;
+    vec3_copy(query->from, from);
+    vec3_copy(query->to, to);
+    query->cont = cont;
+}
+
+
+void Physics_SetSphereQuery(struct physics_query_s *query, float from[3], float to[3], float R, struct engine_container_s *cont, int16_t filter)
+{
+    query->type = PHYSICS_QUERY_SPHERE;
+    query->filter = filter;
+    query->radius = R;
+    vec3_copy(query->from, from);
+    vec3_copy(query->to, to);
+    query->cont = cont;
+}
+
+
+void Physics_GetQueryStats(struct physics_query_stats_s *stats)
+{
+    *stats = physics_query_stats;
+}
+
+
+void Physics_ResetQueryStats()
+{
+    physics_query_stats.single_queries = 0;
+    physics_query_stats.batched_queries = 0;
+    physics_query_stats.batches = 0;
+    physics_query_stats.groups = 0;
+    physics_query_stats.candidates = 0;
+    physics_query_stats.batch_time = 0.0f;
+}
+
+
 int Physics_IsBodyesInited(struct physics_data_s *physics)
 {
     return physics && physics->bt_body;
@@ -644,11 +1016,27 @@ void Physics_GetBodyWorldTransform(struct physics_data_s *physics, float tr[16],
 }
 
 
-void Physics_SetBodyWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index)
+void Physics_GetBodyRenderTransform(struct physics_data_s *physics, float tr[16], uint16_t index)
 {
     if(physics->bt_body[index])
     {
-        physics->bt_body[index]->getWorldTransform().setFromOpenGLMatrix(tr);
+        Physics_GetRenderTransform(physics->bt_body[index]).getOpenGLMatrix(tr);
+    }
+}
+
+
+void Physics_SetBodyWorldTransform(struct physics_data_s *physics, float tr[16], uint16_t index)
+{
+    btRigidBody *body = physics->bt_body[index];
+    if(body)
+    {
+        body->getWorldTransform().setFromOpenGLMatrix(tr);
+        if(body->getMotionState() && !body->isStaticOrKinematicObject())
+        {
+            // teleport: no interpolation from the previous place
+            body->setInterpolationWorldTransform(body->getWorldTransform());
+            body->getMotionState()->setWorldTransform(body->getWorldTransform());
+        }
     }
 }
 
@@ -2009,7 +2397,7 @@ int Hair_GetElementsCount(struct hair_s *hair)
 
 void Hair_GetElementInfo(struct hair_s *hair, int element, struct base_mesh_s **mesh, float tr[16])
 {
-    hair->elements[element].body->getWorldTransform().getOpenGLMatrix(tr);
+    Physics_GetRenderTransform(hair->elements[element].body).getOpenGLMatrix(tr);
     *mesh = hair->elements[element].mesh;
 }
 
@@ -215,6 +215,113 @@ textures_indexes(NULL)
     layOutTextures();
 }
 
+/*!
+ * Layout words: border width, page width, counts of result pages, file object
+ * textures, sprite textures and canonical textures; then result page heights,
+ * file object textures (canonical index, packed corners), sprite canonical
+ * indexes and canonical textures (packed size and origin, original page, new
+ * page, new x, new y).
+ */
+#define LAYOUT_HEAD_SIZE                (6)
+#define LAYOUT_FILE_TEXTURE_SIZE        (2)
+#define LAYOUT_CANONICAL_TEXTURE_SIZE   (5)
+
+bordered_texture_atlas::bordered_texture_atlas(int border,
+                                               size_t page_count,
+                                               const tr4_textile32_t *pages,
+                                               size_t object_texture_count,
+                                               size_t sprite_texture_count,
+                                               const uint32_t *layout,
+                                               size_t layout_size)
+: border_width(border),
+number_result_pages(0),
+result_page_width(0),
+result_page_height(NULL),
+number_original_pages(page_count),
+original_pages(pages),
+number_file_object_textures(0),
+file_object_textures(NULL),
+number_sprite_textures(0),
+canonical_textures_for_sprite_textures(NULL),
+number_canonical_object_textures(0),
+canonical_object_textures(NULL),
+textures_indexes(NULL)
+{
+    GLint max_texture_edge_length = 0;
+    qglGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_edge_length);
+    if (max_texture_edge_length > 4096)
+        max_texture_edge_length = 4096;
+
+    // Page width depends on the driver, so layout of other GL is useless.
+    const uint32_t *end = layout + layout_size / sizeof(uint32_t);
+    if ((layout_size < LAYOUT_HEAD_SIZE * sizeof(uint32_t))
+        || (layout[0] != (uint32_t) border)
+        || (layout[1] != (uint32_t) max_texture_edge_length)
+        || (layout[2] == 0) || (layout[2] > 256)
+        || (layout[3] != object_texture_count)
+        || (layout[4] != sprite_texture_count)
+        || (layout[5] == 0) || (layout[5] > object_texture_count + sprite_texture_count + 1)
+        || ((size_t)(end - layout) != LAYOUT_HEAD_SIZE + layout[2] + LAYOUT_FILE_TEXTURE_SIZE * layout[3] + layout[4] + LAYOUT_CANONICAL_TEXTURE_SIZE * layout[5]))
+        return;
+
+    unsigned long pages_count = layout[2];
+    result_page_width = layout[1];
+    number_file_object_textures = layout[3];
+    number_sprite_textures = layout[4];
+    number_canonical_object_textures = layout[5];
+    layout += LAYOUT_HEAD_SIZE;
+
+    result_page_height = (unsigned *) malloc(sizeof(unsigned) * pages_count);
+    for (unsigned long page = 0; page < pages_count; page++)
+        result_page_height[page] = *layout++;
+
+    file_object_textures = new file_object_texture[number_file_object_textures];
+    for (unsigned long i = 0; i < number_file_object_textures; i++, layout += LAYOUT_FILE_TEXTURE_SIZE)
+    {
+        file_object_textures[i].canonical_texture_index = layout[0];
+        for (int j = 0; j < 4; j++)
+            file_object_textures[i].corner_locations[j] = (corner_location) ((layout[1] >> (8 * j)) & 0x03);
+    }
+
+    canonical_textures_for_sprite_textures = new unsigned long[number_sprite_textures];
+    for (unsigned long i = 0; i < number_sprite_textures; i++)
+        canonical_textures_for_sprite_textures[i] = *layout++;
+
+    canonical_object_textures = new canonical_object_texture[number_canonical_object_textures];
+    for (unsigned long i = 0; i < number_canonical_object_textures; i++, layout += LAYOUT_CANONICAL_TEXTURE_SIZE)
+    {
+        canonical_object_texture &canonical = canonical_object_textures[i];
+        canonical.width = layout[0] & 0xFF;
+        canonical.height = (layout[0] >> 8) & 0xFF;
+        canonical.original_x = (layout[0] >> 16) & 0xFF;
+        canonical.original_y = (layout[0] >> 24) & 0xFF;
+        canonical.original_page = layout[1];
+        canonical.new_page = layout[2];
+        canonical.new_x_with_border = layout[3];
+        canonical.new_y_with_border = layout[4];
+    }
+
+    // Damaged layout must not make createTextures write out of the pages.
+    bool valid = true;
+    for (unsigned long page = 0; page < pages_count; page++)
+        valid = valid && (result_page_height[page] > 0) && (result_page_height[page] <= result_page_width);
+    for (unsigned long i = 0; i < number_file_object_textures; i++)
+        valid = valid && (file_object_textures[i].canonical_texture_index < number_canonical_object_textures);
+    for (unsigned long i = 0; i < number_sprite_textures; i++)
+        valid = valid && (canonical_textures_for_sprite_textures[i] < number_canonical_object_textures);
+    for (unsigned long i = 0; valid && (i < number_canonical_object_textures); i++)
+    {
+        const canonical_object_texture &canonical = canonical_object_textures[i];
+        valid = (canonical.new_page < pages_count)
+                && ((canonical.original_page == WHITE_TEXTURE_INDEX) || (canonical.original_page < page_count))
+                && (canonical.new_x_with_border + canonical.width + 2 * border_width <= result_page_width)
+                && (canonical.new_y_with_border + canonical.height + 2 * border_width <= result_page_height[canonical.new_page]);
+    }
+
+    if (valid)
+        number_result_pages = pages_count;
+}
+
 bordered_texture_atlas::~bordered_texture_atlas()
 {
     delete [] file_object_textures;
@@ -493,6 +600,50 @@ unsigned long bordered_texture_atlas::getNumAtlasPages() const
     return number_result_pages;
 }
 
+size_t bordered_texture_atlas::getLayoutSize() const
+{
+    return sizeof(uint32_t) * (LAYOUT_HEAD_SIZE + number_result_pages
+                               + LAYOUT_FILE_TEXTURE_SIZE * number_file_object_textures
+                               + number_sprite_textures
+                               + LAYOUT_CANONICAL_TEXTURE_SIZE * number_canonical_object_textures);
+}
+
+void bordered_texture_atlas::saveLayout(uint32_t *layout) const
+{
+    *layout++ = border_width;
+    *layout++ = result_page_width;
+    *layout++ = number_result_pages;
+    *layout++ = number_file_object_textures;
+    *layout++ = number_sprite_textures;
+    *layout++ = number_canonical_object_textures;
+
+    for (unsigned long page = 0; page < number_result_pages; page++)
+        *layout++ = result_page_height[page];
+
+    for (unsigned long i = 0; i < number_file_object_textures; i++)
+    {
+        *layout++ = file_object_textures[i].canonical_texture_index;
+        *layout++ = (uint32_t) file_object_textures[i].corner_locations[0]
+                    | ((uint32_t) file_object_textures[i].corner_locations[1] << 8)
+                    | ((uint32_t) file_object_textures[i].corner_locations[2] << 16)
+                    | ((uint32_t) file_object_textures[i].corner_locations[3] << 24);
+    }
+
+    for (unsigned long i = 0; i < number_sprite_textures; i++)
+        *layout++ = canonical_textures_for_sprite_textures[i];
+
+    for (unsigned long i = 0; i < number_canonical_object_textures; i++)
+    {
+        const canonical_object_texture &canonical = canonical_object_textures[i];
+        *layout++ = (uint32_t) canonical.width | ((uint32_t) canonical.height << 8)
+                    | ((uint32_t) canonical.original_x << 16) | ((uint32_t) canonical.original_y << 24);
+        *layout++ = canonical.original_page;
+        *layout++ = canonical.new_page;
+        *layout++ = canonical.new_x_with_border;
+        *layout++ = canonical.new_y_with_border;
+    }
+}
+
 void bordered_texture_atlas::createTextures(GLuint *textureNames)
 {
     GLubyte *data = (GLubyte *) malloc(4 * result_page_width * result_page_width);
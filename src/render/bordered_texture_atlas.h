@@ -128,6 +128,17 @@ public:
                            size_t sprite_texture_count,
                            const tr_sprite_texture_t *sprite_textures);
     
+    /*!
+     * Create a bordered texture atlas from a layout stored with saveLayout, so deduplication and packing are skipped. If layout does not match the arguments or current OpenGL, atlas gets no pages (see getNumAtlasPages) and must not be used.
+     */
+    bordered_texture_atlas(int border,
+                           size_t page_count,
+                           const tr4_textile32_t *pages,
+                           size_t object_texture_count,
+                           size_t sprite_texture_count,
+                           const uint32_t *layout,
+                           size_t layout_size);
+    
     /*!
      * Destroy all contents of a bordered texture atlas. Using the atlas afterwards
      * is an error and undefined. If textures have been uploaded, then the OpenGL
@@ -172,6 +183,12 @@ public:
      */
     unsigned long getCanonicalTextureHeight(unsigned long texture) const;
     float getTextureHeight(unsigned long texture) const;
+    /*!
+     * Size in bytes and data of the layout (everything except pixels), for the world cache.
+     */
+    size_t getLayoutSize() const;
+    void saveLayout(uint32_t *layout) const;
+    
     /*!
      * Uploads the current data to OpenGL, as one or more texture pages.
      * textureNames has to have a length of at least GetNumAtlasPages and will
@@ -27,6 +27,22 @@ struct bsp_node_s *CDynamicBSP::CreateBSPNode()
 }
 
 
+void CDynamicBSP::SaveStaticNode(struct bsp_node_s *node)
+{
+    if((uint8_t*)node < m_tree_buffer + m_static_tree_allocated)
+    {
+        if(m_undo_count >= m_undo_size)
+        {
+            m_undo_size = (m_undo_size) ? (2 * m_undo_size) : (256);
+            m_undo = (bsp_node_undo_p)realloc(m_undo, m_undo_size * sizeof(bsp_node_undo_t));
+        }
+        m_undo[m_undo_count].node = node;
+        m_undo[m_undo_count].saved = *node;
+        m_undo_count++;
+    }
+}
+
+
 struct polygon_s *CDynamicBSP::CreatePolygon(uint16_t vertex_count)
 {
     polygon_p ret = (polygon_p)(m_temp_buffer + m_temp_allocated);
@@ -65,6 +81,7 @@ void CDynamicBSP::AddBSPPolygon(struct bsp_node_s *leaf, struct polygon_s *p)
         //*v  = *pv;
     }
 
+    this->SaveStaticNode(leaf);
     if(vec3_dot(p->plane, leaf->plane) > 0.9)
     {
         bp->next = leaf->polygons_front;
@@ -101,6 +118,7 @@ void CDynamicBSP::AddPolygon(struct bsp_node_s *root, struct polygon_s *p)
     if(root->polygons_front == NULL)
     {
         // we though root->front == NULL and root->back == NULL
+        this->SaveStaticNode(root);
         vec4_copy(root->plane, p->plane);
         p->next = NULL;
         this->AddBSPPolygon(root, p);
@@ -133,6 +151,7 @@ void CDynamicBSP::AddPolygon(struct bsp_node_s *root, struct polygon_s *p)
     {
         if (root->front == NULL)
         {
+            this->SaveStaticNode(root);
             root->front = this->CreateBSPNode();
         }
         this->AddPolygon(root->front, p);
@@ -141,6 +160,7 @@ void CDynamicBSP::AddPolygon(struct bsp_node_s *root, struct polygon_s *p)
     {
         if (root->back == NULL)
         {
+            this->SaveStaticNode(root);
             root->back = this->CreateBSPNode();
         }
         this->AddPolygon(root->back, p);
@@ -157,14 +177,17 @@ void CDynamicBSP::AddPolygon(struct bsp_node_s *root, struct polygon_s *p)
         back = this->CreatePolygon(p->vertex_count + 2);
         back->vertex_count = 0;
         Polygon_Split(p, root->plane, front, back);
+        m_split_polygons++;
 
         if(root->front == NULL)
         {
+            this->SaveStaticNode(root);
             root->front = this->CreateBSPNode();
         }
         this->AddPolygon(root->front, front);
         if(root->back == NULL)
         {
+            this->SaveStaticNode(root);
             root->back = this->CreateBSPNode();
         }
         this->AddPolygon(root->back, back);
@@ -191,6 +214,19 @@ CDynamicBSP::CDynamicBSP(uint32_t size)
 
     m_input_polygons = 0;
     m_added_polygons = 0;
+    m_split_polygons = 0;
+    m_uploaded_vertices = 0;
+
+    m_static_valid = false;
+    m_static_tree_allocated = 0;
+    m_static_vertex_allocated = 0;
+    m_static_input_polygons = 0;
+    m_static_added_polygons = 0;
+    m_vbo_size = 0;
+
+    m_undo = NULL;
+    m_undo_count = 0;
+    m_undo_size = 0;
 
     m_vbo = 0;
     m_anim_seq = NULL;
@@ -228,16 +264,30 @@ CDynamicBSP::~CDynamicBSP()
     }
     m_vertex_buffer_size = 0;
 
+    if(m_undo)
+    {
+        free(m_undo);
+        m_undo = NULL;
+    }
+    m_undo_count = 0;
+    m_undo_size = 0;
+
     m_realloc_state = 0;
     m_anim_seq = NULL;
     m_root = NULL;
 }
 
 
-void CDynamicBSP::AddNewPolygonList(struct polygon_s *p, float transform[16], struct frustum_s *f)
+void CDynamicBSP::AddNewPolygonList(struct polygon_s *p, float transform[16], struct frustum_s *f, int filter)
 {
     for( ; p && (!m_realloc_state); p = p->next)
     {
+        if(((filter == BSP_POLYGONS_STATIC_TEX) && (p->anim_id > 0)) ||
+           ((filter == BSP_POLYGONS_ANIM_TEX) && (p->anim_id == 0)))
+        {
+            continue;
+        }
+
         m_temp_allocated = 0;
         polygon_p np = this->CreatePolygon(p->vertex_count);
         bool visible = (f == NULL);
@@ -355,11 +405,82 @@ void CDynamicBSP::Reset(struct anim_seq_s *seq)
     };
 
     m_anim_seq = seq;
+    m_temp_allocated = 0;
+    m_split_polygons = 0;
+    m_uploaded_vertices = 0;
+    if(m_realloc_state)
+    {
+        m_realloc_state = 0;
+        m_static_valid = false;                                                 // old buffers are dropped
+    }
+
+    if(m_static_valid)
+    {
+        while(m_undo_count > 0)
+        {
+            m_undo_count--;
+            *m_undo[m_undo_count].node = m_undo[m_undo_count].saved;
+        }
+        m_tree_allocated = m_static_tree_allocated;
+        m_vertex_allocated = m_static_vertex_allocated;
+        m_input_polygons = m_static_input_polygons;
+        m_added_polygons = m_static_added_polygons;
+    }
+    else
+    {
+        this->ResetStatic();
+    }
+}
+
+
+void CDynamicBSP::ResetStatic()
+{
+    m_static_valid = false;
+    m_static_tree_allocated = 0;
+    m_static_vertex_allocated = 0;
+    m_static_input_polygons = 0;
+    m_static_added_polygons = 0;
+    m_vbo_size = 0;
+    m_undo_count = 0;
+
     m_temp_allocated = 0;
     m_tree_allocated = 0;
     m_vertex_allocated = 0;
-    m_realloc_state = 0;
     m_input_polygons = 0;
     m_added_polygons = 0;
     m_root = this->CreateBSPNode();
 }
+
+
+void CDynamicBSP::FixStatic()
+{
+    m_static_valid = (m_realloc_state == 0);
+    m_static_tree_allocated = m_tree_allocated;
+    m_static_vertex_allocated = m_vertex_allocated;
+    m_static_input_polygons = m_input_polygons;
+    m_static_added_polygons = m_added_polygons;
+    m_undo_count = 0;
+}
+
+
+void CDynamicBSP::UpdateVBO()
+{
+    m_uploaded_vertices = 0;
+    if(m_vbo != 0)
+    {
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, m_vbo);
+        if((m_vbo_size == 0) || (m_vbo_size < m_vertex_allocated))
+        {
+            m_vbo_size = m_vertex_buffer_size;
+            qglBufferDataARB(GL_ARRAY_BUFFER_ARB, m_vbo_size * sizeof(vertex_t), NULL, GL_DYNAMIC_DRAW);
+            qglBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, m_vertex_allocated * sizeof(vertex_t), m_vertex_buffer);
+            m_uploaded_vertices = m_vertex_allocated;
+        }
+        else if(m_vertex_allocated > m_static_vertex_allocated)
+        {
+            m_uploaded_vertices = m_vertex_allocated - m_static_vertex_allocated;
+            qglBufferSubDataARB(GL_ARRAY_BUFFER_ARB, m_static_vertex_allocated * sizeof(vertex_t),
+                                m_uploaded_vertices * sizeof(vertex_t), m_vertex_buffer + m_static_vertex_allocated);
+        }
+    }
+}
@@ -33,6 +33,28 @@ typedef struct bsp_node_s
 } bsp_node_t, *bsp_node_p;
 
 
+/*
+ * Polygons filter for CDynamicBSP::AddNewPolygonList(); polygons with
+ * animated textures change every frame, so they are never kept in the
+ * static part of the tree.
+ */
+#define BSP_POLYGONS_ALL            (0)
+#define BSP_POLYGONS_STATIC_TEX     (1)
+#define BSP_POLYGONS_ANIM_TEX       (2)
+
+typedef struct bsp_node_undo_s
+{
+    struct bsp_node_s      *node;
+    struct bsp_node_s       saved;
+} bsp_node_undo_t, *bsp_node_undo_p;
+
+/*
+ * Tree consists of static part (built by ResetStatic() ... FixStatic() once
+ * for the set of visible rooms) and dynamic one, added every frame after it.
+ * Static nodes, changed by dynamic polygons, are saved in the undo list, so
+ * Reset() rolls the tree back to the static part without rebuilding; static
+ * vertices are uploaded to the VBO only after the static part was rebuilt.
+ */
 class CDynamicBSP
 {
     uint8_t             *m_tree_buffer;
@@ -52,8 +74,22 @@ class CDynamicBSP
     
     uint32_t             m_input_polygons;
     uint32_t             m_added_polygons;
-    
+    uint32_t             m_split_polygons;
+    uint32_t             m_uploaded_vertices;
+
+    bool                 m_static_valid;
+    uint32_t             m_static_tree_allocated;
+    uint32_t             m_static_vertex_allocated;
+    uint32_t             m_static_input_polygons;
+    uint32_t             m_static_added_polygons;
+    uint32_t             m_vbo_size;                                            // vertices, 0 - static part is not uploaded
+
+    struct bsp_node_undo_s *m_undo;
+    uint32_t             m_undo_count;
+    uint32_t             m_undo_size;
+
     struct bsp_node_s     *CreateBSPNode();
+    void SaveStaticNode(struct bsp_node_s *node);
     struct polygon_s      *CreatePolygon(uint16_t vertex_count);
     void AddBSPPolygon(struct bsp_node_s *leaf, struct polygon_s *p);
     void AddPolygon(struct bsp_node_s *root, struct polygon_s *p);
@@ -65,8 +101,16 @@ public:
     CDynamicBSP(uint32_t size);
    ~CDynamicBSP();
    
-    void AddNewPolygonList(struct polygon_s *p, float transform[16], struct frustum_s *f);
-    void Reset(struct anim_seq_s *seq);
+    void AddNewPolygonList(struct polygon_s *p, float transform[16], struct frustum_s *f, int filter = BSP_POLYGONS_ALL);
+    void Reset(struct anim_seq_s *seq);                                         // drop dynamic part of the tree
+    void ResetStatic();                                                         // drop whole tree
+    void FixStatic();                                                           // current tree becomes static part
+    void UpdateVBO();                                                           // upload new vertices, binds m_vbo
+
+    bool HaveStatic()
+    {
+        return m_static_valid;
+    }
     
     struct vertex_s *GetVertexArray()
     {
@@ -87,6 +131,16 @@ public:
     {
         return m_added_polygons;
     }
+
+    uint32_t GetSplitPolygonsCount()
+    {
+        return m_split_polygons;
+    }
+
+    uint32_t GetUploadedVertexCount()
+    {
+        return m_uploaded_vertices;
+    }
 };
 
 
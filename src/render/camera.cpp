@@ -44,6 +44,7 @@ void Cam_Init(camera_p cam)
     cam->frustum->parents_count = 0;
     cam->frustum->vertex = NULL;
     cam->frustum->planes = cam->clip_planes;
+    cam->frustum->packed_planes = cam->clip_planes_packed;
     cam->frustum->vertex = (float*)malloc(3 * 4 * sizeof(float));
 
     cam->prev_pos[0] = 0.0f;
@@ -362,6 +363,7 @@ void Cam_RecalcClipPlanes(camera_p cam)
     }
 
     vec3_add(cam->frustum->vertex, cam->gl_transform + 12, cam->gl_transform + 8);
+    Frustum_PackPlanes(cam->frustum);
 }
 
 /*
@@ -69,6 +69,7 @@ typedef struct camera_s
     GLfloat                     gl_view_proj_mat[16] __attribute__((packed, aligned(16)));
 
     GLfloat                     clip_planes[16];        // frustum side clip planes
+    GLfloat                     clip_planes_packed[32]; // side clip planes, packed for SIMD tests (FRUSTUM_PACKED_SIZE(4))
     GLfloat                     prev_pos[3];            // previous camera position
     GLfloat                     ang[3];                 // camera orientation
     struct frustum_s           *frustum;                // camera frustum structure
@@ -2,6 +2,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 #include "../core/system.h"
 #include "../core/vmath.h"
@@ -15,6 +20,8 @@
 
 #define SPLIT_EMPTY         (0x00)
 #define SPLIT_SUCCES        (0x01)
+#define FRUSTUM_CULL_MARGIN (1.0f)
+#define FRUSTUM_MAX_DIST    (1024)                                              // polygon distances scratch size
 
 CFrustumManager::CFrustumManager(uint32_t buffer_size)
 {
@@ -23,6 +30,8 @@ CFrustumManager::CFrustumManager(uint32_t buffer_size)
     m_buffer = (uint8_t*)malloc(buffer_size * sizeof(uint8_t));
     memset(m_buffer, 0, (buffer_size * sizeof(uint8_t)));
     m_need_realloc = false;
+    m_tmp = NULL;
+    m_tmp_size = 0;
 }
 
 CFrustumManager::~CFrustumManager()
@@ -32,6 +41,11 @@ CFrustumManager::~CFrustumManager()
         free(m_buffer);
         m_buffer = NULL;
     }
+    if(m_tmp != NULL)
+    {
+        free(m_tmp);
+        m_tmp = NULL;
+    }
 }
 
 void CFrustumManager::Reset()
@@ -62,6 +76,7 @@ frustum_p CFrustumManager::CreateFrustum()
         ret->next = NULL;
         ret->parent = NULL;
         ret->planes = NULL;
+        ret->packed_planes = NULL;
         ret->vertex = NULL;
         ret->cam_pos = NULL;
         vec4_set_zero(ret->norm);
@@ -194,7 +209,7 @@ int CFrustumManager::SplitByPlane(frustum_p p, float n[4], float *buf)
 
 void CFrustumManager::GenClipPlanes(frustum_p p, struct camera_s *cam)
 {
-    if(m_allocated + p->vertex_count * 4 * sizeof(float) >= m_buffer_size)
+    if(m_allocated + (p->vertex_count * 4 + FRUSTUM_PACKED_SIZE(p->vertex_count)) * sizeof(float) >= m_buffer_size)
     {
         m_need_realloc = true;
     }
@@ -229,10 +244,31 @@ void CFrustumManager::GenClipPlanes(frustum_p p, struct camera_s *cam)
         }
 
         p->cam_pos = cam->gl_transform + 12;
+        p->packed_planes = this->Alloc(FRUSTUM_PACKED_SIZE(p->vertex_count));
+        if(p->packed_planes)
+        {
+            Frustum_PackPlanes(p);
+        }
     }
 }
 
-frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frustum_p emitter, struct camera_s *cam)
+float *CFrustumManager::GetTempBuffer(uint32_t size)
+{
+    if(size > m_tmp_size)
+    {
+        free(m_tmp);
+        m_tmp_size = size + 64;
+        m_tmp = (float*)malloc(m_tmp_size * sizeof(float));
+    }
+    return m_tmp;
+}
+
+/**
+ * Generates frustum of the portal, clipped by emitter; result is not linked
+ * to the destination room, so it is safe to call it for different managers
+ * in parallel (see CRender::GenWorldList()).
+ */
+frustum_p CFrustumManager::GenPortalFrustum(struct portal_s *portal, frustum_p emitter, struct camera_s *cam)
 {
     if(!m_need_realloc)
     {
@@ -263,25 +299,8 @@ frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frust
             return NULL;
         }
 
-        /*
-         * Search for the first free room's frustum
-         */
         uint32_t original_allocated = m_allocated;
-        frustum_p prev = NULL, current_gen = NULL;
-        if(dest_room->frustum == NULL)
-        {
-            current_gen = dest_room->frustum = this->CreateFrustum();
-        }
-        else
-        {
-            prev = dest_room->frustum;
-            while(prev->next)
-            {
-                prev = prev->next;
-            }
-            current_gen = prev->next = this->CreateFrustum();                   // generate new frustum.
-        }
-
+        frustum_p current_gen = this->CreateFrustum();
         if(m_need_realloc)
         {
             return NULL;
@@ -290,19 +309,10 @@ frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frust
         this->SplitPrepare(current_gen, portal, emitter);                       // prepare to the clipping
         if(m_need_realloc)
         {
-            if(prev)
-            {
-                prev->next = NULL;
-            }
-            else
-            {
-                dest_room->frustum = NULL;
-            }
             return NULL;
         }
 
-        int buf_size = (current_gen->vertex_count + emitter->vertex_count + 4) * 3 * sizeof(float);
-        float *tmp = (float*)Sys_GetTempMem(buf_size);
+        float *tmp = this->GetTempBuffer((current_gen->vertex_count + emitter->vertex_count + 4) * 3);
         if(this->SplitByPlane(current_gen, emitter->norm, tmp))                 // splitting by main frustum clip plane
         {
             n = emitter->planes;
@@ -310,15 +320,6 @@ frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frust
             {
                 if(!this->SplitByPlane(current_gen, n, tmp))
                 {
-                    if(prev)
-                    {
-                        prev->next = NULL;
-                    }
-                    else
-                    {
-                        dest_room->frustum = NULL;
-                    }
-                    Sys_ReturnTempMem(buf_size);
                     m_allocated = original_allocated;
                     return NULL;
                 }
@@ -327,44 +328,53 @@ frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frust
             this->GenClipPlanes(current_gen, cam);                              // all is OK, let us generate clipplanes
             if(m_need_realloc)
             {
-                if(prev)
-                {
-                    prev->next = NULL;
-                }
-                else
-                {
-                    dest_room->frustum = NULL;
-                }
-                Sys_ReturnTempMem(buf_size);
                 m_allocated = original_allocated;
                 return NULL;
             }
 
             current_gen->parent = emitter;                                      // add parent pointer
             current_gen->parents_count = emitter->parents_count + 1;
-            Sys_ReturnTempMem(buf_size);
             return current_gen;
         }
 
-        if(prev)
-        {
-            prev->next = NULL;
-        }
-        else
-        {
-            dest_room->frustum = NULL;
-        }
         m_allocated = original_allocated;
-        Sys_ReturnTempMem(buf_size);
     }
 
     return NULL;
 }
 
+frustum_p CFrustumManager::PortalFrustumIntersect(struct portal_s *portal, frustum_p emitter, struct camera_s *cam)
+{
+    frustum_p ret = this->GenPortalFrustum(portal, emitter, cam);
+    if(ret)
+    {
+        Frustum_AddToRoom(portal->dest_room->real_room, ret);
+    }
+    return ret;
+}
+
 /*
  ************************* END FRUSTUM MANAGER IMPLEMENTATION*******************
  */
 
+void Frustum_AddToRoom(struct room_s *room, frustum_p frustum)
+{
+    frustum->next = NULL;
+    if(room->frustum == NULL)
+    {
+        room->frustum = frustum;
+    }
+    else
+    {
+        frustum_p prev = room->frustum;
+        while(prev->next)
+        {
+            prev = prev->next;
+        }
+        prev->next = frustum;
+    }
+}
+
 /**
  * we need that checking to avoid infinite recursions
  */
@@ -381,7 +391,7 @@ bool Frustum_HaveParent(frustum_p parent, frustum_p frustum)
     return false;
 }
 
-bool Frustum_IsPolyVisible(struct polygon_s *p, struct frustum_s *frustum, bool check_backface)
+bool Frustum_IsPolyVisibleScalar(struct polygon_s *p, struct frustum_s *frustum, bool check_backface)
 {
     float t, dir[3], T[3], dist[2];
     float *prev_n, *curr_n, *next_n;
@@ -462,6 +472,166 @@ bool Frustum_IsPolyVisible(struct polygon_s *p, struct frustum_s *frustum, bool
     return false;
 }
 
+void Frustum_PackPlanes(frustum_p frustum)
+{
+    float *dst = frustum->packed_planes;
+    uint16_t blocks = (frustum->vertex_count + FRUSTUM_SIMD_WIDTH - 1) / FRUSTUM_SIMD_WIDTH;
+
+    for(uint16_t b = 0; b < blocks; b++, dst += 4 * FRUSTUM_SIMD_WIDTH)
+    {
+        for(int k = 0; k < 4; k++)
+        {
+            for(uint16_t l = 0; l < FRUSTUM_SIMD_WIDTH; l++)
+            {
+                uint16_t i = b * FRUSTUM_SIMD_WIDTH + l;
+                dst[k * FRUSTUM_SIMD_WIDTH + l] = (i < frustum->vertex_count) ? (frustum->planes[4 * i + k]) : (0.0f);
+            }
+        }
+    }
+}
+
+/*
+ * Distances from the point to all planes of the packed block,
+ * summation order is the same as in vec3_plane_dist().
+ */
+static inline void Frustum_BlockDist(const float *block, const float pos[3], float *dist)
+{
+#if defined(__AVX__)
+    __m256 d = _mm256_loadu_ps(block + 24);
+    d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(block + 0), _mm256_set1_ps(pos[0])));
+    d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(block + 8), _mm256_set1_ps(pos[1])));
+    d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(block + 16), _mm256_set1_ps(pos[2])));
+    _mm256_storeu_ps(dist, d);
+#elif defined(__SSE__)
+    __m128 d = _mm_loadu_ps(block + 12);
+    d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(block + 0), _mm_set1_ps(pos[0])));
+    d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(block + 4), _mm_set1_ps(pos[1])));
+    d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(block + 8), _mm_set1_ps(pos[2])));
+    _mm_storeu_ps(dist, d);
+#else
+    dist[0] = block[3] + block[0] * pos[0] + block[1] * pos[1] + block[2] * pos[2];
+#endif
+}
+
+/*
+ * Lazy planes - polygon vertices distances table; block of planes is
+ * calculated for all vertices on the first access, so early exit of
+ * visibility test skips the rest of planes as scalar version does.
+ */
+typedef struct frustum_poly_dist_s
+{
+    const float        *planes;
+    polygon_p           poly;
+    uint32_t            blocks_done;
+    float               dist[FRUSTUM_MAX_DIST];
+}frustum_poly_dist_t, *frustum_poly_dist_p;
+
+static inline float Frustum_PolyDist(frustum_poly_dist_p pd, uint16_t plane, uint16_t vertex)
+{
+    uint16_t b = plane / FRUSTUM_SIMD_WIDTH;
+    float *out = pd->dist + b * pd->poly->vertex_count * FRUSTUM_SIMD_WIDTH;
+
+    if(!(pd->blocks_done & (1U << b)))
+    {
+        const float *block = pd->planes + 4 * FRUSTUM_SIMD_WIDTH * b;
+        for(uint16_t j = 0; j < pd->poly->vertex_count; j++)
+        {
+            Frustum_BlockDist(block, pd->poly->vertices[j].position, out + j * FRUSTUM_SIMD_WIDTH);
+        }
+        pd->blocks_done |= 1U << b;
+    }
+
+    return out[vertex * FRUSTUM_SIMD_WIDTH + plane % FRUSTUM_SIMD_WIDTH];
+}
+
+/*
+ * Same classification as Frustum_IsPolyVisibleScalar(): on iteration k
+ * planes (k - 2, k - 1, k) are (prev, curr, next).
+ */
+bool Frustum_IsPolyVisible(struct polygon_s *p, struct frustum_s *frustum, bool check_backface)
+{
+    frustum_poly_dist_t pd;
+    float t, dir[3], T[3], dist[2];
+    uint16_t planes_count = frustum->vertex_count;
+    uint16_t blocks = (planes_count + FRUSTUM_SIMD_WIDTH - 1) / FRUSTUM_SIMD_WIDTH;
+    char ins, outs;
+
+    if(!frustum->packed_planes || (blocks > 32) || (blocks * FRUSTUM_SIMD_WIDTH * p->vertex_count > FRUSTUM_MAX_DIST))
+    {
+        return Frustum_IsPolyVisibleScalar(p, frustum, check_backface);
+    }
+
+    if(check_backface && ((vec3_plane_dist(p->plane, frustum->cam_pos)) < 0.0f))
+    {
+        return false;
+    }
+
+    vec3_sub(dir, frustum->vertex, frustum->cam_pos);
+    if(Polygon_RayIntersect(p, dir, frustum->cam_pos, &t))
+    {
+        return true;
+    }
+
+    pd.planes = frustum->packed_planes;
+    pd.poly = p;
+    pd.blocks_done = 0;
+    ins = 1;
+    for(uint16_t k = 0; k < planes_count; k++)
+    {
+        uint16_t curr = (k + planes_count - 1) % planes_count;
+        uint16_t prev = (k + planes_count - 2) % planes_count;
+        uint16_t next = k;
+        uint16_t j_prev = p->vertex_count - 1;
+
+        dist[0] = Frustum_PolyDist(&pd, curr, j_prev);
+        outs = 1;
+        for(uint16_t j = 0; j < p->vertex_count; j++)
+        {
+            dist[1] = Frustum_PolyDist(&pd, curr, j);
+            if(ABS(dist[0]) < SPLIT_EPSILON)
+            {
+                if((Frustum_PolyDist(&pd, prev, j_prev) > -SPLIT_EPSILON) &&
+                   (Frustum_PolyDist(&pd, next, j_prev) > -SPLIT_EPSILON) &&
+                   (vec3_plane_dist(frustum->norm, p->vertices[j_prev].position) > -SPLIT_EPSILON))
+                {
+                    return true;
+                }
+            }
+
+            if((dist[0] * dist[1] < 0) && ABS(dist[1]) >= SPLIT_EPSILON)
+            {
+                float *prev_pos = p->vertices[j_prev].position;
+                vec3_sub(dir, p->vertices[j].position, prev_pos)
+                vec3_ray_plane_intersect(prev_pos, dir, frustum->planes + 4 * curr, T, t)
+                if((vec3_plane_dist(frustum->planes + 4 * prev, T) > -SPLIT_EPSILON) &&
+                   (vec3_plane_dist(frustum->planes + 4 * next, T) > -SPLIT_EPSILON))
+                {
+                    return true;
+                }
+            }
+
+            if(dist[1] < -SPLIT_EPSILON)
+            {
+                ins = 0;
+            }
+            else
+            {
+                outs = 0;
+            }
+
+            j_prev = j;
+            dist[0] = dist[1];
+        }
+
+        if(outs)
+        {
+            return false;
+        }
+    }
+
+    return ins;
+}
+
 /**
  *
  * @param bbmin - aabb corner (x_min, y_min, z_min)
@@ -469,7 +639,9 @@ bool Frustum_IsPolyVisible(struct polygon_s *p, struct frustum_s *frustum, bool
  * @param frustum - test frustum
  * @return 1 if aabb is in frustum.
  */
-bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *frustum)
+typedef bool (*frustum_poly_test_t)(struct polygon_s *p, struct frustum_s *frustum, bool check_backface);
+
+static inline bool Frustum_IsAABBVisibleImpl(float bbmin[3], float bbmax[3], struct frustum_s *frustum, frustum_poly_test_t poly_test)
 {
     bool inside = true;
     polygon_t poly;
@@ -502,7 +674,7 @@ bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *fru
         vert[3].position[1] = bbmax[1];
         vert[3].position[2] = bbmin[2];
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+        if(poly_test(&poly, frustum, true))
         {
             return true;
         }
@@ -528,7 +700,7 @@ bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *fru
         vert[3].position[1] = bbmax[1];
         vert[3].position[2] = bbmin[2];
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+        if(poly_test(&poly, frustum, true))
         {
             return true;
         }
@@ -559,7 +731,7 @@ bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *fru
         vert[3].position[1] = bbmin[1];
         vert[3].position[2] = bbmin[2];
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+        if(poly_test(&poly, frustum, true))
         {
             return true;
         }
@@ -585,7 +757,7 @@ bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *fru
         vert[3].position[1] = bbmax[1];
         vert[3].position[2] = bbmin[2];
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+        if(poly_test(&poly, frustum, true))
         {
             return true;
         }
@@ -616,7 +788,7 @@ bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *fru
         vert[3].position[1] = bbmin[1];
         vert[3].position[2] = bbmin[2];
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+        if(poly_test(&poly, frustum, true))
         {
             return true;
         }
@@ -642,7 +814,7 @@ bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *fru
         vert[3].position[1] = bbmin[1];
         vert[3].position[2] = bbmax[2];
 
-        if(Frustum_IsPolyVisible(&poly, frustum, true))
+        if(poly_test(&poly, frustum, true))
         {
             return true;
         }
@@ -653,7 +825,18 @@ bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *fru
 }
 
 
-bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum)
+bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *frustum)
+{
+    return Frustum_IsAABBVisibleImpl(bbmin, bbmax, frustum, Frustum_IsPolyVisible);
+}
+
+bool Frustum_IsAABBVisibleScalar(float bbmin[3], float bbmax[3], struct frustum_s *frustum)
+{
+    return Frustum_IsAABBVisibleImpl(bbmin, bbmax, frustum, Frustum_IsPolyVisibleScalar);
+}
+
+
+static inline bool Frustum_IsOBBVisibleImpl(struct obb_s *obb, struct frustum_s *frustum, frustum_poly_test_t poly_test)
 {
     bool inside = true;
     float t;
@@ -662,7 +845,7 @@ bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum)
     for(int i = 0; i < 6; i++, p++)
     {
         t = vec3_plane_dist(p->plane, frustum->cam_pos);
-        if((t >= 0.0f) && Frustum_IsPolyVisible(p, frustum, true))
+        if((t >= 0.0f) && poly_test(p, frustum, true))
         {
             return true;
         }
@@ -675,6 +858,16 @@ bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum)
     return inside;
 }
 
+bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum)
+{
+    return Frustum_IsOBBVisibleImpl(obb, frustum, Frustum_IsPolyVisible);
+}
+
+bool Frustum_IsOBBVisibleScalar(struct obb_s *obb, struct frustum_s *frustum)
+{
+    return Frustum_IsOBBVisibleImpl(obb, frustum, Frustum_IsPolyVisibleScalar);
+}
+
 bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frustum)
 {
     for(; frustum; frustum = frustum->next)
@@ -688,6 +881,120 @@ bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frus
     return false;
 }
 
+/**
+ * Batched Frustum_IsOBBVisibleInFrustumList(): boxes are tested frustum by
+ * frustum, so packed planes of one frustum stay in cache for all boxes, and
+ * box, already found visible, is not tested by the next frustums.
+ */
+uint32_t Frustum_IsOBBsVisibleInFrustumList(struct obb_s **obbs, uint32_t count, struct frustum_s *frustum, uint8_t *visible)
+{
+    uint32_t ret = 0;
+
+    memset(visible, 0, count * sizeof(uint8_t));
+    for(; frustum && (ret < count); frustum = frustum->next)
+    {
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(!visible[i] && Frustum_IsOBBVisible(obbs[i], frustum))
+            {
+                visible[i] = 0x01;
+                ret++;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * Hierarchy node test: returns true if the box is entirely behind one of the
+ * side clip planes, so nothing inside it can be seen through the frustum.
+ * Frustum_IsPolyVisible() is looser (ray test ignores the ray direction,
+ * edge crossings are checked by neighbour planes only), so some objects,
+ * which it accepts, may be rejected by node, but never visible ones.
+ */
+bool Frustum_IsAABBCulled(const float bbmin[3], const float bbmax[3], struct frustum_s *frustum)
+{
+    float *n = frustum->planes;
+
+#if defined(__AVX__) || defined(__SSE__)
+    if(frustum->packed_planes)
+    {
+        // centre - extent form, |n| * extent is the farthest corner offset
+        const float *block = frustum->packed_planes;
+        uint16_t blocks = (frustum->vertex_count + FRUSTUM_SIMD_WIDTH - 1) / FRUSTUM_SIMD_WIDTH;
+#if defined(__AVX__)
+        __m256 sign = _mm256_set1_ps(-0.0f);
+        __m256 margin = _mm256_set1_ps(-FRUSTUM_CULL_MARGIN);
+        __m256 cx = _mm256_set1_ps(0.5f * (bbmin[0] + bbmax[0]));
+        __m256 cy = _mm256_set1_ps(0.5f * (bbmin[1] + bbmax[1]));
+        __m256 cz = _mm256_set1_ps(0.5f * (bbmin[2] + bbmax[2]));
+        __m256 ex = _mm256_set1_ps(0.5f * (bbmax[0] - bbmin[0]));
+        __m256 ey = _mm256_set1_ps(0.5f * (bbmax[1] - bbmin[1]));
+        __m256 ez = _mm256_set1_ps(0.5f * (bbmax[2] - bbmin[2]));
+        for(uint16_t b = 0; b < blocks; b++, block += 32)
+        {
+            __m256 nx = _mm256_loadu_ps(block + 0);
+            __m256 ny = _mm256_loadu_ps(block + 8);
+            __m256 nz = _mm256_loadu_ps(block + 16);
+            __m256 d = _mm256_loadu_ps(block + 24);
+            __m256 r = _mm256_mul_ps(_mm256_andnot_ps(sign, nx), ex);
+            d = _mm256_add_ps(d, _mm256_mul_ps(nx, cx));
+            d = _mm256_add_ps(d, _mm256_mul_ps(ny, cy));
+            d = _mm256_add_ps(d, _mm256_mul_ps(nz, cz));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_andnot_ps(sign, ny), ey));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_andnot_ps(sign, nz), ez));
+            if(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_add_ps(d, r), margin, _CMP_LT_OQ)))
+            {
+                return true;                                                    // padding planes are zero, never cull
+            }
+        }
+#else
+        __m128 sign = _mm_set1_ps(-0.0f);
+        __m128 margin = _mm_set1_ps(-FRUSTUM_CULL_MARGIN);
+        __m128 cx = _mm_set1_ps(0.5f * (bbmin[0] + bbmax[0]));
+        __m128 cy = _mm_set1_ps(0.5f * (bbmin[1] + bbmax[1]));
+        __m128 cz = _mm_set1_ps(0.5f * (bbmin[2] + bbmax[2]));
+        __m128 ex = _mm_set1_ps(0.5f * (bbmax[0] - bbmin[0]));
+        __m128 ey = _mm_set1_ps(0.5f * (bbmax[1] - bbmin[1]));
+        __m128 ez = _mm_set1_ps(0.5f * (bbmax[2] - bbmin[2]));
+        for(uint16_t b = 0; b < blocks; b++, block += 16)
+        {
+            __m128 nx = _mm_loadu_ps(block + 0);
+            __m128 ny = _mm_loadu_ps(block + 4);
+            __m128 nz = _mm_loadu_ps(block + 8);
+            __m128 d = _mm_loadu_ps(block + 12);
+            __m128 r = _mm_mul_ps(_mm_andnot_ps(sign, nx), ex);
+            d = _mm_add_ps(d, _mm_mul_ps(nx, cx));
+            d = _mm_add_ps(d, _mm_mul_ps(ny, cy));
+            d = _mm_add_ps(d, _mm_mul_ps(nz, cz));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_andnot_ps(sign, ny), ey));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_andnot_ps(sign, nz), ez));
+            if(_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, r), margin)))
+            {
+                return true;                                                    // padding planes are zero, never cull
+            }
+        }
+#endif
+        return false;
+    }
+#endif
+
+    for(uint16_t i = 0; i < frustum->vertex_count; i++, n += 4)
+    {
+        float d = n[3];
+        d += n[0] * ((n[0] > 0.0f) ? (bbmax[0]) : (bbmin[0]));
+        d += n[1] * ((n[1] > 0.0f) ? (bbmax[1]) : (bbmin[1]));
+        d += n[2] * ((n[2] > 0.0f) ? (bbmax[2]) : (bbmin[2]));
+        if(d < -FRUSTUM_CULL_MARGIN)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 /*
  * PORTALS
  */
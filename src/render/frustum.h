@@ -9,6 +9,22 @@ struct room_s;
 struct camera_s;
 struct obb_s;
 
+/*
+ * Visibility tests calculate distances from polygon vertices to 8 (AVX build)
+ * or 4 (SSE build) clip planes at once; planes are stored in SoA blocks
+ * (nx[W], ny[W], nz[W], d[W]) by Frustum_PackPlanes(), padding planes are
+ * zero. Distances are calculated in the same order as vec3_plane_dist(), so
+ * results are equal to *Scalar versions, which are kept for reference.
+ */
+#if defined(__AVX__)
+#define FRUSTUM_SIMD_WIDTH          (8)
+#elif defined(__SSE__)
+#define FRUSTUM_SIMD_WIDTH          (4)
+#else
+#define FRUSTUM_SIMD_WIDTH          (1)
+#endif
+#define FRUSTUM_PACKED_SIZE(planes) (4 * FRUSTUM_SIMD_WIDTH * (((planes) + FRUSTUM_SIMD_WIDTH - 1) / FRUSTUM_SIMD_WIDTH))
+
 
 typedef struct portal_s
 {
@@ -26,6 +42,7 @@ typedef struct frustum_s
     uint16_t            parents_count;
     
     float              *planes;                                                 // clip planes
+    float              *packed_planes;                                          // clip planes in SoA blocks, NULL - use scalar tests
     float              *vertex;                                                 // frustum vertices
     float              *cam_pos;                                                ///@TODO: delete it!
     float               norm[4];                                                // main frustum clip plane (inv. plane of parent portal)
@@ -43,9 +60,11 @@ public:
     
     void Reset();
     frustum_p PortalFrustumIntersect(struct portal_s *portal, frustum_p emitter, struct camera_s *cam);
+    frustum_p GenPortalFrustum(struct portal_s *portal, frustum_p emitter, struct camera_s *cam);  // not linked to the room
 
 private:
     float *Alloc(uint32_t size);
+    float *GetTempBuffer(uint32_t size);
     frustum_p CreateFrustum();
     void SplitPrepare(frustum_p frustum, struct portal_s *p, frustum_p emitter);
     void GenClipPlanes(frustum_p p, struct camera_s *cam);
@@ -55,13 +74,22 @@ private:
     uint32_t m_buffer_size;
     uint32_t m_allocated;
     uint8_t *m_buffer;
+    uint32_t m_tmp_size;
+    float   *m_tmp;                                                             // clipping buffer, own for each manager
 };
 
+void Frustum_AddToRoom(struct room_s *room, frustum_p frustum);              // append to the end of room frustums list
 bool Frustum_HaveParent(frustum_p parent, frustum_p frustum);
+void Frustum_PackPlanes(frustum_p frustum);                                     // fill packed_planes after planes change
 bool Frustum_IsPolyVisible(struct polygon_s *p, struct frustum_s *frustum, bool check_backface);
 bool Frustum_IsAABBVisible(float bbmin[3], float bbmax[3], struct frustum_s *frustum);
 bool Frustum_IsOBBVisible(struct obb_s *obb, struct frustum_s *frustum);
 bool Frustum_IsOBBVisibleInFrustumList(struct obb_s *obb, struct frustum_s *frustum);
+uint32_t Frustum_IsOBBsVisibleInFrustumList(struct obb_s **obbs, uint32_t count, struct frustum_s *frustum, uint8_t *visible);  // returns visible count
+bool Frustum_IsPolyVisibleScalar(struct polygon_s *p, struct frustum_s *frustum, bool check_backface);
+bool Frustum_IsAABBVisibleScalar(float bbmin[3], float bbmax[3], struct frustum_s *frustum);
+bool Frustum_IsOBBVisibleScalar(struct obb_s *obb, struct frustum_s *frustum);
+bool Frustum_IsAABBCulled(const float bbmin[3], const float bbmax[3], struct frustum_s *frustum);
 
 
 portal_p Portal_Create(unsigned int vcount);
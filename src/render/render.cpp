@@ -11,6 +11,8 @@
 #include "../core/vmath.h"
 #include "../core/polygon.h"
 #include "../core/obb.h"
+#include "../core/bvh.h"
+#include "../core/jobs.h"
 #include "../script/script.h"
 #include "../physics/physics.h"
 #include "../vt/tr_versions.h"
@@ -18,6 +20,8 @@
 #include "render.h"
 #include "bsp_tree.h"
 #include "frustum.h"
+#include "render_queue.h"
+#include "render_instances.h"
 #include "shader_description.h"
 #include "shader_manager.h"
 #include "../room.h"
@@ -33,6 +37,48 @@ CRender renderer;
 void CalculateWaterTint(GLfloat *tint, uint8_t fixed_colour);
 
 #define DEBUG_DRAWER_DEFAULT_BUFFER_SIZE        (128 * 1024)
+#define PORTAL_TASK_FRUSTUM_BUFFER_SIZE         (32768)
+
+/*
+ * Parallel portal traversal: each start room portal subtree is processed by
+ * own job with own frustum manager; generated (room, frustum) pairs are
+ * stored in DFS order and merged to rooms / render list after all jobs.
+ */
+typedef struct render_portal_event_s
+{
+    struct room_s              *room;
+    struct frustum_s           *frustum;
+}render_portal_event_t, *render_portal_event_p;
+
+typedef struct render_portal_task_s
+{
+    struct portal_s            *portal;
+    struct frustum_s           *frustum;            // generated by camera
+    struct camera_s            *cam;
+    const uint32_t             *pvs;
+    uint32_t                    pvs_culled;
+    class CFrustumManager      *frustum_manager;
+    render_portal_event_p       events;
+    uint32_t                    events_count;
+    uint32_t                    events_size;
+}render_portal_task_t, *render_portal_task_p;
+
+/*
+ * Static meshes of the room, baked to world space (tint and water tint are
+ * baked to vertices colour) in one VBO, so faces of all visible statics
+ * with the same texture page are drawn by one draw call from the queue.
+ * Statics with animated textures are drawn by DrawMesh() as before.
+ */
+typedef struct render_static_batch_s
+{
+    struct room_content_s      *content;            // batch is rebuilt after room flip
+    uint32_t                    water;
+    GLuint                      vbo;
+    uint8_t                    *batched;            // per static mesh
+    uint32_t                   *static_faces;       // faces of static mesh i: [static_faces[i], static_faces[i + 1])
+    struct mesh_face_s         *faces;              // elements are indexes in batch vertices
+    GLuint                     *elements;
+}render_static_batch_t, *render_static_batch_p;
 
 /*
  * =============================================================================
@@ -50,6 +96,29 @@ r_list_size(0),
 r_list_active_count(0),
 r_list(NULL),
 frustumManager(NULL),
+m_portal_tasks_size(0),
+m_portal_tasks(NULL),
+m_pvs(NULL),
+m_pvs_rooms(0),
+m_pvs_culled(0),
+m_list_time(0.0f),
+m_bvh_buf_size(0),
+m_bvh_items(NULL),
+m_bvh_visible(NULL),
+m_bsp_rooms_count(0),
+m_bsp_rooms(NULL),
+m_bsp_contents(NULL),
+m_queue(NULL),
+m_static_batches(NULL),
+m_queue_view_proj(0),
+m_queue_no_tint(0),
+m_draw_calls(0),
+m_state_changes(0),
+m_queue_items(0),
+m_instances(NULL),
+m_instancing(false),
+m_instanced(0),
+m_saved_draw_calls(0),
 shaderManager(NULL),
 debugDrawer(NULL),
 dynamicBSP(NULL),
@@ -59,6 +128,8 @@ r_flags(0x00)
     frustumManager = new CFrustumManager(32768);
     debugDrawer    = new CRenderDebugDrawer();
     dynamicBSP     = new CDynamicBSP(512 * 1024);
+    m_queue        = new CRenderQueue();
+    m_instances    = new CRenderInstances();
 }
 
 CRender::~CRender()
@@ -79,6 +150,42 @@ CRender::~CRender()
         frustumManager = NULL;
     }
 
+    if(m_portal_tasks)
+    {
+        for(uint32_t i = 0; i < m_portal_tasks_size; i++)
+        {
+            delete m_portal_tasks[i].frustum_manager;
+            free(m_portal_tasks[i].events);
+        }
+        free(m_portal_tasks);
+        m_portal_tasks = NULL;
+        m_portal_tasks_size = 0;
+    }
+
+    free(m_bvh_items);
+    free(m_bvh_visible);
+    m_bvh_items = NULL;
+    m_bvh_visible = NULL;
+    m_bvh_buf_size = 0;
+
+    free(m_bsp_rooms);
+    free(m_bsp_contents);
+    m_bsp_rooms = NULL;
+    m_bsp_contents = NULL;
+    m_bsp_rooms_count = 0;
+
+    this->ClearStaticBatches();
+    if(m_queue)
+    {
+        delete m_queue;
+        m_queue = NULL;
+    }
+    if(m_instances)
+    {
+        delete m_instances;
+        m_instances = NULL;
+    }
+
     if(debugDrawer)
     {
         delete debugDrawer;
@@ -114,6 +221,9 @@ void CRender::InitSettings()
     settings.fog_color[2] = 0.0f;
     settings.fog_start_depth = 10000.0f;
     settings.fog_end_depth = 16000.0f;
+    settings.parallel_portals = 0;
+    settings.room_pvs = 1;
+    settings.instancing = 1;
 }
 
 void CRender::DoShaders()
@@ -127,12 +237,18 @@ void CRender::DoShaders()
 void CRender::ResetWorld(struct room_s *rooms, uint32_t rooms_count, struct anim_seq_s *anim_sequences, uint32_t anim_sequences_count)
 {
     this->CleanList();
+    this->ClearStaticBatches();
     r_flags = 0x00;
 
     m_rooms = rooms;
     m_rooms_count = rooms_count;
     m_anim_sequences = anim_sequences;
     m_anim_sequences_count = anim_sequences_count;
+    m_bsp_rooms_count = 0;
+    if(dynamicBSP)
+    {
+        dynamicBSP->ResetStatic();
+    }
 
     if(m_rooms)
     {
@@ -152,6 +268,10 @@ void CRender::ResetWorld(struct room_s *rooms, uint32_t rooms_count, struct anim
         r_list_size = list_size;
         r_list_active_count = 0;
 
+        m_bsp_rooms = (struct room_s**)realloc(m_bsp_rooms, list_size * sizeof(struct room_s*));
+        m_bsp_contents = (struct room_content_s**)realloc(m_bsp_contents, list_size * sizeof(struct room_content_s*));
+        m_static_batches = (render_static_batch_p)calloc(rooms_count, sizeof(render_static_batch_t));
+
         for(uint32_t i = 0; i < m_rooms_count; i++)
         {
             m_rooms[i].is_in_r_list = 0;
@@ -225,16 +345,78 @@ void CRender::UpdateAnimTextures()
     }
 }
 
+/*
+ * Camera is near the room (standing in the portal), so that room is processed
+ * as room with camera inside.
+ */
+static int Render_IsCameraNearRoom(float cam_pos[3], struct room_s *curr_room, struct room_s *dest_room)
+{
+    const float eps = 10.0f;
+    return (cam_pos[0] <= dest_room->bb_max[0] + eps) && (cam_pos[0] >= dest_room->bb_min[0] - eps) &&
+           (cam_pos[1] <= dest_room->bb_max[1] + eps) && (cam_pos[1] >= dest_room->bb_min[1] - eps) &&
+           (cam_pos[2] <= dest_room->bb_max[2] + eps) && (cam_pos[2] >= dest_room->bb_min[2] - eps) &&
+           !Room_IsInOverlappedRoomsList(curr_room, dest_room);
+}
+
+/*
+ * Same as CRender::ProcessRoom(), but room lists are not touched: new
+ * frustums are allocated in task's manager and stored as events.
+ */
+static void Render_ProcessRoomTask(render_portal_task_p task, struct portal_s *portal, struct frustum_s *frus)
+{
+    room_p room = portal->dest_room->real_room;
+
+    if(room->is_in_r_list && (room->frustum == NULL))                           // only camera rooms are in the list during traversal
+    {
+        return;
+    }
+
+    for(uint16_t i = 0; i < room->portals_count; i++)
+    {
+        portal_p p = room->portals + i;
+        frustum_p gen_frus;
+        if(task->pvs && !WORLD_PVS_HAS_ROOM(task->pvs, p->dest_room->real_room->id))
+        {
+            task->pvs_culled++;
+            continue;
+        }
+        gen_frus = task->frustum_manager->GenPortalFrustum(p, frus, task->cam);
+        if(gen_frus)
+        {
+            if(task->events_count >= task->events_size)
+            {
+                task->events_size = (task->events_size) ? (2 * task->events_size) : (64);
+                task->events = (render_portal_event_p)realloc(task->events, task->events_size * sizeof(render_portal_event_t));
+            }
+            task->events[task->events_count].room = p->dest_room->real_room;
+            task->events[task->events_count].frustum = gen_frus;
+            task->events_count++;
+            Render_ProcessRoomTask(task, p, gen_frus);
+        }
+    }
+}
+
+static void Render_PortalTaskJob(void *data)
+{
+    render_portal_task_p task = (render_portal_task_p)data;
+    Render_ProcessRoomTask(task, task->portal, task->frustum);
+}
+
 /**
  * Renderer list generation by current world and camera
  */
 void CRender::GenWorldList(struct camera_s *cam)
 {
+    float time = Sys_FloatTime();
+
     this->CleanList();
     this->dynamicBSP->Reset(m_anim_sequences);
     this->frustumManager->Reset();
     cam->frustum->next = NULL;
     m_camera = cam;
+    m_pvs = NULL;
+    m_pvs_rooms = 0;
+    m_pvs_culled = 0;
 
     if(m_rooms == NULL)
     {
@@ -246,24 +428,38 @@ void CRender::GenWorldList(struct camera_s *cam)
     cam->current_room = curr_room;                                              // set camera's cuttent room pointer
     if(curr_room != NULL)                                                       // camera located in some room
     {
-        const float eps = 10.0f;
+        m_pvs = (settings.room_pvs) ? (World_GetRoomPVS(curr_room, cam_pos)) : (NULL);
+        for(uint32_t i = 0; m_pvs && (i < (m_rooms_count + 31) / 32); i++)
+        {
+            m_pvs_rooms += __builtin_popcount(m_pvs[i]);
+        }
+
+        if(settings.parallel_portals && (Jobs_GetWorkersCount() > 0) && this->GenWorldListParallel(cam, curr_room))
+        {
+            m_list_time = Sys_FloatTime() - time;
+            return;
+        }
+
         portal_p p = curr_room->portals;
         curr_room->frustum = NULL;                                              // room with camera inside has no frustums!
         this->AddRoom(curr_room);                                               // room with camera inside adds to the render list immediately
         for(uint16_t i = 0; i < curr_room->portals_count; i++, p++)             // go through all start room portals
         {
             room_p dest_room = p->dest_room->real_room;
-            frustum_p last_frus = this->frustumManager->PortalFrustumIntersect(p, cam->frustum, cam);
+            frustum_p last_frus = NULL;
+            if(m_pvs && !WORLD_PVS_HAS_ROOM(m_pvs, dest_room->id))
+            {
+                m_pvs_culled++;                                                 // near rooms are always in PVS
+                continue;
+            }
+            last_frus = this->frustumManager->PortalFrustumIntersect(p, cam->frustum, cam);
             if(last_frus)
             {
                 this->AddRoom(dest_room);                                       // portal destination room
                 last_frus->parents_count = 1;                                   // created by camera
                 this->ProcessRoom(p, last_frus);                                // next start reccursion algorithm
             }
-            else if((cam_pos[0] <= dest_room->bb_max[0] + eps) && (cam_pos[0] >= dest_room->bb_min[0] - eps) &&
-                    (cam_pos[1] <= dest_room->bb_max[1] + eps) && (cam_pos[1] >= dest_room->bb_min[1] - eps) &&
-                    (cam_pos[2] <= dest_room->bb_max[2] + eps) && (cam_pos[2] >= dest_room->bb_min[2] - eps) &&
-                    !Room_IsInOverlappedRoomsList(curr_room, dest_room))
+            else if(Render_IsCameraNearRoom(cam_pos, curr_room, dest_room))
             {
                 portal_p np = dest_room->portals;
                 dest_room->frustum = NULL;                                      // room with camera inside has no frustums!
@@ -272,6 +468,11 @@ void CRender::GenWorldList(struct camera_s *cam)
                     for(uint16_t ii = 0; ii < dest_room->portals_count; ii++, np++)// go through all start room portals
                     {
                         room_p ndest_room = np->dest_room->real_room;
+                        if(m_pvs && !WORLD_PVS_HAS_ROOM(m_pvs, ndest_room->id))
+                        {
+                            m_pvs_culled++;
+                            continue;
+                        }
                         frustum_p last_frus = this->frustumManager->PortalFrustumIntersect(np, cam->frustum, cam);
                         if(last_frus)
                         {
@@ -295,13 +496,125 @@ void CRender::GenWorldList(struct camera_s *cam)
             }
         }
     }
+
+    m_list_time = Sys_FloatTime() - time;
+}
+
+/**
+ * Parallel version of the start room processing: subtree of each start room
+ * portal is traversed by own job, then results are merged in portals order,
+ * so render list and room frustums lists are the same as in serial version.
+ * Camera near other room case depends on traversal order, so it is left for
+ * serial version (returns 0, nothing is changed).
+ */
+int CRender::GenWorldListParallel(struct camera_s *cam, struct room_s *curr_room)
+{
+    job_group_t group;
+    uint32_t tasks_count = 0;
+    portal_p p = curr_room->portals;
+
+    if(curr_room->portals_count > m_portal_tasks_size)
+    {
+        m_portal_tasks = (render_portal_task_p)realloc(m_portal_tasks, curr_room->portals_count * sizeof(render_portal_task_t));
+        for(uint32_t i = m_portal_tasks_size; i < curr_room->portals_count; i++)
+        {
+            m_portal_tasks[i].frustum_manager = new CFrustumManager(PORTAL_TASK_FRUSTUM_BUFFER_SIZE);
+            m_portal_tasks[i].events = NULL;
+            m_portal_tasks[i].events_count = 0;
+            m_portal_tasks[i].events_size = 0;
+        }
+        m_portal_tasks_size = curr_room->portals_count;
+    }
+
+    for(uint16_t i = 0; i < curr_room->portals_count; i++, p++)
+    {
+        frustum_p last_frus = NULL;
+        if(m_pvs && !WORLD_PVS_HAS_ROOM(m_pvs, p->dest_room->real_room->id))
+        {
+            m_pvs_culled++;
+            continue;
+        }
+        last_frus = this->frustumManager->GenPortalFrustum(p, cam->frustum, cam);
+        if(last_frus)
+        {
+            render_portal_task_p task = m_portal_tasks + tasks_count++;
+            last_frus->parents_count = 1;                                       // created by camera
+            task->portal = p;
+            task->frustum = last_frus;
+            task->cam = cam;
+            task->pvs = m_pvs;
+            task->pvs_culled = 0;
+            task->events_count = 0;
+        }
+        else if(Render_IsCameraNearRoom(cam->gl_transform + 12, curr_room, p->dest_room->real_room))
+        {
+            this->frustumManager->Reset();
+            m_pvs_culled = 0;
+            return 0;
+        }
+    }
+
+    curr_room->frustum = NULL;                                                  // room with camera inside has no frustums!
+    this->AddRoom(curr_room);
+
+    Jobs_InitGroup(&group);
+    for(uint32_t i = 0; i < tasks_count; i++)
+    {
+        m_portal_tasks[i].frustum_manager->Reset();
+        Jobs_Add(&group, Render_PortalTaskJob, m_portal_tasks + i);
+    }
+    Jobs_Wait(&group);
+
+    for(uint32_t i = 0; i < tasks_count; i++)
+    {
+        render_portal_task_p task = m_portal_tasks + i;
+        room_p dest_room = task->portal->dest_room->real_room;
+        m_pvs_culled += task->pvs_culled;
+        Frustum_AddToRoom(dest_room, task->frustum);
+        this->AddRoom(dest_room);
+        for(uint32_t j = 0; j < task->events_count; j++)
+        {
+            Frustum_AddToRoom(task->events[j].room, task->events[j].frustum);
+            this->AddRoom(task->events[j].room);
+        }
+    }
+
+    return 1;
+}
+
+void CRender::GetListStats(float *time, uint32_t *pvs_rooms, uint32_t *pvs_culled)
+{
+    *time = m_list_time;
+    *pvs_rooms = m_pvs_rooms;
+    *pvs_culled = m_pvs_culled;
 }
 
 /**
  * Render all visible rooms
  */
+void CRender::GetDrawStats(uint32_t *draw_calls, uint32_t *state_changes, uint32_t *queue_items)
+{
+    *draw_calls = m_draw_calls;
+    *state_changes = m_state_changes;
+    *queue_items = m_queue_items;
+}
+
+bool CRender::GetInstancingStats(uint32_t *instances, int32_t *saved_draw_calls)
+{
+    *instances = m_instanced;
+    *saved_draw_calls = m_saved_draw_calls;
+    return m_instancing;
+}
+
 void CRender::DrawList()
 {
+    m_draw_calls = 0;
+    m_state_changes = 0;
+    m_queue_items = 0;
+    m_instanced = 0;
+    m_saved_draw_calls = 0;
+    m_instancing = settings.instancing && CRenderInstances::IsSupported() && shaderManager &&
+                   shaderManager->getStaticMeshInstancedShader() && shaderManager->getSpriteShader();
     if(m_camera)
     {
         if(r_flags & R_DRAW_WIRE)
@@ -329,39 +642,55 @@ void CRender::DrawList()
         /*
          * room rendering
          */
+        this->FlushQueue();                                                     // empty, just starts the queue with current camera
         for(uint32_t i = 0; i < r_list_active_count; i++)
         {
             this->DrawRoom(r_list[i].room, m_camera->gl_view_mat, m_camera->gl_view_proj_mat);
         }
+        this->FlushQueue();
 
         qglDisable(GL_CULL_FACE);
         for(uint32_t i = 0; i < r_list_active_count; i++)
         {
             this->DrawRoomSprites(r_list[i].room);
         }
+        if(m_instancing)
+        {
+            render_instances_stats_t stats = {0, 0, 0, 0};
+            m_instances->FlushSprites(shaderManager->getSpriteShader(), m_camera->gl_view_proj_mat, m_camera->gl_transform + 0, m_camera->gl_transform + 4, &stats);
+            m_draw_calls += stats.draw_calls;
+            m_state_changes += stats.state_changes;
+            m_instanced += stats.instances;
+            m_saved_draw_calls += stats.saved_draw_calls;
+            m_active_texture = 0;
+        }
 
         /*
          * NOW render transparency polygons
          */
-        /*First generate BSP from base room mesh - it has good for start splitter polygons*/
+        if(!dynamicBSP->HaveStatic() || !this->IsBSPRoomsListValid())
+        {
+            this->GenStaticBSP();
+        }
+
+        // animated textures change every frame, so such polygons are not in the static part
         for(uint32_t i = 0; i < r_list_active_count; i++)
         {
             room_p r = r_list[i].room;
             if((r->content->mesh != NULL) && (r->content->mesh->transparency_polygons != NULL))
             {
-                dynamicBSP->AddNewPolygonList(r->content->mesh->transparency_polygons, r->transform, m_camera->frustum);
+                dynamicBSP->AddNewPolygonList(r->content->mesh->transparency_polygons, r->transform, m_camera->frustum, BSP_POLYGONS_ANIM_TEX);
             }
         }
 
         for(uint32_t i = 0; i < r_list_active_count; i++)
         {
             room_p r = r_list[i].room;
-            // Add transparency polygons from static meshes (if they exists)
             for(uint16_t j = 0; j < r->content->static_mesh_count; j++)
             {
                 if((r->content->static_mesh[j].mesh->transparency_polygons != NULL) && Frustum_IsOBBVisibleInFrustumList(r->content->static_mesh[j].obb, (r->frustum) ? (r->frustum) : (m_camera->frustum)))
                 {
-                    dynamicBSP->AddNewPolygonList(r->content->static_mesh[j].mesh->transparency_polygons, r->content->static_mesh[j].transform, m_camera->frustum);
+                    dynamicBSP->AddNewPolygonList(r->content->static_mesh[j].mesh->transparency_polygons, r->content->static_mesh[j].transform, m_camera->frustum, BSP_POLYGONS_ANIM_TEX);
                 }
             }
 
@@ -397,9 +726,8 @@ void CRender::DrawList()
             qglDisable(GL_ALPHA_TEST);
             qglEnable(GL_BLEND);
             m_active_transparency = 0;
-            qglBindBufferARB(GL_ARRAY_BUFFER_ARB, dynamicBSP->m_vbo);
+            dynamicBSP->UpdateVBO();
             qglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
-            qglBufferDataARB(GL_ARRAY_BUFFER_ARB, dynamicBSP->GetActiveVertexCount() * sizeof(vertex_t), dynamicBSP->GetVertexArray(), GL_DYNAMIC_DRAW);
             qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
             qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
             qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
@@ -415,6 +743,69 @@ void CRender::DrawList()
     }
 }
 
+/*
+ * Static transparency BSP part is valid while the same rooms (with the same
+ * contents) are in the render list.
+ */
+bool CRender::IsBSPRoomsListValid()
+{
+    if(m_bsp_rooms_count != r_list_active_count)
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < m_bsp_rooms_count; i++)
+    {
+        if(!m_bsp_rooms[i]->is_in_r_list || (m_bsp_rooms[i]->content != m_bsp_contents[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Rooms and static meshes transparency polygons of all rooms in the render
+ * list, without camera frustum test, so the tree stays valid while camera
+ * moves inside the same rooms set.
+ */
+void CRender::GenStaticBSP()
+{
+    dynamicBSP->ResetStatic();
+
+    /*First generate BSP from base room mesh - it has good for start splitter polygons*/
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_p r = r_list[i].room;
+        if((r->content->mesh != NULL) && (r->content->mesh->transparency_polygons != NULL))
+        {
+            dynamicBSP->AddNewPolygonList(r->content->mesh->transparency_polygons, r->transform, NULL, BSP_POLYGONS_STATIC_TEX);
+        }
+    }
+
+    // Add transparency polygons from static meshes (if they exists)
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        room_p r = r_list[i].room;
+        for(uint16_t j = 0; j < r->content->static_mesh_count; j++)
+        {
+            if(r->content->static_mesh[j].mesh->transparency_polygons != NULL)
+            {
+                dynamicBSP->AddNewPolygonList(r->content->static_mesh[j].mesh->transparency_polygons, r->content->static_mesh[j].transform, NULL, BSP_POLYGONS_STATIC_TEX);
+            }
+        }
+    }
+
+    dynamicBSP->FixStatic();
+    m_bsp_rooms_count = 0;
+    for(uint32_t i = 0; i < r_list_active_count; i++)
+    {
+        m_bsp_rooms[m_bsp_rooms_count] = r_list[i].room;
+        m_bsp_contents[m_bsp_rooms_count++] = r_list[i].room->content;
+    }
+}
+
 void CRender::DrawListDebugLines()
 {
     if(r_flags && m_camera)
@@ -531,6 +922,7 @@ void CRender::DrawBSPPolygon(struct bsp_polygon_s *p)
     if(m_active_transparency != p->transparency)
     {
         m_active_transparency = p->transparency;
+        m_state_changes++;
         switch(m_active_transparency)
         {
             case BM_MULTIPLY:                                    // Classic PC alpha
@@ -562,8 +954,10 @@ void CRender::DrawBSPPolygon(struct bsp_polygon_s *p)
     {
         m_active_texture = p->texture_index;
         qglBindTexture(GL_TEXTURE_2D, m_active_texture);
+        m_state_changes++;
     }
     qglDrawElements(GL_TRIANGLE_FAN, p->vertex_count, GL_UNSIGNED_INT, p->indexes);
+    m_draw_calls++;
 }
 
 void CRender::DrawBSPFrontToBack(struct bsp_node_s *root)
@@ -662,7 +1056,7 @@ void CRender::DrawBSPBackToFront(struct bsp_node_s *root)
     }
 }
 
-void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals)
+void CRender::DrawMeshAnimatedFaces(struct base_mesh_s *mesh)
 {
     if(mesh->animated_vertex_count)
     {
@@ -700,10 +1094,18 @@ void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices,
             {
                 m_active_texture = face->texture_index;
                 qglBindTexture(GL_TEXTURE_2D, m_active_texture);
+                m_state_changes++;
             }
             qglDrawElements(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, face->elements);
+            m_draw_calls++;
         }
+        m_state_changes += 2;
     }
+}
+
+void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals)
+{
+    this->DrawMeshAnimatedFaces(mesh);
 
     if(mesh->vertex_count == 0)
     {
@@ -717,6 +1119,7 @@ void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices,
         qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
         qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
         qglTexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
+        m_state_changes++;
     }
 
     // Bind overriden vertices if they exist
@@ -736,8 +1139,10 @@ void CRender::DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices,
         {
             m_active_texture = face->texture_index;
             qglBindTexture(GL_TEXTURE_2D, m_active_texture);
+            m_state_changes++;
         }
         qglDrawElements(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, face->elements);
+        m_draw_calls++;
     }
 }
 
@@ -826,6 +1231,44 @@ void CRender::DrawSkeletalModel(const lit_shader_description *shader, struct ss_
 
             Mat4_Mat4_mul(mvpTransform, mvpMatrix, btag->full_transform);
             qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, mvpTransform);
+            m_state_changes += 2;
+
+            this->DrawMesh((btag->mesh_replace) ? (btag->mesh_replace) : (btag->mesh_base), NULL, NULL);
+            if(btag->mesh_slot)
+            {
+                this->DrawMesh(btag->mesh_slot, NULL, NULL);
+            }
+            if(btag->mesh_skin && btag->parent)
+            {
+                this->DrawSkinMesh(btag->mesh_skin, btag->parent->mesh_base, btag->skin_map, btag->transform);
+            }
+        }
+    }
+}
+
+/**
+ * dynamic (ragdoll) entity drawing: bones are taken from bodies render
+ * transforms, so they are interpolated between physics fixed steps; entity
+ * transform and bones full transforms keep simulated state for game logic.
+ */
+void CRender::DrawRagdoll(const lit_shader_description *shader, struct entity_s *entity, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16])
+{
+    ss_bone_tag_p btag = entity->bf->bone_tags;
+    float tr[16];
+    float mvTransform[16];
+    float mvpTransform[16];
+
+    for(uint16_t i = 0; i < entity->bf->bone_tag_count; i++, btag++)
+    {
+        if(!btag->is_hidden)
+        {
+            Physics_GetBodyRenderTransform(entity->physics, tr, i);
+            Mat4_Mat4_mul(mvTransform, modelViewMatrix, tr);
+            qglUniformMatrix4fvARB(shader->model_view, 1, false, mvTransform);
+
+            Mat4_Mat4_mul(mvpTransform, modelViewProjectionMatrix, tr);
+            qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, mvpTransform);
+            m_state_changes += 2;
 
             this->DrawMesh((btag->mesh_replace) ? (btag->mesh_replace) : (btag->mesh_base), NULL, NULL);
             if(btag->mesh_slot)
@@ -854,22 +1297,31 @@ void CRender::DrawEntity(struct entity_s *entity, const float modelViewMatrix[16
     {
         float subModelView[16];
         float subModelViewProjection[16];
-        if(entity->bf->bone_tag_count == 1)
+        if((entity->type_flags & ENTITY_TYPE_DYNAMIC) && (entity->bf->bone_tag_count > 1) &&
+           (entity->self->collision_shape != COLLISION_SHAPE_SINGLE_BOX) &&
+           (entity->self->collision_shape != COLLISION_SHAPE_SINGLE_SPHERE) &&
+           (Physics_GetBodiesCount(entity->physics) >= entity->bf->bone_tag_count))
         {
-            float scaledTransform[16];
-            memcpy(scaledTransform, entity->transform, sizeof(float) * 16);
-            Mat4_Scale(scaledTransform, entity->scaling[0], entity->scaling[1], entity->scaling[2]);
-            Mat4_Mat4_mul(subModelView, modelViewMatrix, scaledTransform);
-            Mat4_Mat4_mul(subModelViewProjection, modelViewProjectionMatrix, scaledTransform);
+            this->DrawRagdoll(shader, entity, modelViewMatrix, modelViewProjectionMatrix);
         }
         else
         {
-            Mat4_Mat4_mul(subModelView, modelViewMatrix, entity->transform);
-            Mat4_Mat4_mul(subModelViewProjection, modelViewProjectionMatrix, entity->transform);
+            if(entity->bf->bone_tag_count == 1)
+            {
+                float scaledTransform[16];
+                memcpy(scaledTransform, entity->transform, sizeof(float) * 16);
+                Mat4_Scale(scaledTransform, entity->scaling[0], entity->scaling[1], entity->scaling[2]);
+                Mat4_Mat4_mul(subModelView, modelViewMatrix, scaledTransform);
+                Mat4_Mat4_mul(subModelViewProjection, modelViewProjectionMatrix, scaledTransform);
+            }
+            else
+            {
+                Mat4_Mat4_mul(subModelView, modelViewMatrix, entity->transform);
+                Mat4_Mat4_mul(subModelViewProjection, modelViewProjectionMatrix, entity->transform);
+            }
+            this->DrawSkeletalModel(shader, entity->bf, subModelView, subModelViewProjection);
         }
 
-        this->DrawSkeletalModel(shader, entity->bf, subModelView, subModelViewProjection);
-
         if(entity->character && entity->character->hair_count)
         {
             base_mesh_p mesh;
@@ -892,9 +1344,68 @@ void CRender::DrawEntity(struct entity_s *entity, const float modelViewMatrix[16
     }
 }
 
+void CRender::PrepareBVHBuffers(uint32_t count)
+{
+    if(count > m_bvh_buf_size)
+    {
+        m_bvh_buf_size = count + 64;
+        m_bvh_items = (uint16_t*)realloc(m_bvh_items, m_bvh_buf_size * sizeof(uint16_t));
+        m_bvh_visible = (uint8_t*)realloc(m_bvh_visible, m_bvh_buf_size * sizeof(uint8_t));
+    }
+    memset(m_bvh_visible, 0, count * sizeof(uint8_t));
+}
+
+/**
+ * Fills m_bvh_items with items of the hierarchy leaves, not rejected by the
+ * frustum; whole clusters are skipped by node box. Without hierarchy all
+ * items are returned. Items still must be tested by their OBBs.
+ */
+uint32_t CRender::QueryBVH(struct bvh_s *bvh, uint32_t items_count, struct frustum_s *frustum)
+{
+    uint16_t stack[BVH_MAX_DEPTH + 1];
+    uint32_t stack_size = 1;
+    uint32_t count = 0;
+
+    if(!bvh)
+    {
+        for(uint32_t i = 0; i < items_count; i++)
+        {
+            m_bvh_items[count++] = i;
+        }
+        return count;
+    }
+
+    stack[0] = 0;
+    while(stack_size > 0)
+    {
+        bvh_node_p node = bvh->nodes + stack[--stack_size];
+        if(Frustum_IsAABBCulled(node->bb_min, node->bb_max, frustum))
+        {
+            continue;
+        }
+
+        if(node->count > 0)
+        {
+            for(uint16_t i = 0; i < node->count; i++)
+            {
+                m_bvh_items[count++] = bvh->items[node->first + i];
+            }
+        }
+        else
+        {
+            stack[stack_size++] = node->first;
+            stack[stack_size++] = node->first + 1;
+        }
+    }
+
+    return count;
+}
+
+
 void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16])
 {
-    float transform[16];
+    frustum_p frustum = (room->frustum) ? (room->frustum) : (m_camera->frustum);
+    struct bvh_s *entity_bvh;
     engine_container_p cont;
     entity_p ent;
 
@@ -956,8 +1467,14 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
     }
 #endif
 
+    if(m_queue->IsFull())
+    {
+        this->FlushQueue();
+    }
+
     if(!(r_flags & R_SKIP_ROOM) && room->content->mesh)
     {
+        base_mesh_p mesh = room->content->mesh;
         float modelViewProjectionTransform[16];
         Mat4_Mat4_mul(modelViewProjectionTransform, modelViewProjectionMatrix, room->transform);
 
@@ -965,17 +1482,48 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
 
         GLfloat tint[4];
         CalculateWaterTint(tint, 1);
-        if (shader != lastShader)
+#if STENCIL_FRUSTUM
+        bool queue_mesh = !need_stencil && mesh->vbo_vertex_array && (mesh->vertex_count > 0);
+#else
+        bool queue_mesh = mesh->vbo_vertex_array && (mesh->vertex_count > 0);
+#endif
+        if(!queue_mesh || mesh->animated_vertex_count)
         {
-            qglUseProgramObjectARB(shader->program);
+            if (shader != lastShader)
+            {
+                qglUseProgramObjectARB(shader->program);
+            }
+
+            lastShader = shader;
+            qglUniform4fvARB(shader->tint_mult, 1, tint);
+            qglUniform1fARB(shader->current_tick, (GLfloat) SDL_GetTicks());
+            qglUniform1iARB(shader->sampler, 0);
+            qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, modelViewProjectionTransform);
+            m_state_changes += 5;
+            if(queue_mesh)
+            {
+                this->DrawMeshAnimatedFaces(mesh);
+            }
+            else
+            {
+                this->DrawMesh(mesh, NULL, NULL);
+            }
         }
 
-        lastShader = shader;
-        qglUniform4fvARB(shader->tint_mult, 1, tint);
-        qglUniform1fARB(shader->current_tick, (GLfloat) SDL_GetTicks());
-        qglUniform1iARB(shader->sampler, 0);
-        qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, modelViewProjectionTransform);
-        this->DrawMesh(room->content->mesh, NULL, NULL);
+        if(queue_mesh)
+        {
+            uint16_t matrix_index = m_queue->AddMatrix(modelViewProjectionTransform);
+            uint16_t tint_index = m_queue->AddTint(tint);
+            float centre[3], depth;
+            vec3_add(centre, room->bb_min, room->bb_max);
+            vec3_mul_scalar(centre, centre, 0.5f);
+            depth = vec3_dist(centre, m_camera->gl_transform + 12);
+            for(uint32_t i = 0; i < mesh->faces_count; i++)
+            {
+                mesh_face_p face = mesh->faces + i;
+                m_queue->AddFace(shader, face->texture_index, mesh->vbo_vertex_array, matrix_index, tint_index, depth, face->elements_count, face->elements);
+            }
+        }
     }
 
 #if STENCIL_FRUSTUM
@@ -987,42 +1535,72 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
 
     if (room->content->static_mesh_count > 0)
     {
-        qglUseProgramObjectARB(shaderManager->getStaticMeshShader()->program);
-        for(uint32_t i = 0; i < room->content->static_mesh_count; i++)
+        render_static_batch_p batch = (m_instancing) ? (NULL) : (this->GetStaticBatch(room));
+        this->PrepareBVHBuffers(room->content->static_mesh_count);
+        for(frustum_p f = frustum; f; f = f->next)
         {
-            if(Frustum_IsOBBVisibleInFrustumList(room->content->static_mesh[i].obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)) &&
-               (!room->content->static_mesh[i].hide || (r_flags & R_DRAW_DUMMY_STATICS)))
+            uint32_t count = this->QueryBVH(room->content->static_mesh_bvh, room->content->static_mesh_count, f);
+            for(uint32_t j = 0; j < count; j++)
             {
-                Mat4_Mat4_mul(transform, modelViewProjectionMatrix, room->content->static_mesh[i].transform);
-                qglUniformMatrix4fvARB(shaderManager->getStaticMeshShader()->model_view_projection, 1, false, transform);
-                base_mesh_s *mesh = room->content->static_mesh[i].mesh;
-                GLfloat tint[4];
-
-                vec4_copy(tint, room->content->static_mesh[i].tint);
-
-                //If this static mesh is in a water room
-                if(room->flags & TR_ROOM_FLAG_WATER)
+                uint16_t i = m_bvh_items[j];
+                if(!m_bvh_visible[i] && Frustum_IsOBBVisible(room->content->static_mesh[i].obb, f))
                 {
-                    CalculateWaterTint(tint, 0);
+                    m_bvh_visible[i] = 0x01;
                 }
-                qglUniform4fvARB(shaderManager->getStaticMeshShader()->tint_mult, 1, tint);
-                this->DrawMesh(mesh, NULL, NULL);
+            }
+        }
+
+        for(uint32_t i = 0; i < room->content->static_mesh_count; i++)
+        {
+            if(m_bvh_visible[i] && (!room->content->static_mesh[i].hide || (r_flags & R_DRAW_DUMMY_STATICS)))
+            {
+                this->DrawStaticMesh(room, i, batch, modelViewProjectionMatrix);
             }
         }
     }
 
-    for(cont = room->content->containers; cont; cont = cont->next)
+    entity_bvh = Room_GetEntityBVH(room);
+    if(entity_bvh)
     {
-        switch(cont->object_type)
+        // hierarchy items are entities containers in the list order
+        this->PrepareBVHBuffers(entity_bvh->items_count);
+        for(frustum_p f = frustum; f; f = f->next)
         {
-        case OBJECT_ENTITY:
-            ent = (entity_p)cont->object;
-            if(Frustum_IsOBBVisibleInFrustumList(ent->obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)))
+            uint32_t count = this->QueryBVH(entity_bvh, entity_bvh->items_count, f);
+            for(uint32_t j = 0; j < count; j++)
             {
-                this->DrawEntity(ent, modelViewMatrix, modelViewProjectionMatrix);
+                uint16_t i = m_bvh_items[j];
+                ent = (entity_p)room->content->entity_bvh_items[i]->object;
+                if(!m_bvh_visible[i] && Frustum_IsOBBVisible(ent->obb, f))
+                {
+                    m_bvh_visible[i] = 0x01;
+                }
             }
-            break;
-        };
+        }
+
+        for(uint16_t i = 0; i < entity_bvh->items_count; i++)
+        {
+            if(m_bvh_visible[i])
+            {
+                this->DrawEntity((entity_p)room->content->entity_bvh_items[i]->object, modelViewMatrix, modelViewProjectionMatrix);
+            }
+        }
+    }
+    else
+    {
+        for(cont = room->content->containers; cont; cont = cont->next)
+        {
+            switch(cont->object_type)
+            {
+            case OBJECT_ENTITY:
+                ent = (entity_p)cont->object;
+                if(Frustum_IsOBBVisibleInFrustumList(ent->obb, frustum))
+                {
+                    this->DrawEntity(ent, modelViewMatrix, modelViewProjectionMatrix);
+                }
+                break;
+            };
+        }
     }
 
     for(uint16_t ni = 0; ni < room->near_room_list_size; ni++)
@@ -1030,30 +1608,16 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
         room_p near_room = room->near_room_list[ni]->real_room;
         if(!room->near_room_list[ni]->is_in_r_list)
         {
-            if (near_room->content->static_mesh_count > 0)
+            uint32_t overlaps_count = 0;
+            static_mesh_overlap_p overlaps = Room_GetStaticMeshOverlaps(near_room, room->id, &overlaps_count);
+            render_static_batch_p batch = ((overlaps_count > 0) && !m_instancing) ? (this->GetStaticBatch(near_room)) : (NULL);
+            for(uint32_t oi = 0; oi < overlaps_count; oi++)
             {
-                for(uint32_t si = 0; si < near_room->content->static_mesh_count; si++)
+                uint32_t si = overlaps[oi].static_index;                        // precomputed OBB_OBB_Test(static, room)
+                if(Frustum_IsOBBVisibleInFrustumList(near_room->content->static_mesh[si].obb, frustum) &&
+                   (!near_room->content->static_mesh[si].hide || (r_flags & R_DRAW_DUMMY_STATICS)))
                 {
-                    if(OBB_OBB_Test(near_room->content->static_mesh[si].obb, room->obb, 0.0f) &&
-                       Frustum_IsOBBVisibleInFrustumList(near_room->content->static_mesh[si].obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)) &&
-                       (!near_room->content->static_mesh[si].hide || (r_flags & R_DRAW_DUMMY_STATICS)))
-                    {
-                        qglUseProgramObjectARB(shaderManager->getStaticMeshShader()->program);
-                        Mat4_Mat4_mul(transform, modelViewProjectionMatrix, near_room->content->static_mesh[si].transform);
-                        qglUniformMatrix4fvARB(shaderManager->getStaticMeshShader()->model_view_projection, 1, false, transform);
-                        base_mesh_s *mesh = near_room->content->static_mesh[si].mesh;
-                        GLfloat tint[4];
-
-                        vec4_copy(tint, near_room->content->static_mesh[si].tint);
-
-                        //If this static mesh is in a water near_room
-                        if(near_room->flags & TR_ROOM_FLAG_WATER)
-                        {
-                            CalculateWaterTint(tint, 0);
-                        }
-                        qglUniform4fvARB(shaderManager->getStaticMeshShader()->tint_mult, 1, tint);
-                        this->DrawMesh(mesh, NULL, NULL);
-                    }
+                    this->DrawStaticMesh(near_room, si, batch, modelViewProjectionMatrix);
                 }
             }
 
@@ -1064,7 +1628,7 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
                 case OBJECT_ENTITY:
                     ent = (entity_p)cont->object;
                     if(OBB_OBB_Test(ent->obb, room->obb, 0.0f) &&
-                       Frustum_IsOBBVisibleInFrustumList(ent->obb, (room->frustum) ? (room->frustum) : (m_camera->frustum)))
+                       Frustum_IsOBBVisibleInFrustumList(ent->obb, frustum))
                     {
                         this->DrawEntity(ent, modelViewMatrix, modelViewProjectionMatrix);
                     }
@@ -1076,9 +1640,224 @@ void CRender::DrawRoom(struct room_s *room, const float modelViewMatrix[16], con
 }
 
 
+void CRender::DrawStaticMesh(struct room_s *room, uint32_t index, struct render_static_batch_s *batch, const float modelViewProjectionMatrix[16])
+{
+    static_mesh_p sm = room->content->static_mesh + index;
+    const unlit_tinted_shader_description *shader = shaderManager->getStaticMeshShader();
+
+    if(batch && batch->batched[index])
+    {
+        float depth = vec3_dist(sm->pos, m_camera->gl_transform + 12);
+        for(uint32_t i = batch->static_faces[index]; i < batch->static_faces[index + 1]; i++)
+        {
+            mesh_face_p face = batch->faces + i;
+            m_queue->AddFace(shader, face->texture_index, batch->vbo, m_queue_view_proj, m_queue_no_tint, depth, face->elements_count, face->elements);
+        }
+    }
+    else
+    {
+        GLfloat tint[4];
+        vec4_copy(tint, sm->tint);
+
+        //If this static mesh is in a water room
+        if(room->flags & TR_ROOM_FLAG_WATER)
+        {
+            CalculateWaterTint(tint, 0);
+        }
+
+        if(m_instancing && sm->mesh->vbo_vertex_array && !sm->mesh->animated_vertex_count)
+        {
+            m_instances->AddStatic(sm->mesh, sm->transform, tint);              // drawn by FlushQueue()
+        }
+        else
+        {
+            float transform[16];
+            qglUseProgramObjectARB(shader->program);
+            Mat4_Mat4_mul(transform, modelViewProjectionMatrix, sm->transform);
+            qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, transform);
+            qglUniform4fvARB(shader->tint_mult, 1, tint);
+            m_state_changes += 3;
+            this->DrawMesh(sm->mesh, NULL, NULL);
+        }
+    }
+}
+
+/*
+ * Returns NULL if room has no static meshes, that may be batched.
+ */
+struct render_static_batch_s *CRender::GetStaticBatch(struct room_s *room)
+{
+    render_static_batch_p batch;
+    room_content_p content = room->content;
+    uint32_t water = room->flags & TR_ROOM_FLAG_WATER;
+    uint32_t vertex_count = 0, faces_count = 0, elements_count = 0;
+    vertex_p vertices;
+
+    if(!m_static_batches || (room < m_rooms) || (room >= m_rooms + m_rooms_count))
+    {
+        return NULL;
+    }
+
+    batch = m_static_batches + (room - m_rooms);
+    if((batch->content == content) && (batch->water == water))
+    {
+        return (batch->vbo) ? (batch) : (NULL);
+    }
+
+    if(qglIsBufferARB(batch->vbo))
+    {
+        qglDeleteBuffersARB(1, &batch->vbo);
+    }
+    free(batch->batched);
+    free(batch->faces);
+    free(batch->elements);
+    batch->vbo = 0;
+    batch->content = content;
+    batch->water = water;
+    batch->batched = (uint8_t*)malloc(content->static_mesh_count * sizeof(uint8_t) + (content->static_mesh_count + 1) * sizeof(uint32_t));
+    batch->static_faces = (uint32_t*)(batch->batched + content->static_mesh_count);
+    batch->faces = NULL;
+    batch->elements = NULL;
+
+    for(uint32_t i = 0; i < content->static_mesh_count; i++)
+    {
+        base_mesh_p mesh = content->static_mesh[i].mesh;
+        batch->batched[i] = mesh && mesh->vbo_vertex_array && mesh->vertex_count && !mesh->animated_vertex_count;
+        if(batch->batched[i])
+        {
+            vertex_count += mesh->vertex_count;
+            faces_count += mesh->faces_count;
+            for(uint32_t j = 0; j < mesh->faces_count; j++)
+            {
+                elements_count += mesh->faces[j].elements_count;
+            }
+        }
+    }
+
+    if(vertex_count == 0)
+    {
+        memset(batch->static_faces, 0, (content->static_mesh_count + 1) * sizeof(uint32_t));
+        return NULL;
+    }
+
+    vertices = (vertex_p)malloc(vertex_count * sizeof(vertex_t));
+    batch->faces = (mesh_face_p)malloc(faces_count * sizeof(mesh_face_t));
+    batch->elements = (GLuint*)malloc(elements_count * sizeof(GLuint));
+    vertex_count = 0;
+    faces_count = 0;
+    elements_count = 0;
+    for(uint32_t i = 0; i < content->static_mesh_count; i++)
+    {
+        static_mesh_p sm = content->static_mesh + i;
+        batch->static_faces[i] = faces_count;
+        if(batch->batched[i])
+        {
+            GLfloat tint[4];
+            vec4_copy(tint, sm->tint);
+            if(water)
+            {
+                CalculateWaterTint(tint, 0);
+            }
+
+            for(uint32_t j = 0; j < sm->mesh->vertex_count; j++)
+            {
+                vertex_p src = sm->mesh->vertices + j;
+                vertex_p dst = vertices + vertex_count + j;
+                Mat4_vec3_mul_macro(dst->position, sm->transform, src->position);
+                Mat4_vec3_rot_macro(dst->normal, sm->transform, src->normal);
+                dst->color[0] = src->color[0] * tint[0];
+                dst->color[1] = src->color[1] * tint[1];
+                dst->color[2] = src->color[2] * tint[2];
+                dst->color[3] = src->color[3] * tint[3];
+                dst->tex_coord[0] = src->tex_coord[0];
+                dst->tex_coord[1] = src->tex_coord[1];
+            }
+
+            for(uint32_t j = 0; j < sm->mesh->faces_count; j++)
+            {
+                mesh_face_p src = sm->mesh->faces + j;
+                mesh_face_p dst = batch->faces + faces_count++;
+                dst->texture_index = src->texture_index;
+                dst->elements_count = src->elements_count;
+                dst->elements = batch->elements + elements_count;
+                for(uint32_t k = 0; k < src->elements_count; k++)
+                {
+                    dst->elements[k] = src->elements[k] + vertex_count;
+                }
+                elements_count += src->elements_count;
+            }
+            vertex_count += sm->mesh->vertex_count;
+        }
+    }
+    batch->static_faces[content->static_mesh_count] = faces_count;
+
+    qglGenBuffersARB(1, &batch->vbo);
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, batch->vbo);
+    qglBufferDataARB(GL_ARRAY_BUFFER_ARB, vertex_count * sizeof(vertex_t), vertices, GL_STATIC_DRAW);
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+    free(vertices);
+
+    return (batch->vbo) ? (batch) : (NULL);
+}
+
+void CRender::ClearStaticBatches()
+{
+    if(m_static_batches)
+    {
+        for(uint32_t i = 0; i < m_rooms_count; i++)
+        {
+            render_static_batch_p batch = m_static_batches + i;
+            if(batch->vbo && qglIsBufferARB(batch->vbo))
+            {
+                qglDeleteBuffersARB(1, &batch->vbo);
+            }
+            free(batch->batched);
+            free(batch->faces);
+            free(batch->elements);
+        }
+        free(m_static_batches);
+        m_static_batches = NULL;
+    }
+}
+
+/*
+ * Draws queued items; queue is started again with camera matrix and
+ * neutral tint, used by all world space geometry.
+ */
+void CRender::FlushQueue()
+{
+    render_queue_stats_t stats = {0, 0, 0};
+    GLfloat no_tint[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    m_queue->Flush(&stats);
+    m_draw_calls += stats.draw_calls;
+    m_state_changes += stats.state_changes;
+    m_queue_items += stats.items;
+    if(m_instancing)
+    {
+        render_instances_stats_t inst_stats = {0, 0, 0, 0};
+        m_instances->FlushStatics(shaderManager->getStaticMeshInstancedShader(), m_camera->gl_view_proj_mat, &inst_stats);
+        m_draw_calls += inst_stats.draw_calls;
+        m_state_changes += inst_stats.state_changes;
+        m_instanced += inst_stats.instances;
+        m_saved_draw_calls += inst_stats.saved_draw_calls;
+    }
+    m_active_texture = 0;
+
+    m_queue_view_proj = m_queue->AddMatrix(m_camera->gl_view_proj_mat);
+    m_queue_no_tint = m_queue->AddTint(no_tint);
+}
+
 void CRender::DrawRoomSprites(struct room_s *room)
 {
-    if (room->content->sprites_count > 0)
+    if(m_instancing)
+    {
+        if(room->content->sprites_count > 0)
+        {
+            m_instances->AddSprites(room->content->sprites, room->content->sprites_count);  // drawn in DrawList()
+        }
+    }
+    else if (room->content->sprites_count > 0)
     {
         const unlit_tinted_shader_description *shader = shaderManager->getRoomShader(false, false);
         GLfloat *view = m_camera->gl_transform + 8;
@@ -1151,6 +1930,17 @@ struct gl_text_line_s *CRender::OutTextXYZ(GLfloat x, GLfloat y, GLfloat z, cons
 }
 
 
+uint32_t CRender::GetRoomsList(struct room_s **rooms, uint32_t max_count)
+{
+    uint32_t count = (r_list_active_count < max_count) ? (r_list_active_count) : (max_count);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        rooms[i] = r_list[i].room;
+    }
+    return count;
+}
+
+
 int  CRender::AddRoom(struct room_s *room)
 {
     int ret = 0;
@@ -1203,7 +1993,13 @@ int CRender::ProcessRoom(struct portal_s *portal, struct frustum_s *frus)
     {
         portal_p p = room->portals + i;
         room_p dest_room = p->dest_room->real_room;
-        frustum_p gen_frus = frustumManager->PortalFrustumIntersect(p, frus, m_camera);  // backface portals are filtered here
+        frustum_p gen_frus;
+        if(m_pvs && !WORLD_PVS_HAS_ROOM(m_pvs, dest_room->id))
+        {
+            m_pvs_culled++;
+            continue;
+        }
+        gen_frus = frustumManager->PortalFrustumIntersect(p, frus, m_camera);  // backface portals are filtered here
         if(gen_frus)
         {
             ret++;
@@ -1326,6 +2122,7 @@ const lit_shader_description *CRender::SetupEntityLight(struct entity_s *entity,
 
         shader = shaderManager->getEntityShader(current_light_number);
         qglUseProgramObjectARB(shader->program);
+        m_state_changes++;
         qglUniform4fvARB(shader->light_ambient, 1, ambient_component);
         qglUniform4fvARB(shader->light_color, current_light_number, colors);
         qglUniform3fvARB(shader->light_position, current_light_number, positions);
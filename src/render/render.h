@@ -78,6 +78,9 @@ typedef struct render_settings_s
     GLfloat   fog_color[4];
     float     fog_start_depth;
     float     fog_end_depth;
+    int8_t    parallel_portals;         // portal visibility traversal on the jobs pool
+    int8_t    room_pvs;                 // skip portals to rooms out of camera room PVS
+    int8_t    instancing;               // instanced static meshes and sprites, if GL supports it
 }render_settings_t, *render_settings_p;
 
 
@@ -143,16 +146,22 @@ class CRender
         void DrawList();
         void DrawListDebugLines();
         void CleanList();
+        uint32_t GetRoomsList(struct room_s **rooms, uint32_t max_count);
+        void GetListStats(float *time, uint32_t *pvs_rooms, uint32_t *pvs_culled);
+        void GetDrawStats(uint32_t *draw_calls, uint32_t *state_changes, uint32_t *queue_items);
+        bool GetInstancingStats(uint32_t *instances, int32_t *saved_draw_calls);   // false if instancing was not used
 
         void DrawBSPPolygon(struct bsp_polygon_s *p);
         void DrawBSPFrontToBack(struct bsp_node_s *root);
         void DrawBSPBackToFront(struct bsp_node_s *root);
 
         void DrawMesh(struct base_mesh_s *mesh, const float *overrideVertices, const float *overrideNormals);
+        void DrawMeshAnimatedFaces(struct base_mesh_s *mesh);
         void DrawSkinMesh(struct base_mesh_s *mesh, struct base_mesh_s *parent_mesh, uint32_t *map, float transform[16]);
         void DrawSkyBox(const float matrix[16]);
 
         void DrawSkeletalModel(const struct lit_shader_description *shader, struct ss_bone_frame_s *bframe, const float mvMatrix[16], const float mvpMatrix[16]);
+        void DrawRagdoll(const struct lit_shader_description *shader, struct entity_s *entity, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16]);
         void DrawEntity(struct entity_s *entity, const float modelViewMatrix[16], const float modelViewProjectionMatrix[16]);
 
         void DrawRoom(struct room_s *room, const float matrix[16], const float modelViewProjectionMatrix[16]);
@@ -171,6 +180,15 @@ class CRender
         void InitSettings();
         int  AddRoom(struct room_s *room);
         int  ProcessRoom(struct portal_s *portal, struct frustum_s *frus);
+        int  GenWorldListParallel(struct camera_s *cam, struct room_s *curr_room);
+        void PrepareBVHBuffers(uint32_t count);
+        uint32_t QueryBVH(struct bvh_s *bvh, uint32_t items_count, struct frustum_s *frustum);
+        bool IsBSPRoomsListValid();
+        void GenStaticBSP();
+        struct render_static_batch_s *GetStaticBatch(struct room_s *room);
+        void ClearStaticBatches();
+        void FlushQueue();
+        void DrawStaticMesh(struct room_s *room, uint32_t index, struct render_static_batch_s *batch, const float modelViewProjectionMatrix[16]);
         const lit_shader_description *SetupEntityLight(struct entity_s *entity, const float modelViewMatrix[16]);
         
         struct camera_s            *m_camera;
@@ -187,6 +205,29 @@ class CRender
         uint32_t                    r_list_active_count;
         struct render_list_s       *r_list;
         class CFrustumManager      *frustumManager;
+        uint32_t                    m_portal_tasks_size;
+        struct render_portal_task_s *m_portal_tasks;      // start room portals subtrees, see GenWorldListParallel()
+        const uint32_t             *m_pvs;                 // camera room PVS row or NULL
+        uint32_t                    m_pvs_rooms;
+        uint32_t                    m_pvs_culled;          // portals skipped by PVS
+        float                       m_list_time;
+        uint32_t                    m_bvh_buf_size;
+        uint16_t                   *m_bvh_items;           // QueryBVH() result
+        uint8_t                    *m_bvh_visible;         // room objects visibility marks, see DrawRoom()
+        uint32_t                    m_bsp_rooms_count;
+        struct room_s             **m_bsp_rooms;           // rooms of the static transparency BSP part
+        struct room_content_s     **m_bsp_contents;        // and their contents (rooms may be flipped)
+        class CRenderQueue         *m_queue;               // opaque rooms and static meshes draws
+        struct render_static_batch_s *m_static_batches;    // per room, static meshes in world space
+        uint16_t                    m_queue_view_proj;     // queue matrix / tint indexes for world space geometry
+        uint16_t                    m_queue_no_tint;
+        uint32_t                    m_draw_calls;          // last frame stats
+        uint32_t                    m_state_changes;
+        uint32_t                    m_queue_items;
+        class CRenderInstances     *m_instances;           // instanced static meshes and sprites
+        bool                        m_instancing;          // m_instances are used in the current frame
+        uint32_t                    m_instanced;
+        int32_t                     m_saved_draw_calls;
         
     public:
         struct render_settings_s    settings;
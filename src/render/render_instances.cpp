@@ -0,0 +1,318 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+#include "../core/gl_util.h"
+#include "../core/vmath.h"
+#include "../core/polygon.h"
+#include "../mesh.h"
+#include "../room.h"
+#include "shader_description.h"
+#include "render_instances.h"
+
+
+static int RenderInstances_CompareStatics(const void *a, const void *b)
+{
+    uintptr_t ma = (uintptr_t)((const render_instance_t*)a)->mesh;
+    uintptr_t mb = (uintptr_t)((const render_instance_t*)b)->mesh;
+    return (ma < mb) ? (-1) : ((ma > mb) ? (1) : (0));
+}
+
+
+static int RenderInstances_CompareSprites(const void *a, const void *b)
+{
+    GLuint ta = ((const render_sprite_instance_t*)a)->texture;
+    GLuint tb = ((const render_sprite_instance_t*)b)->texture;
+    return (ta < tb) ? (-1) : ((ta > tb) ? (1) : (0));
+}
+
+
+static inline void RenderInstances_AttribPointer(GLint index, GLint size, GLsizei stride, size_t offset)
+{
+    qglVertexAttribPointerARB(index, size, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+}
+
+
+CRenderInstances::CRenderInstances() :
+m_statics(NULL),
+m_statics_count(0),
+m_statics_size(0),
+m_sprites(NULL),
+m_sprites_count(0),
+m_sprites_size(0),
+m_sprites_lists(0),
+m_vbo(0),
+m_vbo_size(0),
+m_corners_vbo(0)
+{
+}
+
+
+CRenderInstances::~CRenderInstances()
+{
+    free(m_statics);
+    m_statics = NULL;
+    m_statics_count = 0;
+    m_statics_size = 0;
+
+    free(m_sprites);
+    m_sprites = NULL;
+    m_sprites_count = 0;
+    m_sprites_size = 0;
+
+    if(m_vbo != 0)
+    {
+        qglDeleteBuffersARB(1, &m_vbo);
+        m_vbo = 0;
+    }
+    if(m_corners_vbo != 0)
+    {
+        qglDeleteBuffersARB(1, &m_corners_vbo);
+        m_corners_vbo = 0;
+    }
+    m_vbo_size = 0;
+}
+
+
+bool CRenderInstances::IsSupported()
+{
+    return qglDrawArraysInstancedARB && qglDrawElementsInstancedARB && qglVertexAttribDivisorARB;
+}
+
+
+void CRenderInstances::Upload(const void *data, uint32_t size)
+{
+    if(m_vbo == 0)
+    {
+        qglGenBuffersARB(1, &m_vbo);
+    }
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, m_vbo);
+    if(size > m_vbo_size)
+    {
+        m_vbo_size = size + size / 2;
+    }
+    qglBufferDataARB(GL_ARRAY_BUFFER_ARB, m_vbo_size, NULL, GL_STREAM_DRAW);      // orphans previous flush data
+    qglBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, size, data);
+}
+
+
+void CRenderInstances::AddStatic(const struct base_mesh_s *mesh, const float matrix[16], const float tint[4])
+{
+    render_instance_p inst;
+
+    if(m_statics_count >= m_statics_size)
+    {
+        m_statics_size = (m_statics_size) ? (2 * m_statics_size) : (256);
+        m_statics = (render_instance_p)realloc(m_statics, m_statics_size * sizeof(render_instance_t));
+    }
+
+    inst = m_statics + m_statics_count++;
+    inst->mesh = mesh;
+    Mat4_Copy(inst->matrix, matrix);
+    vec4_copy(inst->tint, tint);
+}
+
+
+void CRenderInstances::AddSprites(const struct room_sprite_s *sprites, uint32_t count)
+{
+    if(m_sprites_count + count > m_sprites_size)
+    {
+        m_sprites_size = m_sprites_count + count + 256;
+        m_sprites = (render_sprite_instance_p)realloc(m_sprites, m_sprites_size * sizeof(render_sprite_instance_t));
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const room_sprite_t *s = sprites + i;
+        if(s->sprite)
+        {
+            render_sprite_instance_p inst = m_sprites + m_sprites_count++;
+            inst->texture = s->sprite->texture_index;
+            vec3_copy(inst->pos, s->pos);
+            inst->rect[0] = s->sprite->left;
+            inst->rect[1] = s->sprite->right;
+            inst->rect[2] = s->sprite->top;
+            inst->rect[3] = s->sprite->bottom;
+            for(int j = 0; j < 4; j++)
+            {
+                inst->tex_x[j] = s->sprite->tex_coord[2 * j + 0];
+                inst->tex_y[j] = s->sprite->tex_coord[2 * j + 1];
+            }
+        }
+    }
+    m_sprites_lists++;
+}
+
+
+void CRenderInstances::FlushStatics(const struct instanced_tinted_shader_description *shader, const float view_proj[16], render_instances_stats_p stats)
+{
+    const GLsizei stride = sizeof(render_instance_t);
+    GLuint texture = 0;
+
+    if(m_statics_count == 0)
+    {
+        return;
+    }
+
+    qsort(m_statics, m_statics_count, sizeof(render_instance_t), RenderInstances_CompareStatics);
+    this->Upload(m_statics, m_statics_count * sizeof(render_instance_t));
+    stats->instances += m_statics_count;
+
+    qglUseProgramObjectARB(shader->program);
+    qglUniform1iARB(shader->sampler, 0);
+    qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, view_proj);
+    stats->state_changes += 2;
+    for(int k = 0; k < 4; k++)
+    {
+        qglEnableVertexAttribArrayARB(shader->instance_matrix + k);
+        qglVertexAttribDivisorARB(shader->instance_matrix + k, 1);
+    }
+    qglEnableVertexAttribArrayARB(shader->instance_tint);
+    qglVertexAttribDivisorARB(shader->instance_tint, 1);
+
+    for(uint32_t i = 0; i < m_statics_count; )
+    {
+        const base_mesh_s *mesh = m_statics[i].mesh;
+        size_t offset = i * sizeof(render_instance_t);
+        uint32_t next = i + 1;
+
+        for(; (next < m_statics_count) && (m_statics[next].mesh == mesh); next++);
+
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, mesh->vbo_vertex_array);
+        qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
+        qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
+        qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
+        qglTexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
+
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, m_vbo);
+        for(int k = 0; k < 4; k++)
+        {
+            RenderInstances_AttribPointer(shader->instance_matrix + k, 4, stride, offset + offsetof(render_instance_t, matrix) + 4 * k * sizeof(GLfloat));
+        }
+        RenderInstances_AttribPointer(shader->instance_tint, 4, stride, offset + offsetof(render_instance_t, tint));
+        stats->state_changes += 2;
+
+        for(uint32_t j = 0; j < mesh->faces_count; j++)
+        {
+            const mesh_face_t *face = mesh->faces + j;
+            if(face->texture_index != texture)
+            {
+                texture = face->texture_index;
+                qglBindTexture(GL_TEXTURE_2D, texture);
+                stats->state_changes++;
+            }
+            qglDrawElementsInstancedARB(GL_TRIANGLES, face->elements_count, GL_UNSIGNED_INT, face->elements, next - i);
+            stats->draw_calls++;
+        }
+        stats->saved_draw_calls += (next - i - 1) * mesh->faces_count;
+        i = next;
+    }
+
+    for(int k = 0; k < 4; k++)
+    {
+        qglVertexAttribDivisorARB(shader->instance_matrix + k, 0);
+        qglDisableVertexAttribArrayARB(shader->instance_matrix + k);
+    }
+    qglVertexAttribDivisorARB(shader->instance_tint, 0);
+    qglDisableVertexAttribArrayARB(shader->instance_tint);
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+    m_statics_count = 0;
+}
+
+
+void CRenderInstances::FlushSprites(const struct sprite_shader_description *shader, const float view_proj[16],
+                                    const float right[3], const float up[3], render_instances_stats_p stats)
+{
+    const GLsizei stride = sizeof(render_sprite_instance_t);
+    const GLint attribs[4] = {shader->sprite_pos, shader->sprite_rect, shader->sprite_tex_x, shader->sprite_tex_y};
+
+    if(m_sprites_count == 0)
+    {
+        m_sprites_lists = 0;
+        return;
+    }
+
+    if(m_corners_vbo == 0)
+    {
+        const GLfloat corners[16] = {1.0f, 0.0f, 0.0f, 0.0f,
+                                     0.0f, 1.0f, 0.0f, 0.0f,
+                                     0.0f, 0.0f, 1.0f, 0.0f,
+                                     0.0f, 0.0f, 0.0f, 1.0f};
+        qglGenBuffersARB(1, &m_corners_vbo);
+        qglBindBufferARB(GL_ARRAY_BUFFER_ARB, m_corners_vbo);
+        qglBufferDataARB(GL_ARRAY_BUFFER_ARB, sizeof(corners), corners, GL_STATIC_DRAW);
+    }
+
+    qsort(m_sprites, m_sprites_count, sizeof(render_sprite_instance_t), RenderInstances_CompareSprites);
+    this->Upload(m_sprites, m_sprites_count * sizeof(render_sprite_instance_t));
+    stats->instances += m_sprites_count;
+    stats->saved_draw_calls += m_sprites_lists;
+
+    qglUseProgramObjectARB(shader->program);
+    qglUniform1iARB(shader->sampler, 0);
+    qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, view_proj);
+    qglUniform3fvARB(shader->camera_right, 1, right);
+    qglUniform3fvARB(shader->camera_up, 1, up);
+    stats->state_changes += 4;
+
+    // corner is on the location 0, which aliases gl_Vertex (and fixed arrays
+    // may alias other generic locations), so client arrays are off here.
+    qglPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    qglDisableClientState(GL_VERTEX_ARRAY);
+    qglDisableClientState(GL_NORMAL_ARRAY);
+    qglDisableClientState(GL_COLOR_ARRAY);
+    qglDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, m_corners_vbo);
+    qglEnableVertexAttribArrayARB(shader->corner);
+    RenderInstances_AttribPointer(shader->corner, 4, 4 * sizeof(GLfloat), 0);
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, m_vbo);
+    for(int k = 0; k < 4; k++)
+    {
+        qglEnableVertexAttribArrayARB(attribs[k]);
+        qglVertexAttribDivisorARB(attribs[k], 1);
+    }
+
+    for(uint32_t i = 0; i < m_sprites_count; )
+    {
+        GLuint texture = m_sprites[i].texture;
+        size_t offset = i * sizeof(render_sprite_instance_t);
+        uint32_t next = i + 1;
+
+        for(; (next < m_sprites_count) && (m_sprites[next].texture == texture); next++);
+
+        RenderInstances_AttribPointer(shader->sprite_pos, 3, stride, offset + offsetof(render_sprite_instance_t, pos));
+        RenderInstances_AttribPointer(shader->sprite_rect, 4, stride, offset + offsetof(render_sprite_instance_t, rect));
+        RenderInstances_AttribPointer(shader->sprite_tex_x, 4, stride, offset + offsetof(render_sprite_instance_t, tex_x));
+        RenderInstances_AttribPointer(shader->sprite_tex_y, 4, stride, offset + offsetof(render_sprite_instance_t, tex_y));
+        qglBindTexture(GL_TEXTURE_2D, texture);
+        qglDrawArraysInstancedARB(GL_TRIANGLE_FAN, 0, 4, next - i);
+        stats->state_changes += 2;
+        stats->draw_calls++;
+        stats->saved_draw_calls--;
+        i = next;
+    }
+
+    for(int k = 0; k < 4; k++)
+    {
+        qglVertexAttribDivisorARB(attribs[k], 0);
+        qglDisableVertexAttribArrayARB(attribs[k]);
+    }
+    qglDisableVertexAttribArrayARB(shader->corner);
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+    qglPopClientAttrib();
+    m_sprites_count = 0;
+    m_sprites_lists = 0;
+}
+
+
+void CRenderInstances::Clear()
+{
+    m_statics_count = 0;
+    m_sprites_count = 0;
+    m_sprites_lists = 0;
+}
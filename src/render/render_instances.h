@@ -0,0 +1,78 @@
+
+#ifndef RENDER_INSTANCES_H
+#define RENDER_INSTANCES_H
+
+#include <stdint.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+struct base_mesh_s;
+struct room_sprite_s;
+struct instanced_tinted_shader_description;
+struct sprite_shader_description;
+
+/*
+ * Instanced draws of repeated static meshes and room sprites: instances
+ * are collected while render list is drawn, grouped by mesh (sprites - by
+ * texture) and drawn by one instanced draw call per mesh face (per sprites
+ * texture). Per instance data is streamed to the one vertex buffer, items
+ * arrays are uploaded as is, so attributes stride is the item size.
+ * Works only if IsSupported(), otherwise renderer uses not instanced path.
+ */
+typedef struct render_instance_s
+{
+    const struct base_mesh_s   *mesh;
+    GLfloat                     matrix[16];
+    GLfloat                     tint[4];
+}render_instance_t, *render_instance_p;
+
+typedef struct render_sprite_instance_s
+{
+    GLuint                      texture;
+    GLfloat                     pos[3];
+    GLfloat                     rect[4];                                        // left, right, top, bottom
+    GLfloat                     tex_x[4];                                       // corners tex coords
+    GLfloat                     tex_y[4];
+}render_sprite_instance_t, *render_sprite_instance_p;
+
+typedef struct render_instances_stats_s
+{
+    uint32_t            instances;
+    uint32_t            draw_calls;
+    int32_t             saved_draw_calls;                                       // against draw per static mesh face and per room sprites
+    uint32_t            state_changes;
+}render_instances_stats_t, *render_instances_stats_p;
+
+
+class CRenderInstances
+{
+    render_instance_p           m_statics;
+    uint32_t                    m_statics_count;
+    uint32_t                    m_statics_size;
+
+    render_sprite_instance_p    m_sprites;
+    uint32_t                    m_sprites_count;
+    uint32_t                    m_sprites_size;
+    uint32_t                    m_sprites_lists;                                // rooms, which sprites were added
+
+    GLuint                      m_vbo;                                          // per instance data
+    uint32_t                    m_vbo_size;
+    GLuint                      m_corners_vbo;                                  // sprite quad
+
+    void Upload(const void *data, uint32_t size);
+
+public:
+    CRenderInstances();
+   ~CRenderInstances();
+
+    static bool IsSupported();
+
+    void AddStatic(const struct base_mesh_s *mesh, const float matrix[16], const float tint[4]);
+    void AddSprites(const struct room_sprite_s *sprites, uint32_t count);
+    void FlushStatics(const struct instanced_tinted_shader_description *shader, const float view_proj[16], render_instances_stats_p stats);
+    void FlushSprites(const struct sprite_shader_description *shader, const float view_proj[16],
+                      const float right[3], const float up[3], render_instances_stats_p stats);
+    void Clear();
+};
+
+#endif
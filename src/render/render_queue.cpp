@@ -0,0 +1,252 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+#include "../core/gl_util.h"
+#include "../core/vmath.h"
+#include "../core/polygon.h"
+#include "shader_description.h"
+#include "render_queue.h"
+
+#define RENDER_QUEUE_DEPTH_SCALE        (1.0f / 32.0f)
+
+
+static int RenderQueue_CompareItems(const void *a, const void *b)
+{
+    uint64_t ka = ((const render_queue_item_t*)a)->key;
+    uint64_t kb = ((const render_queue_item_t*)b)->key;
+    return (ka < kb) ? (-1) : ((ka > kb) ? (1) : (0));
+}
+
+
+static inline bool RenderQueue_SameState(render_queue_item_p a, render_queue_item_p b)
+{
+    return (a->shader == b->shader) && (a->texture == b->texture) && (a->vbo == b->vbo) &&
+           (a->matrix == b->matrix) && (a->tint == b->tint);
+}
+
+
+CRenderQueue::CRenderQueue() :
+m_items(NULL),
+m_items_count(0),
+m_items_size(0),
+m_matrices(NULL),
+m_matrices_count(0),
+m_matrices_size(0),
+m_tints(NULL),
+m_tints_count(0),
+m_tints_size(0),
+m_elements(NULL),
+m_elements_size(0),
+m_shaders_count(0)
+{
+}
+
+
+CRenderQueue::~CRenderQueue()
+{
+    free(m_items);
+    m_items = NULL;
+    m_items_count = 0;
+    m_items_size = 0;
+
+    free(m_matrices);
+    m_matrices = NULL;
+    m_matrices_count = 0;
+    m_matrices_size = 0;
+
+    free(m_tints);
+    m_tints = NULL;
+    m_tints_count = 0;
+    m_tints_size = 0;
+
+    free(m_elements);
+    m_elements = NULL;
+    m_elements_size = 0;
+}
+
+
+uint64_t CRenderQueue::GetShaderOrder(const struct unlit_tinted_shader_description *shader)
+{
+    for(uint32_t i = 0; i < m_shaders_count; i++)
+    {
+        if(m_shaders[i] == shader)
+        {
+            return i;
+        }
+    }
+
+    if(m_shaders_count < RENDER_QUEUE_MAX_SHADERS)
+    {
+        m_shaders[m_shaders_count] = shader;
+        return m_shaders_count++;
+    }
+
+    return RENDER_QUEUE_MAX_SHADERS - 1;                                        // only order, state is checked by pointer
+}
+
+
+uint16_t CRenderQueue::AddMatrix(const float matrix[16])
+{
+    if(m_matrices_count >= m_matrices_size)
+    {
+        m_matrices_size = (m_matrices_size) ? (2 * m_matrices_size) : (256);
+        m_matrices = (float*)realloc(m_matrices, 16 * m_matrices_size * sizeof(float));
+    }
+    Mat4_Copy(m_matrices + 16 * m_matrices_count, matrix);
+
+    return m_matrices_count++;
+}
+
+
+uint16_t CRenderQueue::AddTint(const float tint[4])
+{
+    if(m_tints_count >= m_tints_size)
+    {
+        m_tints_size = (m_tints_size) ? (2 * m_tints_size) : (256);
+        m_tints = (float*)realloc(m_tints, 4 * m_tints_size * sizeof(float));
+    }
+    vec4_copy(m_tints + 4 * m_tints_count, tint);
+
+    return m_tints_count++;
+}
+
+
+void CRenderQueue::AddFace(const struct unlit_tinted_shader_description *shader, GLuint texture, GLuint vbo,
+                           uint16_t matrix, uint16_t tint, float depth, GLuint elements_count, const GLuint *elements)
+{
+    render_queue_item_p item;
+    uint64_t depth_key;
+
+    if(m_items_count >= m_items_size)
+    {
+        m_items_size = (m_items_size) ? (2 * m_items_size) : (1024);
+        m_items = (render_queue_item_p)realloc(m_items, m_items_size * sizeof(render_queue_item_t));
+    }
+
+    depth *= RENDER_QUEUE_DEPTH_SCALE;
+    depth_key = (depth <= 0.0f) ? (0) : ((depth >= 65535.0f) ? (0xFFFF) : ((uint64_t)depth));
+
+    item = m_items + m_items_count++;
+    item->key = (this->GetShaderOrder(shader) << 60) |
+                ((uint64_t)(texture & 0xFFFF) << 44) |
+                ((uint64_t)(vbo & 0xFFFF) << 28) |
+                ((uint64_t)(matrix & 0x0FFF) << 16) |
+                depth_key;                                                      // front to back inside the same state
+    item->shader = shader;
+    item->texture = texture;
+    item->vbo = vbo;
+    item->matrix = matrix;
+    item->tint = tint;
+    item->elements_count = elements_count;
+    item->elements = elements;
+}
+
+
+void CRenderQueue::Flush(render_queue_stats_p stats)
+{
+    const struct unlit_tinted_shader_description *shader = NULL;
+    GLuint texture = 0;
+    GLuint vbo = 0;
+    uint32_t matrix = 0xFFFFFFFF;
+    uint32_t tint = 0xFFFFFFFF;
+    GLfloat tick = (GLfloat)SDL_GetTicks();
+
+    if(m_items_count == 0)
+    {
+        this->Clear();
+        return;
+    }
+
+    qsort(m_items, m_items_count, sizeof(render_queue_item_t), RenderQueue_CompareItems);
+    stats->items += m_items_count;
+
+    for(uint32_t i = 0; i < m_items_count; )
+    {
+        render_queue_item_p item = m_items + i;
+        GLuint elements_count = item->elements_count;
+        uint32_t next = i + 1;
+
+        if(item->shader != shader)
+        {
+            shader = item->shader;
+            qglUseProgramObjectARB(shader->program);
+            qglUniform1iARB(shader->sampler, 0);
+            qglUniform1fARB(shader->current_tick, tick);
+            matrix = 0xFFFFFFFF;
+            tint = 0xFFFFFFFF;
+            stats->state_changes++;
+        }
+        if(item->matrix != matrix)
+        {
+            matrix = item->matrix;
+            qglUniformMatrix4fvARB(shader->model_view_projection, 1, false, m_matrices + 16 * matrix);
+            stats->state_changes++;
+        }
+        if(item->tint != tint)
+        {
+            tint = item->tint;
+            qglUniform4fvARB(shader->tint_mult, 1, m_tints + 4 * tint);
+            stats->state_changes++;
+        }
+        if((item->vbo != vbo) || (i == 0))
+        {
+            vbo = item->vbo;
+            qglBindBufferARB(GL_ARRAY_BUFFER_ARB, vbo);
+            qglVertexPointer(3, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, position));
+            qglColorPointer(4, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, color));
+            qglNormalPointer(GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, normal));
+            qglTexCoordPointer(2, GL_FLOAT, sizeof(vertex_t), (void*)offsetof(vertex_t, tex_coord));
+            stats->state_changes++;
+        }
+        if(item->texture != texture)
+        {
+            texture = item->texture;
+            qglBindTexture(GL_TEXTURE_2D, texture);
+            stats->state_changes++;
+        }
+
+        for(; (next < m_items_count) && RenderQueue_SameState(item, m_items + next); next++)
+        {
+            elements_count += m_items[next].elements_count;
+        }
+
+        if(next == i + 1)
+        {
+            qglDrawElements(GL_TRIANGLES, elements_count, GL_UNSIGNED_INT, item->elements);
+        }
+        else
+        {
+            GLuint *dst;
+            if(elements_count > m_elements_size)
+            {
+                m_elements_size = elements_count + 1024;
+                m_elements = (GLuint*)realloc(m_elements, m_elements_size * sizeof(GLuint));
+            }
+            dst = m_elements;
+            for(uint32_t j = i; j < next; j++)
+            {
+                memcpy(dst, m_items[j].elements, m_items[j].elements_count * sizeof(GLuint));
+                dst += m_items[j].elements_count;
+            }
+            qglDrawElements(GL_TRIANGLES, elements_count, GL_UNSIGNED_INT, m_elements);
+        }
+        stats->draw_calls++;
+        i = next;
+    }
+
+    qglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+    this->Clear();
+}
+
+
+void CRenderQueue::Clear()
+{
+    m_items_count = 0;
+    m_matrices_count = 0;
+    m_tints_count = 0;
+}
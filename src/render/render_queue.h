@@ -0,0 +1,82 @@
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <stdint.h>
+#include <SDL2/SDL_platform.h>
+#include <SDL2/SDL_opengl.h>
+
+struct vertex_s;
+struct unlit_tinted_shader_description;
+
+/*
+ * Opaque draws queue: items are collected while render list is drawn, and
+ * drawn by Flush() sorted by key (shader, texture, vertex buffer, matrix,
+ * depth), so state is changed only between groups; neighbour items with
+ * the same state are merged into one draw call (indexes are copied to one
+ * array). Matrices and tints are stored once per object and addressed by
+ * index from items.
+ */
+#define RENDER_QUEUE_MAX_SHADERS        (16)
+#define RENDER_QUEUE_MAX_MATRICES       (0xFFFF)
+
+typedef struct render_queue_item_s
+{
+    uint64_t                                        key;
+    const struct unlit_tinted_shader_description   *shader;
+    GLuint                                          texture;
+    GLuint                                          vbo;
+    uint16_t                                        matrix;         // model view projection matrix index
+    uint16_t                                        tint;           // tint index
+    GLuint                                          elements_count;
+    const GLuint                                   *elements;
+}render_queue_item_t, *render_queue_item_p;
+
+typedef struct render_queue_stats_s
+{
+    uint32_t            items;
+    uint32_t            draw_calls;
+    uint32_t            state_changes;                                          // program, buffer, texture binds and uniforms
+}render_queue_stats_t, *render_queue_stats_p;
+
+
+class CRenderQueue
+{
+    render_queue_item_p  m_items;
+    uint32_t             m_items_count;
+    uint32_t             m_items_size;
+
+    float               *m_matrices;
+    uint32_t             m_matrices_count;
+    uint32_t             m_matrices_size;
+
+    float               *m_tints;
+    uint32_t             m_tints_count;
+    uint32_t             m_tints_size;
+
+    GLuint              *m_elements;                                            // merged items indexes
+    uint32_t             m_elements_size;
+
+    const struct unlit_tinted_shader_description *m_shaders[RENDER_QUEUE_MAX_SHADERS];
+    uint32_t             m_shaders_count;
+
+    uint64_t GetShaderOrder(const struct unlit_tinted_shader_description *shader);
+
+public:
+    CRenderQueue();
+   ~CRenderQueue();
+
+    uint16_t AddMatrix(const float matrix[16]);                                 // returns index, flush queue if IsFull()
+    uint16_t AddTint(const float tint[4]);
+    bool IsFull()
+    {
+        return (m_matrices_count + 16 >= RENDER_QUEUE_MAX_MATRICES) || (m_tints_count + 16 >= RENDER_QUEUE_MAX_MATRICES);
+    }
+
+    void AddFace(const struct unlit_tinted_shader_description *shader, GLuint texture, GLuint vbo,
+                 uint16_t matrix, uint16_t tint, float depth, GLuint elements_count, const GLuint *elements);
+    void Flush(render_queue_stats_p stats);                                     // draw and clear queue, stats are accumulated
+    void Clear();
+};
+
+#endif
@@ -73,3 +73,30 @@ unlit_tinted_shader_description::unlit_tinted_shader_description(const shader_st
     current_tick = qglGetUniformLocationARB(program, "fCurrentTick");
     tint_mult = qglGetUniformLocationARB(program, "tintMult");
 }
+
+instanced_tinted_shader_description::instanced_tinted_shader_description(const shader_stage &vertex, const shader_stage &fragment)
+: unlit_tinted_shader_description(vertex, fragment)
+{
+    instance_matrix = qglGetAttribLocationARB(program, "instanceMatrix");
+    instance_tint = qglGetAttribLocationARB(program, "instanceTint");
+}
+
+sprite_shader_description::sprite_shader_description(const shader_stage &vertex, const shader_stage &fragment)
+: unlit_shader_description(vertex, fragment)
+{
+    // no gl_Vertex in the program, so quad corner must be on the location 0;
+    // client vertex array is disabled while sprites are drawn (FlushSprites)
+    qglBindAttribLocationARB(program, 0, "corner");
+    qglLinkProgramARB(program);
+    printInfoLog(program);
+
+    sampler = qglGetUniformLocationARB(program, "color_map");
+    model_view_projection = qglGetUniformLocationARB(program, "modelViewProjection");
+    camera_right = qglGetUniformLocationARB(program, "cameraRight");
+    camera_up = qglGetUniformLocationARB(program, "cameraUp");
+    corner = qglGetAttribLocationARB(program, "corner");
+    sprite_pos = qglGetAttribLocationARB(program, "spritePos");
+    sprite_rect = qglGetAttribLocationARB(program, "spriteRect");
+    sprite_tex_x = qglGetAttribLocationARB(program, "spriteTexX");
+    sprite_tex_y = qglGetAttribLocationARB(program, "spriteTexY");
+}
@@ -76,4 +76,32 @@ struct unlit_tinted_shader_description : public unlit_shader_description
     unlit_tinted_shader_description(const shader_stage &vertex, const shader_stage &fragment);
 };
 
+/*!
+ * Static mesh shader with per instance model matrix and tint attributes
+ * (model_view_projection is view projection matrix here).
+ */
+struct instanced_tinted_shader_description : public unlit_tinted_shader_description
+{
+    GLint instance_matrix;                                                      // mat4, takes 4 attribute locations
+    GLint instance_tint;
+
+    instanced_tinted_shader_description(const shader_stage &vertex, const shader_stage &fragment);
+};
+
+/*!
+ * Camera facing sprites, drawn as instances of one quad.
+ */
+struct sprite_shader_description : public unlit_shader_description
+{
+    GLint camera_right;
+    GLint camera_up;
+    GLint corner;
+    GLint sprite_pos;
+    GLint sprite_rect;
+    GLint sprite_tex_x;
+    GLint sprite_tex_y;
+
+    sprite_shader_description(const shader_stage &vertex, const shader_stage &fragment);
+};
+
 #endif /* defined(__OpenTomb__shader_description__) */
@@ -6,7 +6,17 @@
 shader_manager::shader_manager()
 {
     //Color mult prog
-    static_mesh_shader = new unlit_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/static_mesh.vsh"), shader_stage(GL_FRAGMENT_SHADER_ARB, "shaders/static_mesh.fsh"));
+    shader_stage staticMeshFragmentShader(GL_FRAGMENT_SHADER_ARB, "shaders/static_mesh.fsh");
+    static_mesh_shader = new unlit_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/static_mesh.vsh"), staticMeshFragmentShader);
+
+    // Instanced static meshes and sprites progs
+    static_mesh_instanced_shader = NULL;
+    sprite_shader = NULL;
+    if(qglDrawArraysInstancedARB && qglDrawElementsInstancedARB && qglVertexAttribDivisorARB)
+    {
+        static_mesh_instanced_shader = new instanced_tinted_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/static_mesh.vsh", "#define INSTANCED\n"), staticMeshFragmentShader);
+        sprite_shader = new sprite_shader_description(shader_stage(GL_VERTEX_SHADER_ARB, "shaders/sprite.vsh"), staticMeshFragmentShader);
+    }
 
     //Room prog
     shader_stage roomFragmentShader(GL_FRAGMENT_SHADER_ARB, "shaders/room.fsh");
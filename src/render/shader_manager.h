@@ -9,6 +9,8 @@
 class shader_manager {
     unlit_tinted_shader_description *room_shaders[2][2];
     unlit_tinted_shader_description *static_mesh_shader;
+    instanced_tinted_shader_description *static_mesh_instanced_shader;        // NULL if instancing is not supported
+    sprite_shader_description *sprite_shader;                                   // NULL if instancing is not supported
     lit_shader_description *entity_shader[MAX_NUM_LIGHTS+1];
     text_shader_description *text;
 
@@ -19,6 +21,10 @@ public:
     const lit_shader_description *getEntityShader(unsigned numberOfLights) const;
     
     const unlit_tinted_shader_description *getStaticMeshShader() const { return static_mesh_shader; }
+
+    const instanced_tinted_shader_description *getStaticMeshInstancedShader() const { return static_mesh_instanced_shader; }
+
+    const sprite_shader_description *getSpriteShader() const { return sprite_shader; }
     
     const unlit_tinted_shader_description *getRoomShader(bool isFlickering, bool isWater) const;
     
@@ -38,6 +38,7 @@ extern "C" {
 #include "entity.h"
 #include "inventory.h"
 #include "resource.h"
+#include "world_cache.h"
 
 
 typedef struct fd_command_s
@@ -1623,6 +1624,7 @@ void TR_GenSkeletalModel(struct skeletal_model_s *model, size_t model_id, struct
         model->animations->next_frame = 0;
         model->animations->state_change = NULL;
         model->animations->state_change_count = 0;
+        model->animations->frames_pack = NULL;
         model->animations->commands = NULL;
         model->animations->effects = NULL;
         bone_frame->bone_tag_count = model->mesh_count;
@@ -1859,7 +1861,11 @@ void TR_GenSkeletalModel(struct skeletal_model_s *model, size_t model_id, struct
     /*
      * Animations interpolation to 1/30 sec like in original. Needed for correct state change works.
      */
-    TR_SkeletalModelInterpolateFrames(model, tr->animations + tr_moveable->animation_index);
+    if(!WorldCache_GetModelFrames(model, model_id))
+    {
+        TR_SkeletalModelInterpolateFrames(model, tr->animations + tr_moveable->animation_index);
+        WorldCache_PutModelFrames(model, model_id);
+    }
     /*
      * state change's loading
      */
@@ -8,6 +8,7 @@
 #include "core/vmath.h"
 #include "core/polygon.h"
 #include "core/obb.h"
+#include "core/bvh.h"
 #include "render/frustum.h"
 #include "physics/physics.h"
 #include "engine.h"
@@ -15,6 +16,14 @@
 #include "mesh.h"
 #include "trigger.h"
 #include "room.h"
+#include "world.h"
+
+
+static inline void Room_InvalidateEntityBVH(room_content_p content)
+{
+    BVH_Delete(content->entity_bvh);
+    content->entity_bvh = NULL;
+}
 
 
 void Room_Clear(struct room_s *room)
@@ -30,6 +39,17 @@ void Room_Clear(struct room_s *room)
     {
         room->content->containers = NULL;
 
+        BVH_Delete(room->content->static_mesh_bvh);
+        room->content->static_mesh_bvh = NULL;
+        BVH_Delete(room->content->entity_bvh);
+        room->content->entity_bvh = NULL;
+        free(room->content->entity_bvh_items);
+        room->content->entity_bvh_items = NULL;
+        room->content->entity_bvh_items_size = 0;
+        free(room->content->static_mesh_overlaps);
+        room->content->static_mesh_overlaps = NULL;
+        room->content->static_mesh_overlaps_count = 0;
+
         if(room->content->mesh)
         {
             BaseMesh_Clear(room->content->mesh);
@@ -124,6 +144,8 @@ void Room_Clear(struct room_s *room)
         }
         free(room->sectors);
         room->sectors = NULL;
+        free(room->sectors_hot);
+        room->sectors_hot = NULL;
         room->sectors_count = 0;
         room->sectors_x = 0;
         room->sectors_y = 0;
@@ -247,6 +269,7 @@ int  Room_AddObject(struct room_s *room, struct engine_container_s *cont)
     cont->room = room;
     cont->next = room->content->containers;
     room->content->containers = cont;
+    Room_InvalidateEntityBVH(room->content);
     return 1;
 }
 
@@ -264,6 +287,7 @@ int  Room_RemoveObject(struct room_s *room, struct engine_container_s *cont)
     {
         room->content->containers = cont->next;
         cont->room = NULL;
+        Room_InvalidateEntityBVH(room->content);
         return 1;
     }
 
@@ -275,6 +299,7 @@ int  Room_RemoveObject(struct room_s *room, struct engine_container_s *cont)
         {
             previous_cont->next = current_cont->next;
             cont->room = NULL;
+            Room_InvalidateEntityBVH(room->content);
             return 1;
         }
 
@@ -313,10 +338,13 @@ void Room_DoFlip(struct room_s *room1, struct room_s *room2)
         // swap sectors
         {
             room_sector_p t = room1->sectors;
+            room_sector_hot_p th = room1->sectors_hot;
             uint32_t count = room1->sectors_count;
             room1->sectors = room2->sectors;
+            room1->sectors_hot = room2->sectors_hot;
             room1->sectors_count = room2->sectors_count;
             room2->sectors = t;
+            room2->sectors_hot = th;
             room2->sectors_count = count;
 
             for(uint32_t i = 0; i < room1->sectors_count; ++i)
@@ -386,6 +414,8 @@ void Room_DoFlip(struct room_s *room1, struct room_s *room2)
             }
 
             // fix containers ownership
+            Room_InvalidateEntityBVH(room1->content);
+            Room_InvalidateEntityBVH(room2->content);
             for(engine_container_p cont = room1->content->containers; cont; cont = cont->next)
             {
                 cont->room = room1;
@@ -422,7 +452,8 @@ struct room_sector_s *Room_GetSectorRaw(struct room_s *room, float pos[3])
 
 struct room_sector_s *Room_GetSectorXYZ(struct room_s *room, float pos[3])
 {
-    room_sector_p ret = NULL;
+    room_sector_hot_p hs;
+    int index;
     int x = (int)(pos[0] - room->transform[12]) / 1024;
     int y = (int)(pos[1] - room->transform[13]) / 1024;
 
@@ -436,22 +467,75 @@ struct room_sector_s *Room_GetSectorXYZ(struct room_s *room, float pos[3])
      * column index system
      * X - column number, Y - string number
      */
-    ret = room->sectors + x * room->sectors_y + y;
+    index = x * room->sectors_y + y;
+    hs = room->sectors_hot + index;
 
     /*
      * resolve Z overlapped neighboard rooms. room below has more priority.
+     * all rooms in the column have the same sectors XY grid, so the same
+     * query position is used for all of them.
      */
-    if(ret->room_below && (pos[2] < ret->floor))
+    if((hs->room_below != ROOM_INDEX_NONE) && (pos[2] < hs->floor))
     {
-        ret = Room_GetSectorRaw(ret->room_below->real_room, ret->pos);
+        room = World_GetRoomByID(hs->room_below)->real_room;
+        if((index = Room_GetSectorIndex(room, pos)) < 0)
+        {
+            return NULL;
+        }
+        hs = room->sectors_hot + index;
     }
 
-    if(ret->room_above && (pos[2] > ret->ceiling))
+    if((hs->room_above != ROOM_INDEX_NONE) && (pos[2] > hs->ceiling))
     {
-        ret = Room_GetSectorRaw(ret->room_above->real_room, ret->pos);
+        room = World_GetRoomByID(hs->room_above)->real_room;
+        if((index = Room_GetSectorIndex(room, pos)) < 0)
+        {
+            return NULL;
+        }
     }
 
-    return ret;
+    return room->sectors + index;
+}
+
+
+/*
+ * Returns index of the sector in room sectors / sectors_hot arrays or -1.
+ */
+int  Room_GetSectorIndex(struct room_s *room, float pos[3])
+{
+    int x = (int)(pos[0] - room->transform[12]) / 1024;
+    int y = (int)(pos[1] - room->transform[13]) / 1024;
+    if(x < 0 || x >= room->sectors_x || y < 0 || y >= room->sectors_y)
+    {
+        return -1;
+    }
+    return x * room->sectors_y + y;
+}
+
+
+void Room_GenSectorsHot(struct room_s *room)
+{
+    free(room->sectors_hot);
+    room->sectors_hot = (room->sectors_count) ? ((room_sector_hot_p)malloc(room->sectors_count * sizeof(room_sector_hot_t))) : (NULL);
+    for(uint32_t i = 0; i < room->sectors_count; i++)
+    {
+        Room_UpdateSectorHot(room->sectors + i);
+    }
+}
+
+
+void Room_UpdateSectorHot(struct room_sector_s *sector)
+{
+    room_p room = sector->owner_room;
+    if(room->sectors_hot)
+    {
+        room_sector_hot_p hs = room->sectors_hot + (sector - room->sectors);
+        hs->floor = sector->floor;
+        hs->ceiling = sector->ceiling;
+        hs->portal_to_room = (sector->portal_to_room) ? (sector->portal_to_room->id) : (ROOM_INDEX_NONE);
+        hs->room_below = (sector->room_below) ? (sector->room_below->id) : (ROOM_INDEX_NONE);
+        hs->room_above = (sector->room_above) ? (sector->room_above->id) : (ROOM_INDEX_NONE);
+    }
 }
 
 
@@ -609,6 +693,8 @@ void Room_MoveActiveItems(struct room_s *room_to, struct room_s *room_from)
     engine_container_p t = room_from->content->containers;
 
     room_from->content->containers = NULL;
+    Room_InvalidateEntityBVH(room_from->content);
+    Room_InvalidateEntityBVH(room_to->content);
     for(; t; t = t->next)
     {
         t->room = room_to;
@@ -649,6 +735,153 @@ void Room_GenSpritesBuffer(struct room_s *room)
 }
 
 
+
+void Room_GenStaticMeshBVH(struct room_s *room)
+{
+    room_content_p content = room->content;
+
+    BVH_Delete(content->static_mesh_bvh);
+    content->static_mesh_bvh = NULL;
+    if((content->static_mesh_count > 0) && (content->static_mesh_count <= BVH_MAX_ITEMS))
+    {
+        float *bb = (float*)malloc(6 * content->static_mesh_count * sizeof(float));
+        for(uint32_t i = 0; i < content->static_mesh_count; i++)
+        {
+            OBB_GetAABB(content->static_mesh[i].obb, bb + 6 * i, bb + 6 * i + 3);
+        }
+        content->static_mesh_bvh = BVH_Create(bb, content->static_mesh_count);
+        free(bb);
+    }
+}
+
+/*
+ * Stores results of OBB_OBB_Test(static_mesh->obb, r->obb) for all rooms.
+ * Room and static mesh OBBs do not change with flips (content is moved with
+ * its statics), so list stays valid for the whole level.
+ */
+void Room_GenStaticMeshOverlaps(struct room_s *room, struct room_s *rooms, uint32_t rooms_count)
+{
+    room_content_p content = room->content;
+    uint32_t size = 0;
+
+    free(content->static_mesh_overlaps);
+    content->static_mesh_overlaps = NULL;
+    content->static_mesh_overlaps_count = 0;
+
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        room_p r = rooms + i;
+        float r_radius;
+        if(!r->obb)
+        {
+            continue;
+        }
+        r_radius = vec3_abs(r->obb->extent);
+        for(uint32_t j = 0; j < content->static_mesh_count; j++)
+        {
+            obb_p obb = content->static_mesh[j].obb;
+            float radius = r_radius + vec3_abs(obb->extent) + 1.0f;
+            if((vec3_dist_sq(obb->centre, r->obb->centre) <= radius * radius) &&
+               OBB_OBB_Test(obb, r->obb, 0.0f))
+            {
+                if(content->static_mesh_overlaps_count >= size)
+                {
+                    size = (size) ? (2 * size) : (16);
+                    content->static_mesh_overlaps = (static_mesh_overlap_p)realloc(content->static_mesh_overlaps, size * sizeof(static_mesh_overlap_t));
+                }
+                content->static_mesh_overlaps[content->static_mesh_overlaps_count].room_id = r->id;
+                content->static_mesh_overlaps[content->static_mesh_overlaps_count].static_index = j;
+                content->static_mesh_overlaps_count++;
+            }
+        }
+    }
+}
+
+
+struct static_mesh_overlap_s *Room_GetStaticMeshOverlaps(struct room_s *room, uint32_t room_id, uint32_t *count)
+{
+    static_mesh_overlap_p overlaps = room->content->static_mesh_overlaps;
+    uint32_t lo = 0;
+    uint32_t hi = room->content->static_mesh_overlaps_count;
+
+    while(lo < hi)                                                              // first entry with room_id
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if(overlaps[mid].room_id < room_id)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for(hi = lo; (hi < room->content->static_mesh_overlaps_count) && (overlaps[hi].room_id == room_id); hi++);
+    *count = hi - lo;
+
+    return overlaps + lo;
+}
+
+
+struct bvh_s *Room_GetEntityBVH(struct room_s *room)
+{
+    room_content_p content = room->content;
+
+    if(!content->entity_bvh)
+    {
+        uint32_t count = 0;
+        for(engine_container_p cont = content->containers; cont; cont = cont->next)
+        {
+            count += (cont->object_type == OBJECT_ENTITY) ? (1) : (0);
+        }
+
+        if((count > 0) && (count <= BVH_MAX_ITEMS))
+        {
+            float *bb = (float*)malloc(6 * count * sizeof(float));
+            if(count > content->entity_bvh_items_size)
+            {
+                content->entity_bvh_items_size = count;
+                content->entity_bvh_items = (engine_container_p*)realloc(content->entity_bvh_items, count * sizeof(engine_container_p));
+            }
+
+            count = 0;
+            for(engine_container_p cont = content->containers; cont; cont = cont->next)
+            {
+                if(cont->object_type == OBJECT_ENTITY)
+                {
+                    OBB_GetAABB(((entity_p)cont->object)->obb, bb + 6 * count, bb + 6 * count + 3);
+                    content->entity_bvh_items[count++] = cont;
+                }
+            }
+            content->entity_bvh = BVH_Create(bb, count);
+            free(bb);
+        }
+    }
+
+    return content->entity_bvh;
+}
+
+
+void Room_UpdateEntityBV(struct engine_container_s *cont)
+{
+    room_content_p content = (cont->room) ? (cont->room->content) : (NULL);
+
+    if(content && content->entity_bvh && (cont->object_type == OBJECT_ENTITY))
+    {
+        for(uint16_t i = 0; i < content->entity_bvh->items_count; i++)
+        {
+            if(content->entity_bvh_items[i] == cont)
+            {
+                float bb_min[3], bb_max[3];
+                OBB_GetAABB(((entity_p)cont->object)->obb, bb_min, bb_max);
+                BVH_Refit(content->entity_bvh, i, bb_min, bb_max);
+                break;
+            }
+        }
+    }
+}
+
 /*
  *   Sectors functionality
  */
@@ -671,14 +904,18 @@ static room_sector_p Sector_CheckRealRoom(room_sector_p rs)
 
 struct room_sector_s *Sector_GetPortalSectorTargetRaw(struct room_sector_s *rs)
 {
-    if(rs && rs->portal_to_room)
+    if(rs)
     {
-        room_p r = rs->portal_to_room;
-        int ind_x = (rs->pos[0] - r->transform[12 + 0]) / TR_METERING_SECTORSIZE;
-        int ind_y = (rs->pos[1] - r->transform[12 + 1]) / TR_METERING_SECTORSIZE;
-        if((ind_x >= 0) && (ind_x < r->sectors_x) && (ind_y >= 0) && (ind_y < r->sectors_y))
+        room_p r = rs->owner_room;
+        uint16_t portal_to_room = r->sectors_hot[rs - r->sectors].portal_to_room;
+        if(portal_to_room != ROOM_INDEX_NONE)
         {
-            rs = r->sectors + (ind_x * r->sectors_y + ind_y);
+            int index;
+            r = World_GetRoomByID(portal_to_room);
+            if((index = Room_GetSectorIndex(r, rs->pos)) >= 0)
+            {
+                rs = r->sectors + index;
+            }
         }
     }
 
@@ -688,14 +925,18 @@ struct room_sector_s *Sector_GetPortalSectorTargetRaw(struct room_sector_s *rs)
 
 struct room_sector_s *Sector_GetPortalSectorTargetReal(struct room_sector_s *rs)
 {
-    if(rs && rs->portal_to_room)
+    if(rs)
     {
-        room_p r = rs->portal_to_room->real_room;
-        int ind_x = (rs->pos[0] - r->transform[12 + 0]) / TR_METERING_SECTORSIZE;
-        int ind_y = (rs->pos[1] - r->transform[12 + 1]) / TR_METERING_SECTORSIZE;
-        if((ind_x >= 0) && (ind_x < r->sectors_x) && (ind_y >= 0) && (ind_y < r->sectors_y))
+        room_p r = rs->owner_room;
+        uint16_t portal_to_room = r->sectors_hot[rs - r->sectors].portal_to_room;
+        if(portal_to_room != ROOM_INDEX_NONE)
         {
-            rs = r->sectors + (ind_x * r->sectors_y + ind_y);
+            int index;
+            r = World_GetRoomByID(portal_to_room)->real_room;
+            if((index = Room_GetSectorIndex(r, rs->pos)) >= 0)
+            {
+                rs = r->sectors + index;
+            }
         }
     }
 
@@ -703,19 +944,312 @@ struct room_sector_s *Sector_GetPortalSectorTargetReal(struct room_sector_s *rs)
 }
 
 
+/*
+ * Vertical walks use packed sectors only; full sector is taken at the end.
+ */
 struct room_sector_s *Sector_GetLowest(struct room_sector_s *sector)
 {
-    for(; sector && sector->room_below; sector = Room_GetSectorRaw(sector->room_below->real_room, sector->pos));
+    if(sector)
+    {
+        room_p r = sector->owner_room;
+        int index = sector - r->sectors;
+        while(r->sectors_hot[index].room_below != ROOM_INDEX_NONE)
+        {
+            r = World_GetRoomByID(r->sectors_hot[index].room_below)->real_room;
+            if((index = Room_GetSectorIndex(r, sector->pos)) < 0)
+            {
+                return NULL;
+            }
+        }
+        return r->sectors + index;
+    }
 
-    return sector;
+    return NULL;
 }
 
 
 struct room_sector_s *Sector_GetHighest(struct room_sector_s *sector)
 {
-    for(; sector && sector->room_above; sector = Room_GetSectorRaw(sector->room_above->real_room, sector->pos));
+    if(sector)
+    {
+        room_p r = sector->owner_room;
+        int index = sector - r->sectors;
+        while(r->sectors_hot[index].room_above != ROOM_INDEX_NONE)
+        {
+            r = World_GetRoomByID(r->sectors_hot[index].room_above)->real_room;
+            if((index = Room_GetSectorIndex(r, sector->pos)) < 0)
+            {
+                return NULL;
+            }
+        }
+        return r->sectors + index;
+    }
+
+    return NULL;
+}
+
+
+static int Sector_GetTrianglePoint(float corners[4][3], int i0, int i1, int i2, float x, float y, float point[3], float normale[3])
+{
+    const float *v0 = corners[i0], *v1 = corners[i1], *v2 = corners[i2];
+    float d = (v1[1] - v2[1]) * (v0[0] - v2[0]) + (v2[0] - v1[0]) * (v0[1] - v2[1]);
+    float a, b, c, e0[3], e1[3], t;
+
+    if(fabs(d) < 0.001f)
+    {
+        return 0;
+    }
+
+    a = ((v1[1] - v2[1]) * (x - v2[0]) + (v2[0] - v1[0]) * (y - v2[1])) / d;
+    b = ((v2[1] - v0[1]) * (x - v2[0]) + (v0[0] - v2[0]) * (y - v2[1])) / d;
+    c = 1.0f - a - b;
+    if((a < -0.0001f) || (b < -0.0001f) || (c < -0.0001f))
+    {
+        return 0;
+    }
+
+    point[0] = x;
+    point[1] = y;
+    point[2] = a * v0[2] + b * v1[2] + c * v2[2];
+    vec3_sub(e0, v1, v0);
+    vec3_sub(e1, v2, v0);
+    vec3_cross(normale, e0, e1);
+    vec3_norm(normale, t);
+
+    return 1;
+}
+
+/*
+ * Sector quad is split by v0 - v2 diagonal (NONE, NW) or by v1 - v3 (NE);
+ * door configs A / B remove the same triangles as in collision mesh: for NONE /
+ * NW {0, 2, 3} / {0, 1, 2}, for NE floor {1, 2, 3} / {0, 1, 3} and for NE
+ * ceiling (opposite) {0, 1, 3} / {1, 2, 3}.
+ */
+static int Sector_GetSurfacePoint(room_p room, float corners[4][3], uint8_t diagonal_type, uint8_t config, int ceiling, float pos[3], float point[3], float normale[3])
+{
+    float x = pos[0] - room->transform[12 + 0];
+    float y = pos[1] - room->transform[12 + 1];
+    int ret = 0;
+
+    if((config == TR_PENETRATION_CONFIG_GHOST) || (config == TR_PENETRATION_CONFIG_WALL))
+    {
+        return 0;
+    }
+
+    if(diagonal_type == TR_SECTOR_DIAGONAL_TYPE_NE)
+    {
+        uint8_t config_123 = (ceiling) ? (TR_PENETRATION_CONFIG_DOOR_VERTICAL_B) : (TR_PENETRATION_CONFIG_DOOR_VERTICAL_A);
+        uint8_t config_013 = (ceiling) ? (TR_PENETRATION_CONFIG_DOOR_VERTICAL_A) : (TR_PENETRATION_CONFIG_DOOR_VERTICAL_B);
+        ret = ((config != config_123) && Sector_GetTrianglePoint(corners, 1, 2, 3, x, y, point, normale)) ||
+              ((config != config_013) && Sector_GetTrianglePoint(corners, 0, 1, 3, x, y, point, normale));
+    }
+    else
+    {
+        ret = ((config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_A) && Sector_GetTrianglePoint(corners, 0, 2, 3, x, y, point, normale)) ||
+              ((config != TR_PENETRATION_CONFIG_DOOR_VERTICAL_B) && Sector_GetTrianglePoint(corners, 0, 1, 2, x, y, point, normale));
+    }
+
+    if(ret)
+    {
+        point[0] = pos[0];
+        point[1] = pos[1];
+        point[2] += room->transform[12 + 2];
+    }
+
+    return ret;
+}
+
+
+int Sector_GetFloorPoint(struct room_sector_s *rs, float pos[3], float point[3], float normale[3])
+{
+    if(Sector_GetSurfacePoint(rs->owner_room, rs->floor_corners, rs->floor_diagonal_type, rs->floor_penetration_config, 0, pos, point, normale))
+    {
+        if(normale[2] < 0.0f)
+        {
+            vec3_inv(normale);
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+
+int Sector_GetCeilingPoint(struct room_sector_s *rs, float pos[3], float point[3], float normale[3])
+{
+    if(Sector_GetSurfacePoint(rs->owner_room, rs->ceiling_corners, rs->ceiling_diagonal_type, rs->ceiling_penetration_config, 1, pos, point, normale))
+    {
+        if(normale[2] > 0.0f)
+        {
+            vec3_inv(normale);
+        }
+        return 1;
+    }
 
-    return sector;
+    return 0;
+}
+
+
+static inline int Room_IsColumnNear(float pos[3], obb_p obb)
+{
+    float dx = pos[0] - obb->centre[0];
+    float dy = pos[1] - obb->centre[1];
+    float r = obb->radius + ROOM_SAMPLE_EDGE_MARGIN;
+    return dx * dx + dy * dy <= r * r;
+}
+
+/*
+ * Any entity or static mesh with collision, which may stand in the vertical
+ * line through pos (bridges, blocks, trapdoors...).
+ */
+static int Room_HasObjectsInColumn(room_p room, float pos[3], struct engine_container_s *cont, int16_t filter)
+{
+    filter &= ~COLLISION_GROUP_STATIC_ROOM;
+    for(int ri = -1; ri < room->near_room_list_size; ++ri)
+    {
+        room_p r = (ri >= 0) ? (room->near_room_list[ri]) : (room);
+        for(engine_container_p c = r->content->containers; c; c = c->next)
+        {
+            if((c != cont) && (c->object_type == OBJECT_ENTITY) && (c->collision_group & filter) &&
+               Room_IsColumnNear(pos, ((entity_p)c->object)->obb))
+            {
+                return 1;
+            }
+        }
+        if(filter & COLLISION_GROUP_STATIC_OBLECT)
+        {
+            for(uint32_t i = 0; i < r->content->static_mesh_count; i++)
+            {
+                static_mesh_p sm = r->content->static_mesh + i;
+                if(sm->physics_body && Room_IsColumnNear(pos, sm->obb))
+                {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+static inline int Room_IsSampleRoomAccepted(room_p from, room_p r)
+{
+    return !from || (r == from) || (Room_IsInNearRoomsList(from, r) && !Room_IsInOverlappedRoomsList(from, r));
+}
+
+
+static void Room_SetSampleHit(struct collision_result_s *hit, room_sector_p rs, float pos[3], float point[3], float normale[3], float dist)
+{
+    hit->obj = rs->owner_room->self;
+    hit->bone_num = 0;
+    hit->hit = 0x01;
+    hit->fraction = fabs(point[2] - pos[2]) / dist;
+    vec3_copy(hit->point, point);
+    vec3_copy(hit->normale, normale);
+}
+
+
+int  Room_SampleHeights(struct room_s *room, float pos[3], struct engine_container_s *cont, int16_t filter,
+                        struct collision_result_s *floor_hit, float floor_dist, struct collision_result_s *ceiling_hit, float ceiling_dist)
+{
+    room_p from = (cont) ? (cont->room) : (NULL);
+    room_sector_p start, rs;
+    float point[3], normale[3], lx, ly;
+
+    if(!room || !from)
+    {
+        return 0;
+    }
+
+    // on the sector edge vertical tweens and neighbour sectors may be hit
+    lx = fmodf(pos[0] - room->transform[12 + 0], TR_METERING_SECTORSIZE);
+    ly = fmodf(pos[1] - room->transform[12 + 1], TR_METERING_SECTORSIZE);
+    if((lx < ROOM_SAMPLE_EDGE_MARGIN) || (lx > TR_METERING_SECTORSIZE - ROOM_SAMPLE_EDGE_MARGIN) ||
+       (ly < ROOM_SAMPLE_EDGE_MARGIN) || (ly > TR_METERING_SECTORSIZE - ROOM_SAMPLE_EDGE_MARGIN))
+    {
+        return 0;
+    }
+
+    start = Room_GetSectorXYZ(room, pos);
+    if(start && (start->owner_room->sectors_hot[start - start->owner_room->sectors].portal_to_room != ROOM_INDEX_NONE))
+    {
+        start = Sector_GetPortalSectorTargetReal(start);
+        if(start->owner_room->sectors_hot[start - start->owner_room->sectors].portal_to_room != ROOM_INDEX_NONE)
+        {
+            return 0;
+        }
+    }
+    if(!start || Room_HasObjectsInColumn(from, pos, cont, filter))
+    {
+        return 0;
+    }
+
+    floor_hit->hit = 0x00;
+    floor_hit->obj = NULL;
+    floor_hit->fraction = 1.0f;
+    for(rs = start; ; )
+    {
+        room_p r = rs->owner_room;
+        uint16_t below = r->sectors_hot[rs - r->sectors].room_below;
+        int index;
+        if(Sector_GetFloorPoint(rs, pos, point, normale))
+        {
+            if((point[2] > pos[2]) || !Room_IsSampleRoomAccepted(from, r))
+            {
+                return 0;
+            }
+            if(pos[2] - point[2] <= floor_dist)
+            {
+                Room_SetSampleHit(floor_hit, rs, pos, point, normale, floor_dist);
+            }
+            break;
+        }
+        if((rs->floor_penetration_config != TR_PENETRATION_CONFIG_GHOST) || (below == ROOM_INDEX_NONE))
+        {
+            return 0;
+        }
+        r = World_GetRoomByID(below)->real_room;
+        if((index = Room_GetSectorIndex(r, pos)) < 0)
+        {
+            return 0;
+        }
+        rs = r->sectors + index;
+    }
+
+    ceiling_hit->hit = 0x00;
+    ceiling_hit->obj = NULL;
+    ceiling_hit->fraction = 1.0f;
+    for(rs = start; ; )
+    {
+        room_p r = rs->owner_room;
+        uint16_t above = r->sectors_hot[rs - r->sectors].room_above;
+        int index;
+        if(Sector_GetCeilingPoint(rs, pos, point, normale))
+        {
+            if((point[2] < pos[2]) || !Room_IsSampleRoomAccepted(from, r))
+            {
+                return 0;
+            }
+            if(point[2] - pos[2] <= ceiling_dist)
+            {
+                Room_SetSampleHit(ceiling_hit, rs, pos, point, normale, ceiling_dist);
+            }
+            break;
+        }
+        if((rs->ceiling_penetration_config != TR_PENETRATION_CONFIG_GHOST) || (above == ROOM_INDEX_NONE))
+        {
+            return 0;
+        }
+        r = World_GetRoomByID(above)->real_room;
+        if((index = Room_GetSectorIndex(r, pos)) < 0)
+        {
+            return 0;
+        }
+        rs = r->sectors + index;
+    }
+
+    return 1;
 }
 
 
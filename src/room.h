@@ -111,6 +111,8 @@ struct frustum_s;
 struct base_mesh_s;
 struct physics_object_s;
 struct trigger_header_s;
+struct bvh_s;
+struct collision_result_s;
 
 
 typedef struct room_box_s
@@ -155,6 +157,25 @@ typedef struct room_sector_s
 }room_sector_t, *room_sector_p;
 
 
+/*
+ * Packed copy of the sector fields used by height and portal queries. Rooms
+ * are referenced by index in the world rooms array (room id), so sectors of
+ * a room stay in a few cache lines. room_sector_s stays the master copy for
+ * the loader and the debug drawer; call Room_UpdateSectorHot() after it was
+ * changed.
+ */
+#define ROOM_INDEX_NONE         (0xFFFF)
+
+typedef struct room_sector_hot_s
+{
+    int32_t                     floor;
+    int32_t                     ceiling;
+    uint16_t                    portal_to_room;
+    uint16_t                    room_below;
+    uint16_t                    room_above;
+}room_sector_hot_t, *room_sector_hot_p;
+
+
 typedef struct sector_tween_s
 {
     float                       floor_corners[4][3];
@@ -195,6 +216,12 @@ typedef struct static_mesh_s
     struct physics_object_s    *physics_body;
 }static_mesh_t, *static_mesh_p;
 
+typedef struct static_mesh_overlap_s
+{
+    uint32_t                    room_id;                                        // overlapped room
+    uint32_t                    static_index;                                   // static mesh of the content
+}static_mesh_overlap_t, *static_mesh_overlap_p;
+
 
 typedef struct room_content_s
 {
@@ -216,6 +243,13 @@ typedef struct room_content_s
     struct base_mesh_s         *mesh;                                           // room's base mesh
     struct physics_object_s    *physics_body;                                   // static physics data
     struct physics_object_s    *physics_alt_tween;                              // changable (alt room) tween physics data
+
+    struct bvh_s               *static_mesh_bvh;                                // static meshes visibility hierarchy
+    uint32_t                    static_mesh_overlaps_count;
+    struct static_mesh_overlap_s *static_mesh_overlaps;                         // statics, overlapped rooms OBB, sorted by room id
+    struct bvh_s               *entity_bvh;                                     // entities visibility hierarchy, NULL if not built
+    uint16_t                    entity_bvh_items_size;
+    struct engine_container_s **entity_bvh_items;                               // BVH item -> entity container
 }room_content_t, *room_content_p;
 
 
@@ -241,6 +275,7 @@ typedef struct room_s
     uint16_t                    sectors_x;
     uint16_t                    sectors_y;
     struct room_sector_s       *sectors;
+    struct room_sector_hot_s   *sectors_hot;                                    // same order as sectors
 
     uint16_t                    near_room_list_size;
     struct room_s             **near_room_list;
@@ -262,6 +297,9 @@ void Room_DoFlip(struct room_s *room1, struct room_s *room2);
 
 struct room_sector_s *Room_GetSectorRaw(struct room_s *room, float pos[3]);
 struct room_sector_s *Room_GetSectorXYZ(struct room_s *room, float pos[3]);
+int  Room_GetSectorIndex(struct room_s *room, float pos[3]);
+void Room_GenSectorsHot(struct room_s *room);
+void Room_UpdateSectorHot(struct room_sector_s *sector);
 
 void Room_AddToNearRoomsList(struct room_s *room, struct room_s *r);
 int  Room_IsJoined(struct room_s *r1, struct room_s *r2);
@@ -275,6 +313,18 @@ void Room_MoveActiveItems(struct room_s *room_to, struct room_s *room_from);
 // should NOT use such prefix!
 void Room_GenSpritesBuffer(struct room_s *room);
 
+/*
+ * Visibility hierarchies. Statics never move, so their hierarchy and list of
+ * overlapped rooms (used for near rooms statics) are generated once. Entities
+ * hierarchy is rebuilt on demand after containers list was changed and moved
+ * entity box is refitted by Room_UpdateEntityBV().
+ */
+void Room_GenStaticMeshBVH(struct room_s *room);
+void Room_GenStaticMeshOverlaps(struct room_s *room, struct room_s *rooms, uint32_t rooms_count);
+struct static_mesh_overlap_s *Room_GetStaticMeshOverlaps(struct room_s *room, uint32_t room_id, uint32_t *count);
+struct bvh_s *Room_GetEntityBVH(struct room_s *room);
+void Room_UpdateEntityBV(struct engine_container_s *cont);
+
 struct room_sector_s *Sector_GetPortalSectorTargetRaw(struct room_sector_s *rs);
 struct room_sector_s *Sector_GetPortalSectorTargetReal(struct room_sector_s *rs);
 
@@ -282,6 +332,20 @@ struct room_sector_s *Sector_GetLowest(struct room_sector_s *sector);
 struct room_sector_s *Sector_GetHighest(struct room_sector_s *sector);
 
 
+/*
+ * Analytic heights: the same sector triangles, which are given to the room
+ * collision mesh (diagonal split and door halves are respected), are sampled
+ * directly. Room_SampleHeights() follows vertical portals and returns 0 if
+ * the answer is not sure (sector edge, wall, object with collision in the
+ * column, rooms which physics filter rejects), then physics casts are needed.
+ */
+#define ROOM_SAMPLE_EDGE_MARGIN         (1.0f)
+
+int  Sector_GetFloorPoint(struct room_sector_s *rs, float pos[3], float point[3], float normale[3]);
+int  Sector_GetCeilingPoint(struct room_sector_s *rs, float pos[3], float point[3], float normale[3]);
+int  Room_SampleHeights(struct room_s *room, float pos[3], struct engine_container_s *cont, int16_t filter,
+                        struct collision_result_s *floor_hit, float floor_dist, struct collision_result_s *ceiling_hit, float ceiling_dist);
+
 void Sector_HighestFloorCorner(room_sector_p rs, float v[3]);
 void Sector_LowestCeilingCorner(room_sector_p rs, float v[3]);
 
@@ -26,6 +26,7 @@ extern "C" {
 #include "../game.h"
 #include "../gameflow.h"
 #include "../character_controller.h"
+#include "../physics/physics.h"
 
 
 #define LUA_EXPOSE(lua, x) do { lua_pushinteger(lua, x); lua_setglobal(lua, #x); } while(false)
@@ -212,7 +213,7 @@ int Script_DoTasks(lua_State *lua, float time)
     lua_pushnumber(lua, time);
     lua_setglobal(lua, "frame_time");
 
-    Script_CallVoidFunc(lua, "doTasks");
+    Script_RunTasks(lua, time);
     Script_CallVoidFunc(lua, "clearKeys");
 
     return 0;
@@ -441,6 +442,18 @@ int Script_ParseRender(lua_State *lua, struct render_settings_s *rs)
         rs->fog_end_depth = lua_tonumber(lua, -1);
         lua_pop(lua, 1);
 
+        lua_getfield(lua, -1, "parallel_portals");
+        rs->parallel_portals = lua_tointeger(lua, -1);
+        lua_pop(lua, 1);
+
+        lua_getfield(lua, -1, "room_pvs");
+        rs->room_pvs = lua_tointeger(lua, -1);
+        lua_pop(lua, 1);
+
+        lua_getfield(lua, -1, "instancing");
+        rs->instancing = lua_tointeger(lua, -1);
+        lua_pop(lua, 1);
+
 
         lua_getfield(lua, -1, "fog_color");
         if(lua_istable(lua, -1))
@@ -473,6 +486,37 @@ int Script_ParseRender(lua_State *lua, struct render_settings_s *rs)
 }
 
 
+int Script_ParsePhysics(lua_State *lua, struct physics_settings_s *ps)
+{
+    if(lua)
+    {
+        int top = lua_gettop(lua);
+
+        lua_getglobal(lua, "physics");
+        if(lua_istable(lua, -1))
+        {
+            lua_getfield(lua, -1, "fixed_step");
+            ps->fixed_step = lua_tointeger(lua, -1);
+            lua_pop(lua, 1);
+
+            lua_getfield(lua, -1, "max_sub_steps");
+            ps->max_sub_steps = lua_tointeger(lua, -1);
+            lua_pop(lua, 1);
+
+            if(ps->max_sub_steps < 1)
+            {
+                ps->max_sub_steps = PHYSICS_MAX_SUB_STEPS_DEFAULT;
+            }
+        }
+
+        lua_settop(lua, top);
+        return 1;
+    }
+
+    return -1;
+}
+
+
 int Script_ParseConsole(lua_State *lua)
 {
     if(lua)
@@ -874,6 +918,7 @@ void Script_LoadConstants(lua_State *lua)
         LUA_EXPOSE(lua, ENTITY_CALLBACK_COLLISION);
         LUA_EXPOSE(lua, ENTITY_CALLBACK_STAND);
         LUA_EXPOSE(lua, ENTITY_CALLBACK_HIT);
+        LUA_EXPOSE(lua, ENTITY_CALLBACK_LOOP);
 
         LUA_EXPOSE(lua, PARAM_HEALTH);
         LUA_EXPOSE(lua, PARAM_AIR);
@@ -1020,7 +1065,7 @@ void Script_LuaClearTasks()
     {
         int top = lua_gettop(engine_lua);
 
-        Script_CallVoidFunc(engine_lua, "clearTasks");
+        Script_ClearTasks(engine_lua);
 
         lua_getglobal(engine_lua, "tlist_Clear");
         if(lua_isfunction(engine_lua, -1))
@@ -1044,6 +1089,7 @@ void Script_LuaRegisterEntityFuncs(lua_State *lua);
 void Script_LuaRegisterCharacterFuncs(lua_State *lua);
 void Script_LuaRegisterWorldFuncs(lua_State *lua);
 void Script_LuaRegisterAudioFuncs(lua_State *lua);
+void Script_LuaRegisterTaskFuncs(lua_State *lua);
 
 
 void Script_LuaRegisterFuncs(lua_State *lua)
@@ -1068,4 +1114,5 @@ void Script_LuaRegisterFuncs(lua_State *lua)
     Script_LuaRegisterCharacterFuncs(lua);
     Script_LuaRegisterWorldFuncs(lua);
     Script_LuaRegisterAudioFuncs(lua);
+    Script_LuaRegisterTaskFuncs(lua);
 }
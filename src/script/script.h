@@ -2,9 +2,12 @@
 #ifndef ENGINE_SCRIPT_H
 #define ENGINE_SCRIPT_H
 
+#include <stdint.h>
+
 struct screen_info_s;
 struct entity_s;
 struct lua_State;
+struct physics_settings_s;
 
 #define CVAR_LUA_TABLE_NAME "cvars"
 
@@ -41,6 +44,7 @@ int Script_ParseRender(lua_State *lua, struct render_settings_s *rs);
 int Script_ParseAudio(lua_State *lua, struct audio_settings_s *as);
 int Script_ParseConsole(lua_State *lua);
 int Script_ParseControls(lua_State *lua, struct control_settings_s *cs);
+int Script_ParsePhysics(lua_State *lua, struct physics_settings_s *ps);
 
 bool Script_GetOverridedSamplesInfo(lua_State *lua, int *num_samples, int *num_sounds, char *sample_name_mask);
 bool Script_GetOverridedSample(lua_State *lua, int sound_id, int *first_sample_number, int *samples_count);
@@ -52,12 +56,17 @@ bool Script_GetSoundtrack(lua_State *lua, int track_index, char *track_path, int
 bool Script_GetLoadingScreen(lua_State *lua, int level_index, char *pic_path);
 bool Script_GetString(lua_State *lua, int string_index, size_t string_size, char *buffer);
 
-void Script_LoopEntity(lua_State *lua, struct entity_s *ent);
+void Script_LoopEntity(lua_State *lua, struct entity_s *ent);      // updates timer and queues onLoop call
+void Script_LoopEntities(lua_State *lua);                           // calls all queued onLoop in one batch
+void Script_GetLoopEntitiesStats(float *time, uint32_t *count);     // last batch time and size
+bool Script_EntityHasLoop(lua_State *lua, int id_entity);
 int  Script_ExecEntity(lua_State *lua, int id_callback, int id_object, int id_activator = -1);
 size_t Script_GetEntitySaveData(lua_State *lua, int id_entity, char *buf, size_t buf_size);
 void Script_DoFlipEffect(lua_State *lua, int id_effect, int id_object, int param);
 size_t Script_GetFlipEffectsSaveData(lua_State *lua, char *buf, size_t buf_size);
 int  Script_DoTasks(lua_State *lua, float time);
+void Script_RunTasks(lua_State *lua, float time);                   // see script_tasks.cpp
+void Script_ClearTasks(lua_State *lua);
 bool Script_CallVoidFunc(lua_State *lua, const char* func_name, bool destroy_after_call = false);
 
 void Script_AddKey(lua_State *lua, int keycode, int state);
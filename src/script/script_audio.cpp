@@ -271,6 +271,27 @@ int lua_PlayStream(lua_State *lua)
 }
 
 
+int lua_SeekStream(lua_State *lua)
+{
+    if(lua_gettop(lua) >= 2)
+    {
+        int id = lua_tointeger(lua, 1);
+        if(id >= 0)
+        {
+            lua_pushinteger(lua, Audio_StreamSeek(id, lua_tonumber(lua, 2)));
+            return 1;
+        }
+        Con_Warning("wrong stream id");
+    }
+    else
+    {
+        Con_Warning("seekStream: expecting arguments (stream_id, time)");
+    }
+
+    return 0;
+}
+
+
 int lua_PlaySound(lua_State *lua)
 {
     int top = lua_gettop(lua);
@@ -361,4 +382,5 @@ void Script_LuaRegisterAudioFuncs(lua_State *lua)
     lua_register(lua, "playSound", lua_PlaySound);
     lua_register(lua, "stopSound", lua_StopSound);
     lua_register(lua, "playStream", lua_PlayStream);
+    lua_register(lua, "seekStream", lua_SeekStream);
 }
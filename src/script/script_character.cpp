@@ -176,7 +176,7 @@ int lua_SetCharacterTarget(lua_State * lua)
         entity_p ent = World_GetEntityByID(lua_tointeger(lua, 1));
         if(ent && ent->character)
         {
-            ent->character->target_id = ((top > 1) && !lua_isnil(lua, 2)) ? (lua_tointeger(lua, 2)) : (ENTITY_ID_NONE);
+            Character_SetTarget(ent, ((top > 1) && !lua_isnil(lua, 2)) ? (lua_tointeger(lua, 2)) : (ENTITY_ID_NONE));
         }
         else
         {
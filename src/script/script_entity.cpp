@@ -76,11 +76,25 @@ size_t Script_GetEntitySaveData(lua_State *lua, int id_entity, char *buf, size_t
 }
 
 
+/*
+ * onLoop callbacks are queued as (id, tick_state) pairs and called with one
+ * "loopEntities" call per frame; entities without ENTITY_CALLBACK_LOOP flag
+ * are not passed to Lua at all.
+ */
+static struct
+{
+    int32_t    *list;
+    uint32_t    count;
+    uint32_t    size;
+    uint32_t    last_count;
+    float       last_time;
+}entity_loops = {NULL, 0, 0, 0, 0.0f};
+
+
 void Script_LoopEntity(lua_State *lua, struct entity_s *ent)
 {
     if(lua && ent && (ent->state_flags & ENTITY_STATE_ACTIVE))
     {
-        int top = lua_gettop(lua);
         int tick_state = TICK_ACTIVE;
 
         if(ent->timer > 0.0f)
@@ -97,15 +111,74 @@ void Script_LoopEntity(lua_State *lua, struct entity_s *ent)
             tick_state = TICK_IDLE;
         }
 
-        lua_getglobal(lua, "loopEntity");
+        if(ent->callback_flags & ENTITY_CALLBACK_LOOP)
+        {
+            if(2 * entity_loops.count >= entity_loops.size)
+            {
+                entity_loops.size = (entity_loops.size) ? (2 * entity_loops.size) : (128);
+                entity_loops.list = (int32_t*)realloc(entity_loops.list, entity_loops.size * sizeof(int32_t));
+            }
+            entity_loops.list[2 * entity_loops.count + 0] = ent->id;
+            entity_loops.list[2 * entity_loops.count + 1] = tick_state;
+            entity_loops.count++;
+        }
+    }
+}
+
+
+void Script_LoopEntities(lua_State *lua)
+{
+    float time = Sys_FloatTime();
+
+    if(lua && (entity_loops.count > 0))
+    {
+        int top = lua_gettop(lua);
+        lua_getglobal(lua, "loopEntities");
         if(lua_isfunction(lua, -1))
         {
-            lua_pushinteger(lua, ent->id);
-            lua_pushinteger(lua, tick_state);
+            lua_createtable(lua, 2 * entity_loops.count, 0);
+            for(uint32_t i = 0; i < 2 * entity_loops.count; i++)
+            {
+                lua_pushinteger(lua, entity_loops.list[i]);
+                lua_rawseti(lua, -2, i + 1);
+            }
+            lua_pushinteger(lua, entity_loops.count);
             lua_CallAndLog(lua, 2, 0, 0);
         }
         lua_settop(lua, top);
     }
+
+    entity_loops.last_count = entity_loops.count;
+    entity_loops.last_time = Sys_FloatTime() - time;
+    entity_loops.count = 0;
+}
+
+
+void Script_GetLoopEntitiesStats(float *time, uint32_t *count)
+{
+    *time = entity_loops.last_time;
+    *count = entity_loops.last_count;
+}
+
+
+bool Script_EntityHasLoop(lua_State *lua, int id_entity)
+{
+    bool ret = false;
+    int top = lua_gettop(lua);
+
+    lua_getglobal(lua, "entity_funcs");
+    if(lua_istable(lua, -1))
+    {
+        lua_rawgeti(lua, -1, id_entity);
+        if(lua_istable(lua, -1))
+        {
+            lua_getfield(lua, -1, "onLoop");
+            ret = !lua_isnil(lua, -1);
+        }
+    }
+    lua_settop(lua, top);
+
+    return ret;
 }
 
 /*
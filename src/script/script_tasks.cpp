@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+}
+
+#include "script.h"
+
+#include "../core/system.h"
+#include "../core/console.h"
+
+/*
+ * Tasks scheduler. Task is a function or a coroutine, called every frame
+ * until it returns (yields) false / nil or finishes; returned (yielded)
+ * number puts the task to sleep for that many seconds, yield without
+ * values just waits for the next frame. Running tasks are
+ * kept in adding order, sleeping ones - in min-heap by wake time. Task
+ * handle = (slot generation << 16) | slot index, so handle of removed task
+ * never points to a new one; stale list / heap entries are dropped lazily.
+ */
+#define TASK_STATE_FREE         (0)
+#define TASK_STATE_RUNNING      (1)
+#define TASK_STATE_SLEEPING     (2)
+
+#define TASK_HANDLE(slot, gen)  (((uint32_t)(gen) << 16) | (slot))
+#define TASK_SLOT(handle)       ((handle) & 0xFFFF)
+#define TASK_MAX_COUNT          (0xFFFF)
+#define TASK_HANDLE_NONE        (0xFFFFFFFF)
+
+typedef struct script_task_s
+{
+    int                 ref;                // function or thread in registry
+    uint16_t            generation;
+    uint16_t            state;
+}script_task_t, *script_task_p;
+
+typedef struct script_task_wake_s
+{
+    float               time;
+    uint32_t            handle;
+}script_task_wake_t, *script_task_wake_p;
+
+static struct
+{
+    script_task_p       tasks;
+    uint32_t            tasks_count;
+    uint32_t           *free_slots;
+    uint32_t            free_count;
+    uint32_t           *running;            // handles, in adding order
+    uint32_t            running_count;
+    uint32_t            running_size;
+    script_task_wake_p  heap;
+    uint32_t            heap_count;
+    uint32_t            heap_size;
+    uint32_t            clear_count;        // to detect clearTasks() from task
+    float               time;
+}script_tasks = {NULL, 0, NULL, 0, NULL, 0, 0, NULL, 0, 0, 0, 0.0f};
+
+
+static script_task_p Script_GetTask(uint32_t handle)
+{
+    uint32_t slot = TASK_SLOT(handle);
+    if((slot < script_tasks.tasks_count) &&
+       (script_tasks.tasks[slot].state != TASK_STATE_FREE) &&
+       (TASK_HANDLE(slot, script_tasks.tasks[slot].generation) == handle))
+    {
+        return script_tasks.tasks + slot;
+    }
+    return NULL;
+}
+
+
+static void Script_PushRunning(uint32_t handle)
+{
+    if(script_tasks.running_count >= script_tasks.running_size)
+    {
+        script_tasks.running_size = (script_tasks.running_size) ? (2 * script_tasks.running_size) : (64);
+        script_tasks.running = (uint32_t*)realloc(script_tasks.running, script_tasks.running_size * sizeof(uint32_t));
+    }
+    script_tasks.running[script_tasks.running_count++] = handle;
+}
+
+
+static void Script_PushSleeping(uint32_t handle, float time)
+{
+    script_task_wake_t w;
+    uint32_t i;
+
+    if(script_tasks.heap_count >= script_tasks.heap_size)
+    {
+        script_tasks.heap_size = (script_tasks.heap_size) ? (2 * script_tasks.heap_size) : (64);
+        script_tasks.heap = (script_task_wake_p)realloc(script_tasks.heap, script_tasks.heap_size * sizeof(script_task_wake_t));
+    }
+
+    w.time = time;
+    w.handle = handle;
+    for(i = script_tasks.heap_count++; i > 0; i = (i - 1) / 2)
+    {
+        script_task_wake_p parent = script_tasks.heap + (i - 1) / 2;
+        if(parent->time <= time)
+        {
+            break;
+        }
+        script_tasks.heap[i] = *parent;
+    }
+    script_tasks.heap[i] = w;
+}
+
+
+static void Script_PopSleeping()
+{
+    script_task_wake_t w = script_tasks.heap[--script_tasks.heap_count];
+    uint32_t i = 0;
+
+    for(uint32_t child = 1; child < script_tasks.heap_count; child = 2 * i + 1)
+    {
+        if((child + 1 < script_tasks.heap_count) && (script_tasks.heap[child + 1].time < script_tasks.heap[child].time))
+        {
+            child++;
+        }
+        if(w.time <= script_tasks.heap[child].time)
+        {
+            break;
+        }
+        script_tasks.heap[i] = script_tasks.heap[child];
+        i = child;
+    }
+    if(script_tasks.heap_count > 0)
+    {
+        script_tasks.heap[i] = w;
+    }
+}
+
+
+static void Script_FreeTask(lua_State *lua, script_task_p task)
+{
+    luaL_unref(lua, LUA_REGISTRYINDEX, task->ref);
+    task->ref = LUA_NOREF;
+    task->state = TASK_STATE_FREE;
+    task->generation++;
+    script_tasks.free_slots[script_tasks.free_count++] = task - script_tasks.tasks;
+}
+
+
+/*
+ * Runs the task; returns -1 if task is finished, 0 to run it on the next
+ * frame, else sleep time is stored in *sleep.
+ */
+static int Script_RunTask(lua_State *lua, script_task_p task, float *sleep)
+{
+    int ret = 0;
+    int top = lua_gettop(lua);
+
+    lua_rawgeti(lua, LUA_REGISTRYINDEX, task->ref);
+    if(lua_isthread(lua, -1))
+    {
+        lua_State *co = lua_tothread(lua, -1);
+#if LUA_VERSION_NUM >= 504
+        int nres = 0;
+        int status = lua_resume(co, lua, 0, &nres);
+#else
+        int status = lua_resume(co, lua, 0);
+#endif
+        if(status == LUA_YIELD)
+        {
+            if((lua_gettop(co) > 0) && lua_isnumber(co, -1))
+            {
+                *sleep = lua_tonumber(co, -1);
+                ret = 1;
+            }
+            else if((lua_gettop(co) > 0) && !lua_toboolean(co, -1))
+            {
+                ret = -1;
+            }
+            lua_settop(co, 0);
+        }
+        else
+        {
+            if(status != LUA_OK)
+            {
+                Con_Warning("task: %s", lua_tostring(co, -1));
+            }
+            ret = -1;
+        }
+    }
+    else if(lua_CallAndLog(lua, 0, 1, 0))
+    {
+        if(lua_isnumber(lua, -1))
+        {
+            *sleep = lua_tonumber(lua, -1);
+            ret = 1;
+        }
+        else if(!lua_toboolean(lua, -1))
+        {
+            ret = -1;
+        }
+    }
+    else
+    {
+        ret = -1;
+    }
+    lua_settop(lua, top);
+
+    return ret;
+}
+
+
+static uint32_t Script_AddTask(lua_State *lua, int index, float delay)
+{
+    script_task_p task;
+    uint32_t handle;
+
+    if(script_tasks.free_count == 0)
+    {
+        uint32_t old_count = script_tasks.tasks_count;
+        uint32_t new_count = (old_count) ? (2 * old_count) : (64);
+        if(old_count >= TASK_MAX_COUNT)
+        {
+            Con_Warning("addTask: too many tasks");
+            return TASK_HANDLE_NONE;
+        }
+        new_count = (new_count > TASK_MAX_COUNT) ? (TASK_MAX_COUNT) : (new_count);
+        script_tasks.tasks = (script_task_p)realloc(script_tasks.tasks, new_count * sizeof(script_task_t));
+        script_tasks.free_slots = (uint32_t*)realloc(script_tasks.free_slots, new_count * sizeof(uint32_t));
+        for(uint32_t i = new_count; i > old_count; i--)
+        {
+            script_tasks.tasks[i - 1].ref = LUA_NOREF;
+            script_tasks.tasks[i - 1].generation = 0;
+            script_tasks.tasks[i - 1].state = TASK_STATE_FREE;
+            script_tasks.free_slots[script_tasks.free_count++] = i - 1;
+        }
+        script_tasks.tasks_count = new_count;
+    }
+
+    task = script_tasks.tasks + script_tasks.free_slots[--script_tasks.free_count];
+    lua_pushvalue(lua, index);
+    task->ref = luaL_ref(lua, LUA_REGISTRYINDEX);
+    handle = TASK_HANDLE(task - script_tasks.tasks, task->generation);
+    if(delay > 0.0f)
+    {
+        task->state = TASK_STATE_SLEEPING;
+        Script_PushSleeping(handle, script_tasks.time + delay);
+    }
+    else
+    {
+        task->state = TASK_STATE_RUNNING;
+        Script_PushRunning(handle);
+    }
+
+    return handle;
+}
+
+
+static int Script_RemoveTask(lua_State *lua, uint32_t handle)
+{
+    script_task_p task = Script_GetTask(handle);
+    if(task)
+    {
+        Script_FreeTask(lua, task);
+        return 1;
+    }
+    return 0;
+}
+
+
+void Script_ClearTasks(lua_State *lua)
+{
+    for(uint32_t i = 0; i < script_tasks.tasks_count; i++)
+    {
+        if(script_tasks.tasks[i].state != TASK_STATE_FREE)
+        {
+            Script_FreeTask(lua, script_tasks.tasks + i);
+        }
+    }
+    script_tasks.running_count = 0;
+    script_tasks.heap_count = 0;
+    script_tasks.clear_count++;
+    script_tasks.time = 0.0f;
+}
+
+
+void Script_RunTasks(lua_State *lua, float time)
+{
+    uint32_t clear_count = script_tasks.clear_count;
+    uint32_t n = 0;
+
+    script_tasks.time += time;
+    while((script_tasks.heap_count > 0) && (script_tasks.heap[0].time <= script_tasks.time))
+    {
+        uint32_t handle = script_tasks.heap[0].handle;
+        script_task_p task = Script_GetTask(handle);
+        Script_PopSleeping();
+        if(task && (task->state == TASK_STATE_SLEEPING))
+        {
+            task->state = TASK_STATE_RUNNING;
+            Script_PushRunning(handle);
+        }
+    }
+
+    // tasks added by running tasks are appended and run in the same pass.
+    for(uint32_t i = 0; i < script_tasks.running_count; i++)
+    {
+        uint32_t handle = script_tasks.running[i];
+        script_task_p task = Script_GetTask(handle);
+        float sleep = 0.0f;
+        int ret;
+
+        if(!task)
+        {
+            continue;                                                           // removed task
+        }
+
+        ret = Script_RunTask(lua, task, &sleep);
+        if(clear_count != script_tasks.clear_count)
+        {
+            return;                                                             // list was cleared by task
+        }
+
+        task = Script_GetTask(handle);                                          // task may remove itself
+        if(task)
+        {
+            if(ret < 0)
+            {
+                Script_FreeTask(lua, task);
+            }
+            else if((ret > 0) && (sleep > 0.0f))
+            {
+                task->state = TASK_STATE_SLEEPING;
+                Script_PushSleeping(handle, script_tasks.time + sleep);
+            }
+            else
+            {
+                script_tasks.running[n++] = handle;
+            }
+        }
+    }
+    script_tasks.running_count = n;
+}
+
+
+/*
+ * Lua API
+ */
+int lua_AddTask(lua_State *lua)
+{
+    if((lua_gettop(lua) >= 1) && (lua_isfunction(lua, 1) || lua_isthread(lua, 1)))
+    {
+        float delay = (lua_gettop(lua) >= 2) ? (lua_tonumber(lua, 2)) : (0.0f);
+        uint32_t handle = Script_AddTask(lua, 1, delay);
+        if(handle != TASK_HANDLE_NONE)
+        {
+            lua_pushinteger(lua, handle);
+            return 1;
+        }
+    }
+    else
+    {
+        Con_Warning("addTask: expecting arguments (function or coroutine, (delay))");
+    }
+
+    return 0;
+}
+
+
+int lua_RemoveTask(lua_State *lua)
+{
+    if(lua_gettop(lua) >= 1)
+    {
+        lua_pushboolean(lua, Script_RemoveTask(lua, lua_tointeger(lua, 1)));
+        return 1;
+    }
+
+    Con_Warning("removeTask: expecting arguments (task_handle)");
+    return 0;
+}
+
+
+int lua_ClearTasks(lua_State *lua)
+{
+    Script_ClearTasks(lua);
+    return 0;
+}
+
+
+void Script_LuaRegisterTaskFuncs(lua_State *lua)
+{
+    lua_register(lua, "addTask", lua_AddTask);
+    lua_register(lua, "removeTask", lua_RemoveTask);
+    lua_register(lua, "clearTasks", lua_ClearTasks);
+}
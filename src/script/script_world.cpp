@@ -101,6 +101,7 @@ int lua_SetSectorFloorConfig(lua_State * lua)
             rs->floor_corners[1][2] = lua_tonumber(lua, 8);
             rs->floor_corners[2][2] = lua_tonumber(lua, 9);
             rs->floor_corners[3][2] = lua_tonumber(lua, 10);
+            Room_UpdateSectorHot(rs);
         }
         else
         {
@@ -133,6 +134,7 @@ int lua_SetSectorCeilingConfig(lua_State * lua)
             rs->ceiling_corners[1][2] = lua_tonumber(lua, 8);
             rs->ceiling_corners[2][2] = lua_tonumber(lua, 9);
             rs->ceiling_corners[3][2] = lua_tonumber(lua, 10);
+            Room_UpdateSectorHot(rs);
         }
         else
         {
@@ -159,6 +161,7 @@ int lua_SetSectorPortal(lua_State * lua)
         if(rs)
         {
             rs->portal_to_room = World_GetRoomByID(lua_tointeger(lua, 4));
+            Room_UpdateSectorHot(rs);
         }
         else
         {
@@ -529,33 +532,8 @@ int lua_AddRoomToOverlappedList(lua_State * lua)
         room_p r1 = World_GetRoomByID(lua_tointeger(lua, 2));
         if(r0 && r1 && !Room_IsInOverlappedRoomsList(r0, r1))
         {
-            room_p *old_list = r0->overlapped_room_list;
-            room_p *new_list = (room_p*)malloc((r0->overlapped_room_list_size + 1) * sizeof(room_p));
-            for(uint16_t i = 0; i < r0->overlapped_room_list_size; ++i)
-            {
-                new_list[i] = r0->overlapped_room_list[i];
-            }
-            new_list[r0->overlapped_room_list_size] = r1->real_room;
-            r0->overlapped_room_list = new_list;
-            r0->overlapped_room_list_size++;
-            if(old_list)
-            {
-                free(old_list);
-            }
-
-            old_list = r1->overlapped_room_list;
-            new_list = (room_p*)malloc((r1->overlapped_room_list_size + 1) * sizeof(room_p));
-            for(uint16_t i = 0; i < r1->overlapped_room_list_size; ++i)
-            {
-                new_list[i] = r1->overlapped_room_list[i];
-            }
-            new_list[r1->overlapped_room_list_size] = r0->real_room;
-            r1->overlapped_room_list = new_list;
-            r1->overlapped_room_list_size++;
-            if(old_list)
-            {
-                free(old_list);
-            }
+            World_AddToOverlappedRoomsList(r0, r1);
+            World_AddToOverlappedRoomsList(r1, r0);
         }
     }
     return 0;
@@ -48,6 +48,15 @@ void SkeletalModel_Clear(skeletal_model_p model)
                     anim->state_change = NULL;
                 }
 
+                if(anim->frames_pack)
+                {
+                    free(anim->frames_pack->qrotate);
+                    free(anim->frames_pack->offset_delta);
+                    free(anim->frames_pack->offset);
+                    free(anim->frames_pack);
+                    anim->frames_pack = NULL;
+                }
+
                 if(anim->frames_count)
                 {
                     for(uint16_t j = 0; j < anim->frames_count; j++)
@@ -160,6 +169,95 @@ void BoneFrame_Copy(bone_frame_p dst, bone_frame_p src)
 }
 
 
+/*
+ * Packs bones of the multiframe animations (see bone_frames_pack_s).
+ * Single frame animations are left as is: no gain and the skybox renderer
+ * reads them directly.
+ */
+uint32_t SkeletalModel_PackFrames(skeletal_model_p model)
+{
+    uint32_t saved = 0;
+    animation_frame_p anim = model->animations;
+
+    for(uint16_t i = 0; i < model->animation_count; i++, anim++)
+    {
+        bone_frames_pack_p pack;
+        uint16_t bones = (anim->frames_count > 0) ? (anim->frames[0].bone_tag_count) : (0);
+        int has_delta = 0;
+
+        if((anim->frames_count < 2) || (bones == 0) || anim->frames_pack)
+        {
+            continue;
+        }
+
+        for(uint16_t j = 0; j < anim->frames_count; j++)
+        {
+            if(anim->frames[j].bone_tag_count != bones)
+            {
+                bones = 0;
+                break;
+            }
+            for(uint16_t k = 0; k < bones; k++)
+            {
+                for(int l = 0; l < 3; l++)
+                {
+                    float d = anim->frames[j].bone_tags[k].offset[l] - anim->frames[0].bone_tags[k].offset[l];
+                    if((d < -32768.0f) || (d > 32767.0f) || (d != (float)((int16_t)d)))
+                    {
+                        bones = 0;                                              // not representable - keep it unpacked
+                    }
+                    has_delta |= (d != 0.0f);
+                }
+            }
+        }
+        if(bones == 0)
+        {
+            continue;
+        }
+
+        pack = (bone_frames_pack_p)malloc(sizeof(bone_frames_pack_t));
+        pack->bone_tag_count = bones;
+        pack->frames_count = anim->frames_count;
+        pack->qrotate = (int16_t*)malloc(4 * bones * anim->frames_count * sizeof(int16_t));
+        pack->offset_delta = (has_delta) ? ((int16_t*)malloc(3 * bones * anim->frames_count * sizeof(int16_t))) : (NULL);
+        pack->offset = (float*)malloc(3 * bones * sizeof(float));
+        for(uint16_t k = 0; k < bones; k++)
+        {
+            vec3_copy(pack->offset + 3 * k, anim->frames[0].bone_tags[k].offset);
+        }
+
+        for(uint16_t j = 0; j < anim->frames_count; j++)
+        {
+            bone_frame_p frame = anim->frames + j;
+            int16_t *q = pack->qrotate + 4 * bones * j;
+            for(uint16_t k = 0; k < bones; k++)
+            {
+                for(int l = 0; l < 4; l++)
+                {
+                    *q++ = (int16_t)lrintf(frame->bone_tags[k].qrotate[l] * 32767.0f);
+                }
+                if(pack->offset_delta)
+                {
+                    int16_t *d = pack->offset_delta + 3 * (bones * j + k);
+                    d[0] = (int16_t)(frame->bone_tags[k].offset[0] - pack->offset[3 * k + 0]);
+                    d[1] = (int16_t)(frame->bone_tags[k].offset[1] - pack->offset[3 * k + 1]);
+                    d[2] = (int16_t)(frame->bone_tags[k].offset[2] - pack->offset[3 * k + 2]);
+                }
+            }
+            free(frame->bone_tags);
+            frame->bone_tags = NULL;
+        }
+        anim->frames_pack = pack;
+
+        saved += anim->frames_count * bones * sizeof(bone_tag_t);
+        saved -= anim->frames_count * bones * ((pack->offset_delta) ? (7) : (4)) * sizeof(int16_t);
+        saved -= sizeof(bone_frames_pack_t) + 3 * bones * sizeof(float);
+    }
+
+    return saved;
+}
+
+
 void SSBoneFrame_CreateFromModel(ss_bone_frame_p bf, skeletal_model_p model)
 {
     vec3_set_zero(bf->bb_min);
@@ -169,6 +267,16 @@ void SSBoneFrame_CreateFromModel(ss_bone_frame_p bf, skeletal_model_p model)
     bf->transform = NULL;
     bf->bone_tag_count = 0;
     bf->bone_tags = NULL;
+    bf->frame_cache_tick = 0;
+    for(int i = 0; i < SS_FRAME_CACHE_SIZE; i++)
+    {
+        bf->frame_cache[i].anim = NULL;
+        bf->frame_cache[i].frame = 0;
+        bf->frame_cache[i].bone_tags_size = 0;
+        bf->frame_cache[i].last_use = 0;
+        bf->frame_cache[i].pinned = 0;
+        bf->frame_cache[i].bone_tags = NULL;
+    }
     
     SSBoneFrame_InitSSAnim(&bf->animations, ANIM_TYPE_BASE);
     bf->animations.model = model;
@@ -257,6 +365,14 @@ void SSBoneFrame_Clear(ss_bone_frame_p bf)
         bf->bone_tags = NULL;
     }
 
+    for(int i = 0; i < SS_FRAME_CACHE_SIZE; i++)
+    {
+        free(bf->frame_cache[i].bone_tags);
+        bf->frame_cache[i].anim = NULL;
+        bf->frame_cache[i].bone_tags_size = 0;
+        bf->frame_cache[i].bone_tags = NULL;
+    }
+
     for(ss_animation_p ss_anim = bf->animations.next; ss_anim;)
     {
         ss_animation_p ss_anim_next = ss_anim->next;
@@ -290,57 +406,196 @@ void SSBoneFrame_Copy(struct ss_bone_frame_s *dst, struct ss_bone_frame_s *src)
 }
 
 
-void SSBoneFrame_Update(struct ss_bone_frame_s *bf, float time)
+/*
+ * Returns bones of the animation frame; packed frames are decoded into the
+ * bone frame cache (least recently used not pinned slot is replaced).
+ */
+struct bone_tag_s *SSBoneFrame_GetFrameBones(struct ss_bone_frame_s *bf, struct animation_frame_s *anim, uint16_t frame)
+{
+    bone_frames_pack_p pack = anim->frames_pack;
+    ss_frame_cache_p slot = NULL;
+    bone_tag_p bone;
+    const int16_t *q, *d;
+
+    if(pack == NULL)
+    {
+        return anim->frames[frame].bone_tags;
+    }
+
+    bf->frame_cache_tick++;
+    for(int i = 0; i < SS_FRAME_CACHE_SIZE; i++)
+    {
+        ss_frame_cache_p c = bf->frame_cache + i;
+        if((c->anim == anim) && (c->frame == frame))
+        {
+            c->last_use = bf->frame_cache_tick;
+            return c->bone_tags;
+        }
+        if(!c->pinned && (!slot || (c->last_use < slot->last_use)))
+        {
+            slot = c;
+        }
+    }
+
+    if(slot->bone_tags_size < pack->bone_tag_count)
+    {
+        slot->bone_tags_size = pack->bone_tag_count;
+        slot->bone_tags = (bone_tag_p)realloc(slot->bone_tags, slot->bone_tags_size * sizeof(bone_tag_t));
+    }
+    slot->anim = anim;
+    slot->frame = frame;
+    slot->last_use = bf->frame_cache_tick;
+
+    bone = slot->bone_tags;
+    q = pack->qrotate + 4 * pack->bone_tag_count * frame;
+    d = (pack->offset_delta) ? (pack->offset_delta + 3 * pack->bone_tag_count * frame) : (NULL);
+    for(uint16_t k = 0; k < pack->bone_tag_count; k++, bone++, q += 4)
+    {
+        float t;
+        bone->qrotate[0] = q[0];
+        bone->qrotate[1] = q[1];
+        bone->qrotate[2] = q[2];
+        bone->qrotate[3] = q[3];
+        t = 1.0f / sqrtf(vec4_norm(bone->qrotate));
+        bone->qrotate[0] *= t;
+        bone->qrotate[1] *= t;
+        bone->qrotate[2] *= t;
+        bone->qrotate[3] *= t;
+        vec3_copy(bone->offset, pack->offset + 3 * k);
+        if(d)
+        {
+            bone->offset[0] += d[0];
+            bone->offset[1] += d[1];
+            bone->offset[2] += d[2];
+            d += 3;
+        }
+    }
+
+    return slot->bone_tags;
+}
+
+
+void SSBoneFrame_ResetFrameCache(struct ss_bone_frame_s *bf)
+{
+    for(int i = 0; i < SS_FRAME_CACHE_SIZE; i++)
+    {
+        bf->frame_cache[i].anim = NULL;
+        bf->frame_cache[i].last_use = 0;
+        bf->frame_cache[i].pinned = 0;
+    }
+}
+
+static void SSBoneFrame_PinFrameBones(struct ss_bone_frame_s *bf, struct bone_tag_s *bones, uint32_t pinned)
+{
+    for(int i = 0; i < SS_FRAME_CACHE_SIZE; i++)
+    {
+        if(!bones || (bf->frame_cache[i].bone_tags == bones))
+        {
+            bf->frame_cache[i].pinned = pinned;
+        }
+    }
+}
+
+/*
+ * Interpolates bounding box, centre and base offset; returns frame to
+ * interpolate with.
+ */
+static animation_frame_p SSBoneFrame_InterpolateBounds(struct ss_bone_frame_s *bf, uint16_t *next_frame)
 {
     float t = 1.0f - bf->animations.lerp;
-    ss_bone_tag_p btag = bf->bone_tags;
-    bone_tag_p src_btag, next_btag;
     skeletal_model_p model = bf->animations.model;
     animation_frame_p curr_anim = model->animations + bf->animations.current_animation;
     animation_frame_p next_anim = model->animations + bf->animations.next_animation;
     bone_frame_p curr_bf = curr_anim->frames + bf->animations.current_frame;
-    bone_frame_p next_bf = next_anim->frames + bf->animations.next_frame;
-    
+    bone_frame_p next_bf;
+
+    *next_frame = bf->animations.next_frame;
     if((bf->animations.current_frame + 1 == curr_anim->max_frame) && (curr_anim->max_frame < curr_anim->frames_count))
     {
         next_anim = curr_anim;
-        next_bf = curr_bf + 1;
+        *next_frame = bf->animations.current_frame + 1;
     }
-    
+    next_bf = next_anim->frames + *next_frame;
+
     vec3_interpolate_macro(bf->bb_max, curr_bf->bb_max, next_bf->bb_max, bf->animations.lerp, t);
     vec3_interpolate_macro(bf->bb_min, curr_bf->bb_min, next_bf->bb_min, bf->animations.lerp, t);
     vec3_interpolate_macro(bf->centre, curr_bf->centre, next_bf->centre, bf->animations.lerp, t);
     vec3_interpolate_macro(bf->pos, curr_bf->pos, next_bf->pos, bf->animations.lerp, t);
-    
-    next_btag = next_bf->bone_tags;
-    src_btag = curr_bf->bone_tags;
-    for(uint16_t k = 0; k < curr_bf->bone_tag_count; k++, btag++, src_btag++, next_btag++)
+
+    return next_anim;
+}
+
+
+void SSBoneFrame_UpdateBounds(struct ss_bone_frame_s *bf)
+{
+    uint16_t next_frame;
+    SSBoneFrame_InterpolateBounds(bf, &next_frame);
+}
+
+/*
+ * Interpolates bounding box and base offset, returns bones of frames for
+ * interpolation and number of bones.
+ */
+static uint16_t SSBoneFrame_UpdateBase(struct ss_bone_frame_s *bf, bone_tag_p *curr, bone_tag_p *next)
+{
+    animation_frame_p curr_anim = bf->animations.model->animations + bf->animations.current_animation;
+    uint16_t next_frame;
+    animation_frame_p next_anim = SSBoneFrame_InterpolateBounds(bf, &next_frame);
+
+    // Overriding animations frames are decoded while base bones are walked,
+    // so base slots must not be replaced (or reallocated) until pose is done.
+    *curr = SSBoneFrame_GetFrameBones(bf, curr_anim, bf->animations.current_frame);
+    SSBoneFrame_PinFrameBones(bf, *curr, 1);
+    *next = SSBoneFrame_GetFrameBones(bf, next_anim, next_frame);
+    SSBoneFrame_PinFrameBones(bf, *next, 1);
+
+    return curr_anim->frames[bf->animations.current_frame].bone_tag_count;
+}
+
+/*
+ * Returns lerp and source rotations of the bone, takes overriding animations into account.
+ */
+static float SSBoneFrame_GetBoneRotations(struct ss_bone_frame_s *bf, uint16_t k, bone_tag_p src_btag, bone_tag_p next_btag, float **q1, float **q2)
+{
+    ss_bone_tag_p btag = bf->bone_tags + k;
+    float lerp = bf->animations.lerp;
+
+    if((k > 0) && btag->alt_anim && btag->alt_anim->model && btag->alt_anim->enabled && (btag->alt_anim->model->mesh_tree[k].replace_anim != 0))
+    {
+        animation_frame_p curr_anim = btag->alt_anim->model->animations + btag->alt_anim->current_animation;
+        animation_frame_p next_anim = btag->alt_anim->model->animations + btag->alt_anim->next_animation;
+        lerp = btag->alt_anim->lerp;
+        src_btag = SSBoneFrame_GetFrameBones(bf, curr_anim, btag->alt_anim->current_frame) + k;
+        next_btag = SSBoneFrame_GetFrameBones(bf, next_anim, btag->alt_anim->next_frame) + k;
+    }
+    *q1 = src_btag->qrotate;
+    *q2 = next_btag->qrotate;
+
+    return lerp;
+}
+
+/*
+ * Reference bone by bone pose evaluation (no targeting).
+ */
+void SSBoneFrame_UpdatePoseScalar(struct ss_bone_frame_s *bf)
+{
+    float t = 1.0f - bf->animations.lerp;
+    ss_bone_tag_p btag = bf->bone_tags;
+    bone_tag_p src_btag, next_btag;
+    uint16_t count = SSBoneFrame_UpdateBase(bf, &src_btag, &next_btag);
+
+    for(uint16_t k = 0; k < count; k++, btag++, src_btag++, next_btag++)
     {
+        float *q1, *q2;
+        float lerp = SSBoneFrame_GetBoneRotations(bf, k, src_btag, next_btag, &q1, &q2);
         vec3_interpolate_macro(btag->offset, src_btag->offset, next_btag->offset, bf->animations.lerp, t);
         vec3_copy(btag->transform + 12, btag->offset);
         btag->transform[15] = 1.0f;
         if(k == 0)
         {
             vec3_add(btag->transform + 12, btag->transform + 12, bf->pos);
-            vec4_slerp(btag->qrotate, src_btag->qrotate, next_btag->qrotate, bf->animations.lerp);
-        }
-        else
-        {
-            bone_tag_p ov_src_btag = src_btag;
-            bone_tag_p ov_next_btag = next_btag;
-            float ov_lerp = bf->animations.lerp;
-            if(btag->alt_anim && btag->alt_anim->model && btag->alt_anim->enabled && (btag->alt_anim->model->mesh_tree[k].replace_anim != 0))
-            {
-                curr_anim = btag->alt_anim->model->animations + btag->alt_anim->current_animation;
-                next_anim = btag->alt_anim->model->animations + btag->alt_anim->next_animation;
-                bone_frame_p ov_curr_bf = curr_anim->frames + btag->alt_anim->current_frame;
-                bone_frame_p ov_next_bf = next_anim->frames + btag->alt_anim->next_frame;
-                ov_lerp = btag->alt_anim->lerp;
-                ov_src_btag = ov_curr_bf->bone_tags + k;
-                ov_next_btag = ov_next_bf->bone_tags + k;
-            }
-            vec4_slerp(btag->qrotate, ov_src_btag->qrotate, ov_next_btag->qrotate, ov_lerp);
         }
+        vec4_slerp(btag->qrotate, q1, q2, lerp);
         Mat4_set_qrotation(btag->transform, btag->qrotate);
     }
 
@@ -351,11 +606,71 @@ void SSBoneFrame_Update(struct ss_bone_frame_s *bf, float time)
     Mat4_Copy(btag->full_transform, btag->transform);
     Mat4_Copy(btag->orig_transform, btag->transform);
     btag++;
-    for(uint16_t k = 1; k < curr_bf->bone_tag_count; k++, btag++)
+    for(uint16_t k = 1; k < count; k++, btag++)
     {
         Mat4_Mat4_mul(btag->full_transform, btag->parent->full_transform, btag->transform);
         Mat4_Copy(btag->orig_transform, btag->full_transform);
     }
+    SSBoneFrame_PinFrameBones(bf, NULL, 0);
+}
+
+/*
+ * Batch pose evaluation: all bones rotations are gathered and slerped at once
+ * (vec4_slerp_array), then hierarchy is built in bones order (parent is
+ * always before child) with SIMD matrices multiplication.
+ */
+void SSBoneFrame_UpdatePose(struct ss_bone_frame_s *bf)
+{
+    float q1[4 * SS_BONE_BATCH_MAX], q2[4 * SS_BONE_BATCH_MAX], qr[4 * SS_BONE_BATCH_MAX];
+    float lerp[SS_BONE_BATCH_MAX];
+    float t = 1.0f - bf->animations.lerp;
+    ss_bone_tag_p btag = bf->bone_tags;
+    bone_tag_p src_btag, next_btag;
+    uint16_t count = SSBoneFrame_UpdateBase(bf, &src_btag, &next_btag);
+
+    if(count > SS_BONE_BATCH_MAX)
+    {
+        SSBoneFrame_UpdatePoseScalar(bf);
+        return;
+    }
+
+    for(uint16_t k = 0; k < count; k++, btag++, src_btag++, next_btag++)
+    {
+        float *bq1, *bq2;
+        lerp[k] = SSBoneFrame_GetBoneRotations(bf, k, src_btag, next_btag, &bq1, &bq2);
+        vec4_copy(q1 + 4 * k, bq1);
+        vec4_copy(q2 + 4 * k, bq2);
+        vec3_interpolate_macro(btag->offset, src_btag->offset, next_btag->offset, bf->animations.lerp, t);
+    }
+
+    vec4_slerp_array(qr, q1, q2, lerp, count);
+
+    btag = bf->bone_tags;
+    for(uint16_t k = 0; k < count; k++, btag++)
+    {
+        vec4_copy(btag->qrotate, qr + 4 * k);
+        Mat4_set_qrotation(btag->transform, btag->qrotate);
+        vec3_copy(btag->transform + 12, btag->offset);
+        btag->transform[15] = 1.0f;
+    }
+    vec3_add(bf->bone_tags->transform + 12, bf->bone_tags->transform + 12, bf->pos);
+
+    btag = bf->bone_tags;
+    Mat4_Copy(btag->full_transform, btag->transform);
+    Mat4_Copy(btag->orig_transform, btag->transform);
+    btag++;
+    for(uint16_t k = 1; k < count; k++, btag++)
+    {
+        Mat4_Mat4_mul_SIMD(btag->full_transform, btag->parent->full_transform, btag->transform);
+        Mat4_Copy(btag->orig_transform, btag->full_transform);
+    }
+    SSBoneFrame_PinFrameBones(bf, NULL, 0);
+}
+
+
+void SSBoneFrame_Update(struct ss_bone_frame_s *bf, float time)
+{
+    SSBoneFrame_UpdatePose(bf);
 
     for(ss_animation_p ss_anim = &bf->animations; ss_anim; ss_anim = ss_anim->next)
     {
@@ -25,6 +25,9 @@ extern "C" {
 #define SS_CHANGING_BY_STATE    (0x03)      // 0x03 - new frame, new anim (by state change info);
 #define SS_CHANGING_HEAVY       (0x04)      // 0x04 - rough change by set animation;
 
+#define SS_BONE_BATCH_MAX       (64)        // more bones - SSBoneFrame_UpdatePose uses scalar path
+#define SS_FRAME_CACHE_SIZE     (8)         // base + overriding animations current / next frames
+
     
 #define ANIM_EXT_TARGET_TO              (1)
     
@@ -110,6 +113,19 @@ typedef struct ss_animation_s
     struct ss_animation_s      *prev;
 }ss_animation_t, *ss_animation_p;
 
+/*
+ * decoded packed animation frame, see bone_frames_pack_s
+ */
+typedef struct ss_frame_cache_s
+{
+    struct animation_frame_s   *anim;
+    uint16_t                    frame;
+    uint16_t                    bone_tags_size;                                 // allocated bones
+    uint32_t                    last_use;
+    uint32_t                    pinned;                                         // base frame of current pose evaluation, not replaced
+    struct bone_tag_s          *bone_tags;
+}ss_frame_cache_t, *ss_frame_cache_p;
+
 /*
  * base frame of animated skeletal model
  */
@@ -126,6 +142,9 @@ typedef struct ss_bone_frame_s
     float                      *transform;
 
     struct ss_animation_s       animations;                                     // animations list
+
+    uint32_t                    frame_cache_tick;
+    struct ss_frame_cache_s     frame_cache[SS_FRAME_CACHE_SIZE];               // decoded packed frames
 }ss_bone_frame_t, *ss_bone_frame_p;
 
 /*
@@ -151,6 +170,20 @@ typedef struct bone_frame_s
     float               centre[3];                                              // bounding box centre
 }bone_frame_t, *bone_frame_p ;
 
+/*
+ * packed bones of all animation frames: quaternions are quantized to int16
+ * (q * 32767), offsets are int16 deltas from the first frame offsets (NULL if
+ * all frames have the same offsets). Frames headers (pos, bb) are not packed.
+ */
+typedef struct bone_frames_pack_s
+{
+    uint16_t            bone_tag_count;
+    uint16_t            frames_count;
+    int16_t            *qrotate;                                                // 4 per bone per frame
+    int16_t            *offset_delta;                                           // 3 per bone per frame
+    float              *offset;                                                 // 3 per bone, first frame
+}bone_frames_pack_t, *bone_frames_pack_p;
+
 /*
  * mesh tree base element structure
  */
@@ -211,6 +244,7 @@ typedef struct animation_frame_s
     uint16_t                    frames_count;           // Number of frames
     uint16_t                    state_change_count;     // Number of animation statechanges
     struct bone_frame_s        *frames;                 // Frame data
+    struct bone_frames_pack_s  *frames_pack;            // Packed frames bones, frames[i].bone_tags == NULL
     struct state_change_s      *state_change;           // Animation statechanges data
     
     struct animation_command_s *commands;
@@ -253,11 +287,17 @@ void SkeletalModel_GenParentsIndexes(skeletal_model_p model);
 void SkeletalModel_FillTransparency(skeletal_model_p model);
 void SkeletalModel_CopyMeshes(mesh_tree_tag_p dst, mesh_tree_tag_p src, int tags_count);
 void BoneFrame_Copy(bone_frame_p dst, bone_frame_p src);
+uint32_t SkeletalModel_PackFrames(skeletal_model_p model);                      // returns number of saved bytes
+struct bone_tag_s *SSBoneFrame_GetFrameBones(struct ss_bone_frame_s *bf, struct animation_frame_s *anim, uint16_t frame);
+void SSBoneFrame_ResetFrameCache(struct ss_bone_frame_s *bf);
 
 void SSBoneFrame_CreateFromModel(ss_bone_frame_p bf, skeletal_model_p model);
 void SSBoneFrame_Clear(ss_bone_frame_p bf);
 void SSBoneFrame_Copy(struct ss_bone_frame_s *dst, struct ss_bone_frame_s *src);
 void SSBoneFrame_Update(struct ss_bone_frame_s *bf, float time);
+void SSBoneFrame_UpdatePose(struct ss_bone_frame_s *bf);                        // batch (SIMD) pose, no targeting
+void SSBoneFrame_UpdatePoseScalar(struct ss_bone_frame_s *bf);                  // reference bone by bone path
+void SSBoneFrame_UpdateBounds(struct ss_bone_frame_s *bf);                      // bounding box, centre and base offset only
 void SSBoneFrame_RotateBone(struct ss_bone_frame_s *bf, const float q_rotate[4], int bone);
 int  SSBoneFrame_CheckTargetBoneLimit(struct ss_bone_frame_s *bf, struct ss_animation_s *ss_anim);
 void SSBoneFrame_TargetBoneToSlerp(struct ss_bone_frame_s *bf, struct ss_animation_s *ss_anim, float time);
@@ -20,6 +20,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_endian.h>
@@ -27,6 +28,130 @@
 #include "l_main.h"
 #include "../core/system.h"
 
+/** \brief memory source cursor.
+  *
+  * TR_RWFromMem sources keep their own cursor (in hidden.unknown.data1), so
+  * scalar readers may access memory directly, without SDL_RWops internals.
+  */
+typedef struct tr_mem_cursor_s
+{
+    uint8_t *base;
+    uint8_t *here;
+    uint8_t *stop;
+} tr_mem_cursor_t;
+
+static Sint64 SDLCALL TR_MemSize(SDL_RWops *ctx)
+{
+    tr_mem_cursor_t *mem = (tr_mem_cursor_t*)ctx->hidden.unknown.data1;
+    return (Sint64)(mem->stop - mem->base);
+}
+
+static Sint64 SDLCALL TR_MemSeek(SDL_RWops *ctx, Sint64 offset, int whence)
+{
+    tr_mem_cursor_t *mem = (tr_mem_cursor_t*)ctx->hidden.unknown.data1;
+    uint8_t *pos;
+
+    switch (whence)
+    {
+        case RW_SEEK_SET:
+            pos = mem->base + offset;
+            break;
+        case RW_SEEK_CUR:
+            pos = mem->here + offset;
+            break;
+        case RW_SEEK_END:
+            pos = mem->stop + offset;
+            break;
+        default:
+            return -1;
+    }
+
+    mem->here = (pos < mem->base) ? (mem->base) : ((pos > mem->stop) ? (mem->stop) : (pos));
+    return (Sint64)(mem->here - mem->base);
+}
+
+static size_t SDLCALL TR_MemRead(SDL_RWops *ctx, void *ptr, size_t size, size_t maxnum)
+{
+    tr_mem_cursor_t *mem = (tr_mem_cursor_t*)ctx->hidden.unknown.data1;
+    size_t num = 0;
+
+    if (size > 0)
+    {
+        num = (size_t)(mem->stop - mem->here) / size;
+        num = (num < maxnum) ? (num) : (maxnum);
+        memcpy(ptr, mem->here, num * size);
+        mem->here += num * size;
+    }
+
+    return num;
+}
+
+static size_t SDLCALL TR_MemWrite(SDL_RWops *ctx, const void *ptr, size_t size, size_t num)
+{
+    return 0;                                                                   // level sources are read only
+}
+
+static int SDLCALL TR_MemClose(SDL_RWops *ctx)
+{
+    free(ctx->hidden.unknown.data1);
+    SDL_FreeRW(ctx);
+    return 0;
+}
+
+/** \brief creates read only source over size bytes of mem (not copied, not freed).
+  */
+SDL_RWops *TR_RWFromMem(const void *mem, size_t size)
+{
+    SDL_RWops *src = SDL_AllocRW();
+    tr_mem_cursor_t *cursor;
+
+    if (src == NULL)
+        return NULL;
+
+    cursor = (tr_mem_cursor_t*)malloc(sizeof(tr_mem_cursor_t));
+    if (cursor == NULL)
+    {
+        SDL_FreeRW(src);
+        return NULL;
+    }
+    cursor->base = (uint8_t*)mem;
+    cursor->here = cursor->base;
+    cursor->stop = cursor->base + size;
+
+    src->size = TR_MemSize;
+    src->seek = TR_MemSeek;
+    src->read = TR_MemRead;
+    src->write = TR_MemWrite;
+    src->close = TR_MemClose;
+    src->type = SDL_RWOPS_UNKNOWN;
+    src->hidden.unknown.data1 = cursor;
+
+    return src;
+}
+
+/** \brief reads size bytes from src.
+  *
+  * memory sources (whole level buffer, uncompressed TR4/TR5 chunks) are read
+  * directly through their cursor, so there is no callback per scalar value.
+  * returns 0 if there is not enough data left.
+  */
+static inline int TR_RWread(SDL_RWops * const src, void *data, size_t size)
+{
+    if (src->read == TR_MemRead)
+    {
+        tr_mem_cursor_t *mem = (tr_mem_cursor_t*)src->hidden.unknown.data1;
+        if ((size_t)(mem->stop - mem->here) < size)
+        {
+            return 0;
+        }
+        memcpy(data, mem->here, size);
+        mem->here += size;
+        return 1;
+    }
+
+    return (SDL_RWread(src, data, size, 1) == 1);
+}
+
 /** \brief reads signed 8-bit value.
   *
   * uses current position from src. throws TR_ReadError when not successful.
@@ -39,7 +164,7 @@ int8_t TR_Level::read_bit8(SDL_RWops * const src)
     if (src == NULL)
         Sys_extError("read_bit8: src == NULL");
 
-    if (SDL_RWread(src, &data, 1, 1) < 1)
+    if (!TR_RWread(src, &data, 1))
         Sys_extError("read_bit8");
 
     return data;
@@ -56,7 +181,7 @@ uint8_t TR_Level::read_bitu8(SDL_RWops * const src)
     if (src == NULL)
         Sys_extError("read_bitu8: src == NULL");
 
-    if (SDL_RWread(src, &data, 1, 1) < 1)
+    if (!TR_RWread(src, &data, 1))
         Sys_extError("read_bitu8");
 
     return data;
@@ -73,7 +198,7 @@ int16_t TR_Level::read_bit16(SDL_RWops * const src)
     if (src == NULL)
         Sys_extError("read_bit16: src == NULL");
 
-    if (SDL_RWread(src, &data, 2, 1) < 1)
+    if (!TR_RWread(src, &data, 2))
         Sys_extError("read_bit16");
 
     data = SDL_SwapLE16(data);
@@ -92,7 +217,7 @@ uint16_t TR_Level::read_bitu16(SDL_RWops * const src)
     if (src == NULL)
         Sys_extError("read_bitu16: src == NULL");
 
-    if (SDL_RWread(src, &data, 2, 1) < 1)
+    if (!TR_RWread(src, &data, 2))
         Sys_extError("read_bitu16");
 
     data = SDL_SwapLE16(data);
@@ -111,7 +236,7 @@ int32_t TR_Level::read_bit32(SDL_RWops * const src)
     if (src == NULL)
         Sys_extError("read_bit32: src == NULL");
 
-    if (SDL_RWread(src, &data, 4, 1) < 1)
+    if (!TR_RWread(src, &data, 4))
         Sys_extError("read_bit32");
 
     data = SDL_SwapLE32(data);
@@ -130,7 +255,7 @@ uint32_t TR_Level::read_bitu32(SDL_RWops * const src)
     if (src == NULL)
         Sys_extError("read_bitu32: src == NULL");
 
-    if (SDL_RWread(src, &data, 4, 1) < 1)
+    if (!TR_RWread(src, &data, 4))
         Sys_extError("read_bitu32");
 
     data = SDL_SwapLE32(data);
@@ -149,7 +274,7 @@ float TR_Level::read_float(SDL_RWops * const src)
     if (src == NULL)
         Sys_extError("read_float: src == NULL");
 
-    if (SDL_RWread(src, &data, 4, 1) < 1)
+    if (!TR_RWread(src, &data, 4))
         Sys_extError("read_float");
 
     data = SDL_SwapLE32(data);
@@ -169,7 +294,7 @@ float TR_Level::read_mixfloat(SDL_RWops * const src)
     if (src == NULL)
         Sys_extError("read_mixfloat: src == NULL");
 
-    if ((SDL_RWread(src, &sign_int, 2, 1) < 1) || (SDL_RWread(src, &base_int, 2, 1) < 1))
+    if (!TR_RWread(src, &sign_int, 2) || !TR_RWread(src, &base_int, 2))
         Sys_extError("read_mixfloat");
 
     base_int = SDL_SwapLE32(base_int);
@@ -177,3 +302,61 @@ float TR_Level::read_mixfloat(SDL_RWops * const src)
 
     return ((float)base_int + ((float)sign_int / 65535.0));
 }
+
+/** \brief reads array of unsigned 8-bit values.
+  *
+  * one bulk copy instead of count single reads. throws TR_ReadError when not successful.
+  */
+void TR_Level::read_bitu8_array(SDL_RWops * const src, uint8_t *data, uint32_t count)
+{
+    if (src == NULL)
+        Sys_extError("read_bitu8_array: src == NULL");
+
+    if ((count > 0) && !TR_RWread(src, data, count))
+        Sys_extError("read_bitu8_array");
+}
+
+/** \brief reads array of signed 16-bit values.
+  *
+  * bulk copy followed by endian correction pass. throws TR_ReadError when not successful.
+  */
+void TR_Level::read_bit16_array(SDL_RWops * const src, int16_t *data, uint32_t count)
+{
+    this->read_bitu16_array(src, (uint16_t*)data, count);
+}
+
+/** \brief reads array of unsigned 16-bit values.
+  *
+  * bulk copy followed by endian correction pass. throws TR_ReadError when not successful.
+  */
+void TR_Level::read_bitu16_array(SDL_RWops * const src, uint16_t *data, uint32_t count)
+{
+    if (src == NULL)
+        Sys_extError("read_bitu16_array: src == NULL");
+
+    if ((count > 0) && !TR_RWread(src, data, count * sizeof(uint16_t)))
+        Sys_extError("read_bitu16_array");
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    for (uint32_t i = 0; i < count; i++)
+        data[i] = SDL_SwapLE16(data[i]);
+#endif
+}
+
+/** \brief reads array of unsigned 32-bit values.
+  *
+  * bulk copy followed by endian correction pass. throws TR_ReadError when not successful.
+  */
+void TR_Level::read_bitu32_array(SDL_RWops * const src, uint32_t *data, uint32_t count)
+{
+    if (src == NULL)
+        Sys_extError("read_bitu32_array: src == NULL");
+
+    if ((count > 0) && !TR_RWread(src, data, count * sizeof(uint32_t)))
+        Sys_extError("read_bitu32_array");
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    for (uint32_t i = 0; i < count; i++)
+        data[i] = SDL_SwapLE32(data[i]);
+#endif
+}
@@ -46,13 +46,12 @@ void TR_Level::read_mesh_data(SDL_RWops * const src)
     if (SDL_RWread(src, buffer, 1, size) < size)
         Sys_extError("read_tr_mesh_data: SDL_RWread(buffer)");
 
-    if ((newsrc = SDL_RWFromMem(buffer, size)) == NULL)
-        Sys_extError("read_tr_mesh_data: SDL_RWFromMem");
+    if ((newsrc = TR_RWFromMem(buffer, size)) == NULL)
+        Sys_extError("read_tr_mesh_data: TR_RWFromMem");
 
     this->mesh_indices_count = read_bitu32(src);
     this->mesh_indices = (uint32_t*)malloc(this->mesh_indices_count * sizeof(uint32_t));
-    for (i = 0; i < this->mesh_indices_count; i++)
-        this->mesh_indices[i] = read_bitu32(src);
+    read_bitu32_array(src, this->mesh_indices, this->mesh_indices_count);
 
     this->meshes_count = this->mesh_indices_count;
     this->meshes = (tr4_mesh_t*)calloc(this->meshes_count, sizeof(tr4_mesh_t));
@@ -97,11 +96,10 @@ void TR_Level::read_frame_moveable_data(SDL_RWops * const src)
     this->frame_data_size = read_bitu32(src);
     this->frame_data = (uint16_t*)malloc(this->frame_data_size * sizeof(uint16_t));
 
-    if (SDL_RWread(src, this->frame_data, sizeof(uint16_t), this->frame_data_size) < frame_data_size)
-        Sys_extError("read_tr_level: frame_data: SDL_RWread(buffer)");
+    read_bitu8_array(src, (uint8_t*)this->frame_data, this->frame_data_size * sizeof(uint16_t));     // raw, as stored in file
 
-    if ((newsrc = SDL_RWFromMem(this->frame_data, this->frame_data_size)) == NULL)
-        Sys_extError("read_tr_level: frame_data: SDL_RWFromMem");
+    if ((newsrc = TR_RWFromMem(this->frame_data, this->frame_data_size * sizeof(uint16_t))) == NULL)
+        Sys_extError("read_tr_level: frame_data: TR_RWFromMem");
 
     this->moveables_count = read_bitu32(src);
     this->moveables = (tr_moveable_t*)calloc(this->moveables_count, sizeof(tr_moveable_t));
@@ -141,7 +139,11 @@ void TR_Level::read_frame_moveable_data(SDL_RWops * const src)
     newsrc = NULL;
 }
 
-void TR_Level::read_level(const char *filename, int32_t game_version)
+/** \brief reads the level from file.
+  *
+  * if buffered is set, whole file is loaded to memory first and parsed from there.
+  */
+void TR_Level::read_level(const char *filename, int32_t game_version, bool buffered)
 {
     int len, i, len2;
     SDL_RWops *src = SDL_RWFromFile(filename, "rb");
@@ -168,6 +170,28 @@ void TR_Level::read_level(const char *filename, int32_t game_version)
         strncat(this->sfx_path, "MAIN.SFX", 256);
     }
 
+    if(buffered)
+    {
+        // Whole file is read at once and parsed from memory - level readers do
+        // lots of small reads, which are much cheaper from memory source.
+        Sint64 size = SDL_RWsize(src);
+        uint8_t *buffer = (size > 0) ? ((uint8_t*)malloc(size)) : (NULL);
+        if((buffer == NULL) || (SDL_RWread(src, buffer, size, 1) < 1))
+        {
+            Sys_extError("read_level: can not read \"%s\" to memory", filename);
+        }
+        SDL_RWclose(src);
+
+        if((src = TR_RWFromMem(buffer, size)) == NULL)
+        {
+            Sys_extError("read_level: TR_RWFromMem");
+        }
+        this->read_level(src, game_version);
+        SDL_RWclose(src);
+        free(buffer);
+        return;
+    }
+
     this->read_level(src, game_version);
     SDL_RWclose(src);
 }
@@ -29,6 +29,31 @@
 #define TR_AUDIO_DEFAULT_RANGE 8
 #define TR_AUDIO_DEFAULT_PITCH 1.0       // 0.0 - only noise
 
+class TR_Level;
+
+SDL_RWops *TR_RWFromMem(const void *mem, size_t size);    ///< \brief read only memory source, parsed without SDL_RWread callbacks.
+
+/** \brief zlib compressed chunk of TR4/TR5 level file.
+  *
+  * Chunks are read sequentially and inflated on worker threads; textile chunks
+  * are also decoded to textiles right in the job.
+  */
+typedef struct tr4_zchunk_s
+{
+    const char *name;
+    uint32_t uncomp_size;
+    uint32_t comp_size;
+    uint8_t *comp_buffer;
+    uint8_t *uncomp_buffer;
+    int result;                     ///< \brief zlib result code.
+    float time;                     ///< \brief inflate (and decode) time in seconds.
+
+    TR_Level *level;
+    tr4_textile32_t *textile32;     ///< \brief decode target (if not NULL).
+    tr2_textile16_t *textile16;     ///< \brief decode target (if not NULL).
+    uint32_t textiles_count;
+} tr4_zchunk_t;
+
 /** \brief A complete TR level.
   *
   * This contains all necessary functions to load a TR level.
@@ -549,7 +574,7 @@ class TR_Level
         
     char     sfx_path[256];
         
-    void read_level(const char *filename, int32_t game_version);
+    void read_level(const char *filename, int32_t game_version, bool buffered = true);
     void read_level(SDL_RWops * const src, int32_t game_version);
 
     protected:
@@ -568,6 +593,10 @@ class TR_Level
     uint32_t read_bitu32(SDL_RWops * const src);
     float read_float(SDL_RWops * const src);
     float read_mixfloat(SDL_RWops * const src);
+    void read_bitu8_array(SDL_RWops * const src, uint8_t *data, uint32_t count);
+    void read_bit16_array(SDL_RWops * const src, int16_t *data, uint32_t count);
+    void read_bitu16_array(SDL_RWops * const src, uint16_t *data, uint32_t count);
+    void read_bitu32_array(SDL_RWops * const src, uint32_t *data, uint32_t count);
 
     void read_mesh_data(SDL_RWops * const src);
     void read_frame_moveable_data(SDL_RWops * const src);
@@ -584,6 +613,7 @@ class TR_Level
     void read_tr_room_sprite(SDL_RWops * const src, tr_room_sprite_t & room_sprite);
     void read_tr_room_portal(SDL_RWops * const src, tr_room_portal_t & portal);
     void read_tr_room_sector(SDL_RWops * const src, tr_room_sector_t & room_sector);
+    void read_tr_room_sectors(SDL_RWops * const src, tr_room_sector_t *sectors, uint32_t count);
     void read_tr_room_light(SDL_RWops * const src, tr5_room_light_t & light);
     void read_tr_room_vertex(SDL_RWops * const src, tr5_room_vertex_t & room_vertex);
     void read_tr_room_staticmesh(SDL_RWops * const src, tr2_room_staticmesh_t & room_static_mesh);
@@ -622,6 +652,10 @@ class TR_Level
 
     void read_tr4_vertex_float(SDL_RWops * const src, tr5_vertex_t & vertex);
     void read_tr4_textile32(SDL_RWops * const src, tr4_textile32_t & textile);
+    void read_tr4_zchunk(SDL_RWops * const src, tr4_zchunk_t & chunk, const char *name, bool skip);
+    void check_tr4_zchunk(tr4_zchunk_t & chunk);
+    static void inflate_tr4_zchunk(void *data);
+    static void free_tr4_zchunk(tr4_zchunk_t & chunk);
     void read_tr4_face3(SDL_RWops * const src, tr4_face3_t & meshface);
     void read_tr4_face4(SDL_RWops * const src, tr4_face4_t & meshface);
     void read_tr4_room_light(SDL_RWops * const src, tr5_room_light_t & light);
@@ -104,8 +104,7 @@ void TR_Level::read_tr_textile8(SDL_RWops * const src, tr_textile8_t & textile)
 /// \brief reads the lightmap.
 void TR_Level::read_tr_lightmap(SDL_RWops * const src, tr_lightmap_t & lightmap)
 {
-    for (int i = 0; i < (32 * 256); i++)
-        lightmap.map[i] = read_bitu8(src);
+    read_bitu8_array(src, lightmap.map, 32 * 256);
 }
 
 /// \brief reads the 256 colour palette values.
@@ -170,6 +169,31 @@ void TR_Level::read_tr_room_sector(SDL_RWops * const src, tr_room_sector_t & sec
     sector.ceiling = read_bit8(src);
 }
 
+/** \brief reads an array of room sectors.
+  *
+  * file layout matches tr_room_sector_t, so the whole array is copied at once;
+  * only fd_index and box_index need endian correction.
+  */
+void TR_Level::read_tr_room_sectors(SDL_RWops * const src, tr_room_sector_t *sectors, uint32_t count)
+{
+    if (sizeof(tr_room_sector_t) != 8)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            read_tr_room_sector(src, sectors[i]);
+        return;
+    }
+
+    read_bitu8_array(src, (uint8_t*)sectors, count * 8);
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sectors[i].fd_index = SDL_SwapLE16(sectors[i].fd_index);
+        sectors[i].box_index = SDL_SwapLE16(sectors[i].box_index);
+    }
+#endif
+}
+
 /** \brief reads a room light definition.
   *
   * intensity1 gets converted, so it matches the 0-32768 range introduced in TR3.
@@ -307,8 +331,7 @@ void TR_Level::read_tr_room(SDL_RWops * const src, tr5_room_t & room)
     room.num_zsectors = read_bitu16(src);
     room.num_xsectors = read_bitu16(src);
     room.sector_list = (tr_room_sector_t*)malloc(room.num_zsectors * room.num_xsectors * sizeof(tr_room_sector_t));
-    for (i = 0; i < (uint32_t)(room.num_zsectors * room.num_xsectors); i++)
-        read_tr_room_sector(src, room.sector_list[i]);
+    read_tr_room_sectors(src, room.sector_list, room.num_zsectors * room.num_xsectors);
 
     // read and make consistent
     room.intensity1 = (8191 - read_bit16(src)) << 2;
@@ -620,8 +643,7 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->floor_data_size = read_bitu32(src);
     this->floor_data = (uint16_t*)malloc(this->floor_data_size * sizeof(uint16_t));
-    for(i = 0; i < this->floor_data_size; i++)
-        this->floor_data[i] = read_bitu16(src);
+    read_bitu16_array(src, this->floor_data, this->floor_data_size);
 
     read_mesh_data(src);
 
@@ -642,13 +664,11 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->anim_commands_count = read_bitu32(src);
     this->anim_commands = (int16_t*)malloc(this->anim_commands_count * sizeof(int16_t));
-    for (i = 0; i < this->anim_commands_count; i++)
-        this->anim_commands[i] = read_bit16(src);
+    read_bit16_array(src, this->anim_commands, this->anim_commands_count);
 
     this->mesh_tree_data_size = read_bitu32(src);
     this->mesh_tree_data = (uint32_t*)malloc(this->mesh_tree_data_size * sizeof(uint32_t));
-    for (i = 0; i < this->mesh_tree_data_size; i++)
-        this->mesh_tree_data[i] = read_bitu32(src);                     // 4 bytes
+    read_bitu32_array(src, this->mesh_tree_data, this->mesh_tree_data_size);
 
     read_frame_moveable_data(src);
 
@@ -713,8 +733,7 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->overlaps_count = read_bitu32(src);
     this->overlaps = (uint16_t*)malloc(this->overlaps_count * sizeof(uint16_t));
-    for (i = 0; i < this->overlaps_count; i++)
-        this->overlaps[i] = read_bitu16(src);
+    read_bitu16_array(src, this->overlaps, this->overlaps_count);
 
     // Zones
     SDL_RWseek(src, this->boxes_count * 12, RW_SEEK_CUR);
@@ -746,13 +765,11 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->demo_data_count = read_bitu16(src);
     this->demo_data = (uint8_t*)malloc(this->demo_data_count * sizeof(uint8_t));
-    for(i=0; i < this->demo_data_count; i++)
-        this->demo_data[i] = read_bitu8(src);
+    read_bitu8_array(src, this->demo_data, this->demo_data_count);
 
     // Soundmap
     this->soundmap = (int16_t*)malloc(TR_AUDIO_MAP_SIZE_TR1 * sizeof(int16_t));
-    for(i=0; i < TR_AUDIO_MAP_SIZE_TR1; i++)
-        this->soundmap[i] = read_bit16(src);
+    read_bit16_array(src, this->soundmap, TR_AUDIO_MAP_SIZE_TR1);
 
     this->sound_details_count = read_bitu32(src);
     this->sound_details = (tr_sound_details_t*)malloc(this->sound_details_count * sizeof(tr_sound_details_t));
@@ -776,10 +793,10 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
     this->samples_count = 0;
     this->samples_data_size = read_bitu32(src);
     this->samples_data = (uint8_t*)malloc(this->samples_data_size * sizeof(uint8_t));
-    for(i=0; i < this->samples_data_size; i++)
+    read_bitu8_array(src, this->samples_data, this->samples_data_size);
+    for(i = 4; i < this->samples_data_size; i++)
     {
-        this->samples_data[i] = read_bitu8(src);
-        if((i >= 4) && (*((uint32_t*)(this->samples_data+i-4)) == 0x46464952))   /// RIFF
+        if(*((uint32_t*)(this->samples_data+i-4)) == 0x46464952)   /// RIFF
         {
             this->samples_count++;
         }
@@ -787,6 +804,5 @@ void TR_Level::read_tr_level(SDL_RWops * const src, bool demo_or_ub)
 
     this->sample_indices_count = read_bitu32(src);
     this->sample_indices = (uint32_t*)malloc(this->sample_indices_count * sizeof(uint32_t));
-    for(i=0; i < this->sample_indices_count; i++)
-        this->sample_indices[i] = read_bitu32(src);
+    read_bitu32_array(src, this->sample_indices, this->sample_indices_count);
 }
@@ -24,6 +24,7 @@
 #include "l_main.h"
 #include "tr_versions.h"
 #include "../core/system.h"
+#include "../core/jobs.h"
 
 #define RCSID "$Id: l_tr4.cpp,v 1.14 2002/09/20 15:59:02 crow Exp $"
 
@@ -45,6 +46,103 @@ void TR_Level::read_tr4_textile32(SDL_RWops * const src, tr4_textile32_t & texti
     }
 }
 
+/** \brief reads compressed chunk sizes and data.
+  *
+  * inflating is done later by inflate_tr4_zchunk(). if skip is set, data is skipped.
+  */
+void TR_Level::read_tr4_zchunk(SDL_RWops * const src, tr4_zchunk_t & chunk, const char *name, bool skip)
+{
+    memset(&chunk, 0, sizeof(tr4_zchunk_t));
+    chunk.name = name;
+    chunk.level = this;
+    chunk.result = Z_OK;
+
+    chunk.uncomp_size = read_bitu32(src);
+    if (chunk.uncomp_size == 0)
+        Sys_extError("read_tr4_zchunk: %s uncomp_size == 0", name);
+
+    chunk.comp_size = read_bitu32(src);
+    if (chunk.comp_size == 0)
+        return;
+
+    if (skip)
+    {
+        SDL_RWseek(src, chunk.comp_size, RW_SEEK_CUR);
+        return;
+    }
+
+    chunk.comp_buffer = new uint8_t[chunk.comp_size];
+    if (SDL_RWread(src, chunk.comp_buffer, 1, chunk.comp_size) < chunk.comp_size)
+    {
+        free_tr4_zchunk(chunk);
+        Sys_extError("read_tr4_zchunk: %s", name);
+    }
+}
+
+/** \brief inflates chunk and decodes textiles from it (if set); job function.
+  *
+  * does not throw errors, result code is checked by check_tr4_zchunk() in loader thread.
+  */
+void TR_Level::inflate_tr4_zchunk(void *data)
+{
+    tr4_zchunk_t *chunk = (tr4_zchunk_t*)data;
+    unsigned long size = chunk->uncomp_size;
+    float time = Sys_FloatTime();
+
+    chunk->uncomp_buffer = new uint8_t[chunk->uncomp_size];
+    chunk->result = uncompress(chunk->uncomp_buffer, &size, chunk->comp_buffer, chunk->comp_size);
+    if ((chunk->result == Z_OK) && (size != chunk->uncomp_size))
+        chunk->result = Z_BUF_ERROR;
+
+    delete [] chunk->comp_buffer;
+    chunk->comp_buffer = NULL;
+
+    if ((chunk->result == Z_OK) && (chunk->textiles_count > 0))
+    {
+        SDL_RWops *newsrc = TR_RWFromMem(chunk->uncomp_buffer, chunk->uncomp_size);
+        if (newsrc == NULL)
+        {
+            chunk->result = Z_MEM_ERROR;
+        }
+        else
+        {
+            for (uint32_t i = 0; i < chunk->textiles_count; i++)
+            {
+                if (chunk->textile32)
+                    chunk->level->read_tr4_textile32(newsrc, chunk->textile32[i]);
+                else
+                    chunk->level->read_tr2_textile16(newsrc, chunk->textile16[i]);
+            }
+            SDL_RWclose(newsrc);
+        }
+
+        delete [] chunk->uncomp_buffer;
+        chunk->uncomp_buffer = NULL;
+    }
+
+    chunk->time = Sys_FloatTime() - time;
+}
+
+/// \brief checks result of inflated chunk and logs its timing.
+void TR_Level::check_tr4_zchunk(tr4_zchunk_t & chunk)
+{
+    if (chunk.result != Z_OK)
+    {
+        free_tr4_zchunk(chunk);
+        Sys_extError("check_tr4_zchunk: %s: uncompress error %d", chunk.name, chunk.result);
+    }
+
+    Sys_DebugLog(SYS_LOG_FILENAME, "level chunk \"%s\": %d -> %d bytes, %.2f ms", chunk.name, chunk.comp_size, chunk.uncomp_size, 1000.0f * chunk.time);
+}
+
+void TR_Level::free_tr4_zchunk(tr4_zchunk_t & chunk)
+{
+    delete [] chunk.comp_buffer;
+    delete [] chunk.uncomp_buffer;
+    chunk.comp_buffer = NULL;
+    chunk.uncomp_buffer = NULL;
+}
+
 void TR_Level::read_tr4_face3(SDL_RWops * const src, tr4_face3_t & meshface)
 {
     meshface.vertices[0] = read_bitu16(src);
@@ -164,8 +262,7 @@ void TR_Level::read_tr4_room(SDL_RWops * const src, tr5_room_t & room)
     room.num_zsectors = read_bitu16(src);
     room.num_xsectors = read_bitu16(src);
     room.sector_list = (tr_room_sector_t*)malloc(room.num_zsectors * room.num_xsectors * sizeof(tr_room_sector_t));
-    for (i = 0; i < (uint32_t)(room.num_zsectors * room.num_xsectors); i++)
-        read_tr_room_sector(src, room.sector_list[i]);
+    read_tr_room_sectors(src, room.sector_list, room.num_zsectors * room.num_xsectors);
 
     room.light_colour.b = read_bitu8(src) / 255.0f;
     room.light_colour.g = read_bitu8(src) / 255.0f;
@@ -343,8 +440,11 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
     SDL_RWops *src = _src;
     uint32_t i;
     uint8_t *uncomp_buffer = NULL;
-    uint8_t *comp_buffer = NULL;
     SDL_RWops *newsrc = NULL;
+    tr4_zchunk_t chunks[4];
+    job_group_t geometry_jobs;
+    job_group_t textile_jobs;
+    float time = Sys_FloatTime();
 
     // Version
     uint32_t file_version = read_bitu32(src);
@@ -359,211 +459,81 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
     this->num_misc_textiles = 0;
     this->read_32bit_textiles = false;
 
+    this->num_room_textiles = read_bitu16(src);
+    this->num_obj_textiles = read_bitu16(src);
+    this->num_bump_textiles = read_bitu16(src);
+    this->num_misc_textiles = 2;
+    this->num_textiles = this->num_room_textiles + this->num_obj_textiles + this->num_bump_textiles + this->num_misc_textiles;
+
+    // All compressed chunks are read first, then inflated concurrently.
+    // Geometry is parsed as soon as its chunk is ready, while textiles are
+    // still decoded by workers.
+    read_tr4_zchunk(src, chunks[0], "textiles32", false);
+    if (chunks[0].comp_size > 0)
     {
-        uint32_t uncomp_size;
-        uint32_t comp_size;
-        unsigned long size;
-
-        this->num_room_textiles = read_bitu16(src);
-        this->num_obj_textiles = read_bitu16(src);
-        this->num_bump_textiles = read_bitu16(src);
-        this->num_misc_textiles = 2;
-        this->num_textiles = this->num_room_textiles + this->num_obj_textiles + this->num_bump_textiles + this->num_misc_textiles;
-
-        uncomp_size = read_bitu32(src);
-        if (uncomp_size == 0)
-            Sys_extError("read_tr4_level: textiles32 uncomp_size == 0");
-
-        comp_size = read_bitu32(src);
-        if (comp_size > 0)
-        {
-            uncomp_buffer = new uint8_t[uncomp_size];
-
-            this->textile32_count = this->num_textiles;
-            this->textile32 = (tr4_textile32_t*)malloc(this->textile32_count * sizeof(tr4_textile32_t));
-            comp_buffer = new uint8_t[comp_size];
-
-            if (SDL_RWread(src, comp_buffer, 1, comp_size) < comp_size)
-                Sys_extError("read_tr4_level: textiles32");
-
-            size = uncomp_size;
-            if (uncompress(uncomp_buffer, &size, comp_buffer, comp_size) != Z_OK)
-                Sys_extError("read_tr4_level: uncompress");
-
-            if (size != uncomp_size)
-                Sys_extError("read_tr4_level: uncompress size mismatch");
-            delete [] comp_buffer;
-
-            comp_buffer = NULL;
-            if ((newsrc = SDL_RWFromMem(uncomp_buffer, uncomp_size)) == NULL)
-                Sys_extError("read_tr4_level: SDL_RWFromMem");
-
-            for (i = 0; i < (this->num_textiles - this->num_misc_textiles); i++)
-                read_tr4_textile32(newsrc, this->textile32[i]);
-            SDL_RWclose(newsrc);
-            newsrc = NULL;
-            delete [] uncomp_buffer;
-
-            uncomp_buffer = NULL;
-            this->read_32bit_textiles = true;
-        }
-
-        uncomp_size = read_bitu32(src);
-        if (uncomp_size == 0)
-            Sys_extError("read_tr4_level: textiles16 uncomp_size == 0");
+        this->textile32_count = this->num_textiles;
+        this->textile32 = (tr4_textile32_t*)malloc(this->textile32_count * sizeof(tr4_textile32_t));
+        chunks[0].textile32 = this->textile32;
+        chunks[0].textiles_count = this->num_textiles - this->num_misc_textiles;
+        this->read_32bit_textiles = true;
+    }
 
-        comp_size = read_bitu32(src);
-        if (comp_size > 0)
-        {
-            if (this->textile32_count == 0)
-            {
-                uncomp_buffer = new uint8_t[uncomp_size];
-
-                this->textile16_count = this->num_textiles;
-                this->textile16 = (tr2_textile16_t*)malloc(this->textile16_count * sizeof(tr2_textile16_t));
-                comp_buffer = new uint8_t[comp_size];
-
-                if (SDL_RWread(src, comp_buffer, 1, comp_size) < comp_size)
-                {
-                    delete [] comp_buffer;
-                    delete [] uncomp_buffer;
-                    Sys_extError("read_tr4_level: textiles16");
-                }
-
-                size = uncomp_size;
-                if (uncompress(uncomp_buffer, &size, comp_buffer, comp_size) != Z_OK)
-                {
-                    delete [] comp_buffer;
-                    delete [] uncomp_buffer;
-                    Sys_extError("read_tr4_level: uncompress");
-                }
-
-                delete [] comp_buffer;
-                comp_buffer = NULL;
-
-                if (size != uncomp_size)
-                {
-                    delete [] uncomp_buffer;
-                    Sys_extError("read_tr4_level: uncompress size mismatch");
-                }
-
-                if ((newsrc = SDL_RWFromMem(uncomp_buffer, uncomp_size)) == NULL)
-                {
-                    delete [] uncomp_buffer;
-                    Sys_extError("read_tr4_level: SDL_RWFromMem");
-                }
-
-                for (i = 0; i < (this->num_textiles - this->num_misc_textiles); i++)
-                    read_tr2_textile16(newsrc, this->textile16[i]);
-
-                SDL_RWclose(newsrc);
-                newsrc = NULL;
-                delete [] uncomp_buffer;
-                uncomp_buffer = NULL;
-            }
-            else
-            {
-                SDL_RWseek(src, comp_size, SEEK_CUR);
-            }
-        }
+    read_tr4_zchunk(src, chunks[1], "textiles16", this->textile32_count != 0);
+    if (chunks[1].comp_buffer != NULL)
+    {
+        this->textile16_count = this->num_textiles;
+        this->textile16 = (tr2_textile16_t*)malloc(this->textile16_count * sizeof(tr2_textile16_t));
+        chunks[1].textile16 = this->textile16;
+        chunks[1].textiles_count = this->num_textiles - this->num_misc_textiles;
+    }
 
-        uncomp_size = read_bitu32(src);
-        if (uncomp_size == 0)
-            Sys_extError("read_tr4_level: textiles32d uncomp_size == 0");
+    read_tr4_zchunk(src, chunks[2], "misc_textiles", false);
+    if (chunks[2].comp_size > 0)
+    {
+        if ((chunks[2].uncomp_size / (256 * 256 * 4)) > 2)
+            Sys_extWarn("read_tr4_level: num_misc_textiles > 2");
 
-        comp_size = read_bitu32(src);
-        if (comp_size > 0)
+        if (this->textile32_count == 0)
         {
-            uncomp_buffer = new uint8_t[uncomp_size];
-
-            if ((uncomp_size / (256 * 256 * 4)) > 2)
-                Sys_extWarn("read_tr4_level: num_misc_textiles > 2");
-
-            if (this->textile32_count == 0)
-            {
-                this->textile32_count = this->num_textiles;
-                this->textile32 = (tr4_textile32_t*)malloc(this->textile32_count * sizeof(tr4_textile32_t));
-            }
-            comp_buffer = new uint8_t[comp_size];
-
-            if (SDL_RWread(src, comp_buffer, 1, comp_size) < comp_size)
-            {
-                delete [] uncomp_buffer;
-                delete [] comp_buffer;
-                Sys_extError("read_tr4_level: misc_textiles");
-            }
-
-            size = uncomp_size;
-            if (uncompress(uncomp_buffer, &size, comp_buffer, comp_size) != Z_OK)
-            {
-                delete [] uncomp_buffer;
-                delete [] comp_buffer;
-                Sys_extError("read_tr4_level: uncompress");
-            }
-
-            delete [] comp_buffer;
-            comp_buffer = NULL;
-            if (size != uncomp_size)
-            {
-                delete [] uncomp_buffer;
-                Sys_extError("read_tr4_level: uncompress size mismatch");
-            }
-
-            if ((newsrc = SDL_RWFromMem(uncomp_buffer, uncomp_size)) == NULL)
-            {
-                delete [] uncomp_buffer;
-                Sys_extError("read_tr4_level: SDL_RWFromMem");
-            }
-
-            for (i = (this->num_textiles - this->num_misc_textiles); i < this->num_textiles; i++)
-                read_tr4_textile32(newsrc, this->textile32[i]);
-
-            SDL_RWclose(newsrc);
-            newsrc = NULL;
-            delete [] uncomp_buffer;
-            uncomp_buffer = NULL;
+            this->textile32_count = this->num_textiles;
+            this->textile32 = (tr4_textile32_t*)malloc(this->textile32_count * sizeof(tr4_textile32_t));
         }
+        chunks[2].textile32 = this->textile32 + (this->num_textiles - this->num_misc_textiles);
+        chunks[2].textiles_count = this->num_misc_textiles;
+    }
 
-        uncomp_size = read_bitu32(src);
-        if (uncomp_size == 0)
-            Sys_extError("read_tr4_level: packed geometry uncomp_size == 0");
-
-        comp_size = read_bitu32(src);
-
-        if (!comp_size)
-            Sys_extError("read_tr4_level: packed geometry");
-
-        uncomp_buffer = new uint8_t[uncomp_size];
-        comp_buffer = new uint8_t[comp_size];
+    read_tr4_zchunk(src, chunks[3], "packed_geometry", false);
+    if (chunks[3].comp_size == 0)
+        Sys_extError("read_tr4_level: packed geometry");
 
-        if (SDL_RWread(src, comp_buffer, 1, comp_size) < comp_size)
-        {
-            delete [] uncomp_buffer;
-            delete [] comp_buffer;
-            Sys_extError("read_tr4_level: packed geometry");
-        }
+    for (i = 0; i < 3; i++)
+    {
+        uint32_t textile_size = (chunks[i].textile32) ? (sizeof(tr4_textile32_t)) : (sizeof(tr2_textile16_t));
+        if (chunks[i].uncomp_size < chunks[i].textiles_count * textile_size)
+            Sys_extError("read_tr4_level: %s: chunk is too small", chunks[i].name);
+    }
 
-        size = uncomp_size;
-        if (uncompress(uncomp_buffer, &size, comp_buffer, comp_size) != Z_OK)
-        {
-            delete [] uncomp_buffer;
-            delete [] comp_buffer;
-            Sys_extError("read_tr4_level: uncompress");
-        }
+    Jobs_InitGroup(&geometry_jobs);
+    Jobs_InitGroup(&textile_jobs);
+    Jobs_Add(&geometry_jobs, inflate_tr4_zchunk, chunks + 3);
+    for (i = 0; i < 3; i++)
+    {
+        if (chunks[i].comp_buffer != NULL)
+            Jobs_Add(&textile_jobs, inflate_tr4_zchunk, chunks + i);
+    }
 
-        delete [] comp_buffer;
-        comp_buffer = NULL;
-        if (size != uncomp_size)
-        {
-            delete [] uncomp_buffer;
-            Sys_extError("read_tr4_level: uncompress size mismatch");
-        }
+    Jobs_Wait(&geometry_jobs);
+    if (chunks[3].result != Z_OK)
+        Jobs_Wait(&textile_jobs);
+    check_tr4_zchunk(chunks[3]);
+    uncomp_buffer = chunks[3].uncomp_buffer;
+    chunks[3].uncomp_buffer = NULL;
 
-        if ((newsrc = SDL_RWFromMem(uncomp_buffer, uncomp_size)) == NULL)
-        {
-            delete [] uncomp_buffer;
-            Sys_extError("read_tr4_level: SDL_RWFromMem");
-        }
+    if ((newsrc = TR_RWFromMem(uncomp_buffer, chunks[3].uncomp_size)) == NULL)
+    {
+        Jobs_Wait(&textile_jobs);
+        delete [] uncomp_buffer;
+        Sys_extError("read_tr4_level: TR_RWFromMem");
     }
 
     // Unused
@@ -577,8 +547,7 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
 
     this->floor_data_size = read_bitu32(newsrc);
     this->floor_data = (uint16_t*)malloc(this->floor_data_size * sizeof(uint16_t));
-    for(i = 0; i < this->floor_data_size; i++)
-        this->floor_data[i] = read_bitu16(newsrc);
+    read_bitu16_array(newsrc, this->floor_data, this->floor_data_size);
 
     read_mesh_data(newsrc);
 
@@ -599,13 +568,11 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
 
     this->anim_commands_count = read_bitu32(newsrc);
     this->anim_commands = (int16_t*)malloc(this->anim_commands_count * sizeof(int16_t));
-    for (i = 0; i < this->anim_commands_count; i++)
-        this->anim_commands[i] = read_bit16(newsrc);
+    read_bit16_array(newsrc, this->anim_commands, this->anim_commands_count);
 
     this->mesh_tree_data_size = read_bitu32(newsrc);
     this->mesh_tree_data = (uint32_t*)malloc(this->mesh_tree_data_size * sizeof(uint32_t));
-    for (i = 0; i < this->mesh_tree_data_size; i++)
-        this->mesh_tree_data[i] = read_bitu32(newsrc);                     // 4 bytes
+    read_bitu32_array(newsrc, this->mesh_tree_data, this->mesh_tree_data_size);
 
     read_frame_moveable_data(newsrc);
 
@@ -688,8 +655,7 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
 
     this->overlaps_count = read_bitu32(newsrc);
     this->overlaps = (uint16_t*)malloc(this->overlaps_count * sizeof(uint16_t));
-    for (i = 0; i < this->overlaps_count; i++)
-        this->overlaps[i] = read_bitu16(newsrc);
+    read_bitu16_array(newsrc, this->overlaps, this->overlaps_count);
 
     // Zones
     SDL_RWseek(newsrc, this->boxes_count * 20, SEEK_CUR);
@@ -740,13 +706,11 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
 
     this->demo_data_count = read_bitu16(newsrc);
     this->demo_data = (uint8_t*)malloc(this->demo_data_count * sizeof(uint8_t));
-    for(i=0; i < this->demo_data_count; i++)
-        this->demo_data[i] = read_bitu8(newsrc);
+    read_bitu8_array(newsrc, this->demo_data, this->demo_data_count);
 
     // Soundmap
     this->soundmap = (int16_t*)malloc(TR_AUDIO_MAP_SIZE_TR4 * sizeof(int16_t));
-    for(i=0; i < TR_AUDIO_MAP_SIZE_TR4; i++)
-        this->soundmap[i] = read_bit16(newsrc);
+    read_bit16_array(newsrc, this->soundmap, TR_AUDIO_MAP_SIZE_TR4);
 
     this->sound_details_count = 0;
     i = read_bitu32(newsrc);
@@ -774,8 +738,7 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
         this->sample_indices_count = i;
 
         this->sample_indices = (uint32_t*)malloc(this->sample_indices_count * sizeof(uint32_t));
-        for(i=0; i < this->sample_indices_count; i++)
-            this->sample_indices[i] = read_bitu32(newsrc);
+        read_bitu32_array(newsrc, this->sample_indices, this->sample_indices_count);
     }
     else
     {
@@ -797,7 +760,14 @@ void TR_Level::read_tr4_level(SDL_RWops * const _src)
         // block of file as single array.
         this->samples_data_size = (uint32_t) (SDL_RWsize(src) - SDL_RWtell(src));
         this->samples_data = (uint8_t*)malloc(this->samples_data_size * sizeof(uint8_t));
-        for(i = 0; i < this->samples_data_size; i++)
-            this->samples_data[i] = read_bitu8(src);
+        read_bitu8_array(src, this->samples_data, this->samples_data_size);
+    }
+
+    Jobs_Wait(&textile_jobs);
+    for (i = 0; i < 3; i++)
+    {
+        if (chunks[i].textiles_count > 0)
+            check_tr4_zchunk(chunks[i]);
     }
+    Sys_DebugLog(SYS_LOG_FILENAME, "read_tr4_level: %d workers, wall time %.2f ms", Jobs_GetWorkersCount(), 1000.0f * (Sys_FloatTime() - time));
 }
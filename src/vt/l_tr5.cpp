@@ -23,6 +23,7 @@
 #include <zlib.h>
 #include "l_main.h"
 #include "../core/system.h"
+#include "../core/jobs.h"
 
 #define RCSID "$Id: l_tr5.cpp,v 1.14 2002/09/20 15:59:02 crow Exp $"
 
@@ -137,10 +138,10 @@ void TR_Level::read_tr5_room(SDL_RWops * const src, tr5_room_t & room)
     if (SDL_RWread(src, buffer, 1, room_data_size) < room_data_size)
         Sys_extError("read_tr5_room: room_data");
 
-    if ((newsrc = SDL_RWFromMem(buffer, room_data_size)) == NULL)
+    if ((newsrc = TR_RWFromMem(buffer, room_data_size)) == NULL)
     {
         delete [] buffer;
-        Sys_extError("read_tr5_room: SDL_RWFromMem");
+        Sys_extError("read_tr5_room: TR_RWFromMem");
     }
 
     room.intensity1 = 32767;
@@ -320,8 +321,7 @@ void TR_Level::read_tr5_room(SDL_RWops * const src, tr5_room_t & room)
     SDL_RWseek(newsrc, 208 + sector_data_offset, SEEK_SET);
 
     room.sector_list = (tr_room_sector_t*)malloc(room.num_zsectors * room.num_xsectors * sizeof(tr_room_sector_t));
-    for (i = 0; i < (uint32_t)(room.num_zsectors * room.num_xsectors); i++)
-        read_tr_room_sector(newsrc, room.sector_list[i]);
+    read_tr_room_sectors(newsrc, room.sector_list, room.num_zsectors * room.num_xsectors);
 
     /*
         if (room.portal_offset != 0xFFFFFFFF)
@@ -412,9 +412,9 @@ void TR_Level::read_tr5_moveable(SDL_RWops * const src, tr_moveable_t & moveable
 void TR_Level::read_tr5_level(SDL_RWops * const src)
 {
     uint32_t i;
-    uint8_t *comp_buffer = NULL;
-    uint8_t *uncomp_buffer = NULL;
-    SDL_RWops *newsrc = NULL;
+    tr4_zchunk_t chunks[3];
+    job_group_t textile_jobs;
+    float time = Sys_FloatTime();
 
     // Version
     uint32_t file_version = read_bitu32(src);
@@ -429,131 +429,37 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
     this->num_misc_textiles = 0;
     this->read_32bit_textiles = false;
 
-    uint32_t uncomp_size;
-    uint32_t comp_size;
-    unsigned long size;
-
     this->num_room_textiles = read_bitu16(src);
     this->num_obj_textiles = read_bitu16(src);
     this->num_bump_textiles = read_bitu16(src);
     this->num_misc_textiles = 3;
     this->num_textiles = this->num_room_textiles + this->num_obj_textiles + this->num_bump_textiles + this->num_misc_textiles;
 
-    uncomp_size = read_bitu32(src);
-    if (uncomp_size == 0)
-        Sys_extError("read_tr5_level: textiles32 uncomp_size == 0");
-
-    comp_size = read_bitu32(src);
-    if (comp_size > 0)
+    // Textile chunks are inflated and decoded by workers, while level data
+    // (it is not compressed in TR5) is parsed.
+    read_tr4_zchunk(src, chunks[0], "textiles32", false);
+    if (chunks[0].comp_size > 0)
     {
-        comp_buffer = new uint8_t[comp_size];
         this->textile32_count = this->num_textiles;
         this->textile32 = (tr4_textile32_t*)malloc(this->textile32_count * sizeof(tr4_textile32_t));
-
-        if (SDL_RWread(src, comp_buffer, 1, comp_size) < comp_size)
-        {
-            delete [] comp_buffer;
-            Sys_extError("read_tr5_level: textiles32");
-        }
-
-        uncomp_buffer = new uint8_t[uncomp_size];
-        size = uncomp_size;
-        if (uncompress(uncomp_buffer, &size, comp_buffer, comp_size) != Z_OK)
-        {
-            delete [] comp_buffer;
-            delete [] uncomp_buffer;
-            Sys_extError("read_tr5_level: uncompress");
-        }
-
-        delete [] comp_buffer;
-        comp_buffer = NULL;
-        if (size != uncomp_size)
-        {
-            delete [] uncomp_buffer;
-            Sys_extError("read_tr5_level: uncompress size mismatch");
-        }
-
-        if ((newsrc = SDL_RWFromMem(uncomp_buffer, uncomp_size)) == NULL)
-        {
-            delete [] uncomp_buffer;
-            Sys_extError("read_tr5_level: SDL_RWFromMem");
-        }
-
-        for (i = 0; i < (this->num_textiles - this->num_misc_textiles); i++)
-            read_tr4_textile32(newsrc, this->textile32[i]);
-
-        SDL_RWclose(newsrc);
-        newsrc = NULL;
-        delete [] uncomp_buffer;
-        uncomp_buffer = NULL;
-
+        chunks[0].textile32 = this->textile32;
+        chunks[0].textiles_count = this->num_textiles - this->num_misc_textiles;
         this->read_32bit_textiles = true;
     }
 
-    uncomp_size = read_bitu32(src);
-    if (uncomp_size == 0)
-        Sys_extError("read_tr5_level: textiles16 uncomp_size == 0");
-
-    comp_size = read_bitu32(src);
-    if (comp_size > 0)
+    read_tr4_zchunk(src, chunks[1], "textiles16", this->textile32_count != 0);
+    if (chunks[1].comp_buffer != NULL)
     {
-        if (this->textile32_count == 0)
-        {
-            comp_buffer = new uint8_t[comp_size];
-            this->textile16_count = this->num_textiles;
-            this->textile16 = (tr2_textile16_t*)malloc(this->textile16_count * sizeof(tr2_textile16_t));
-
-            if (SDL_RWread(src, comp_buffer, 1, comp_size) < comp_size)
-            {
-                delete [] comp_buffer;
-                Sys_extError("read_tr5_level: textiles16");
-            }
-
-            uncomp_buffer = new uint8_t[uncomp_size];
-            size = uncomp_size;
-            if (uncompress(uncomp_buffer, &size, comp_buffer, comp_size) != Z_OK)
-            {
-                delete [] comp_buffer;
-                delete [] uncomp_buffer;
-                Sys_extError("read_tr5_level: uncompress");
-            }
-            delete [] comp_buffer;
-            comp_buffer = NULL;
-
-            if (size != uncomp_size)
-            {
-                delete [] uncomp_buffer;
-                Sys_extError("read_tr5_level: uncompress size mismatch");
-            }
-
-            if ((newsrc = SDL_RWFromMem(uncomp_buffer, uncomp_size)) == NULL)
-            {
-                delete [] uncomp_buffer;
-                Sys_extError("read_tr5_level: SDL_RWFromMem");
-            }
-
-            for (i = 0; i < (this->num_textiles - this->num_misc_textiles); i++)
-                read_tr2_textile16(newsrc, this->textile16[i]);
-
-            SDL_RWclose(newsrc);
-            newsrc = NULL;
-            delete [] uncomp_buffer;
-            uncomp_buffer = NULL;
-        }
-        else
-        {
-            SDL_RWseek(src, comp_size, SEEK_CUR);
-        }
+        this->textile16_count = this->num_textiles;
+        this->textile16 = (tr2_textile16_t*)malloc(this->textile16_count * sizeof(tr2_textile16_t));
+        chunks[1].textile16 = this->textile16;
+        chunks[1].textiles_count = this->num_textiles - this->num_misc_textiles;
     }
 
-    uncomp_size = read_bitu32(src);
-    if (uncomp_size == 0)
-        Sys_extError("read_tr5_level: textiles32d uncomp_size == 0");
-
-    comp_size = read_bitu32(src);
-    if (comp_size > 0)
+    read_tr4_zchunk(src, chunks[2], "misc_textiles", false);
+    if (chunks[2].comp_size > 0)
     {
-        if ((uncomp_size / (256 * 256 * 4)) > 3)
+        if ((chunks[2].uncomp_size / (256 * 256 * 4)) > 3)
             Sys_extWarn("read_tr5_level: num_misc_textiles > 3");
 
         if (this->textile32_count == 0)
@@ -561,44 +467,21 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
             this->textile32_count = this->num_misc_textiles;
             this->textile32 = (tr4_textile32_t*)malloc(this->textile32_count * sizeof(tr4_textile32_t));
         }
+        chunks[2].textile32 = this->textile32 + (this->num_textiles - this->num_misc_textiles);
+        chunks[2].textiles_count = this->num_misc_textiles;
+    }
 
-        comp_buffer = new uint8_t[comp_size];
-        if (SDL_RWread(src, comp_buffer, 1, comp_size) < comp_size)
-        {
-            delete [] comp_buffer;
-            Sys_extError("read_tr5_level: misc_textiles");
-        }
-
-        uncomp_buffer = new uint8_t[uncomp_size];
-        size = uncomp_size;
-        if (uncompress(uncomp_buffer, &size, comp_buffer, comp_size) != Z_OK)
-        {
-            delete [] uncomp_buffer;
-            delete [] comp_buffer;
-            Sys_extError("read_tr5_level: uncompress");
-        }
-        delete [] comp_buffer;
-        comp_buffer = NULL;
-
-        if (size != uncomp_size)
-        {
-            delete [] uncomp_buffer;
-            Sys_extError("read_tr5_level: uncompress size mismatch");
-        }
-
-        if ((newsrc = SDL_RWFromMem(uncomp_buffer, uncomp_size)) == NULL)
+    Jobs_InitGroup(&textile_jobs);
+    for (i = 0; i < 3; i++)
+    {
+        uint32_t textile_size = (chunks[i].textile32) ? (sizeof(tr4_textile32_t)) : (sizeof(tr2_textile16_t));
+        if (chunks[i].uncomp_size < chunks[i].textiles_count * textile_size)
         {
-            delete [] uncomp_buffer;
-            Sys_extError("read_tr5_level: SDL_RWFromMem");
+            Jobs_Wait(&textile_jobs);
+            Sys_extError("read_tr5_level: %s: chunk is too small", chunks[i].name);
         }
-
-        for (i = (this->num_textiles - this->num_misc_textiles); i < this->num_textiles; i++)
-            read_tr4_textile32(newsrc, this->textile32[i]);
-
-        SDL_RWclose(newsrc);
-        newsrc = NULL;
-        delete [] uncomp_buffer;
-        uncomp_buffer = NULL;
+        if (chunks[i].comp_buffer != NULL)
+            Jobs_Add(&textile_jobs, inflate_tr4_zchunk, chunks + i);
     }
 
     // flags?
@@ -653,8 +536,7 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->floor_data_size = read_bitu32(src);
     this->floor_data = (uint16_t*)malloc(this->floor_data_size * sizeof(uint16_t));
-    for(i = 0; i < this->floor_data_size; i++)
-        this->floor_data[i] = read_bitu16(src);
+    read_bitu16_array(src, this->floor_data, this->floor_data_size);
 
     read_mesh_data(src);
 
@@ -677,13 +559,11 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->anim_commands_count = read_bitu32(src);
     this->anim_commands = (int16_t*)malloc(this->anim_commands_count * sizeof(int16_t));
-    for (i = 0; i < this->anim_commands_count; i++)
-        this->anim_commands[i] = read_bit16(src);
+    read_bit16_array(src, this->anim_commands, this->anim_commands_count);
 
     this->mesh_tree_data_size = read_bitu32(src);
     this->mesh_tree_data = (uint32_t*)malloc(this->mesh_tree_data_size * sizeof(uint32_t));
-    for (i = 0; i < this->mesh_tree_data_size; i++)
-        this->mesh_tree_data[i] = read_bitu32(src);                     // 4 bytes
+    read_bitu32_array(src, this->mesh_tree_data, this->mesh_tree_data_size);
 
     read_frame_moveable_data(src);
 
@@ -768,8 +648,7 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->overlaps_count = read_bitu32(src);
     this->overlaps = (uint16_t*)malloc(this->overlaps_count * sizeof(uint16_t));
-    for (i = 0; i < this->overlaps_count; i++)
-        this->overlaps[i] = read_bitu16(src);
+    read_bitu16_array(src, this->overlaps, this->overlaps_count);
 
     // Zones
     SDL_RWseek(src, this->boxes_count * 20, SEEK_CUR);
@@ -827,13 +706,11 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->demo_data_count = read_bitu16(src);
     this->demo_data = (uint8_t*)malloc(this->demo_data_count * sizeof(uint8_t));
-    for(i=0; i < this->demo_data_count; i++)
-        this->demo_data[i] = read_bitu8(src);
+    read_bitu8_array(src, this->demo_data, this->demo_data_count);
 
     // Soundmap
     this->soundmap = (int16_t*)malloc(TR_AUDIO_MAP_SIZE_TR5 * sizeof(int16_t));
-    for(i=0; i < TR_AUDIO_MAP_SIZE_TR5; i++)
-        this->soundmap[i] = read_bit16(src);
+    read_bit16_array(src, this->soundmap, TR_AUDIO_MAP_SIZE_TR5);
 
     this->sound_details_count = read_bitu32(src);
     this->sound_details = (tr_sound_details_t*)malloc(this->sound_details_count * sizeof(tr_sound_details_t));
@@ -851,8 +728,7 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
 
     this->sample_indices_count = read_bitu32(src);
     this->sample_indices = (uint32_t*)malloc(this->sample_indices_count * sizeof(uint32_t));
-    for(i=0; i < this->sample_indices_count; i++)
-        this->sample_indices[i] = read_bitu32(src);
+    read_bitu32_array(src, this->sample_indices, this->sample_indices_count);
 
     SDL_RWseek(src, 6, SEEK_CUR);   // In TR5, sample indices are followed by 6 0xCD bytes. - correct - really 0xCDCDCDCDCDCD
 
@@ -864,7 +740,14 @@ void TR_Level::read_tr5_level(SDL_RWops * const src)
         // block of file as single array.
         this->samples_data_size = SDL_RWsize(src) - SDL_RWtell(src);
         this->samples_data = (uint8_t*)malloc(this->samples_data_size * sizeof(uint8_t));
-        for(i = 0; i < this->samples_data_size; i++)
-            this->samples_data[i] = read_bitu8(src);
+        read_bitu8_array(src, this->samples_data, this->samples_data_size);
+    }
+
+    Jobs_Wait(&textile_jobs);
+    for (i = 0; i < 3; i++)
+    {
+        if (chunks[i].textiles_count > 0)
+            check_tr4_zchunk(chunks[i]);
     }
+    Sys_DebugLog(SYS_LOG_FILENAME, "read_tr5_level: %d workers, wall time %.2f ms", Jobs_GetWorkersCount(), 1000.0f * (Sys_FloatTime() - time));
 }
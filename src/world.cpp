@@ -15,6 +15,7 @@ extern "C" {
 #include "core/gl_util.h"
 #include "core/console.h"
 #include "core/system.h"
+#include "core/jobs.h"
 #include "core/vmath.h"
 #include "core/polygon.h"
 #include "core/obb.h"
@@ -30,6 +31,7 @@ extern "C" {
 #include "audio.h"
 #include "room.h"
 #include "world.h"
+#include "world_cache.h"
 #include "mesh.h"
 #include "skeletal_model.h"
 #include "entity.h"
@@ -50,6 +52,15 @@ extern "C" {
     uint32_t                        rooms_count;
     struct room_s                  *rooms;
 
+    float                           room_grid_min[2];       // Rooms search grid origin
+    uint32_t                        room_grid_size[2];      // Number of grid cells by X and Y
+    uint32_t                       *room_grid_offsets;      // Cell -> first index in room_grid_rooms, (cells count + 1) items
+    uint32_t                       *room_grid_rooms;        // Indexes of real rooms which cross the cell, ascending
+
+    uint32_t                        room_lists_size;
+    struct room_s                 **room_lists;             // Overlapped and near rooms lists of all rooms, one after another
+    uint32_t                       *room_pvs;               // Rows of potentially visible rooms bits, see World_GenRoomPVS()
+
     uint32_t                        room_boxes_count;
     struct room_box_s              *room_boxes;
 
@@ -57,6 +68,9 @@ extern "C" {
     uint8_t                        *flip_map;               // Flipped room activity array.
     uint8_t                        *flip_state;             // Flipped room state array.
     uint16_t                        global_flip_state;
+    struct flip_tweens_s           *flip_tweens;            // Per room dynamic tweens dependencies and bodies, see World_UpdateFlipCollisions()
+    uint8_t                        *flip_changed;           // Rooms flipped after last collisions update
+    uint32_t                        flip_tweens_tick;
 
     bordered_texture_atlas         *tex_atlas;
     uint32_t                        tex_count;              // Number of textures
@@ -77,7 +91,9 @@ extern "C" {
     struct entity_s                *Character;              // this is an unique Lara's pointer =)
     struct skeletal_model_s        *sky_box;                // global skybox
 
-    std::map<uint32_t, entity_p>    entity_tree;
+    uint32_t                        entities_size;          // Entity slots count; slot index == entity id
+    uint32_t                        entities_count;         // Live entities count
+    struct entity_slot_s           *entities;               // Dense entity table
     std::map<uint32_t, base_item_p> items_tree;
 
     uint32_t                        type;
@@ -89,6 +105,12 @@ extern "C" {
     struct flyby_camera_sequence_s *flyby_camera_sequences;
 } global_world;
 
+typedef struct entity_slot_s
+{
+    entity_p                        entity;
+    uint32_t                        generation;             // bumped on each delete, see World_GetEntityHandle()
+} entity_slot_t, *entity_slot_p;
+
 
 // private load level functions prototipes:
 void World_SetEntityModelProperties(struct entity_s *ent);
@@ -115,10 +137,92 @@ void World_GenEntities(class VT_Level *tr);
 void World_GenBaseItems();
 void World_GenSpritesBuffer();
 void World_GenRoomProperties(class VT_Level *tr);
+void World_GenRoomGrid();
+void World_GenRoomLists();
+void World_GenRoomPVS();
 void World_GenRoomCollision();
 void World_FixRooms();
 void World_MakeEntityPickable(entity_p ent);                                    // Assign pickup functions to previously created base items.
 
+/*
+ * World loading stages graph. Stage is started when all stages from its
+ * depends mask are finished. Worker stages are CPU only (no GL, Lua, physics
+ * or console output) and are executed by jobs workers; other stages are
+ * executed by main thread in table order. Load screen shows weight of
+ * finished stages.
+ */
+enum world_load_stage_e
+{
+    WORLD_STAGE_SCRIPTS = 0,
+    WORLD_STAGE_TEXTURES,
+    WORLD_STAGE_ANIM_TEXTURES,
+    WORLD_STAGE_MESHES,
+    WORLD_STAGE_SPRITES,
+    WORLD_STAGE_BOXES,
+    WORLD_STAGE_CAMERAS,
+    WORLD_STAGE_ROOMS,
+    WORLD_STAGE_FLYBY_CAMERAS,
+    WORLD_STAGE_ROOM_FLIPMAP,
+    WORLD_STAGE_SKELETAL_MODELS,
+    WORLD_STAGE_ENTITIES,
+    WORLD_STAGE_BASE_ITEMS,
+    WORLD_STAGE_SPRITES_BUFFER,
+    WORLD_STAGE_ROOM_PROPERTIES,
+    WORLD_STAGE_ROOM_COLLISION,
+    WORLD_STAGE_SAMPLES,
+    WORLD_STAGE_AUDIO_SCRIPT,
+    WORLD_STAGE_SKYBOX,
+    WORLD_STAGE_ENTITY_FUNCTIONS,
+    WORLD_STAGE_AUTOEXEC,
+    WORLD_STAGE_FIX_ROOMS,
+    WORLD_STAGES_COUNT
+};
+
+#define WORLD_STAGE_BIT(s)          (1U << (s))
+#define WORLD_STAGE_ALL             (WORLD_STAGE_BIT(WORLD_STAGES_COUNT) - 1)
+#define WORLD_STAGE_FLAG_WORKER     (0x01)
+
+typedef struct world_load_stage_s
+{
+    uint32_t                    depends;
+    uint16_t                    flags;
+    uint16_t                    weight;
+}world_load_stage_t, *world_load_stage_p;
+
+typedef struct world_load_task_s
+{
+    class VT_Level             *tr;
+    int                         stage;
+    int                         started;
+    job_group_t                 group;
+}world_load_task_t, *world_load_task_p;
+
+static const world_load_stage_t world_load_stages[WORLD_STAGES_COUNT] =
+{
+    /* SCRIPTS          */ {0, 0, 200},
+    /* TEXTURES         */ {WORLD_STAGE_BIT(WORLD_STAGE_SCRIPTS), 0, 100},
+    /* ANIM_TEXTURES    */ {WORLD_STAGE_BIT(WORLD_STAGE_TEXTURES), 0, 20},
+    /* MESHES           */ {WORLD_STAGE_BIT(WORLD_STAGE_ANIM_TEXTURES), 0, 80},
+    /* SPRITES          */ {WORLD_STAGE_BIT(WORLD_STAGE_TEXTURES), WORLD_STAGE_FLAG_WORKER, 20},
+    /* BOXES            */ {0, WORLD_STAGE_FLAG_WORKER, 20},
+    /* CAMERAS          */ {0, WORLD_STAGE_FLAG_WORKER, 20},
+    /* ROOMS            */ {WORLD_STAGE_BIT(WORLD_STAGE_MESHES) | WORLD_STAGE_BIT(WORLD_STAGE_SPRITES), 0, 20},
+    /* FLYBY_CAMERAS    */ {WORLD_STAGE_BIT(WORLD_STAGE_ROOMS), WORLD_STAGE_FLAG_WORKER, 20},
+    /* ROOM_FLIPMAP     */ {0, 0, 20},
+    /* SKELETAL_MODELS  */ {WORLD_STAGE_BIT(WORLD_STAGE_MESHES), WORLD_STAGE_FLAG_WORKER, 80},
+    /* ENTITIES         */ {WORLD_STAGE_BIT(WORLD_STAGE_ROOMS) | WORLD_STAGE_BIT(WORLD_STAGE_ROOM_FLIPMAP) | WORLD_STAGE_BIT(WORLD_STAGE_SKELETAL_MODELS), 0, 50},
+    /* BASE_ITEMS       */ {WORLD_STAGE_BIT(WORLD_STAGE_ENTITIES), 0, 30},
+    /* SPRITES_BUFFER   */ {WORLD_STAGE_BIT(WORLD_STAGE_BASE_ITEMS), 0, 20},
+    /* ROOM_PROPERTIES  */ {WORLD_STAGE_BIT(WORLD_STAGE_SPRITES_BUFFER) | WORLD_STAGE_BIT(WORLD_STAGE_BOXES) | WORLD_STAGE_BIT(WORLD_STAGE_CAMERAS), 0, 50},
+    /* ROOM_COLLISION   */ {WORLD_STAGE_BIT(WORLD_STAGE_ROOM_PROPERTIES), 0, 50},
+    /* SAMPLES          */ {WORLD_STAGE_BIT(WORLD_STAGE_SCRIPTS), WORLD_STAGE_FLAG_WORKER, 40},
+    /* AUDIO_SCRIPT     */ {WORLD_STAGE_BIT(WORLD_STAGE_ROOM_PROPERTIES) | WORLD_STAGE_BIT(WORLD_STAGE_SAMPLES), 0, 10},
+    /* SKYBOX           */ {WORLD_STAGE_BIT(WORLD_STAGE_SKELETAL_MODELS), 0, 10},
+    /* ENTITY_FUNCTIONS */ {WORLD_STAGE_BIT(WORLD_STAGE_ENTITIES), 0, 50},
+    /* AUTOEXEC         */ {WORLD_STAGE_ALL & ~(WORLD_STAGE_BIT(WORLD_STAGE_AUTOEXEC) | WORLD_STAGE_BIT(WORLD_STAGE_FIX_ROOMS)), 0, 60},
+    /* FIX_ROOMS        */ {WORLD_STAGE_ALL & ~WORLD_STAGE_BIT(WORLD_STAGE_FIX_ROOMS), 0, 10}
+};
+
 
 void World_Prepare()
 {
@@ -131,13 +235,26 @@ void World_Prepare()
     global_world.sprites_count = 0;
     global_world.rooms_count = 0;
     global_world.rooms = 0;
+    global_world.room_grid_offsets = NULL;
+    global_world.room_grid_rooms = NULL;
+    global_world.room_grid_size[0] = 0;
+    global_world.room_grid_size[1] = 0;
+    global_world.room_lists = NULL;
+    global_world.room_lists_size = 0;
+    global_world.room_pvs = NULL;
     global_world.flip_map = NULL;
     global_world.flip_state = NULL;
     global_world.flip_count = 0;
     global_world.global_flip_state = 0;
+    global_world.flip_tweens = NULL;
+    global_world.flip_changed = NULL;
+    global_world.flip_tweens_tick = 0;
     global_world.textures = NULL;
     global_world.type = 0;
     global_world.Character = NULL;
+    global_world.entities = NULL;
+    global_world.entities_size = 0;
+    global_world.entities_count = 0;
 
     global_world.anim_sequences = NULL;
     global_world.anim_sequences_count = 0;
@@ -157,89 +274,229 @@ void World_Prepare()
 }
 
 
-void World_Open(class VT_Level *tr)
+static void World_RunLoadStage(int stage, class VT_Level *tr)
 {
-    World_Clear();
+    switch(stage)
+    {
+        case WORLD_STAGE_SCRIPTS:
+            World_ScriptsOpen();                // Open configuration scripts.
+            break;
 
-    global_world.version = tr->game_version;
+        case WORLD_STAGE_TEXTURES:
+            World_GenTextures(tr);              // Generate OGL textures
+            break;
+
+        case WORLD_STAGE_ANIM_TEXTURES:
+            World_GenAnimTextures(tr);          // Generate animated textures
+            break;
+
+        case WORLD_STAGE_MESHES:
+            World_GenMeshes(tr);                // Generate all meshes
+            break;
+
+        case WORLD_STAGE_SPRITES:
+            World_GenSprites(tr);               // Generate all sprites
+            break;
+
+        case WORLD_STAGE_BOXES:
+            World_GenBoxes(tr);                 // Generate boxes.
+            break;
+
+        case WORLD_STAGE_CAMERAS:
+            World_GenCameras(tr);               // Generate cameras & sinks.
+            break;
 
-    World_ScriptsOpen();                // Open configuration scripts.
-    Gui_DrawLoadScreen(200);
+        case WORLD_STAGE_ROOMS:
+            World_GenRooms(tr);                 // Build all rooms
+            break;
 
-    World_GenTextures(tr);              // Generate OGL textures
-    Gui_DrawLoadScreen(300);
+        case WORLD_STAGE_FLYBY_CAMERAS:
+            World_GenFlyByCameras(tr);
+            break;
 
-    World_GenAnimTextures(tr);          // Generate animated textures
-    Gui_DrawLoadScreen(320);
+        case WORLD_STAGE_ROOM_FLIPMAP:
+            World_GenRoomFlipMap();             // Generate room flipmaps
+            break;
 
-    World_GenMeshes(tr);                // Generate all meshes
-    Gui_DrawLoadScreen(400);
+        case WORLD_STAGE_SKELETAL_MODELS:
+            // Build all skeletal models. Must be generated before TR_Sector_Calculate() function.
+            World_GenSkeletalModels(tr);
+            break;
 
-    World_GenSprites(tr);               // Generate all sprites
-    Gui_DrawLoadScreen(420);
+        case WORLD_STAGE_ENTITIES:
+            World_GenEntities(tr);              // Build all moveables (entities)
+            break;
 
-    World_GenBoxes(tr);                 // Generate boxes.
-    Gui_DrawLoadScreen(440);
+        case WORLD_STAGE_BASE_ITEMS:
+            World_GenBaseItems();               // Generate inventory item entries.
+            break;
 
-    World_GenCameras(tr);               // Generate cameras & sinks.
-    Gui_DrawLoadScreen(460);
+        case WORLD_STAGE_SPRITES_BUFFER:
+            // Generate sprite buffers. Only now because entity generation adds new sprites
+            World_GenSpritesBuffer();
+            break;
 
-    World_GenRooms(tr);                 // Build all rooms
-    Gui_DrawLoadScreen(480);
+        case WORLD_STAGE_ROOM_PROPERTIES:
+            World_GenRoomProperties(tr);
+            break;
 
-    World_GenFlyByCameras(tr);
-    Gui_DrawLoadScreen(500);
+        case WORLD_STAGE_ROOM_COLLISION:
+            World_GenRoomCollision();
+            break;
 
-    World_GenRoomFlipMap();             // Generate room flipmaps
-    Gui_DrawLoadScreen(520);
+        case WORLD_STAGE_SAMPLES:
+            Audio_GenSamples(tr);               // Initialize audio.
+            break;
 
-    // Build all skeletal models. Must be generated before TR_Sector_Calculate() function.
-    World_GenSkeletalModels(tr);
-    Gui_DrawLoadScreen(600);
+        case WORLD_STAGE_AUDIO_SCRIPT:
+            Audio_UploadSamples();              // OpenAL calls stay on main thread.
+            Audio_GenScriptData();              // Needs triggers for stream tracks list.
+            break;
 
-    World_GenEntities(tr);              // Build all moveables (entities)
-    Gui_DrawLoadScreen(650);
+        case WORLD_STAGE_SKYBOX:
+            // Find and set skybox.
+            global_world.sky_box = World_GetSkybox();
+            break;
 
-    World_GenBaseItems();               // Generate inventory item entries.
-    Gui_DrawLoadScreen(680);
+        case WORLD_STAGE_ENTITY_FUNCTIONS:
+            // Generate entity functions.
+            for(uint32_t i = 0; i < global_world.entities_size; i++)
+            {
+                if(global_world.entities[i].entity)
+                {
+                    World_SetEntityFunction(global_world.entities[i].entity);
+                }
+            }
+            break;
 
-    // Generate sprite buffers. Only now because entity generation adds new sprites
-    World_GenSpritesBuffer();
-    Gui_DrawLoadScreen(700);
+        case WORLD_STAGE_AUTOEXEC:
+            // Process level autoexec loading.
+            World_AutoexecOpen();
+            break;
 
-    World_GenRoomProperties(tr);
-    Gui_DrawLoadScreen(750);
+        case WORLD_STAGE_FIX_ROOMS:
+            // Fix initial room states
+            World_FixRooms();
+            World_UpdateFlipCollisions();
+            break;
+    };
+}
 
-    World_GenRoomCollision();
-    Gui_DrawLoadScreen(800);
 
-    // Initialize audio.
-    Audio_GenSamples(tr);
-    Gui_DrawLoadScreen(850);
+static void World_LoadStageJob(void *data)
+{
+    world_load_task_p task = (world_load_task_p)data;
+    World_RunLoadStage(task->stage, task->tr);
+}
 
-    // Find and set skybox.
-    global_world.sky_box = World_GetSkybox();
-    Gui_DrawLoadScreen(860);
+/*
+ * Starts ready worker stages and collects finished ones.
+ * Returns not zero if some stage was finished.
+ */
+static int World_UpdateLoadStages(world_load_task_p tasks, uint32_t *finished, uint32_t *done_weight)
+{
+    int ret = 0;
+    int updated = 1;
 
-    // Generate entity functions.
-    for(const std::pair<uint32_t, entity_p> &it : global_world.entity_tree)
+    while(updated)
     {
-        World_SetEntityFunction(it.second);
+        updated = 0;
+        for(int i = 0; i < WORLD_STAGES_COUNT; i++)
+        {
+            const world_load_stage_t *stage = world_load_stages + i;
+            if(!(stage->flags & WORLD_STAGE_FLAG_WORKER) || (*finished & WORLD_STAGE_BIT(i)))
+            {
+                continue;
+            }
+
+            if(!tasks[i].started && ((stage->depends & *finished) == stage->depends))
+            {
+                tasks[i].started = 1;
+                Jobs_Add(&tasks[i].group, World_LoadStageJob, tasks + i);
+            }
+
+            if(tasks[i].started && Jobs_IsDone(&tasks[i].group))
+            {
+                *finished |= WORLD_STAGE_BIT(i);
+                *done_weight += stage->weight;
+                updated = 1;
+                ret = 1;
+            }
+        }
     }
-    Gui_DrawLoadScreen(910);
 
-    // Load entity collision flags and ID overrides from script.
+    return ret;
+}
 
-    Gui_DrawLoadScreen(940);
 
-    // Process level autoexec loading.
-    World_AutoexecOpen();
-    Gui_DrawLoadScreen(960);
+void World_Open(class VT_Level *tr)
+{
+    world_load_task_t tasks[WORLD_STAGES_COUNT];
+    uint32_t finished = 0;
+    uint32_t total_weight = 0;
+    uint32_t done_weight = 0;
 
-    // Fix initial room states
-    World_FixRooms();
-    World_UpdateFlipCollisions();
-    Gui_DrawLoadScreen(970);
+    World_Clear();
+
+    global_world.version = tr->game_version;
+
+    for(int i = 0; i < WORLD_STAGES_COUNT; i++)
+    {
+        tasks[i].tr = tr;
+        tasks[i].stage = i;
+        tasks[i].started = 0;
+        Jobs_InitGroup(&tasks[i].group);
+        total_weight += world_load_stages[i].weight;
+    }
+
+    for(int i = 0; i < WORLD_STAGES_COUNT; i++)
+    {
+        const world_load_stage_t *stage = world_load_stages + i;
+        if(stage->flags & WORLD_STAGE_FLAG_WORKER)
+        {
+            continue;
+        }
+
+        // Wait for dependencies, executing queued jobs meanwhile.
+        while(1)
+        {
+            if(World_UpdateLoadStages(tasks, &finished, &done_weight))
+            {
+                Gui_DrawLoadScreen(done_weight * 1000 / total_weight);
+            }
+            if((stage->depends & finished) == stage->depends)
+            {
+                break;
+            }
+
+            int j = 0;
+            for(; j < WORLD_STAGES_COUNT; j++)
+            {
+                if((stage->depends & ~finished & WORLD_STAGE_BIT(j)) && tasks[j].started)
+                {
+                    Jobs_Wait(&tasks[j].group);
+                    break;
+                }
+            }
+            if(j == WORLD_STAGES_COUNT)
+            {
+                Sys_extError("World_Open: stage %d depends on not started stages", i);
+            }
+        }
+
+        World_RunLoadStage(i, tr);
+        finished |= WORLD_STAGE_BIT(i);
+        done_weight += stage->weight;
+        Gui_DrawLoadScreen(done_weight * 1000 / total_weight);
+    }
+
+    for(int i = 0; i < WORLD_STAGES_COUNT; i++)
+    {
+        if(tasks[i].started)
+        {
+            Jobs_Wait(&tasks[i].group);
+        }
+    }
 
     if(global_world.tex_atlas)
     {
@@ -269,24 +526,52 @@ void World_Clear()
     global_world.Character = NULL;
 
     /* entity empty must be done before rooms destroy */
-    for(std::pair<const uint32_t, entity_p> &it : global_world.entity_tree)
+    for(uint32_t i = 0; i < global_world.entities_size; i++)
     {
-        Entity_Delete(it.second);
-        it.second = NULL;
+        if(global_world.entities[i].entity)
+        {
+            Entity_Delete(global_world.entities[i].entity);
+            global_world.entities[i].entity = NULL;
+        }
     }
-    global_world.entity_tree.clear();
+    free(global_world.entities);
+    global_world.entities = NULL;
+    global_world.entities_size = 0;
+    global_world.entities_count = 0;
 
     /* Now we can delete physics misc objects */
     Physics_CleanUpObjects();
+    World_ClearFlipTweens();                                                    // cached bodies may be linked from rooms contents
 
     for(uint32_t i = 0; i < global_world.rooms_count; i++)
     {
-        Room_Clear(global_world.rooms + i);
+        room_p r = global_world.rooms + i;
+        if(World_IsInRoomListsStorage(r->near_room_list))
+        {
+            r->near_room_list = NULL;                                           // shared storage, see World_GenRoomLists()
+        }
+        if(World_IsInRoomListsStorage(r->overlapped_room_list))
+        {
+            r->overlapped_room_list = NULL;
+        }
+        Room_Clear(r);
     }
+    free(global_world.room_lists);
+    global_world.room_lists = NULL;
+    global_world.room_lists_size = 0;
+    free(global_world.room_pvs);
+    global_world.room_pvs = NULL;
     global_world.rooms_count = 0;
     free(global_world.rooms);
     global_world.rooms = NULL;
 
+    free(global_world.room_grid_offsets);
+    free(global_world.room_grid_rooms);
+    global_world.room_grid_offsets = NULL;
+    global_world.room_grid_rooms = NULL;
+    global_world.room_grid_size[0] = 0;
+    global_world.room_grid_size[1] = 0;
+
     if(global_world.flip_count)
     {
         global_world.flip_count = 0;
@@ -440,20 +725,23 @@ uint32_t World_SpawnEntity(uint32_t model_id, uint32_t room_id, float pos[3], fl
             return entity->id;
         }
 
-        entity = Entity_Create();
         if(id < 0)
         {
-            entity->id = 0;
-            if(!global_world.entity_tree.empty())
+            id = global_world.entities_size;
+            while((id > 0) && (global_world.entities[id - 1].entity == NULL))
             {
-                entity->id = global_world.entity_tree.rbegin()->first + 1;
+                id--;
             }
         }
-        else
+        if(id >= WORLD_ENTITIES_MAX)
         {
-            entity->id = id;
+            Con_Warning("can not spawn entity with id = %d", id);
+            return ENTITY_ID_NONE;
         }
 
+        entity = Entity_Create();
+        entity->id = id;
+
         if(pos != NULL)
         {
             vec3_copy(entity->transform + 12, pos);
@@ -496,7 +784,11 @@ uint32_t World_SpawnEntity(uint32_t model_id, uint32_t room_id, float pos[3], fl
         {
             Room_AddObject(entity->self->room, entity->self);
         }
-        World_AddEntity(entity);
+        if(!World_AddEntity(entity))
+        {
+            Entity_Delete(entity);
+            return ENTITY_ID_NONE;
+        }
         World_MakeEntityPickable(entity);
 
         return entity->id;
@@ -508,15 +800,39 @@ uint32_t World_SpawnEntity(uint32_t model_id, uint32_t room_id, float pos[3], fl
 
 struct entity_s *World_GetEntityByID(uint32_t id)
 {
-    entity_p ent = NULL;
-    std::map<uint32_t, entity_p>::iterator it = global_world.entity_tree.find(id);
+    return (id < global_world.entities_size) ? (global_world.entities[id].entity) : (NULL);
+}
+
 
-    if(it != global_world.entity_tree.end())
+uint32_t World_GetEntityHandle(struct entity_s *entity)
+{
+    if(entity && (entity->id < global_world.entities_size) && (global_world.entities[entity->id].entity == entity))
     {
-        ent = it->second;
+        return ((global_world.entities[entity->id].generation & WORLD_ENTITY_HANDLE_GEN_MASK) << WORLD_ENTITY_HANDLE_ID_BITS) | entity->id;
     }
 
-    return ent;
+    return ENTITY_ID_NONE;
+}
+
+
+struct entity_s *World_GetEntityByHandle(uint32_t handle)
+{
+    uint32_t id = handle & (WORLD_ENTITIES_MAX - 1);
+    uint32_t generation = handle >> WORLD_ENTITY_HANDLE_ID_BITS;
+
+    if((handle != ENTITY_ID_NONE) && (id < global_world.entities_size) &&
+       ((global_world.entities[id].generation & WORLD_ENTITY_HANDLE_GEN_MASK) == generation))
+    {
+        return global_world.entities[id].entity;
+    }
+
+    return NULL;
+}
+
+
+uint32_t World_GetEntitiesCount()
+{
+    return global_world.entities_count;
 }
 
 
@@ -545,11 +861,12 @@ struct entity_s *World_GetPlayer()
 
 void World_IterateAllEntities(int (*iterator)(struct entity_s *ent, void *data), void *data)
 {
-    for(std::pair<const uint32_t, entity_p> &it : global_world.entity_tree)
+    entity_slot_p slot = global_world.entities;
+    for(uint32_t i = 0; i < global_world.entities_size; i++, slot++)
     {
-        if(iterator(it.second, data))
+        if(slot->entity && iterator(slot->entity, data))
         {
-            break;;
+            break;
         }
     }
 }
@@ -645,9 +962,41 @@ int World_AddAnimSeq(struct anim_seq_s *seq)
 }
 
 
+/*
+ * Returns 0 if id is out of table range or slot is taken by other entity;
+ * entity is not added then and stays owned by the caller.
+ */
 int World_AddEntity(struct entity_s *entity)
 {
-    global_world.entity_tree[entity->id] = entity;
+    if(entity->id >= WORLD_ENTITIES_MAX)
+    {
+        Con_Warning("entity id = %d is out of range", entity->id);
+        return 0;
+    }
+    if((entity->id < global_world.entities_size) && global_world.entities[entity->id].entity &&
+       (global_world.entities[entity->id].entity != entity))
+    {
+        Con_Warning("entity id = %d is already used", entity->id);
+        return 0;
+    }
+
+    if(entity->id >= global_world.entities_size)
+    {
+        uint32_t new_size = (global_world.entities_size > 0) ? (global_world.entities_size) : (64);
+        while(new_size <= entity->id)
+        {
+            new_size *= 2;
+        }
+        global_world.entities = (entity_slot_p)realloc(global_world.entities, new_size * sizeof(entity_slot_t));
+        memset(global_world.entities + global_world.entities_size, 0, (new_size - global_world.entities_size) * sizeof(entity_slot_t));
+        global_world.entities_size = new_size;
+    }
+
+    if(global_world.entities[entity->id].entity == NULL)
+    {
+        global_world.entities_count++;
+    }
+    global_world.entities[entity->id].entity = entity;
 
     return 1;
 }
@@ -655,7 +1004,12 @@ int World_AddEntity(struct entity_s *entity)
 
 int World_DeleteEntity(struct entity_s *entity)
 {
-    global_world.entity_tree.erase(entity->id);
+    if((entity->id < global_world.entities_size) && (global_world.entities[entity->id].entity == entity))
+    {
+        global_world.entities[entity->id].entity = NULL;
+        global_world.entities[entity->id].generation++;                         // invalidate old handles
+        global_world.entities_count--;
+    }
     Entity_Delete(entity);
 
     return 1;
@@ -785,23 +1139,70 @@ struct room_s *World_GetRoomByID(uint32_t id)
 }
 
 
-struct room_s *World_FindRoomByPos(float pos[3])
+static room_p World_CheckRoomByPos(room_p r, float pos[3])
 {
     const float z_margin = TR_METERING_SECTORSIZE / 2.0f;
+    if((r == r->real_room) &&
+       (pos[0] >= r->bb_min[0]) && (pos[0] < r->bb_max[0]) &&
+       (pos[1] >= r->bb_min[1]) && (pos[1] < r->bb_max[1]) &&
+       (pos[2] >= r->bb_min[2] - z_margin) && (pos[2] < r->bb_max[2]))
+    {
+        room_sector_p orig_sector = Room_GetSectorRaw(r->real_room, pos);
+        if(orig_sector && orig_sector->portal_to_room)
+        {
+            return orig_sector->portal_to_room->real_room;
+        }
+        return r->real_room;
+    }
+    return NULL;
+}
+
+
+static room_p World_FindRoomByPosLinear(float pos[3])
+{
     room_p r = global_world.rooms;
     for(uint32_t i = 0; i < global_world.rooms_count; i++, r++)
     {
-        if((r == r->real_room) &&
-           (pos[0] >= r->bb_min[0]) && (pos[0] < r->bb_max[0]) &&
-           (pos[1] >= r->bb_min[1]) && (pos[1] < r->bb_max[1]) &&
-           (pos[2] >= r->bb_min[2] - z_margin) && (pos[2] < r->bb_max[2]))
+        room_p ret = World_CheckRoomByPos(r, pos);
+        if(ret)
         {
-            room_sector_p orig_sector = Room_GetSectorRaw(r->real_room, pos);
-            if(orig_sector && orig_sector->portal_to_room)
-            {
-                return orig_sector->portal_to_room->real_room;
-            }
-            return r->real_room;
+            return ret;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Grid cell holds rooms in ascending order, so result is the same as in
+ * linear search. Real rooms are checked at query time, so grid stays valid
+ * after flips.
+ */
+struct room_s *World_FindRoomByPos(float pos[3])
+{
+    if(global_world.room_grid_offsets == NULL)
+    {
+        return World_FindRoomByPosLinear(pos);                                  // rooms are still loading
+    }
+
+    if((pos[0] < global_world.room_grid_min[0]) || (pos[1] < global_world.room_grid_min[1]))
+    {
+        return NULL;
+    }
+
+    uint32_t x = (pos[0] - global_world.room_grid_min[0]) / TR_METERING_SECTORSIZE;
+    uint32_t y = (pos[1] - global_world.room_grid_min[1]) / TR_METERING_SECTORSIZE;
+    if((x >= global_world.room_grid_size[0]) || (y >= global_world.room_grid_size[1]))
+    {
+        return NULL;
+    }
+
+    uint32_t cell = x * global_world.room_grid_size[1] + y;
+    for(uint32_t i = global_world.room_grid_offsets[cell]; i < global_world.room_grid_offsets[cell + 1]; i++)
+    {
+        room_p ret = World_CheckRoomByPos(global_world.rooms + global_world.room_grid_rooms[i], pos);
+        if(ret)
+        {
+            return ret;
         }
     }
     return NULL;
@@ -816,25 +1217,25 @@ struct room_s *World_FindRoomByPosCogerrence(float pos[3], struct room_s *old_ro
     }
 
     old_room = old_room->real_room;
-    room_sector_p orig_sector = Room_GetSectorRaw(old_room, pos);
-    if(orig_sector && orig_sector->portal_to_room)
+    int index = Room_GetSectorIndex(old_room, pos);
+    if(index >= 0)
     {
-        return orig_sector->portal_to_room->real_room;
-    }
-
-    if(orig_sector)
-    {
-        if(orig_sector->room_below && (pos[2] < orig_sector->room_below->bb_max[2]))
+        room_sector_hot_p hs = old_room->sectors_hot + index;
+        if(hs->portal_to_room != ROOM_INDEX_NONE)
         {
-            return orig_sector->room_below->real_room;
+            return World_GetRoomByID(hs->portal_to_room)->real_room;
+        }
+        else if((hs->room_below != ROOM_INDEX_NONE) && (pos[2] < World_GetRoomByID(hs->room_below)->bb_max[2]))
+        {
+            return World_GetRoomByID(hs->room_below)->real_room;
         }
         else if((pos[2] >= old_room->bb_min[2]) && (pos[2] < old_room->bb_max[2]))
         {
             return old_room;
         }
-        else if(orig_sector->room_above && (pos[2] >= orig_sector->room_above->bb_min[2]))
+        else if((hs->room_above != ROOM_INDEX_NONE) && (pos[2] >= World_GetRoomByID(hs->room_above)->bb_min[2]))
         {
-            return orig_sector->room_above->real_room;
+            return World_GetRoomByID(hs->room_above)->real_room;
         }
     }
 
@@ -854,6 +1255,227 @@ struct room_s *World_FindRoomByPosCogerrence(float pos[3], struct room_s *old_ro
 }
 
 
+void World_BenchFindRoomByPos(uint32_t count)
+{
+    float bb_min[3], bb_max[3], *points;
+    uint32_t mismatches = 0;
+    float time_linear, time_grid;
+    room_p r = global_world.rooms;
+
+    if((global_world.rooms_count == 0) || (count == 0))
+    {
+        return;
+    }
+
+    vec3_copy(bb_min, r->bb_min);
+    vec3_copy(bb_max, r->bb_max);
+    for(uint32_t i = 1; i < global_world.rooms_count; i++)
+    {
+        r = global_world.rooms + i;
+        bb_min[0] = (r->bb_min[0] < bb_min[0]) ? (r->bb_min[0]) : (bb_min[0]);
+        bb_min[1] = (r->bb_min[1] < bb_min[1]) ? (r->bb_min[1]) : (bb_min[1]);
+        bb_min[2] = (r->bb_min[2] < bb_min[2]) ? (r->bb_min[2]) : (bb_min[2]);
+        bb_max[0] = (r->bb_max[0] > bb_max[0]) ? (r->bb_max[0]) : (bb_max[0]);
+        bb_max[1] = (r->bb_max[1] > bb_max[1]) ? (r->bb_max[1]) : (bb_max[1]);
+        bb_max[2] = (r->bb_max[2] > bb_max[2]) ? (r->bb_max[2]) : (bb_max[2]);
+    }
+
+    points = (float*)malloc(3 * count * sizeof(float));
+    for(uint32_t i = 0; i < 3 * count; i++)
+    {
+        float t = (float)rand() / (float)RAND_MAX;
+        points[i] = bb_min[i % 3] + t * (bb_max[i % 3] - bb_min[i % 3]);
+    }
+
+    time_linear = Sys_FloatTime();
+    for(uint32_t i = 0; i < count; i++)
+    {
+        World_FindRoomByPosLinear(points + 3 * i);
+    }
+    time_linear = Sys_FloatTime() - time_linear;
+
+    time_grid = Sys_FloatTime();
+    for(uint32_t i = 0; i < count; i++)
+    {
+        World_FindRoomByPos(points + 3 * i);
+    }
+    time_grid = Sys_FloatTime() - time_grid;
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        mismatches += (World_FindRoomByPosLinear(points + 3 * i) != World_FindRoomByPos(points + 3 * i));
+    }
+    free(points);
+
+    Engine_BenchReport("bench_find_room", "linear %.3f us, grid %.3f us, %d queries, %d mismatches",
+                       Engine_BenchUs(time_linear, count), Engine_BenchUs(time_grid, count), count, mismatches);
+}
+
+
+static int World_BenchHeightsCompare(collision_result_p a, collision_result_p b)
+{
+    if(a->hit != b->hit)
+    {
+        return 1;
+    }
+    return a->hit && ((fabs(a->point[2] - b->point[2]) > 1.0f) || (vec3_dot(a->normale, b->normale) < 0.99f));
+}
+
+/*
+ * Validation of analytic heights: random points inside active rooms are
+ * sampled by sectors data and by floor / ceiling rays (as from a character
+ * standing in the found room), results of the analytic path are compared.
+ */
+void World_BenchHeights(uint32_t count)
+{
+    float *points, time_sample, time_rays, from[3], to[3];
+    room_p *rooms;
+    collision_result_p results;
+    uint8_t *sampled;
+    engine_container_t cont;
+    uint32_t samples = 0, valid = 0, floor_mismatches = 0, ceiling_mismatches = 0;
+
+    if((global_world.rooms_count == 0) || (count == 0))
+    {
+        return;
+    }
+
+    points = (float*)malloc(3 * count * sizeof(float));
+    rooms = (room_p*)malloc(count * sizeof(room_p));
+    results = (collision_result_p)malloc(4 * count * sizeof(collision_result_t));
+    sampled = (uint8_t*)malloc(count * sizeof(uint8_t));
+    for(uint32_t i = 0; i < count; i++)
+    {
+        room_p r = global_world.rooms + (rand() % global_world.rooms_count);
+        float *p = points + 3 * i;
+        for(int k = 0; k < 3; k++)
+        {
+            float t = (float)rand() / (float)RAND_MAX;
+            p[k] = r->real_room->bb_min[k] + t * (r->real_room->bb_max[k] - r->real_room->bb_min[k]);
+        }
+        rooms[i] = World_FindRoomByPos(p);
+    }
+
+    memset(&cont, 0, sizeof(cont));
+    time_sample = Sys_FloatTime();
+    for(uint32_t i = 0; i < count; i++)
+    {
+        cont.room = rooms[i];
+        sampled[i] = Room_SampleHeights(rooms[i], points + 3 * i, &cont, COLLISION_FILTER_HEIGHT_TEST,
+                                        results + 4 * i + 0, 8192.0f, results + 4 * i + 1, 4096.0f);
+    }
+    time_sample = Sys_FloatTime() - time_sample;
+
+    time_rays = Sys_FloatTime();
+    for(uint32_t i = 0; i < count; i++)
+    {
+        cont.room = rooms[i];
+        vec3_copy(from, points + 3 * i);
+        vec3_copy(to, from);
+        to[2] -= 8192.0f;
+        Physics_RayTest(results + 4 * i + 2, from, to, &cont, COLLISION_FILTER_HEIGHT_TEST);
+        to[2] = from[2] + 4096.0f;
+        Physics_RayTest(results + 4 * i + 3, from, to, &cont, COLLISION_FILTER_HEIGHT_TEST);
+    }
+    time_rays = Sys_FloatTime() - time_rays;
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        valid += (rooms[i] != NULL);
+        if(sampled[i])
+        {
+            collision_result_p res = results + 4 * i;
+            samples++;
+            floor_mismatches += World_BenchHeightsCompare(res + 0, res + 2);
+            ceiling_mismatches += World_BenchHeightsCompare(res + 1, res + 3);
+        }
+    }
+
+    free(sampled);
+    free(results);
+    free(rooms);
+    free(points);
+
+    Engine_BenchReport("bench_heights", "sectors %.3f us, rays %.3f us, %d points (%d in rooms, %d sampled), mismatches floor %d / ceiling %d",
+                       Engine_BenchUs(time_sample, count), Engine_BenchUs(time_rays, count), count, valid, samples, floor_mismatches, ceiling_mismatches);
+}
+
+
+static int World_BenchEntitiesIterator(struct entity_s *ent, void *data)
+{
+    *((uint32_t*)data) += ent->id;
+    return 0;
+}
+
+void World_BenchEntities(uint32_t count)
+{
+    std::map<uint32_t, entity_p> tree;                                          // old entities storage, for reference
+    uint32_t *ids, sum_tree = 0, sum_table = 0, mismatches = 0;
+    uint32_t iterations = count / 100 + 1;
+    float time_tree_find, time_table_find, time_tree_iter, time_table_iter;
+
+    if((global_world.entities_count == 0) || (count == 0))
+    {
+        return;
+    }
+
+    for(uint32_t i = 0; i < global_world.entities_size; i++)
+    {
+        if(global_world.entities[i].entity)
+        {
+            tree[i] = global_world.entities[i].entity;
+        }
+    }
+
+    ids = (uint32_t*)malloc(count * sizeof(uint32_t));
+    for(uint32_t i = 0; i < count; i++)
+    {
+        ids[i] = rand() % (global_world.entities_size + 1);                     // some misses too
+    }
+
+    time_tree_find = Sys_FloatTime();
+    for(uint32_t i = 0; i < count; i++)
+    {
+        std::map<uint32_t, entity_p>::iterator it = tree.find(ids[i]);
+        sum_tree += (it != tree.end()) ? (it->second->id) : (0);
+    }
+    time_tree_find = Sys_FloatTime() - time_tree_find;
+
+    time_table_find = Sys_FloatTime();
+    for(uint32_t i = 0; i < count; i++)
+    {
+        entity_p ent = World_GetEntityByID(ids[i]);
+        sum_table += (ent) ? (ent->id) : (0);
+    }
+    time_table_find = Sys_FloatTime() - time_table_find;
+    mismatches += (sum_tree != sum_table);
+
+    time_tree_iter = Sys_FloatTime();
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        for(std::pair<const uint32_t, entity_p> &it : tree)
+        {
+            sum_tree += it.second->id;
+        }
+    }
+    time_tree_iter = Sys_FloatTime() - time_tree_iter;
+
+    time_table_iter = Sys_FloatTime();
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        World_IterateAllEntities(World_BenchEntitiesIterator, &sum_table);
+    }
+    time_table_iter = Sys_FloatTime() - time_table_iter;
+    mismatches += (sum_tree != sum_table);
+    free(ids);
+
+    Engine_BenchReport("bench_entities", "find map %.3f us, table %.3f us; iterate map %.3f us, table %.3f us; %d entities, %d mismatches",
+                       Engine_BenchUs(time_tree_find, count), Engine_BenchUs(time_table_find, count),
+                       Engine_BenchUs(time_tree_iter, iterations), Engine_BenchUs(time_table_iter, iterations),
+                       global_world.entities_count, mismatches);
+}
+
+
 struct room_sector_s *World_GetRoomSector(int room_id, int x, int y)
 {
     if((room_id >= 0) && ((uint32_t)room_id < global_world.rooms_count))
@@ -869,112 +1491,581 @@ struct room_sector_s *World_GetRoomSector(int room_id, int x, int y)
 }
 
 
-void World_BuildNearRoomsList(struct room_s *room)
+int World_IsInRoomListsStorage(struct room_s **list)
 {
-    room->near_room_list_size = 0;
-    room->near_room_list = (room_t**)Sys_GetTempMem(global_world.rooms_count * sizeof(room_t*));
+    return list && global_world.room_lists && (list >= global_world.room_lists) &&
+           (list < global_world.room_lists + global_world.room_lists_size);
+}
+
+
+void World_AddToOverlappedRoomsList(struct room_s *room, struct room_s *r)
+{
+    room_p *list = (room_p*)malloc((room->overlapped_room_list_size + 1) * sizeof(room_p));
+    if(room->overlapped_room_list_size > 0)
+    {
+        memcpy(list, room->overlapped_room_list, room->overlapped_room_list_size * sizeof(room_p));
+    }
+    list[room->overlapped_room_list_size] = r->real_room;
+
+    if(room->overlapped_room_list && !World_IsInRoomListsStorage(room->overlapped_room_list))
+    {
+        free(room->overlapped_room_list);
+    }
+    room->overlapped_room_list = list;
+    room->overlapped_room_list_size++;
+}
+
+
+static int World_CompareRoomsByMinX(const void *p1, const void *p2)
+{
+    const room_p r1 = global_world.rooms + *((const uint32_t*)p1);
+    const room_p r2 = global_world.rooms + *((const uint32_t*)p2);
+    if(r1->bb_min[0] != r2->bb_min[0])
+    {
+        return (r1->bb_min[0] < r2->bb_min[0]) ? (-1) : (1);
+    }
+    return (r1 < r2) ? (-1) : ((r1 > r2) ? (1) : (0));
+}
+
+
+static int World_CompareRoomPairs(const void *p1, const void *p2)
+{
+    const uint32_t *a = (const uint32_t*)p1;
+    const uint32_t *b = (const uint32_t*)p2;
+    if(a[0] != b[0])
+    {
+        return (a[0] < b[0]) ? (-1) : (1);
+    }
+    return (a[1] < b[1]) ? (-1) : ((a[1] > b[1]) ? (1) : (0));
+}
+
+/**
+ * Builds overlapped and near rooms lists for all rooms at once.
+ * Overlapping candidates are found by sweep and prune along X axis (the
+ * same margin as in Room_IsOverlapped), so only rooms with crossing X
+ * ranges are checked. Lists of all rooms are stored in one array in CSR
+ * way: [room 0 overlapped][room 0 near][room 1 overlapped][room 1 near]...
+ * Room_DoFlip swaps pointers to the storage; lists grown by scripts are
+ * separate allocations (see World_AddToOverlappedRoomsList()).
+ */
+void World_GenRoomLists()
+{
+    const float margin = TR_METERING_SECTORSIZE * 2;
+    uint32_t rooms_count = global_world.rooms_count;
+    uint32_t *order, *active, active_count = 0;
+    uint32_t *pairs = NULL, pairs_count = 0, pairs_allocated = 0;
+    room_p *overlapped, *near_rooms = NULL, *near_buf;
+    uint32_t near_count = 0, near_allocated = 0, *near_offsets;
+
+    if(rooms_count == 0)
+    {
+        return;
+    }
+
+    global_world.room_lists = WorldCache_GetRoomLists(global_world.rooms, rooms_count, &global_world.room_lists_size);
+    if(global_world.room_lists)
+    {
+        return;
+    }
+
+    // Overlapped rooms: relation is symmetric, so every pair is checked once.
+    order = (uint32_t*)malloc(rooms_count * sizeof(uint32_t));
+    active = (uint32_t*)malloc(rooms_count * sizeof(uint32_t));
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        order[i] = i;
+    }
+    qsort(order, rooms_count, sizeof(uint32_t), World_CompareRoomsByMinX);
+
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        room_p r = global_world.rooms + order[i];
+        uint32_t k = 0;
+        for(uint32_t j = 0; j < active_count; j++)
+        {
+            room_p a = global_world.rooms + active[j];
+            if(a->bb_max[0] - margin > r->bb_min[0])
+            {
+                active[k++] = active[j];
+                if(Room_IsOverlapped(r, a))
+                {
+                    if(pairs_count + 2 > pairs_allocated)
+                    {
+                        pairs_allocated = (pairs_allocated > 0) ? (2 * pairs_allocated) : (256);
+                        pairs = (uint32_t*)realloc(pairs, 2 * pairs_allocated * sizeof(uint32_t));
+                    }
+                    pairs[2 * pairs_count + 0] = order[i];
+                    pairs[2 * pairs_count + 1] = active[j];
+                    pairs_count++;
+                    pairs[2 * pairs_count + 0] = active[j];
+                    pairs[2 * pairs_count + 1] = order[i];
+                    pairs_count++;
+                }
+            }
+        }
+        active_count = k;
+        active[active_count++] = order[i];
+    }
+    free(order);
+    free(active);
 
-    room_sector_p rs = room->sectors;
-    for(uint32_t i = 0; i < room->sectors_count; i++, rs++)
+    qsort(pairs, pairs_count, 2 * sizeof(uint32_t), World_CompareRoomPairs);
+    overlapped = (room_p*)malloc((pairs_count + 1) * sizeof(room_p));
+    for(uint32_t i = 0, j = 0; i < rooms_count; i++)
     {
-        if(rs->portal_to_room)
+        room_p r = global_world.rooms + i;
+        r->overlapped_room_list = overlapped + j;
+        r->overlapped_room_list_size = 0;
+        for(; (j < pairs_count) && (pairs[2 * j] == i); j++)
         {
-            Room_AddToNearRoomsList(room, rs->portal_to_room->real_room);
+            overlapped[j] = global_world.rooms + pairs[2 * j + 1];
+            r->overlapped_room_list_size++;
         }
+    }
+    free(pairs);
+
+    // Near rooms: linked by portals and floor / ceiling holes.
+    near_buf = (room_p*)malloc(rooms_count * sizeof(room_p));
+    near_offsets = (uint32_t*)malloc((rooms_count + 1) * sizeof(uint32_t));
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        room_p room = global_world.rooms + i;
+        room->near_room_list = near_buf;
+        room->near_room_list_size = 0;
 
-        if(rs->room_above)
+        room_sector_p rs = room->sectors;
+        for(uint32_t j = 0; j < room->sectors_count; j++, rs++)
         {
-            Room_AddToNearRoomsList(room, rs->room_above->real_room);
+            if(rs->portal_to_room)
+            {
+                Room_AddToNearRoomsList(room, rs->portal_to_room->real_room);
+            }
+
+            if(rs->room_above)
+            {
+                Room_AddToNearRoomsList(room, rs->room_above->real_room);
+            }
+
+            if(rs->room_below)
+            {
+                Room_AddToNearRoomsList(room, rs->room_below->real_room);
+            }
         }
 
-        if(rs->room_below)
+        if(near_count + room->near_room_list_size > near_allocated)
         {
-            Room_AddToNearRoomsList(room, rs->room_below->real_room);
+            near_allocated = 2 * near_allocated + room->near_room_list_size;
+            near_rooms = (room_p*)realloc(near_rooms, near_allocated * sizeof(room_p));
         }
+        memcpy(near_rooms + near_count, near_buf, room->near_room_list_size * sizeof(room_p));
+        near_offsets[i] = near_count;
+        near_count += room->near_room_list_size;
     }
+    free(near_buf);
 
-    if(room->near_room_list_size > 0)
+    // Pack both lists to the final storage.
+    global_world.room_lists_size = pairs_count + near_count;
+    global_world.room_lists = (room_p*)malloc((global_world.room_lists_size + 1) * sizeof(room_p));
+    room_p *storage = global_world.room_lists;
+    for(uint32_t i = 0; i < rooms_count; i++)
     {
-        room_t **p = (room_t**)malloc(room->near_room_list_size * sizeof(room_t*));
-        memcpy(p, room->near_room_list, room->near_room_list_size * sizeof(room_t*));
-        room->near_room_list = p;
+        room_p room = global_world.rooms + i;
+        memcpy(storage, room->overlapped_room_list, room->overlapped_room_list_size * sizeof(room_p));
+        room->overlapped_room_list = (room->overlapped_room_list_size > 0) ? (storage) : (NULL);
+        storage += room->overlapped_room_list_size;
+
+        memcpy(storage, near_rooms + near_offsets[i], room->near_room_list_size * sizeof(room_p));
+        room->near_room_list = (room->near_room_list_size > 0) ? (storage) : (NULL);
+        storage += room->near_room_list_size;
     }
-    else
+    free(overlapped);
+    free(near_rooms);
+    free(near_offsets);
+
+    WorldCache_PutRoomLists(global_world.rooms, rooms_count);
+}
+
+/*
+ * WORLD  TRIGGERING  FUNCTIONS
+ */
+
+/*
+ * Dynamic tweens of the real room depend on its own sectors and on sectors
+ * of rooms, which its portal sectors lead to. So after flip only real rooms,
+ * which depend on flipped ones, are rebuilt. Built bodies are kept per room
+ * with contents of the dependency rooms as a key, so flipping back to the
+ * known state only swaps bodies. Rooms without flippable dependencies never
+ * have dynamic tweens and are skipped.
+ */
+#define WORLD_FLIP_TWEENS_CACHE_SIZE        (2)
+
+#define WORLD_FLIP_COLLISIONS_FULL          (0)                                 // rebuild tweens of all rooms
+#define WORLD_FLIP_COLLISIONS_INCREMENTAL   (1)                                 // rebuild rooms, which depend on flipped
+#define WORLD_FLIP_COLLISIONS_CACHED        (2)                                 // and reuse bodies of known states
+
+typedef struct flip_tweens_entry_s
+{
+    struct physics_object_s    *body;                                           // NULL if room has no tweens in this state
+    struct room_content_s      *owner;                                          // content, which physics_alt_tween is the body
+    struct room_content_s     **key;                                            // dependency rooms contents
+    uint32_t                    last_use;                                       // 0 - empty entry
+}flip_tweens_entry_t, *flip_tweens_entry_p;
+
+typedef struct flip_tweens_s
+{
+    uint32_t                    deps_count;
+    uint32_t                   *deps;                                           // real rooms indexes, the room itself is first
+    flip_tweens_entry_t         entries[WORLD_FLIP_TWEENS_CACHE_SIZE];
+}flip_tweens_t, *flip_tweens_p;
+
+static int      flip_collisions_mode = WORLD_FLIP_COLLISIONS_CACHED;
+static uint32_t flip_last_rebuilt = 0;
+static uint32_t flip_last_swapped = 0;
+static float    flip_last_time = 0.0f;
+
+
+static struct physics_object_s *World_GenFlipTweensBody(room_p r)
+{
+    struct physics_object_s *ret = NULL;
+    int num_tweens = r->sectors_count * 4;
+    size_t buff_size = num_tweens * sizeof(sector_tween_t);
+    sector_tween_p room_tween = (sector_tween_p)Sys_GetTempMem(buff_size);
+
+    // Clear tween array.
+    for(int j = 0; j < num_tweens; j++)
     {
-        room->near_room_list = NULL;
+        room_tween[j].ceiling_tween_type = TR_SECTOR_TWEEN_TYPE_NONE;
+        room_tween[j].floor_tween_type   = TR_SECTOR_TWEEN_TYPE_NONE;
     }
-    Sys_ReturnTempMem(global_world.rooms_count * sizeof(room_t*));
+
+    // Most difficult task with converting floordata collision to trimesh collision is
+    // building inbetween polygons which will block out gaps between sector heights.
+    num_tweens = Res_Sector_GenDynamicTweens(r, room_tween);
+    if(num_tweens > 0)
+    {
+        ret = Physics_GenRoomRigidBody(r, NULL, 0, room_tween, num_tweens);
+    }
+
+    Sys_ReturnTempMem(buff_size);
+    return ret;
 }
 
 
-void World_BuildOverlappedRoomsList(struct room_s *room)
+static inline bool World_IsFlippable(room_p r)
 {
-    room->overlapped_room_list_size = 0;
-    room->overlapped_room_list = (room_t**)Sys_GetTempMem(global_world.rooms_count * sizeof(room_t*));
+    return r->alternate_room_next || r->alternate_room_prev;
+}
 
-    for(uint32_t i = 0; i < global_world.rooms_count; i++)
+
+static void World_GenFlipTweensDeps()
+{
+    uint32_t rooms_count = global_world.rooms_count;
+    uint32_t *deps = (uint32_t*)Sys_GetTempMem(rooms_count * sizeof(uint32_t));
+
+    global_world.flip_tweens = (flip_tweens_p)calloc(rooms_count, sizeof(flip_tweens_t));
+    global_world.flip_changed = (uint8_t*)calloc(rooms_count, sizeof(uint8_t));
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        room_p r = global_world.rooms + i;
+        flip_tweens_p ft = global_world.flip_tweens + i;
+        uint32_t deps_count = 1;
+        bool flippable = World_IsFlippable(r);
+
+        if(r->real_room != r)
+        {
+            continue;
+        }
+
+        // sectors are swapped inside the alternate rooms group, so all the group sectors are checked
+        deps[0] = i;
+        for(uint32_t j = 0; j < rooms_count; j++)
+        {
+            room_p alt = global_world.rooms + j;
+            if(alt->real_room != r)
+            {
+                continue;
+            }
+            for(uint32_t k = 0; k < alt->sectors_count; k++)
+            {
+                room_p target = alt->sectors[k].portal_to_room;
+                uint32_t index, d;
+                if(!target)
+                {
+                    continue;
+                }
+                target = target->real_room;
+                index = target - global_world.rooms;
+                for(d = 0; (d < deps_count) && (deps[d] != index); d++);
+                if(d == deps_count)
+                {
+                    deps[deps_count++] = index;
+                    flippable |= World_IsFlippable(target);
+                }
+            }
+        }
+
+        if(flippable)
+        {
+            ft->deps_count = deps_count;
+            ft->deps = (uint32_t*)malloc(deps_count * sizeof(uint32_t));
+            memcpy(ft->deps, deps, deps_count * sizeof(uint32_t));
+            for(int e = 0; e < WORLD_FLIP_TWEENS_CACHE_SIZE; e++)
+            {
+                ft->entries[e].key = (room_content_p*)malloc(deps_count * sizeof(room_content_p));
+            }
+        }
+        global_world.flip_changed[i] = 0x01;
+    }
+
+    Sys_ReturnTempMem(rooms_count * sizeof(uint32_t));
+}
+
+
+static void World_DeleteFlipTweensEntry(flip_tweens_entry_p e)
+{
+    if(e->owner && (e->owner->physics_alt_tween == e->body))
+    {
+        e->owner->physics_alt_tween = NULL;
+    }
+    Physics_DeleteObject(e->body);
+    e->body = NULL;
+    e->owner = NULL;
+    e->last_use = 0;
+}
+
+
+static void World_ClearFlipTweensCache()
+{
+    if(global_world.flip_tweens)
     {
-        if(Room_IsOverlapped(room, global_world.rooms + i))
+        for(uint32_t i = 0; i < global_world.rooms_count; i++)
         {
-            room->overlapped_room_list[room->overlapped_room_list_size] = global_world.rooms + i;
-            room->overlapped_room_list_size++;
+            flip_tweens_p ft = global_world.flip_tweens + i;
+            for(int e = 0; (e < WORLD_FLIP_TWEENS_CACHE_SIZE) && ft->deps_count; e++)
+            {
+                World_DeleteFlipTweensEntry(ft->entries + e);
+            }
         }
     }
+}
 
-    if(room->overlapped_room_list_size > 0)
+
+void World_ClearFlipTweens()
+{
+    World_ClearFlipTweensCache();
+    if(global_world.flip_tweens)
     {
-        room_t **p = (room_t**)malloc(room->overlapped_room_list_size * sizeof(room_t*));
-        memcpy(p, room->overlapped_room_list, room->overlapped_room_list_size * sizeof(room_t*));
-        room->overlapped_room_list = p;
+        for(uint32_t i = 0; i < global_world.rooms_count; i++)
+        {
+            flip_tweens_p ft = global_world.flip_tweens + i;
+            free(ft->deps);
+            for(int e = 0; e < WORLD_FLIP_TWEENS_CACHE_SIZE; e++)
+            {
+                free(ft->entries[e].key);
+            }
+        }
+        free(global_world.flip_tweens);
+        global_world.flip_tweens = NULL;
     }
-    else
+    free(global_world.flip_changed);
+    global_world.flip_changed = NULL;
+}
+
+
+static void World_MarkFlipChanged(room_p r)
+{
+    if(global_world.flip_changed)
     {
-        room->overlapped_room_list = NULL;
+        global_world.flip_changed[r->real_room - global_world.rooms] = 0x01;
     }
-    Sys_ReturnTempMem(global_world.rooms_count * sizeof(room_t*));
 }
 
+
 /*
- * WORLD  TRIGGERING  FUNCTIONS
+ * Returns 1 if cached body was reused, 0 if tweens were rebuilt.
  */
-
-void World_UpdateFlipCollisions()
+static int World_UpdateRoomFlipTweens(room_p r, flip_tweens_p ft, bool use_cache)
 {
-    room_p r = global_world.rooms;
-    for(uint32_t i = 0; i < global_world.rooms_count; ++i, ++r)
+    flip_tweens_entry_p hit = NULL;
+    flip_tweens_entry_p victim = ft->entries;
+    bool reused;
+
+    // unlink bodies of the previous state, content may be already moved to the alternate room
+    for(int e = 0; e < WORLD_FLIP_TWEENS_CACHE_SIZE; e++)
     {
-        if(r->real_room == r)
+        flip_tweens_entry_p entry = ft->entries + e;
+        if(entry->owner && (entry->owner->physics_alt_tween == entry->body))
         {
-            int num_tweens = r->sectors_count * 4;
-            size_t buff_size = num_tweens * sizeof(sector_tween_t);
-            sector_tween_p room_tween = (sector_tween_p)Sys_GetTempMem(buff_size);
-
-            // Clear previous dynamic tweens
-            Physics_DeleteObject(r->content->physics_alt_tween);
-            r->content->physics_alt_tween = NULL;
+            Physics_DisableObject(entry->body);
+            entry->owner->physics_alt_tween = NULL;
+        }
+        entry->owner = NULL;
+    }
+    if(r->content->physics_alt_tween)
+    {
+        Physics_DeleteObject(r->content->physics_alt_tween);                    // not cached (full rebuild mode) body
+        r->content->physics_alt_tween = NULL;
+    }
 
-            // Clear tween array.
-            for(int j = 0; j < num_tweens; j++)
+    for(int e = 0; e < WORLD_FLIP_TWEENS_CACHE_SIZE; e++)
+    {
+        flip_tweens_entry_p entry = ft->entries + e;
+        if(!use_cache)
+        {
+            World_DeleteFlipTweensEntry(entry);
+            continue;
+        }
+        if(entry->last_use)
+        {
+            uint32_t d = 0;
+            for(; (d < ft->deps_count) && (entry->key[d] == global_world.rooms[ft->deps[d]].content); d++);
+            if(d == ft->deps_count)
             {
-                room_tween[j].ceiling_tween_type = TR_SECTOR_TWEEN_TYPE_NONE;
-                room_tween[j].floor_tween_type   = TR_SECTOR_TWEEN_TYPE_NONE;
+                hit = entry;
+                break;
             }
+        }
+        if(entry->last_use < victim->last_use)
+        {
+            victim = entry;
+        }
+    }
+
+    if(!hit)
+    {
+        World_DeleteFlipTweensEntry(victim);
+        for(uint32_t d = 0; d < ft->deps_count; d++)
+        {
+            victim->key[d] = global_world.rooms[ft->deps[d]].content;
+        }
+        victim->body = World_GenFlipTweensBody(r);
+    }
+
+    reused = (hit != NULL);
+    hit = (hit) ? (hit) : (victim);
+    hit->last_use = ++global_world.flip_tweens_tick;
+    if(hit->body)
+    {
+        hit->owner = r->content;
+        r->content->physics_alt_tween = hit->body;
+        Physics_EnableObject(hit->body);
+    }
+
+    return (reused) ? (1) : (0);
+}
+
+
+void World_UpdateFlipCollisions()
+{
+    float time = Sys_FloatTime();
+    uint32_t rebuilt = 0, swapped = 0;
+
+    if(!global_world.flip_tweens)
+    {
+        World_GenFlipTweensDeps();
+    }
 
-            // Most difficult task with converting floordata collision to trimesh collision is
-            // building inbetween polygons which will block out gaps between sector heights.
-            num_tweens = Res_Sector_GenDynamicTweens(r, room_tween);
-            if(num_tweens > 0)
+    if(flip_collisions_mode == WORLD_FLIP_COLLISIONS_FULL)
+    {
+        World_ClearFlipTweensCache();
+        room_p r = global_world.rooms;
+        for(uint32_t i = 0; i < global_world.rooms_count; ++i, ++r)
+        {
+            if(r->real_room == r)
             {
-                r->content->physics_alt_tween = Physics_GenRoomRigidBody(r, NULL, 0, room_tween, num_tweens);
+                // Clear previous dynamic tweens
+                Physics_DeleteObject(r->content->physics_alt_tween);
+                r->content->physics_alt_tween = World_GenFlipTweensBody(r);
                 if(r->content->physics_alt_tween)
                 {
                     Physics_EnableObject(r->content->physics_alt_tween);
                 }
+                rebuilt++;
             }
+        }
+    }
+    else
+    {
+        for(uint32_t i = 0; i < global_world.rooms_count; ++i)
+        {
+            flip_tweens_p ft = global_world.flip_tweens + i;
+            uint32_t d = 0;
+            for(; (d < ft->deps_count) && !global_world.flip_changed[ft->deps[d]]; d++);
+            if(d < ft->deps_count)
+            {
+                if(World_UpdateRoomFlipTweens(global_world.rooms + i, ft, flip_collisions_mode == WORLD_FLIP_COLLISIONS_CACHED))
+                {
+                    swapped++;
+                }
+                else
+                {
+                    rebuilt++;
+                }
+            }
+        }
+    }
+    memset(global_world.flip_changed, 0, global_world.rooms_count * sizeof(uint8_t));
+
+    flip_last_rebuilt = rebuilt;
+    flip_last_swapped = swapped;
+    flip_last_time = Sys_FloatTime() - time;
+    Sys_DebugLog(SYS_LOG_FILENAME, "flip collisions: %d rooms rebuilt, %d swapped, %.3f ms", rebuilt, swapped, 1000.0f * flip_last_time);
+}
+
 
-            Sys_ReturnTempMem(buff_size);
+void World_BenchFlipCollisions(uint32_t count)
+{
+    static const char *mode_names[3] = {"full", "incremental", "cached"};
+    float times[3];
+    uint32_t rebuilt[3], swapped[3], flips = 0;
+
+    if(global_world.flip_count == 0)
+    {
+        Con_Warning("bench_flip: level has no flipmaps");
+        return;
+    }
+
+    for(int mode = WORLD_FLIP_COLLISIONS_FULL; mode <= WORLD_FLIP_COLLISIONS_CACHED; mode++)
+    {
+        flip_collisions_mode = mode;
+        times[mode] = 0.0f;
+        rebuilt[mode] = 0;
+        swapped[mode] = 0;
+        flips = 0;
+        for(uint32_t n = 0; n < count; n++)
+        {
+            for(uint32_t i = 0; i < global_world.flip_count; i++)
+            {
+                uint8_t map = global_world.flip_map[i];
+                uint8_t state = global_world.flip_state[i];
+                global_world.flip_map[i] = 0x1F;                                // allow any state
+                for(int k = 0; k < 2; k++)                                      // flip and restore
+                {
+                    if(World_SetFlipState(i, ((k == 0) ? (state ^ 0x01) : (state)) | 0x02))
+                    {
+                        times[mode] += flip_last_time;
+                        rebuilt[mode] += flip_last_rebuilt;
+                        swapped[mode] += flip_last_swapped;
+                        flips++;
+                    }
+                }
+                global_world.flip_map[i] = map;
+            }
         }
     }
+    flip_collisions_mode = WORLD_FLIP_COLLISIONS_CACHED;
+
+    if(flips == 0)
+    {
+        Con_Warning("bench_flip: no rooms were flipped");
+        return;
+    }
+
+    for(int mode = WORLD_FLIP_COLLISIONS_FULL; mode <= WORLD_FLIP_COLLISIONS_CACHED; mode++)
+    {
+        Engine_BenchReport("bench_flip", "%s %.3f ms, %.1f rooms rebuilt, %.1f swapped per flip; %d flips",
+                           mode_names[mode], 1000.0f * times[mode] / (float)flips, (float)rebuilt[mode] / (float)flips, (float)swapped[mode] / (float)flips, flips);
+    }
 }
 
 
@@ -1008,6 +2099,8 @@ void World_SetGlobalFlipState(int flip_state)
             {
                 current_room->is_swapped = !current_room->is_swapped;
                 Room_DoFlip(current_room, current_room->alternate_room_next);
+                World_MarkFlipChanged(current_room);
+                World_MarkFlipChanged(current_room->alternate_room_next);
                 global_world.global_flip_state = flip_state;
             }
         }
@@ -1055,6 +2148,8 @@ int World_SetFlipState(uint32_t flip_index, uint32_t flip_state)
                 {
                     current_room->is_swapped = !current_room->is_swapped;
                     Room_DoFlip(current_room, current_room->alternate_room_next);
+                    World_MarkFlipChanged(current_room);
+                    World_MarkFlipChanged(current_room->alternate_room_next);
                     ret = 1;
                 }
             }
@@ -1265,9 +2360,17 @@ void World_SetEntityFunction(struct entity_s *ent)
             lua_pushinteger(engine_lua, ent->bf->animations.model->id);         // entity model id
             if (lua_CallAndLog(engine_lua, 2, 1, 0))
             {
-                if(!lua_isnil(engine_lua, -1))
+                if(!lua_isnil(engine_lua, -1) && Res_CreateEntityFunc(engine_lua, lua_tolstring(engine_lua, -1, 0), ent->id))
                 {
-                    Res_CreateEntityFunc(engine_lua, lua_tolstring(engine_lua, -1, 0), ent->id);
+                    // record entities with onLoop, only they are passed to Lua each frame.
+                    if(Script_EntityHasLoop(engine_lua, ent->id))
+                    {
+                        ent->callback_flags |= ENTITY_CALLBACK_LOOP;
+                    }
+                    else
+                    {
+                        ent->callback_flags &= ~ENTITY_CALLBACK_LOOP;
+                    }
                 }
             }
         }
@@ -1281,13 +2384,18 @@ void World_GenTextures(class VT_Level *tr)
     int border_size = renderer.settings.texture_border;
     border_size = (border_size < 0) ? (0) : (border_size);
     border_size = (border_size > 128) ? (128) : (border_size);
-    global_world.tex_atlas = new bordered_texture_atlas(border_size,
-                                                  tr->textile32_count,
-                                                  tr->textile32,
-                                                  tr->object_textures_count,
-                                                  tr->object_textures,
-                                                  tr->sprite_textures_count,
-                                                  tr->sprite_textures);
+    global_world.tex_atlas = WorldCache_GetTexAtlas(border_size, tr);
+    if(global_world.tex_atlas == NULL)
+    {
+        global_world.tex_atlas = new bordered_texture_atlas(border_size,
+                                                      tr->textile32_count,
+                                                      tr->textile32,
+                                                      tr->object_textures_count,
+                                                      tr->object_textures,
+                                                      tr->sprite_textures_count,
+                                                      tr->sprite_textures);
+        WorldCache_PutTexAtlas(global_world.tex_atlas);
+    }
 
     global_world.tex_count = (uint32_t) global_world.tex_atlas->getNumAtlasPages();
     global_world.textures = (GLuint*)malloc(global_world.tex_count * sizeof(GLuint));
@@ -1449,8 +2557,14 @@ void World_GenMeshes(class VT_Level *tr)
     base_mesh = global_world.meshes = (base_mesh_p)calloc(global_world.meshes_count, sizeof(base_mesh_t));
     for(uint32_t i = 0; i < global_world.meshes_count; i++, base_mesh++)
     {
+        if(WorldCache_GetMesh(base_mesh, i, global_world.textures, global_world.tex_count))
+        {
+            BaseMesh_GenAnimatedFaces(base_mesh);
+            continue;
+        }
         TR_GenMesh(base_mesh, i, global_world.anim_sequences, global_world.anim_sequences_count, global_world.tex_atlas, tr);
         BaseMesh_GenFaces(base_mesh);
+        WorldCache_PutMesh(base_mesh, i, global_world.textures, global_world.tex_count);
     }
 }
 
@@ -1626,12 +2740,20 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     room->self->object_type = OBJECT_ROOM_BASE;
 
     room->near_room_list_size = 0;
+    room->near_room_list = NULL;
     room->overlapped_room_list_size = 0;
+    room->overlapped_room_list = NULL;
 
     room->content = (room_content_p)malloc(sizeof(room_content_t));
     room->content->containers = NULL;
     room->content->physics_body = NULL;
     room->content->physics_alt_tween = NULL;
+    room->content->static_mesh_bvh = NULL;
+    room->content->static_mesh_overlaps_count = 0;
+    room->content->static_mesh_overlaps = NULL;
+    room->content->entity_bvh = NULL;
+    room->content->entity_bvh_items_size = 0;
+    room->content->entity_bvh_items = NULL;
     room->content->mesh = NULL;
     room->content->static_mesh = NULL;
     room->content->sprites = NULL;
@@ -1646,10 +2768,21 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     room->content->ambient_lighting[1] = tr->rooms[room->id].light_colour.g * 2;
     room->content->ambient_lighting[2] = tr->rooms[room->id].light_colour.b * 2;
 
-    TR_GenRoomMesh(room, room->id, global_world.anim_sequences, global_world.anim_sequences_count, global_world.tex_atlas, tr);
-    if(room->content->mesh)
+    if(WorldCache_GetRoomMesh(room, room->id, global_world.textures, global_world.tex_count))
     {
-        BaseMesh_GenFaces(room->content->mesh);
+        if(room->content->mesh)
+        {
+            BaseMesh_GenAnimatedFaces(room->content->mesh);
+        }
+    }
+    else
+    {
+        TR_GenRoomMesh(room, room->id, global_world.anim_sequences, global_world.anim_sequences_count, global_world.tex_atlas, tr);
+        if(room->content->mesh)
+        {
+            BaseMesh_GenFaces(room->content->mesh);
+        }
+        WorldCache_PutRoomMesh(room, room->id, global_world.textures, global_world.tex_count);
     }
     /*
      *  let us load static room meshes
@@ -1768,6 +2901,7 @@ void World_GenRoom(struct room_s *room, class VT_Level *tr)
     room->sectors_y = tr_room->num_zsectors;
     room->sectors_count = room->sectors_x * room->sectors_y;
     room->sectors = (room_sector_p)malloc(room->sectors_count * sizeof(room_sector_t));
+    room->sectors_hot = NULL;                                                   // see World_GenRoomProperties()
 
     /*
      * base sectors information loading and collisional mesh creation
@@ -2025,6 +3159,7 @@ void World_GenSkeletalModels(class VT_Level *tr)
 {
     skeletal_model_p smodel;
     tr_moveable_t *tr_moveable;
+    uint32_t packed_bytes = 0;
 
     global_world.skeletal_models_count = tr->moveables_count;
     smodel = global_world.skeletal_models = (skeletal_model_p)calloc(global_world.skeletal_models_count, sizeof(skeletal_model_t));
@@ -2036,7 +3171,9 @@ void World_GenSkeletalModels(class VT_Level *tr)
         smodel->mesh_count = tr_moveable->num_meshes;
         TR_GenSkeletalModel(smodel, i, global_world.meshes, tr);
         SkeletalModel_FillTransparency(smodel);
+        packed_bytes += SkeletalModel_PackFrames(smodel);
     }
+    Sys_DebugLog(SYS_LOG_FILENAME, "animation frames packing: %d KB saved", packed_bytes / 1024);
 }
 
 
@@ -2123,7 +3260,11 @@ void World_GenEntities(class VT_Level *tr)
         Entity_SetAnimation(entity, ANIM_TYPE_BASE, 0, 0);                      // Set zero animation and zero frame
         Entity_RebuildBV(entity);
         Room_AddObject(entity->self->room, entity->self);
-        World_AddEntity(entity);
+        if(!World_AddEntity(entity))
+        {
+            Entity_Delete(entity);
+            continue;
+        }
         World_SetEntityModelProperties(entity);
         Physics_GenRigidBody(entity->physics, entity->bf);
         Entity_UpdateRigidBody(entity, 1);
@@ -2286,6 +3427,19 @@ void World_GenRoomProperties(class VT_Level *tr)
     for(uint32_t i = 0; i < global_world.rooms_count; i++)
     {
         room_p r = global_world.rooms + i;
+        if(WorldCache_GetRoomSectors(global_world.rooms, global_world.rooms_count, i))
+        {
+            // Geometry is cached, triggers own heap data and are parsed on a copy.
+            for(uint32_t j = 0; j < r->sectors_count; j++)
+            {
+                room_sector_t sector = r->sectors[j];
+                sector.trigger = NULL;
+                Res_Sector_TranslateFloorData(global_world.rooms, global_world.rooms_count, &sector, tr);
+                r->sectors[j].trigger = sector.trigger;
+            }
+            continue;
+        }
+
         // Fill heightmap and translate floordata.
         for(uint32_t j = 0; j < r->sectors_count; j++)
         {
@@ -2294,12 +3448,557 @@ void World_GenRoomProperties(class VT_Level *tr)
 
         // Basic sector calculations.
         Res_RoomSectorsCalculate(global_world.rooms, global_world.rooms_count, i, tr);
+        WorldCache_PutRoomSectors(global_world.rooms, global_world.rooms_count, i);
+    }
+
+    // Sectors are final now, pack the query fields.
+    for(uint32_t i = 0; i < global_world.rooms_count; i++)
+    {
+        Room_GenSectorsHot(global_world.rooms + i);
+    }
+
+    // Generate links to the overlapped and near rooms; all sectors must be calculated.
+    World_GenRoomLists();
+    World_GenRoomGrid();
+    World_GenRoomPVS();                                                         // portals of all rooms must be loaded
+
+    // Statics never move, so their visibility data is generated once.
+    for(uint32_t i = 0; i < global_world.rooms_count; i++)
+    {
+        Room_GenStaticMeshBVH(global_world.rooms + i);
+        Room_GenStaticMeshOverlaps(global_world.rooms + i, global_world.rooms, global_world.rooms_count);
+    }
+}
+
+
+/**
+ * Builds sector sized 2D grid over real rooms for World_FindRoomByPos.
+ * Cells are stored in CSR way: rooms indexes of cell i are
+ * room_grid_rooms[room_grid_offsets[i] .. room_grid_offsets[i + 1]).
+ */
+void World_GenRoomGrid()
+{
+    uint32_t cells_count, *cursor = NULL;
+    uint32_t range[4];
+    float bb_max[2] = {0.0f, 0.0f};
+    int first = 1;
+
+    for(uint32_t i = 0; i < global_world.rooms_count; i++)
+    {
+        room_p r = global_world.rooms + i;
+        if(r == r->real_room)
+        {
+            if(first || (r->bb_min[0] < global_world.room_grid_min[0])) global_world.room_grid_min[0] = r->bb_min[0];
+            if(first || (r->bb_min[1] < global_world.room_grid_min[1])) global_world.room_grid_min[1] = r->bb_min[1];
+            if(first || (r->bb_max[0] > bb_max[0])) bb_max[0] = r->bb_max[0];
+            if(first || (r->bb_max[1] > bb_max[1])) bb_max[1] = r->bb_max[1];
+            first = 0;
+        }
+    }
+
+    if(first)
+    {
+        return;
+    }
+
+    global_world.room_grid_size[0] = (bb_max[0] - global_world.room_grid_min[0]) / TR_METERING_SECTORSIZE + 1;
+    global_world.room_grid_size[1] = (bb_max[1] - global_world.room_grid_min[1]) / TR_METERING_SECTORSIZE + 1;
+    cells_count = global_world.room_grid_size[0] * global_world.room_grid_size[1];
+    global_world.room_grid_offsets = (uint32_t*)calloc(cells_count + 1, sizeof(uint32_t));
+
+    // Pass 1: count rooms per cell, pass 2: fill cells; rooms go in ascending order.
+    for(int pass = 0; pass < 2; pass++)
+    {
+        for(uint32_t i = 0; i < global_world.rooms_count; i++)
+        {
+            room_p r = global_world.rooms + i;
+            if(r != r->real_room)
+            {
+                continue;
+            }
+
+            range[0] = (r->bb_min[0] - global_world.room_grid_min[0]) / TR_METERING_SECTORSIZE;
+            range[1] = (r->bb_max[0] - global_world.room_grid_min[0]) / TR_METERING_SECTORSIZE;
+            range[2] = (r->bb_min[1] - global_world.room_grid_min[1]) / TR_METERING_SECTORSIZE;
+            range[3] = (r->bb_max[1] - global_world.room_grid_min[1]) / TR_METERING_SECTORSIZE;
+            for(uint32_t x = range[0]; x <= range[1]; x++)
+            {
+                for(uint32_t y = range[2]; y <= range[3]; y++)
+                {
+                    uint32_t cell = x * global_world.room_grid_size[1] + y;
+                    if(pass == 0)
+                    {
+                        global_world.room_grid_offsets[cell + 1]++;
+                    }
+                    else
+                    {
+                        global_world.room_grid_rooms[cursor[cell]++] = i;
+                    }
+                }
+            }
+        }
+
+        if(pass == 0)
+        {
+            for(uint32_t i = 0; i < cells_count; i++)
+            {
+                global_world.room_grid_offsets[i + 1] += global_world.room_grid_offsets[i];
+            }
+            global_world.room_grid_rooms = (uint32_t*)malloc(global_world.room_grid_offsets[cells_count] * sizeof(uint32_t));
+            cursor = (uint32_t*)malloc(cells_count * sizeof(uint32_t));
+            memcpy(cursor, global_world.room_grid_offsets, cells_count * sizeof(uint32_t));
+        }
+    }
+    free(cursor);
+}
+
+
+/*
+ * Rooms PVS: for every real room - bits (by room id) of real rooms, that may
+ * be reached by portal traversal when camera is in that room. Portal graph is
+ * united over all flip states (portals of all rooms of alternate sequence), so
+ * PVS stays conservative after any Room_DoFlip() and is not rebuilt. Portal
+ * sequence test: camera volume (room bbox + margin) must be in front of
+ * portal, portal is clipped by planes of all previous portals of sequence and
+ * by separating planes between (camera volume / first portal) and previous
+ * clipped portal. Rooms near camera volume (see CRender::GenWorldList()) are
+ * traversed as start rooms too. If row can not be built exactly (too many
+ * steps, too deep sequence or portal with too many vertices), all rooms
+ * connected to the source room are marked.
+ */
+#define WORLD_PVS_MARGIN            (32.0f)             // camera may be out of room bbox a little
+#define WORLD_PVS_NEAR_MARGIN       (10.0f)             // same as camera near room test in render
+#define WORLD_PVS_EPSILON           (2.0f)              // portals of neighbour rooms are moved by 1, see World_GenRoom()
+#define WORLD_PVS_PLANE_EPSILON     (0.1f)
+#define WORLD_PVS_MAX_DEPTH         (64)
+#define WORLD_PVS_MAX_VERTICES      (32)
+#define WORLD_PVS_MAX_STEPS         (1 << 14)           // per room; if exceeded - all connected rooms are marked
+#define WORLD_PVS_ROOMS_PER_JOB     (8)
+
+typedef struct world_pvs_window_s
+{
+    struct portal_s        *portal;
+    uint16_t                vertex_count;
+    float                   vertex[3 * WORLD_PVS_MAX_VERTICES];
+}world_pvs_window_t, *world_pvs_window_p;
+
+typedef struct world_pvs_builder_s
+{
+    const uint32_t         *group_offsets;                  // real room id -> rooms of its alternate sequence
+    const uint32_t         *group_rooms;
+    uint32_t                first;                          // rooms range of the job
+    uint32_t                last;
+    uint32_t               *row;
+    uint32_t               *reached;                        // connectivity fallback
+    uint32_t               *queue;
+    room_p                  source;
+    float                   volume[8 * 3];                  // camera volume corners
+    uint32_t                steps;
+    int                     overflow;
+    float                   tmp[3 * WORLD_PVS_MAX_VERTICES];
+    world_pvs_window_t      windows[WORLD_PVS_MAX_DEPTH];
+}world_pvs_builder_t, *world_pvs_builder_p;
+
+
+/*
+ * Keeps part of polygon with plane distance >= -WORLD_PVS_EPSILON; if there
+ * are too many vertices, polygon stays as is (it is conservative).
+ */
+static uint16_t World_PVSClip(float *v, uint16_t count, const float n[4], float *buf)
+{
+    uint16_t added = 0;
+    float *prev_v = v + 3 * (count - 1);
+    float prev_d = vec3_plane_dist(n, prev_v) + WORLD_PVS_EPSILON;
+
+    for(uint16_t i = 0; i < count; i++)
+    {
+        float *curr_v = v + 3 * i;
+        float d = vec3_plane_dist(n, curr_v) + WORLD_PVS_EPSILON;
+        if((d >= 0.0f) != (prev_d >= 0.0f))
+        {
+            float t = prev_d / (prev_d - d);
+            if(added >= WORLD_PVS_MAX_VERTICES)
+            {
+                return count;
+            }
+            buf[3 * added + 0] = prev_v[0] + t * (curr_v[0] - prev_v[0]);
+            buf[3 * added + 1] = prev_v[1] + t * (curr_v[1] - prev_v[1]);
+            buf[3 * added + 2] = prev_v[2] + t * (curr_v[2] - prev_v[2]);
+            added++;
+        }
+        if(d >= 0.0f)
+        {
+            if(added >= WORLD_PVS_MAX_VERTICES)
+            {
+                return count;
+            }
+            vec3_copy(buf + 3 * added, curr_v);
+            added++;
+        }
+        prev_v = curr_v;
+        prev_d = d;
+    }
+
+    memcpy(v, buf, 3 * added * sizeof(float));
+    return (added >= 3) ? (added) : (0);
+}
+
+/*
+ * Plane through (p0, p1, p2) is a separator if all "from" points are on its
+ * back side and all "pass" points are on its front side; then lines from
+ * "from" through "pass" stay on front side behind "pass".
+ */
+static uint16_t World_PVSClipBySeparator(world_pvs_builder_p b, world_pvs_window_p w, const float *p0, const float *p1, const float *p2,
+                                         const float *from, uint16_t from_count, const float *pass, uint16_t pass_count)
+{
+    float n[4], v1[3], v2[3], t;
+    float from_min = 0.0f, from_max = 0.0f, pass_min = 0.0f, pass_max = 0.0f;
+
+    vec3_sub(v1, p1, p0);
+    vec3_sub(v2, p2, p0);
+    vec3_cross(n, v1, v2);
+    t = vec3_abs(n);
+    if(t < 0.001f * vec3_abs(v1) * vec3_abs(v2))
+    {
+        return w->vertex_count;                                                 // degenerate plane
+    }
+    vec3_norm_plane(n, p0, t);
+
+    for(uint16_t i = 0; i < from_count; i++)
+    {
+        float d = vec3_plane_dist(n, from + 3 * i);
+        from_min = (d < from_min) ? (d) : (from_min);
+        from_max = (d > from_max) ? (d) : (from_max);
+    }
+    for(uint16_t i = 0; i < pass_count; i++)
+    {
+        float d = vec3_plane_dist(n, pass + 3 * i);
+        pass_min = (d < pass_min) ? (d) : (pass_min);
+        pass_max = (d > pass_max) ? (d) : (pass_max);
+    }
+
+    if((from_max <= WORLD_PVS_PLANE_EPSILON) && (pass_min >= -WORLD_PVS_PLANE_EPSILON) && (pass_max > WORLD_PVS_EPSILON) && (from_min < -WORLD_PVS_EPSILON))
+    {
+        return World_PVSClip(w->vertex, w->vertex_count, n, b->tmp);
+    }
+    if((from_min >= -WORLD_PVS_PLANE_EPSILON) && (pass_max <= WORLD_PVS_PLANE_EPSILON) && (pass_min < -WORLD_PVS_EPSILON) && (from_max > WORLD_PVS_EPSILON))
+    {
+        vec4_copy_inv(n, n);
+        return World_PVSClip(w->vertex, w->vertex_count, n, b->tmp);
+    }
+
+    return w->vertex_count;
+}
+
+
+static uint16_t World_PVSClipBySeparators(world_pvs_builder_p b, world_pvs_window_p w, const float *from, uint16_t from_count, int from_is_polygon,
+                                          const float *pass, uint16_t pass_count)
+{
+    // pass edge + from point
+    for(uint16_t i = 0; (i < pass_count) && (w->vertex_count > 0); i++)
+    {
+        const float *e0 = pass + 3 * i;
+        const float *e1 = pass + 3 * ((i + 1) % pass_count);
+        for(uint16_t j = 0; (j < from_count) && (w->vertex_count > 0); j++)
+        {
+            w->vertex_count = World_PVSClipBySeparator(b, w, e0, e1, from + 3 * j, from, from_count, pass, pass_count);
+        }
+    }
+
+    // from edge + pass point
+    for(uint16_t i = 0; from_is_polygon && (i < from_count) && (w->vertex_count > 0); i++)
+    {
+        const float *e0 = from + 3 * i;
+        const float *e1 = from + 3 * ((i + 1) % from_count);
+        for(uint16_t j = 0; (j < pass_count) && (w->vertex_count > 0); j++)
+        {
+            w->vertex_count = World_PVSClipBySeparator(b, w, e0, e1, pass + 3 * j, from, from_count, pass, pass_count);
+        }
+    }
+
+    return w->vertex_count;
+}
+
+
+static void World_PVSMarkConnected(world_pvs_builder_p b)
+{
+    uint32_t row_size = (global_world.rooms_count + 31) / 32;
+    uint32_t head = 0, tail = 0;
+
+    memset(b->reached, 0, row_size * sizeof(uint32_t));
+    b->queue[tail++] = b->source->id;
+    b->reached[b->source->id / 32] |= 1U << (b->source->id % 32);
+    while(head < tail)
+    {
+        uint32_t id = b->queue[head++];
+        for(uint32_t g = b->group_offsets[id]; g < b->group_offsets[id + 1]; g++)
+        {
+            room_p r = global_world.rooms + b->group_rooms[g];
+            for(uint16_t i = 0; i < r->portals_count; i++)
+            {
+                uint32_t dest_id = r->portals[i].dest_room->real_room->id;
+                if(!WORLD_PVS_HAS_ROOM(b->reached, dest_id))
+                {
+                    b->reached[dest_id / 32] |= 1U << (dest_id % 32);
+                    b->queue[tail++] = dest_id;
+                }
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < row_size; i++)
+    {
+        b->row[i] |= b->reached[i];
+    }
+}
+
+
+static void World_PVSWalk(world_pvs_builder_p b, room_p room, int depth)
+{
+    world_pvs_window_p w = b->windows + depth;
+
+    for(uint32_t g = b->group_offsets[room->id]; (g < b->group_offsets[room->id + 1]) && !b->overflow; g++)
+    {
+        room_p r = global_world.rooms + b->group_rooms[g];
+        portal_p p = r->portals;
+        for(uint16_t i = 0; (i < r->portals_count) && !b->overflow; i++, p++)
+        {
+            room_p dest_room = p->dest_room->real_room;
+            float front, n[4];
+
+            if(dest_room == b->source)
+            {
+                continue;                                                       // camera room is never entered again
+            }
+
+            front = vec3_plane_dist(p->norm, b->volume);
+            for(int j = 1; j < 8; j++)
+            {
+                float d = vec3_plane_dist(p->norm, b->volume + 3 * j);
+                front = (d > front) ? (d) : (front);
+            }
+            if(front < -WORLD_PVS_EPSILON)
+            {
+                continue;                                                       // backface from all camera positions
+            }
+
+            for(int j = 0; (j < depth) && (front >= -WORLD_PVS_EPSILON); j++)
+            {
+                const float *prev_n = b->windows[j].portal->norm;
+                if((vec3_dot(prev_n, p->norm) < -0.99f) && (fabs(prev_n[3] + p->norm[3]) < WORLD_PVS_EPSILON))
+                {
+                    front = -2.0f * WORLD_PVS_EPSILON;                          // line of sight can not cross the same plane back
+                }
+            }
+            if(front < -WORLD_PVS_EPSILON)
+            {
+                continue;
+            }
+
+            if((++b->steps > WORLD_PVS_MAX_STEPS) || (p->vertex_count > WORLD_PVS_MAX_VERTICES))
+            {
+                b->overflow = 1;                                                // can not be clipped, row falls back to connectivity
+                return;
+            }
+
+            w->portal = p;
+            w->vertex_count = p->vertex_count;
+            memcpy(w->vertex, p->vertex, 3 * p->vertex_count * sizeof(float));
+            for(int j = 0; (j < depth) && (w->vertex_count > 0); j++)
+            {
+                vec4_copy_inv(n, b->windows[j].portal->norm);                  // must be behind all previous portals
+                w->vertex_count = World_PVSClip(w->vertex, w->vertex_count, n, b->tmp);
+            }
+            if((depth >= 1) && (w->vertex_count > 0))
+            {
+                world_pvs_window_p pass = b->windows + depth - 1;
+                World_PVSClipBySeparators(b, w, b->volume, 8, 0, pass->vertex, pass->vertex_count);
+                if((depth >= 2) && (w->vertex_count > 0))
+                {
+                    World_PVSClipBySeparators(b, w, b->windows[0].vertex, b->windows[0].vertex_count, 1, pass->vertex, pass->vertex_count);
+                }
+            }
+
+            if(w->vertex_count > 0)
+            {
+                b->row[dest_room->id / 32] |= 1U << (dest_room->id % 32);
+                if(depth + 1 < WORLD_PVS_MAX_DEPTH)
+                {
+                    World_PVSWalk(b, dest_room, depth + 1);
+                }
+                else
+                {
+                    b->overflow = 1;
+                }
+            }
+        }
+    }
+}
+
+
+static void World_PVSBuildRow(world_pvs_builder_p b, room_p room)
+{
+    uint32_t row_size = (global_world.rooms_count + 31) / 32;
+    float bb_min[3], bb_max[3];
+
+    b->row = global_world.room_pvs + room->id * row_size;
+    b->source = room;
+    b->steps = 0;
+    b->overflow = 0;
+    bb_min[0] = room->bb_min[0] - WORLD_PVS_MARGIN;
+    bb_min[1] = room->bb_min[1] - WORLD_PVS_MARGIN;
+    bb_min[2] = room->bb_min[2] - WORLD_PVS_MARGIN;
+    bb_max[0] = room->bb_max[0] + WORLD_PVS_MARGIN;
+    bb_max[1] = room->bb_max[1] + WORLD_PVS_MARGIN;
+    bb_max[2] = room->bb_max[2] + WORLD_PVS_MARGIN;
+    for(int j = 0; j < 8; j++)
+    {
+        b->volume[3 * j + 0] = (j & 1) ? (bb_max[0]) : (bb_min[0]);
+        b->volume[3 * j + 1] = (j & 2) ? (bb_max[1]) : (bb_min[1]);
+        b->volume[3 * j + 2] = (j & 4) ? (bb_max[2]) : (bb_min[2]);
+    }
+
+    b->row[room->id / 32] |= 1U << (room->id % 32);
+    World_PVSWalk(b, room, 0);
+
+    // rooms processed as rooms with camera inside
+    for(uint32_t g = b->group_offsets[room->id]; (g < b->group_offsets[room->id + 1]) && !b->overflow; g++)
+    {
+        room_p r = global_world.rooms + b->group_rooms[g];
+        for(uint16_t i = 0; (i < r->portals_count) && !b->overflow; i++)
+        {
+            room_p near_room = r->portals[i].dest_room->real_room;
+            if((near_room != room) &&
+               (near_room->bb_min[0] - WORLD_PVS_NEAR_MARGIN <= bb_max[0]) && (near_room->bb_max[0] + WORLD_PVS_NEAR_MARGIN >= bb_min[0]) &&
+               (near_room->bb_min[1] - WORLD_PVS_NEAR_MARGIN <= bb_max[1]) && (near_room->bb_max[1] + WORLD_PVS_NEAR_MARGIN >= bb_min[1]) &&
+               (near_room->bb_min[2] - WORLD_PVS_NEAR_MARGIN <= bb_max[2]) && (near_room->bb_max[2] + WORLD_PVS_NEAR_MARGIN >= bb_min[2]))
+            {
+                b->row[near_room->id / 32] |= 1U << (near_room->id % 32);
+                World_PVSWalk(b, near_room, 0);
+            }
+        }
+    }
+
+    if(b->overflow)
+    {
+        World_PVSMarkConnected(b);
+    }
+}
+
+
+static void World_PVSBuildJob(void *data)
+{
+    world_pvs_builder_p b = (world_pvs_builder_p)data;
+    for(uint32_t i = b->first; i < b->last; i++)
+    {
+        room_p r = global_world.rooms + i;
+        if(r == r->real_room)
+        {
+            World_PVSBuildRow(b, r);
+        }
+    }
+}
+
+
+void World_GenRoomPVS()
+{
+    uint32_t rooms_count = global_world.rooms_count;
+    uint32_t row_size = (rooms_count + 31) / 32;
+    uint32_t jobs_count = (rooms_count + WORLD_PVS_ROOMS_PER_JOB - 1) / WORLD_PVS_ROOMS_PER_JOB;
+    uint32_t *group_offsets, *group_rooms, *cursor, *reached, *queue;
+    uint32_t real_count = 0, visible_count = 0;
+    world_pvs_builder_p builders;
+    job_group_t group;
+    float time;
+
+    if(rooms_count == 0)
+    {
+        return;
+    }
+
+    global_world.room_pvs = WorldCache_GetRoomPVS(rooms_count, row_size);
+    if(global_world.room_pvs)
+    {
+        return;
+    }
+
+    time = Sys_FloatTime();
+    global_world.room_pvs = (uint32_t*)calloc(rooms_count * row_size, sizeof(uint32_t));
+
+    // Rooms of each alternate sequence, CSR by real room id.
+    group_offsets = (uint32_t*)calloc(rooms_count + 1, sizeof(uint32_t));
+    group_rooms = (uint32_t*)malloc(rooms_count * sizeof(uint32_t));
+    cursor = (uint32_t*)malloc(rooms_count * sizeof(uint32_t));
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        group_offsets[global_world.rooms[i].real_room->id + 1]++;
+    }
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        group_offsets[i + 1] += group_offsets[i];
+    }
+    memcpy(cursor, group_offsets, rooms_count * sizeof(uint32_t));
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        group_rooms[cursor[global_world.rooms[i].real_room->id]++] = i;
+    }
+    free(cursor);
+
+    builders = (world_pvs_builder_p)malloc(jobs_count * sizeof(world_pvs_builder_t));
+    reached = (uint32_t*)malloc(jobs_count * row_size * sizeof(uint32_t));
+    queue = (uint32_t*)malloc(jobs_count * rooms_count * sizeof(uint32_t));
+    Jobs_InitGroup(&group);
+    for(uint32_t i = 0; i < jobs_count; i++)
+    {
+        world_pvs_builder_p b = builders + i;
+        b->group_offsets = group_offsets;
+        b->group_rooms = group_rooms;
+        b->first = i * WORLD_PVS_ROOMS_PER_JOB;
+        b->last = (b->first + WORLD_PVS_ROOMS_PER_JOB < rooms_count) ? (b->first + WORLD_PVS_ROOMS_PER_JOB) : (rooms_count);
+        b->reached = reached + i * row_size;
+        b->queue = queue + i * rooms_count;
+        Jobs_Add(&group, World_PVSBuildJob, b);
+    }
+    Jobs_Wait(&group);
+
+    free(queue);
+    free(reached);
+    free(builders);
+    free(group_rooms);
+    free(group_offsets);
+
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        room_p r = global_world.rooms + i;
+        if(r == r->real_room)
+        {
+            real_count++;
+            for(uint32_t j = 0; j < row_size; j++)
+            {
+                visible_count += __builtin_popcount(global_world.room_pvs[i * row_size + j]);
+            }
+        }
+    }
+    Sys_DebugLog(SYS_LOG_FILENAME, "room pvs: %d rooms, %.1f potentially visible per room, %.3f s",
+                 real_count, (real_count) ? ((float)visible_count / (float)real_count) : (0.0f), Sys_FloatTime() - time);
+
+    WorldCache_PutRoomPVS(global_world.room_pvs, rooms_count, row_size);
+}
 
-        // Generate links to the overlapped rooms.
-        World_BuildOverlappedRoomsList(r);
-        // Generate links to the near rooms.
-        World_BuildNearRoomsList(r);
+
+const uint32_t *World_GetRoomPVS(struct room_s *room, float cam_pos[3])
+{
+    if(global_world.room_pvs && room)
+    {
+        room = room->real_room;
+        if((cam_pos[0] >= room->bb_min[0] - WORLD_PVS_MARGIN) && (cam_pos[0] <= room->bb_max[0] + WORLD_PVS_MARGIN) &&
+           (cam_pos[1] >= room->bb_min[1] - WORLD_PVS_MARGIN) && (cam_pos[1] <= room->bb_max[1] + WORLD_PVS_MARGIN) &&
+           (cam_pos[2] >= room->bb_min[2] - WORLD_PVS_MARGIN) && (cam_pos[2] <= room->bb_max[2] + WORLD_PVS_MARGIN))
+        {
+            return global_world.room_pvs + room->id * ((global_world.rooms_count + 31) / 32);
+        }
     }
+    return NULL;
 }
 
 
@@ -2336,7 +4035,12 @@ void World_GenRoomCollision()
 
         // Most difficult task with converting floordata collision to trimesh collision is
         // building inbetween polygons which will block out gaps between sector heights.
-        num_tweens = Res_Sector_GenStaticTweens(r, room_tween);
+        num_tweens = WorldCache_GetRoomTweens(i, room_tween, num_tweens);
+        if(num_tweens < 0)
+        {
+            num_tweens = Res_Sector_GenStaticTweens(r, room_tween);
+            WorldCache_PutRoomTweens(i, room_tween, num_tweens);
+        }
 
         // Final step is sending actual sectors to Bullet collision model. We do it here.
         r->content->physics_body = Physics_GenRoomRigidBody(r, r->sectors, r->sectors_count, room_tween, num_tweens);
@@ -8,6 +8,23 @@
 #define FLIP_STATE_ON       (0x01)
 #define FLIP_STATE_BY_FLAG  (0x03)
 
+/*
+ * Entities are stored in dense table indexed by entity id (level items keep
+ * their item index as id), so ids must be less than WORLD_ENTITIES_MAX.
+ * Handle = (slot generation << WORLD_ENTITY_HANDLE_ID_BITS) | id; it becomes
+ * invalid when entity is deleted, even if slot is reused by new entity.
+ */
+#define WORLD_ENTITY_HANDLE_ID_BITS     (20)
+#define WORLD_ENTITY_HANDLE_GEN_MASK    (0x7FF)
+#define WORLD_ENTITIES_MAX              (1 << WORLD_ENTITY_HANDLE_ID_BITS)
+
+/*
+ * Rooms PVS row: bits (by room id) of real rooms, that may be visible through
+ * portals from the room in any flip state. NULL if there is no PVS or camera
+ * is too far from room bounding box.
+ */
+#define WORLD_PVS_HAS_ROOM(pvs, id)     (((pvs)[(id) / 32] >> ((id) % 32)) & 1)
+
 
 void World_Prepare();
 void World_Open(class VT_Level *tr);
@@ -16,8 +33,11 @@ int  World_GetVersion();
 
 uint32_t World_SpawnEntity(uint32_t model_id, uint32_t room_id, float pos[3], float ang[3], int32_t id);
 struct entity_s *World_GetEntityByID(uint32_t id);
+uint32_t World_GetEntityHandle(struct entity_s *entity);  // ENTITY_ID_NONE if entity is not in world
+struct entity_s *World_GetEntityByHandle(uint32_t handle);
 void World_SetPlayer(struct entity_s *entity);
 struct entity_s *World_GetPlayer();
+uint32_t World_GetEntitiesCount();
 void World_IterateAllEntities(int (*iterator)(struct entity_s *ent, void *data), void *data);
 struct flyby_camera_sequence_s *World_GetFlyBySequences();
 struct base_item_s *World_GetBaseItemByID(uint32_t id);
@@ -39,17 +59,24 @@ struct skeletal_model_s* World_GetSkybox();
 
 struct room_s *World_GetRoomByID(uint32_t id);
 struct room_s *World_FindRoomByPos(float pos[3]);
+void World_BenchFindRoomByPos(uint32_t count);           // compare grid and linear search on random points
+void World_BenchEntities(uint32_t count);                // compare entity table and std::map lookup / iteration
+void World_BenchHeights(uint32_t count);                 // compare analytic sectors heights and physics rays on random points
 struct room_s *World_FindRoomByPosCogerrence(float pos[3], struct room_s *old_room);
 struct room_sector_s *World_GetRoomSector(int room_id, int x, int y);
 
-void World_BuildNearRoomsList(struct room_s *room);
-void World_BuildOverlappedRoomsList(struct room_s *room);
+const uint32_t *World_GetRoomPVS(struct room_s *room, float cam_pos[3]);
+
+int  World_IsInRoomListsStorage(struct room_s **list);
+void World_AddToOverlappedRoomsList(struct room_s *room, struct room_s *r);
 
 uint16_t World_GetGlobalFlipState();
 void World_SetGlobalFlipState(int flip_state);
 int World_SetFlipState(uint32_t flip_index, uint32_t flip_state);
 int World_SetFlipMap(uint32_t flip_index, uint8_t flip_mask, uint8_t flip_operation);
-void World_UpdateFlipCollisions();
+void World_UpdateFlipCollisions();                       // rebuild dynamic tweens of rooms, which depend on flipped ones
+void World_ClearFlipTweens();
+void World_BenchFlipCollisions(uint32_t count);          // compare full / incremental / cached flip collisions update
 uint32_t World_GetFlipMap(uint32_t flip_index);
 uint32_t World_GetFlipState(uint32_t flip_index);
 
@@ -0,0 +1,1040 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_opengl.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define WORLD_CACHE_USE_MMAP
+#endif
+
+#include "core/system.h"
+#include "core/vmath.h"
+#include "core/polygon.h"
+#include "render/bordered_texture_atlas.h"
+#include "vt/vt_level.h"
+#include "mesh.h"
+#include "skeletal_model.h"
+#include "room.h"
+#include "world_cache.h"
+
+
+enum world_cache_section_e
+{
+    WORLD_CACHE_SECTION_FRAMES = 0,
+    WORLD_CACHE_SECTION_ROOM_LISTS,
+    WORLD_CACHE_SECTION_TWEENS,
+    WORLD_CACHE_SECTION_ROOM_PVS,
+    WORLD_CACHE_SECTION_TEX_ATLAS,
+    WORLD_CACHE_SECTION_MESHES,
+    WORLD_CACHE_SECTION_ROOM_MESHES,
+    WORLD_CACHE_SECTION_SECTORS,
+    WORLD_CACHE_SECTIONS_COUNT
+};
+
+typedef struct world_cache_header_s
+{
+    uint32_t            magic;
+    uint32_t            version;
+    uint64_t            level_size;
+    uint64_t            level_mtime;
+    uint64_t            level_hash;                 // hash of level file head
+    uint32_t            tween_size;                 // compiler dependent struct layouts check
+    uint32_t            bone_tag_size;
+    uint32_t            vertex_size;
+    uint32_t            section_offset[WORLD_CACHE_SECTIONS_COUNT];
+    uint32_t            section_size[WORLD_CACHE_SECTIONS_COUNT];
+} world_cache_header_t, *world_cache_header_p;
+
+typedef struct world_cache_section_s
+{
+    uint8_t            *data;
+    uint32_t            size;
+    uint32_t            allocated;                  // recording only
+    uint32_t            pos;                        // loading only
+    int                 damaged;                    // loading only, section is accessed by one thread
+} world_cache_section_t, *world_cache_section_p;
+
+static struct
+{
+    char                    file_name[1024];
+    uint64_t                level_size;
+    uint64_t                level_mtime;
+    uint64_t                level_hash;
+    uint8_t                *buffer;                 // whole loaded cache file
+    uint32_t                buffer_size;
+    int                     mapped;                 // buffer is mapped file, not allocated
+    int                     loaded;
+    int                     recording;
+    world_cache_section_t   sections[WORLD_CACHE_SECTIONS_COUNT];
+} world_cache;
+
+
+static uint64_t WorldCache_Hash(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;                                    // FNV-1a 64
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+static uint8_t *WorldCache_ReadFile(const char *name, uint32_t size_limit, uint32_t *size)
+{
+    uint8_t *ret = NULL;
+    SDL_RWops *f = SDL_RWFromFile(name, "rb");
+
+    *size = 0;
+    if(f)
+    {
+        Sint64 file_size = SDL_RWsize(f);
+        file_size = (size_limit && (file_size > size_limit)) ? (size_limit) : (file_size);
+        if(file_size > 0)
+        {
+            ret = (uint8_t*)malloc(file_size);
+            if(SDL_RWread(f, ret, file_size, 1) == 1)
+            {
+                *size = file_size;
+            }
+            else
+            {
+                free(ret);
+                ret = NULL;
+            }
+        }
+        SDL_RWclose(f);
+    }
+
+    return ret;
+}
+
+
+/*
+ * Cache file is mapped where possible: sections are read right from the page
+ * cache and only touched pages are loaded.
+ */
+static uint8_t *WorldCache_MapFile(const char *name, uint32_t *size, int *mapped)
+{
+    *mapped = 0;
+#ifdef WORLD_CACHE_USE_MMAP
+    int fd = open(name, O_RDONLY);
+    if(fd >= 0)
+    {
+        struct stat st;
+        void *ret = MAP_FAILED;
+        if((fstat(fd, &st) == 0) && (st.st_size > 0) && ((uint64_t)st.st_size <= 0xFFFFFFFFU))
+        {
+            ret = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if(ret != MAP_FAILED)
+        {
+            *size = st.st_size;
+            *mapped = 1;
+            return (uint8_t*)ret;
+        }
+    }
+#endif
+    return WorldCache_ReadFile(name, 0, size);
+}
+
+
+static void WorldCache_FreeBuffer()
+{
+    if(world_cache.buffer)
+    {
+#ifdef WORLD_CACHE_USE_MMAP
+        if(world_cache.mapped)
+        {
+            munmap(world_cache.buffer, world_cache.buffer_size);
+        }
+        else
+#endif
+        {
+            free(world_cache.buffer);
+        }
+        world_cache.buffer = NULL;
+        world_cache.buffer_size = 0;
+        world_cache.mapped = 0;
+    }
+}
+
+
+/*
+ * Sections may be used from different threads (see World_Open stages), so
+ * damaged data only disables its own section; whole file is removed on close.
+ */
+static int WorldCache_IsSectionLoaded(int section)
+{
+    return world_cache.loaded && !world_cache.sections[section].damaged;
+}
+
+
+static void WorldCache_Invalidate(int section)
+{
+    if(WorldCache_IsSectionLoaded(section))
+    {
+        Sys_DebugLog(SYS_LOG_FILENAME, "world cache: \"%s\" is damaged, dropped", world_cache.file_name);
+        world_cache.sections[section].damaged = 1;
+    }
+}
+
+
+static const void *WorldCache_Read(int section, uint32_t size)
+{
+    world_cache_section_p s = world_cache.sections + section;
+    if(WorldCache_IsSectionLoaded(section) && (s->pos + size <= s->size))
+    {
+        const void *ret = s->data + s->pos;
+        s->pos += size;
+        return ret;
+    }
+
+    WorldCache_Invalidate(section);
+    return NULL;
+}
+
+
+static void WorldCache_Write(int section, const void *data, uint32_t size)
+{
+    world_cache_section_p s = world_cache.sections + section;
+    if(s->size + size > s->allocated)
+    {
+        s->allocated = (s->size + size > 2 * s->allocated) ? (s->size + size + 4096) : (2 * s->allocated);
+        s->data = (uint8_t*)realloc(s->data, s->allocated);
+    }
+    memcpy(s->data + s->size, data, size);
+    s->size += size;
+}
+
+
+static void WorldCache_Save()
+{
+    world_cache_header_t header;
+    SDL_RWops *f = SDL_RWFromFile(world_cache.file_name, "wb");
+
+    if(f == NULL)
+    {
+        Sys_DebugLog(SYS_LOG_FILENAME, "world cache: can not write \"%s\"", world_cache.file_name);
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = WORLD_CACHE_MAGIC;
+    header.version = WORLD_CACHE_VERSION;
+    header.level_size = world_cache.level_size;
+    header.level_mtime = world_cache.level_mtime;
+    header.level_hash = world_cache.level_hash;
+    header.tween_size = sizeof(sector_tween_t);
+    header.bone_tag_size = sizeof(bone_tag_t);
+    header.vertex_size = sizeof(vertex_t);
+    uint32_t offset = sizeof(header);
+    for(int i = 0; i < WORLD_CACHE_SECTIONS_COUNT; i++)
+    {
+        header.section_offset[i] = offset;
+        header.section_size[i] = world_cache.sections[i].size;
+        offset += world_cache.sections[i].size;
+    }
+
+    SDL_RWwrite(f, &header, sizeof(header), 1);
+    for(int i = 0; i < WORLD_CACHE_SECTIONS_COUNT; i++)
+    {
+        if(world_cache.sections[i].size > 0)
+        {
+            SDL_RWwrite(f, world_cache.sections[i].data, world_cache.sections[i].size, 1);
+        }
+    }
+    SDL_RWclose(f);
+
+    Sys_DebugLog(SYS_LOG_FILENAME, "world cache: saved \"%s\", %d bytes", world_cache.file_name, offset);
+}
+
+
+void WorldCache_Open(const char *level_name)
+{
+    struct stat st;
+    uint8_t *level_head;
+    uint32_t head_size;
+
+    WorldCache_Close();
+
+    // Full level hash costs as much as a part of the load, so key is size, time and head.
+    if(stat(level_name, &st) != 0)
+    {
+        return;
+    }
+    level_head = WorldCache_ReadFile(level_name, WORLD_CACHE_HASHED_HEAD, &head_size);
+    if(level_head == NULL)
+    {
+        return;
+    }
+    world_cache.level_size = st.st_size;
+    world_cache.level_mtime = st.st_mtime;
+    world_cache.level_hash = WorldCache_Hash(level_head, head_size);
+    free(level_head);
+
+    snprintf(world_cache.file_name, sizeof(world_cache.file_name), "%s.cache", level_name);
+    world_cache.buffer = WorldCache_MapFile(world_cache.file_name, &world_cache.buffer_size, &world_cache.mapped);
+    if(world_cache.buffer && (world_cache.buffer_size >= sizeof(world_cache_header_t)))
+    {
+        uint32_t size = world_cache.buffer_size;
+        world_cache_header_p header = (world_cache_header_p)world_cache.buffer;
+        world_cache.loaded = (header->magic == WORLD_CACHE_MAGIC) &&
+                             (header->version == WORLD_CACHE_VERSION) &&
+                             (header->level_size == world_cache.level_size) &&
+                             (header->level_mtime == world_cache.level_mtime) &&
+                             (header->level_hash == world_cache.level_hash) &&
+                             (header->tween_size == sizeof(sector_tween_t)) &&
+                             (header->bone_tag_size == sizeof(bone_tag_t)) &&
+                             (header->vertex_size == sizeof(vertex_t));
+        for(int i = 0; world_cache.loaded && (i < WORLD_CACHE_SECTIONS_COUNT); i++)
+        {
+            if((header->section_offset[i] > size) || (header->section_size[i] > size - header->section_offset[i]) ||
+               (header->section_offset[i] % sizeof(uint32_t)))
+            {
+                world_cache.loaded = 0;
+                break;
+            }
+            world_cache.sections[i].data = world_cache.buffer + header->section_offset[i];
+            world_cache.sections[i].size = header->section_size[i];
+            world_cache.sections[i].pos = 0;
+        }
+    }
+
+    if(world_cache.loaded)
+    {
+        Sys_DebugLog(SYS_LOG_FILENAME, "world cache: using \"%s\"", world_cache.file_name);
+    }
+    else
+    {
+        if(world_cache.buffer)
+        {
+            // Stale file is rewritten on close, so mapping must be released now.
+            Sys_DebugLog(SYS_LOG_FILENAME, "world cache: \"%s\" is stale, rebuilding", world_cache.file_name);
+            WorldCache_FreeBuffer();
+        }
+        memset(world_cache.sections, 0, sizeof(world_cache.sections));
+        world_cache.recording = 1;
+    }
+}
+
+
+void WorldCache_Close()
+{
+    if(world_cache.recording)
+    {
+        WorldCache_Save();
+    }
+    else if(world_cache.loaded)
+    {
+        for(int i = 0; i < WORLD_CACHE_SECTIONS_COUNT; i++)
+        {
+            if(world_cache.sections[i].damaged)
+            {
+                remove(world_cache.file_name);
+                break;
+            }
+        }
+    }
+
+    for(int i = 0; i < WORLD_CACHE_SECTIONS_COUNT; i++)
+    {
+        if(world_cache.buffer == NULL)
+        {
+            free(world_cache.sections[i].data);
+        }
+        world_cache.sections[i].data = NULL;
+        world_cache.sections[i].size = 0;
+        world_cache.sections[i].allocated = 0;
+        world_cache.sections[i].pos = 0;
+        world_cache.sections[i].damaged = 0;
+    }
+
+    WorldCache_FreeBuffer();
+    world_cache.loaded = 0;
+    world_cache.recording = 0;
+}
+
+
+int  WorldCache_IsLoaded()
+{
+    return world_cache.loaded;
+}
+
+/*
+ * Model record: model_index, animation_count, then per animation: frames_count,
+ * then per frame: bone_tag_count, bone_frame floats, bone tags.
+ */
+int  WorldCache_GetModelFrames(struct skeletal_model_s *model, uint32_t model_index)
+{
+    world_cache_section_p s = world_cache.sections + WORLD_CACHE_SECTION_FRAMES;
+    const uint32_t *begin, *end, *p;
+
+    if(!WorldCache_IsSectionLoaded(WORLD_CACHE_SECTION_FRAMES))
+    {
+        return 0;
+    }
+
+    // Whole record is checked before model is touched.
+    begin = p = (const uint32_t*)(s->data + s->pos);
+    end = (const uint32_t*)(s->data + s->size);
+    if((end - p < 2) || (p[0] != model_index) || (p[1] != model->animation_count))
+    {
+        WorldCache_Invalidate(WORLD_CACHE_SECTION_FRAMES);
+        return 0;
+    }
+    p += 2;
+    for(uint16_t i = 0; i < model->animation_count; i++)
+    {
+        uint32_t frames_count = (p < end) ? (*p++) : (0xFFFFFFFF);
+        if(frames_count > 0xFFFF)
+        {
+            WorldCache_Invalidate(WORLD_CACHE_SECTION_FRAMES);
+            return 0;
+        }
+        for(uint32_t j = 0; j < frames_count; j++)
+        {
+            if((p >= end) || (*p > 0xFFFF) || ((uint32_t)(end - p) < 1 + 12 + *p * sizeof(bone_tag_t) / sizeof(uint32_t)))
+            {
+                WorldCache_Invalidate(WORLD_CACHE_SECTION_FRAMES);
+                return 0;
+            }
+            p += 1 + 12 + *p * sizeof(bone_tag_t) / sizeof(uint32_t);
+        }
+    }
+    s->pos += (p - begin) * sizeof(uint32_t);
+
+    p = begin + 2;
+    animation_frame_p anim = model->animations;
+    for(uint16_t i = 0; i < model->animation_count; i++, anim++)
+    {
+        for(uint16_t j = 0; j < anim->frames_count; j++)
+        {
+            if(anim->frames[j].bone_tag_count)
+            {
+                free(anim->frames[j].bone_tags);
+            }
+        }
+        free(anim->frames);
+        anim->frames_count = *p++;
+        anim->frames = (bone_frame_p)calloc(anim->frames_count, sizeof(bone_frame_t));
+
+        bone_frame_p bf = anim->frames;
+        for(uint16_t j = 0; j < anim->frames_count; j++, bf++)
+        {
+            const float *v = (const float*)(p + 1);
+            bf->bone_tag_count = *p;
+            vec3_copy(bf->pos, v + 0);
+            vec3_copy(bf->bb_min, v + 3);
+            vec3_copy(bf->bb_max, v + 6);
+            vec3_copy(bf->centre, v + 9);
+            p += 1 + 12;
+            if(bf->bone_tag_count)
+            {
+                bf->bone_tags = (bone_tag_p)malloc(bf->bone_tag_count * sizeof(bone_tag_t));
+                memcpy(bf->bone_tags, p, bf->bone_tag_count * sizeof(bone_tag_t));
+                p += bf->bone_tag_count * sizeof(bone_tag_t) / sizeof(uint32_t);
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+void WorldCache_PutModelFrames(struct skeletal_model_s *model, uint32_t model_index)
+{
+    if(!world_cache.recording)
+    {
+        return;
+    }
+
+    uint32_t head[2] = {model_index, model->animation_count};
+    WorldCache_Write(WORLD_CACHE_SECTION_FRAMES, head, sizeof(head));
+
+    animation_frame_p anim = model->animations;
+    for(uint16_t i = 0; i < model->animation_count; i++, anim++)
+    {
+        uint32_t frames_count = anim->frames_count;
+        WorldCache_Write(WORLD_CACHE_SECTION_FRAMES, &frames_count, sizeof(uint32_t));
+
+        bone_frame_p bf = anim->frames;
+        for(uint16_t j = 0; j < anim->frames_count; j++, bf++)
+        {
+            uint32_t bone_tag_count = bf->bone_tag_count;
+            float v[12];
+            vec3_copy(v + 0, bf->pos);
+            vec3_copy(v + 3, bf->bb_min);
+            vec3_copy(v + 6, bf->bb_max);
+            vec3_copy(v + 9, bf->centre);
+            WorldCache_Write(WORLD_CACHE_SECTION_FRAMES, &bone_tag_count, sizeof(uint32_t));
+            WorldCache_Write(WORLD_CACHE_SECTION_FRAMES, v, sizeof(v));
+            WorldCache_Write(WORLD_CACHE_SECTION_FRAMES, bf->bone_tags, bone_tag_count * sizeof(bone_tag_t));
+        }
+    }
+}
+
+/*
+ * Room lists record: rooms count, overlapped and near lists sizes of each room,
+ * then rooms indexes of all lists in World_GenRoomLists() storage order.
+ */
+struct room_s **WorldCache_GetRoomLists(struct room_s *rooms, uint32_t rooms_count, uint32_t *storage_size)
+{
+    const uint32_t *head, *sizes, *indexes;
+    uint32_t count = 0;
+    room_p *storage, *list;
+
+    if(!WorldCache_IsSectionLoaded(WORLD_CACHE_SECTION_ROOM_LISTS) ||
+       ((head = (const uint32_t*)WorldCache_Read(WORLD_CACHE_SECTION_ROOM_LISTS, sizeof(uint32_t))) == NULL))
+    {
+        return NULL;
+    }
+
+    if((*head != rooms_count) ||
+       ((sizes = (const uint32_t*)WorldCache_Read(WORLD_CACHE_SECTION_ROOM_LISTS, 2 * rooms_count * sizeof(uint32_t))) == NULL))
+    {
+        WorldCache_Invalidate(WORLD_CACHE_SECTION_ROOM_LISTS);
+        return NULL;
+    }
+
+    for(uint32_t i = 0; i < 2 * rooms_count; i++)
+    {
+        if(sizes[i] > 0xFFFF)
+        {
+            WorldCache_Invalidate(WORLD_CACHE_SECTION_ROOM_LISTS);
+            return NULL;
+        }
+        count += sizes[i];
+    }
+
+    if((indexes = (const uint32_t*)WorldCache_Read(WORLD_CACHE_SECTION_ROOM_LISTS, count * sizeof(uint32_t))) == NULL)
+    {
+        return NULL;
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(indexes[i] >= rooms_count)
+        {
+            WorldCache_Invalidate(WORLD_CACHE_SECTION_ROOM_LISTS);
+            return NULL;
+        }
+    }
+
+    list = storage = (room_p*)malloc((count + 1) * sizeof(room_p));
+    for(uint32_t i = 0; i < count; i++)
+    {
+        storage[i] = rooms + indexes[i];
+    }
+
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        room_p room = rooms + i;
+        room->overlapped_room_list_size = sizes[2 * i + 0];
+        room->overlapped_room_list = (room->overlapped_room_list_size > 0) ? (list) : (NULL);
+        list += room->overlapped_room_list_size;
+        room->near_room_list_size = sizes[2 * i + 1];
+        room->near_room_list = (room->near_room_list_size > 0) ? (list) : (NULL);
+        list += room->near_room_list_size;
+    }
+
+    *storage_size = count;
+    return storage;
+}
+
+
+void WorldCache_PutRoomLists(struct room_s *rooms, uint32_t rooms_count)
+{
+    if(!world_cache.recording)
+    {
+        return;
+    }
+
+    WorldCache_Write(WORLD_CACHE_SECTION_ROOM_LISTS, &rooms_count, sizeof(uint32_t));
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        uint32_t sizes[2] = {rooms[i].overlapped_room_list_size, rooms[i].near_room_list_size};
+        WorldCache_Write(WORLD_CACHE_SECTION_ROOM_LISTS, sizes, sizeof(sizes));
+    }
+    for(uint32_t i = 0; i < rooms_count; i++)
+    {
+        for(uint16_t j = 0; j < rooms[i].overlapped_room_list_size; j++)
+        {
+            uint32_t index = rooms[i].overlapped_room_list[j] - rooms;
+            WorldCache_Write(WORLD_CACHE_SECTION_ROOM_LISTS, &index, sizeof(uint32_t));
+        }
+        for(uint16_t j = 0; j < rooms[i].near_room_list_size; j++)
+        {
+            uint32_t index = rooms[i].near_room_list[j] - rooms;
+            WorldCache_Write(WORLD_CACHE_SECTION_ROOM_LISTS, &index, sizeof(uint32_t));
+        }
+    }
+}
+
+
+/*
+ * Room PVS record: rooms count, row size (in words), rows of all rooms.
+ */
+uint32_t *WorldCache_GetRoomPVS(uint32_t rooms_count, uint32_t row_size)
+{
+    const uint32_t *head, *rows;
+    uint32_t *ret;
+
+    if(!WorldCache_IsSectionLoaded(WORLD_CACHE_SECTION_ROOM_PVS) ||
+       ((head = (const uint32_t*)WorldCache_Read(WORLD_CACHE_SECTION_ROOM_PVS, 2 * sizeof(uint32_t))) == NULL))
+    {
+        return NULL;
+    }
+
+    if((head[0] != rooms_count) || (head[1] != row_size) ||
+       ((rows = (const uint32_t*)WorldCache_Read(WORLD_CACHE_SECTION_ROOM_PVS, rooms_count * row_size * sizeof(uint32_t))) == NULL))
+    {
+        WorldCache_Invalidate(WORLD_CACHE_SECTION_ROOM_PVS);
+        return NULL;
+    }
+
+    ret = (uint32_t*)malloc(rooms_count * row_size * sizeof(uint32_t));
+    memcpy(ret, rows, rooms_count * row_size * sizeof(uint32_t));
+    return ret;
+}
+
+
+void WorldCache_PutRoomPVS(const uint32_t *pvs, uint32_t rooms_count, uint32_t row_size)
+{
+    if(!world_cache.recording)
+    {
+        return;
+    }
+
+    uint32_t head[2] = {rooms_count, row_size};
+    WorldCache_Write(WORLD_CACHE_SECTION_ROOM_PVS, head, sizeof(head));
+    WorldCache_Write(WORLD_CACHE_SECTION_ROOM_PVS, pvs, rooms_count * row_size * sizeof(uint32_t));
+}
+
+
+/*
+ * Tweens record: room index, tweens count, tweens.
+ */
+int  WorldCache_GetRoomTweens(uint32_t room_index, struct sector_tween_s *tweens, int max_tweens)
+{
+    const uint32_t *head;
+    const void *data;
+
+    if(!WorldCache_IsSectionLoaded(WORLD_CACHE_SECTION_TWEENS) || ((head = (const uint32_t*)WorldCache_Read(WORLD_CACHE_SECTION_TWEENS, 2 * sizeof(uint32_t))) == NULL))
+    {
+        return -1;
+    }
+
+    if((head[0] != room_index) || (head[1] > (uint32_t)max_tweens) ||
+       ((data = WorldCache_Read(WORLD_CACHE_SECTION_TWEENS, head[1] * sizeof(sector_tween_t))) == NULL))
+    {
+        WorldCache_Invalidate(WORLD_CACHE_SECTION_TWEENS);
+        return -1;
+    }
+
+    memcpy(tweens, data, head[1] * sizeof(sector_tween_t));
+    return head[1];
+}
+
+
+void WorldCache_PutRoomTweens(uint32_t room_index, struct sector_tween_s *tweens, int num_tweens)
+{
+    if(!world_cache.recording)
+    {
+        return;
+    }
+
+    uint32_t head[2] = {room_index, (uint32_t)num_tweens};
+    WorldCache_Write(WORLD_CACHE_SECTION_TWEENS, head, sizeof(head));
+    WorldCache_Write(WORLD_CACHE_SECTION_TWEENS, tweens, num_tweens * sizeof(sector_tween_t));
+}
+
+
+/*
+ * Texture atlas record: layout words of bordered_texture_atlas::saveLayout.
+ * Pixels are not stored, pages are composed from the level textiles.
+ * Cached meshes keep UVs and pages of that layout, so if atlas is rebuilt
+ * (other border or GL max texture size), mesh sections are dropped too.
+ */
+class bordered_texture_atlas *WorldCache_GetTexAtlas(int border, class VT_Level *tr)
+{
+    world_cache_section_p s = world_cache.sections + WORLD_CACHE_SECTION_TEX_ATLAS;
+    bordered_texture_atlas *atlas = NULL;
+
+    if(WorldCache_IsSectionLoaded(WORLD_CACHE_SECTION_TEX_ATLAS))
+    {
+        atlas = new bordered_texture_atlas(border, tr->textile32_count, tr->textile32,
+                                           tr->object_textures_count, tr->sprite_textures_count,
+                                           (const uint32_t*)s->data, s->size);
+        if(atlas->getNumAtlasPages() == 0)
+        {
+            delete atlas;
+            atlas = NULL;
+        }
+    }
+
+    if(atlas == NULL)
+    {
+        WorldCache_Invalidate(WORLD_CACHE_SECTION_TEX_ATLAS);
+        WorldCache_Invalidate(WORLD_CACHE_SECTION_MESHES);
+        WorldCache_Invalidate(WORLD_CACHE_SECTION_ROOM_MESHES);
+    }
+
+    return atlas;
+}
+
+
+void WorldCache_PutTexAtlas(const class bordered_texture_atlas *atlas)
+{
+    if(!world_cache.recording)
+    {
+        return;
+    }
+
+    uint32_t *layout = (uint32_t*)malloc(atlas->getLayoutSize());
+    atlas->saveLayout(layout);
+    WorldCache_Write(WORLD_CACHE_SECTION_TEX_ATLAS, layout, atlas->getLayoutSize());
+    free(layout);
+}
+
+/*
+ * Mesh record: index, presence flag, polygons, vertices and faces counts,
+ * centre, bb_min, bb_max, radius; then per polygon: vertex_count, texture page,
+ * anim_id, frame_offset, transparency, double_side, plane, vertices; then
+ * vertices; then per face: texture page, elements_count, elements.
+ */
+#define WORLD_CACHE_MESH_HEAD_SIZE      (5)
+#define WORLD_CACHE_POLYGON_HEAD_SIZE   (10)
+
+static uint32_t WorldCache_TexturePage(GLuint texture, const uint32_t *textures, uint32_t tex_count)
+{
+    for(uint32_t i = 0; i < tex_count; i++)
+    {
+        if(textures[i] == texture)
+        {
+            return i;
+        }
+    }
+    return 0xFFFFFFFF;
+}
+
+
+static int WorldCache_ReadMeshData(int section, struct base_mesh_s *mesh, const uint32_t *head, const uint32_t *textures, uint32_t tex_count)
+{
+    world_cache_section_p s = world_cache.sections + section;
+    const uint32_t *p;
+    const float *v;
+
+    // Counts are checked against the record room before anything is allocated.
+    if((uint64_t)head[2] * WORLD_CACHE_POLYGON_HEAD_SIZE * sizeof(uint32_t) + (uint64_t)head[3] * sizeof(vertex_t) +
+       (uint64_t)head[4] * 2 * sizeof(uint32_t) > s->size - s->pos)
+    {
+        return 0;
+    }
+
+    if((v = (const float*)WorldCache_Read(section, 10 * sizeof(float))) == NULL)
+    {
+        return 0;
+    }
+    vec3_copy(mesh->centre, v + 0);
+    vec3_copy(mesh->bb_min, v + 3);
+    vec3_copy(mesh->bb_max, v + 6);
+    mesh->radius = v[9];
+
+    mesh->polygons_count = head[2];
+    mesh->polygons = Polygon_CreateArray(mesh->polygons_count);
+    polygon_p poly = mesh->polygons;
+    for(uint32_t i = 0; i < mesh->polygons_count; i++, poly++)
+    {
+        if(((p = (const uint32_t*)WorldCache_Read(section, WORLD_CACHE_POLYGON_HEAD_SIZE * sizeof(uint32_t))) == NULL) ||
+           (p[0] > 0xFFFF) || (p[1] >= tex_count))
+        {
+            return 0;
+        }
+        const void *vertices = WorldCache_Read(section, p[0] * sizeof(vertex_t));
+        if(vertices == NULL)
+        {
+            return 0;
+        }
+        Polygon_Resize(poly, p[0]);
+        memcpy(poly->vertices, vertices, p[0] * sizeof(vertex_t));
+        poly->texture_index = textures[p[1]];
+        poly->anim_id = p[2];
+        poly->frame_offset = p[3];
+        poly->transparency = p[4];
+        poly->double_side = p[5];
+        vec4_copy(poly->plane, (const float*)(p + 6));
+    }
+
+    mesh->vertex_count = head[3];
+    if(mesh->vertex_count)
+    {
+        const void *vertices = WorldCache_Read(section, mesh->vertex_count * sizeof(vertex_t));
+        if(vertices == NULL)
+        {
+            return 0;
+        }
+        mesh->vertices = (vertex_p)malloc(mesh->vertex_count * sizeof(vertex_t));
+        memcpy(mesh->vertices, vertices, mesh->vertex_count * sizeof(vertex_t));
+    }
+
+    mesh->faces_count = head[4];
+    mesh->faces = (mesh->faces_count) ? ((mesh_face_p)calloc(mesh->faces_count, sizeof(mesh_face_t))) : (NULL);
+    for(uint32_t i = 0; i < mesh->faces_count; i++)
+    {
+        mesh_face_p face = mesh->faces + i;
+        if(((p = (const uint32_t*)WorldCache_Read(section, 2 * sizeof(uint32_t))) == NULL) || (p[0] >= tex_count))
+        {
+            return 0;
+        }
+        face->texture_index = textures[p[0]];
+        const uint32_t *elements = (const uint32_t*)WorldCache_Read(section, p[1] * sizeof(uint32_t));
+        if(elements == NULL)
+        {
+            return 0;
+        }
+        face->elements_count = p[1];
+        face->elements = (GLuint*)malloc(face->elements_count * sizeof(GLuint));
+        for(uint32_t j = 0; j < face->elements_count; j++)
+        {
+            if(elements[j] >= mesh->vertex_count)
+            {
+                return 0;
+            }
+            face->elements[j] = elements[j];
+        }
+    }
+
+    return 1;
+}
+
+
+static int WorldCache_ReadMesh(int section, struct base_mesh_s **mesh, uint32_t index, const uint32_t *textures, uint32_t tex_count)
+{
+    const uint32_t *head;
+    struct base_mesh_s *new_mesh;
+
+    if(!WorldCache_IsSectionLoaded(section) ||
+       ((head = (const uint32_t*)WorldCache_Read(section, WORLD_CACHE_MESH_HEAD_SIZE * sizeof(uint32_t))) == NULL))
+    {
+        return 0;
+    }
+
+    if((head[0] != index) || (head[1] > 1))
+    {
+        WorldCache_Invalidate(section);
+        return 0;
+    }
+
+    if(head[1] == 0)
+    {
+        *mesh = NULL;
+        return 1;
+    }
+
+    new_mesh = (*mesh) ? (*mesh) : ((struct base_mesh_s*)calloc(1, sizeof(base_mesh_t)));
+    new_mesh->id = index;
+    if(!WorldCache_ReadMeshData(section, new_mesh, head, textures, tex_count))
+    {
+        WorldCache_Invalidate(section);
+        BaseMesh_Clear(new_mesh);
+        if(*mesh == NULL)
+        {
+            free(new_mesh);
+        }
+        return 0;
+    }
+
+    *mesh = new_mesh;
+    return 1;
+}
+
+
+static void WorldCache_WriteMesh(int section, struct base_mesh_s *mesh, uint32_t index, const uint32_t *textures, uint32_t tex_count)
+{
+    uint32_t head[WORLD_CACHE_MESH_HEAD_SIZE] = {index, 0, 0, 0, 0};
+
+    if(mesh == NULL)
+    {
+        WorldCache_Write(section, head, sizeof(head));
+        return;
+    }
+
+    head[1] = 1;
+    head[2] = mesh->polygons_count;
+    head[3] = mesh->vertex_count;
+    head[4] = mesh->faces_count;
+    WorldCache_Write(section, head, sizeof(head));
+
+    float v[10];
+    vec3_copy(v + 0, mesh->centre);
+    vec3_copy(v + 3, mesh->bb_min);
+    vec3_copy(v + 6, mesh->bb_max);
+    v[9] = mesh->radius;
+    WorldCache_Write(section, v, sizeof(v));
+
+    polygon_p poly = mesh->polygons;
+    for(uint32_t i = 0; i < mesh->polygons_count; i++, poly++)
+    {
+        uint32_t p[WORLD_CACHE_POLYGON_HEAD_SIZE];
+        p[0] = poly->vertex_count;
+        p[1] = WorldCache_TexturePage(poly->texture_index, textures, tex_count);
+        p[2] = poly->anim_id;
+        p[3] = poly->frame_offset;
+        p[4] = poly->transparency;
+        p[5] = poly->double_side;
+        memcpy(p + 6, poly->plane, 4 * sizeof(float));
+        WorldCache_Write(section, p, sizeof(p));
+        WorldCache_Write(section, poly->vertices, poly->vertex_count * sizeof(vertex_t));
+    }
+
+    WorldCache_Write(section, mesh->vertices, mesh->vertex_count * sizeof(vertex_t));
+
+    for(uint32_t i = 0; i < mesh->faces_count; i++)
+    {
+        uint32_t f[2] = {WorldCache_TexturePage(mesh->faces[i].texture_index, textures, tex_count), mesh->faces[i].elements_count};
+        WorldCache_Write(section, f, sizeof(f));
+        WorldCache_Write(section, mesh->faces[i].elements, f[1] * sizeof(GLuint));
+    }
+}
+
+
+int  WorldCache_GetMesh(struct base_mesh_s *mesh, uint32_t mesh_index, const uint32_t *textures, uint32_t tex_count)
+{
+    // Model meshes always exist, so "no mesh" record is damaged data here.
+    struct base_mesh_s *ret = mesh;
+    if(WorldCache_ReadMesh(WORLD_CACHE_SECTION_MESHES, &ret, mesh_index, textures, tex_count))
+    {
+        if(ret)
+        {
+            return 1;
+        }
+        WorldCache_Invalidate(WORLD_CACHE_SECTION_MESHES);
+    }
+    return 0;
+}
+
+
+void WorldCache_PutMesh(struct base_mesh_s *mesh, uint32_t mesh_index, const uint32_t *textures, uint32_t tex_count)
+{
+    if(world_cache.recording)
+    {
+        WorldCache_WriteMesh(WORLD_CACHE_SECTION_MESHES, mesh, mesh_index, textures, tex_count);
+    }
+}
+
+
+int  WorldCache_GetRoomMesh(struct room_s *room, uint32_t room_index, const uint32_t *textures, uint32_t tex_count)
+{
+    room->content->mesh = NULL;
+    return WorldCache_ReadMesh(WORLD_CACHE_SECTION_ROOM_MESHES, &room->content->mesh, room_index, textures, tex_count);
+}
+
+
+void WorldCache_PutRoomMesh(struct room_s *room, uint32_t room_index, const uint32_t *textures, uint32_t tex_count)
+{
+    if(world_cache.recording)
+    {
+        WorldCache_WriteMesh(WORLD_CACHE_SECTION_ROOM_MESHES, room->content->mesh, room_index, textures, tex_count);
+    }
+}
+
+/*
+ * Sectors record: room index, sectors count, then per sector: flags, packed
+ * diagonal types and penetration configs, portal / below / above rooms
+ * indexes, ceiling corners, floor corners.
+ */
+#define WORLD_CACHE_SECTOR_SIZE         (5 + 12 + 12)
+
+static uint32_t WorldCache_RoomIndex(struct room_s *rooms, struct room_s *room)
+{
+    return (room) ? ((uint32_t)(room - rooms)) : (0xFFFFFFFF);
+}
+
+
+int  WorldCache_GetRoomSectors(struct room_s *rooms, uint32_t rooms_count, uint32_t room_index)
+{
+    room_p room = rooms + room_index;
+    const uint32_t *head, *p;
+
+    if(!WorldCache_IsSectionLoaded(WORLD_CACHE_SECTION_SECTORS) ||
+       ((head = (const uint32_t*)WorldCache_Read(WORLD_CACHE_SECTION_SECTORS, 2 * sizeof(uint32_t))) == NULL))
+    {
+        return 0;
+    }
+
+    if((head[0] != room_index) || (head[1] != room->sectors_count) ||
+       ((p = (const uint32_t*)WorldCache_Read(WORLD_CACHE_SECTION_SECTORS, head[1] * WORLD_CACHE_SECTOR_SIZE * sizeof(uint32_t))) == NULL))
+    {
+        WorldCache_Invalidate(WORLD_CACHE_SECTION_SECTORS);
+        return 0;
+    }
+
+    for(uint32_t i = 0; i < room->sectors_count; i++)
+    {
+        const uint32_t *rec = p + i * WORLD_CACHE_SECTOR_SIZE;
+        for(int j = 2; j < 5; j++)
+        {
+            if((rec[j] != 0xFFFFFFFF) && (rec[j] >= rooms_count))
+            {
+                WorldCache_Invalidate(WORLD_CACHE_SECTION_SECTORS);
+                return 0;
+            }
+        }
+    }
+
+    room_sector_p sector = room->sectors;
+    for(uint32_t i = 0; i < room->sectors_count; i++, sector++, p += WORLD_CACHE_SECTOR_SIZE)
+    {
+        const float *v = (const float*)(p + 5);
+        sector->flags = p[0];
+        sector->ceiling_diagonal_type      = (p[1] >>  0) & 0xFF;
+        sector->ceiling_penetration_config = (p[1] >>  8) & 0xFF;
+        sector->floor_diagonal_type        = (p[1] >> 16) & 0xFF;
+        sector->floor_penetration_config   = (p[1] >> 24) & 0xFF;
+        sector->portal_to_room = (p[2] != 0xFFFFFFFF) ? (rooms + p[2]) : (NULL);
+        sector->room_below     = (p[3] != 0xFFFFFFFF) ? (rooms + p[3]) : (NULL);
+        sector->room_above     = (p[4] != 0xFFFFFFFF) ? (rooms + p[4]) : (NULL);
+        memcpy(sector->ceiling_corners, v, 12 * sizeof(float));
+        memcpy(sector->floor_corners, v + 12, 12 * sizeof(float));
+    }
+
+    return 1;
+}
+
+
+void WorldCache_PutRoomSectors(struct room_s *rooms, uint32_t rooms_count, uint32_t room_index)
+{
+    if(!world_cache.recording)
+    {
+        return;
+    }
+
+    room_p room = rooms + room_index;
+    uint32_t head[2] = {room_index, room->sectors_count};
+    WorldCache_Write(WORLD_CACHE_SECTION_SECTORS, head, sizeof(head));
+
+    room_sector_p sector = room->sectors;
+    for(uint32_t i = 0; i < room->sectors_count; i++, sector++)
+    {
+        uint32_t rec[WORLD_CACHE_SECTOR_SIZE];
+        rec[0] = sector->flags;
+        rec[1] = (uint32_t)sector->ceiling_diagonal_type | ((uint32_t)sector->ceiling_penetration_config << 8) |
+                 ((uint32_t)sector->floor_diagonal_type << 16) | ((uint32_t)sector->floor_penetration_config << 24);
+        rec[2] = WorldCache_RoomIndex(rooms, sector->portal_to_room);
+        rec[3] = WorldCache_RoomIndex(rooms, sector->room_below);
+        rec[4] = WorldCache_RoomIndex(rooms, sector->room_above);
+        memcpy(rec + 5, sector->ceiling_corners, 12 * sizeof(float));
+        memcpy(rec + 17, sector->floor_corners, 12 * sizeof(float));
+        WorldCache_Write(WORLD_CACHE_SECTION_SECTORS, rec, sizeof(rec));
+    }
+}
@@ -0,0 +1,61 @@
+
+#ifndef WORLD_CACHE_H
+#define WORLD_CACHE_H
+
+#include <stdint.h>
+
+/*
+ * Binary cache of data derived from the level file by World_Open.
+ * Cache file is stored next to level file (LEVEL.EXT.cache) and keyed by
+ * level file size, modification time, hash of the level file head and
+ * WORLD_CACHE_VERSION; if key does not match, cache is ignored and
+ * regenerated. All data is stored as offsets / indexes (textures as atlas
+ * pages), so blob is used right from the mapped file.
+ */
+
+#define WORLD_CACHE_MAGIC           (0x4357544F)        // "OTWC"
+#define WORLD_CACHE_VERSION         (4)
+#define WORLD_CACHE_HASHED_HEAD     (64 * 1024)         // level file bytes hashed for the key
+
+struct skeletal_model_s;
+struct base_mesh_s;
+struct room_s;
+struct sector_tween_s;
+class  bordered_texture_atlas;
+class  VT_Level;
+
+void WorldCache_Open(const char *level_name);           // load cache or start recording of a new one
+void WorldCache_Close();                                // save recorded cache (if any) and free data
+int  WorldCache_IsLoaded();
+
+/*
+ * Getters return 1 (tweens getter - number of tweens, room lists getter -
+ * lists storage) if data was taken from cache; else 0 (-1, NULL) and data
+ * must be generated and passed to Put* function.
+ */
+int  WorldCache_GetModelFrames(struct skeletal_model_s *model, uint32_t model_index);
+void WorldCache_PutModelFrames(struct skeletal_model_s *model, uint32_t model_index);
+struct room_s **WorldCache_GetRoomLists(struct room_s *rooms, uint32_t rooms_count, uint32_t *storage_size);
+void WorldCache_PutRoomLists(struct room_s *rooms, uint32_t rooms_count);
+uint32_t *WorldCache_GetRoomPVS(uint32_t rooms_count, uint32_t row_size);
+void WorldCache_PutRoomPVS(const uint32_t *pvs, uint32_t rooms_count, uint32_t row_size);
+int  WorldCache_GetRoomTweens(uint32_t room_index, struct sector_tween_s *tweens, int max_tweens);
+void WorldCache_PutRoomTweens(uint32_t room_index, struct sector_tween_s *tweens, int num_tweens);
+
+/*
+ * Atlas getter returns laid out atlas or NULL (then cached meshes are not
+ * used, they depend on the atlas layout); meshes getters fill polygons,
+ * vertices, static faces and bounds (room mesh may be NULL), animated faces
+ * and VBO must be generated by BaseMesh_GenAnimatedFaces. Sectors getter
+ * fills geometry, flags and rooms links; triggers are not cached.
+ */
+class bordered_texture_atlas *WorldCache_GetTexAtlas(int border, class VT_Level *tr);
+void WorldCache_PutTexAtlas(const class bordered_texture_atlas *atlas);
+int  WorldCache_GetMesh(struct base_mesh_s *mesh, uint32_t mesh_index, const uint32_t *textures, uint32_t tex_count);
+void WorldCache_PutMesh(struct base_mesh_s *mesh, uint32_t mesh_index, const uint32_t *textures, uint32_t tex_count);
+int  WorldCache_GetRoomMesh(struct room_s *room, uint32_t room_index, const uint32_t *textures, uint32_t tex_count);
+void WorldCache_PutRoomMesh(struct room_s *room, uint32_t room_index, const uint32_t *textures, uint32_t tex_count);
+int  WorldCache_GetRoomSectors(struct room_s *rooms, uint32_t rooms_count, uint32_t room_index);
+void WorldCache_PutRoomSectors(struct room_s *rooms, uint32_t rooms_count, uint32_t room_index);
+
+#endif